@@ -33,17 +33,16 @@
 #include <vector>                       // vector used to keep list of input images
 #include <stdio.h>
 #include "fitsio.h"
+#include "../implement/rmLib/rmFITSmerge.h"	 // parallel merge of 2-D images
 
 
 using namespace std;
 
 
 void readList(const string &listfilename, vector<string> &list);
-bool checkFiles(const vector<string> &list);
 void merge2Dto3D(const vector<string> &list, const string  
 				 &outfilename);
 void preemptivelyDeleteFITS(const string &filename);
-void correctFreqHeader(vector<string> &list, vector<double> &freqs);
 void readPlane(fitsfile *fptr, float *plane, const unsigned long z, void *nulval, int &fitsstatus);
 void writePlane (fitsfile *fptr, float *plane, const long x, const  
 				 long y, const long z, void *nulval, int  &fitsstatus);
@@ -115,154 +114,23 @@ void readList(const string &listfilename, vector<string> &list)
 /*!
  \brief Merge a list of 2D images into a 3-D cube
  
+ Images are validated and read in parallel and written in list order, the
+ frequency axis is taken from the input headers (RM::rmFITSmerge).
+
  \param list - vector containing a list of 2-D FITS files
  \param outfilename - filename of 3-D FITS file to be created
- // \param freqlist - text file the frequencies of the input files is written to
  */
 void merge2Dto3D(const vector<string> &list, const string  
 				 &outfilename)
 {
-	fitsfile *infptr=NULL, *outfptr=NULL;                           // fileptr for current input  and (one) output file
-	//      ofstream outfile(const_cast<const char*>(freqlist.c_str()),  ofstream::out); // output filestream to create frequency list file
-	int fitsstatus=0;                                                                       // status returned from cfitsio functions
-	int naxis=0;													// number of axes for output image
-	long *naxes;													// array holding dimensions for each axis
-	float nulval;													// null value to be used if nan is encountered in FITS file
-	char errortext[255];											// char string to contain fits error message
-	
 	// Check input parameters
 	if(list.size()==0)
 		throw "fitsmerge::merge2Dto3D file list has length 0";
 	if(outfilename=="")
 		throw "fitsmerge::merge2Dto3D no filename given";
 	
-	//-----------------------------------------------
-	checkFiles(list);		
-	
-	fits_open_image(&infptr, list[0].c_str(), READONLY, &fitsstatus);
-	fits_get_img_dim(infptr, &naxis, &fitsstatus);
-	
-	// Prepare creation of 3D FITS image
-	naxis=3;
-	naxes=new long[naxis];
-	fits_get_img_size(infptr, naxis, naxes, &fitsstatus);					// check  img  dimensions of input FITS
-	
-	naxes[2]=list.size();                   // Length of list = z-axis of output  FITS
- 	
-	fits_create_file(&outfptr, outfilename.c_str(),  &fitsstatus);      // create output fits image
-	if(fitsstatus)
-	{
-		fits_get_errstatus(fitsstatus, errortext);	
-		cout << "fitserror: " << errortext << endl;
-		throw "fitsmerge::merge2Dto3D could not create output file";    //  throw exception
-	}
-	
-	// Create the primary array image (32-bit float pixels)
-	fits_create_img(outfptr, FLOAT_IMG, naxis, naxes, &fitsstatus);
-	if(fitsstatus)
-	{
-		fits_get_errstatus(fitsstatus, errortext);	
-		cout << "fitserror: " << errortext << endl;
-		throw "fitsmerge::merge2Dto3D could not create image extension";    //  throw exception
-	}
-	
-	if(fitsstatus)
-	{
-		fits_get_errstatus(fitsstatus, errortext);	
-		cout << "fitserror: " << errortext << endl;
-		throw "fitsmerge::merge2Dto3D could not copy header from source to destination";    //  throw exception
-	}
-	
-	float *plane=new float[naxes[0]*naxes[1]]; 	// create buffer to read plane into
-	
-	nulval=0.0; // set nulval
-	
-	// Loop over list and copy 2-D FITS files into output file
-	for(unsigned long int i=0; i<list.size(); i++)
-	{
-		fits_open_image(&infptr, list[i].c_str(), READONLY , &fitsstatus);			// update infptr
-		
-		cout << "i = " << i << "\t" << list[i].c_str() << "\t" << fits_file_name(infptr, errortext, &fitsstatus) << endl;
-		
-		readPlane(infptr, plane, 1, &nulval, fitsstatus);							// read plane from input file: FITS start with index 1!							
-		
-		writePlane(outfptr, plane, naxes[0], naxes[1], i+1, &nulval, fitsstatus);	// write to i-th plane in output file
-		
-		fits_close_file(infptr, &fitsstatus);
-	}
-	
-	// Close input and output files
-	//        fits_close_file(infptr, &fitsstatus);
-	fits_close_file(outfptr, &fitsstatus);
-    //    outfile.close();
-	delete[] naxes;
-	delete[] plane;
-}
-
-
-
-/*!
- \brief Check images for consistency
- 
- \param &list - vector containing list of FITS files
-*/
-bool checkFiles(const vector<string> &list)
-{
-  fitsfile *infptr=NULL;											// fileptr for current input file
-  //      ofstream outfile(const_cast<const char*>(freqlist.c_str()),  ofstream::out); // output filestream to create frequency list file
-  int fitsstatus=0;                                                                       // status returned from cfitsio functions
-  int prevx=0;      // x dimension of previous image in list
-  int prevy=0;      // y dimension of previous image in list
-  int naxis=1;													// number of axes for output image
-  long naxes[3];                                                  // array holding dimensions for each axis
-  //	void *nulval;													// null value to be used if nan is encountered in FITS file
-  char errortext[255];											// char string to contain fits error message
-  
-  // Check input parameters
-  if(list.size()==0)
-    throw "fitsmerge::merge2Dto3D file list has length 0";
-  
-  //-----------------------------------------------
-  // For each image in list... (a) check if it is an image extension  (b) check dimensions
-  for(unsigned int i=0; i < list.size(); i++)
-    {
-      int hdutype=0;          // hdutype variable needed to check we have an image  HDU
-      //		double freq=0;          // frequency to be read from keyword
-      string filename;        // name of current file
-      
-      //-----------------------------------------------
-      filename=list[i];       // get filename from list
-      
-      if(filename=="")
-	throw "fitsmerge::merge2Dto3D filename is empty";
-      
-      
-      fits_open_image(&infptr, filename.c_str(), READONLY, &fitsstatus);    // Open Image
-      
-      if(fitsstatus)
-	{
-	  fits_get_errstatus(fitsstatus, errortext);
-	  throw "fitsmerge::merge2Dto3D could not open image " + filename;
-	}                
-      fits_get_hdu_type(infptr, &hdutype ,&fitsstatus);                       // Check if  current HDU is an image extension
-      if(fitsstatus)
-	throw "fitsmerge::merge2Dto3D";
-      
-      fits_get_img_dim(infptr, &naxis, &fitsstatus);
-      fits_get_img_size(infptr, naxis, naxes, &fitsstatus);					// check  img  dimensions of input FITS
-      
-      if((prevx!=naxes[0] || prevy!=naxes[1]) && i>0)                         // only compare  2nd image to 1st and so on...
-	throw "fitsmerge::merge2Dto3D input images differ in size";
-      else
-	{
-	  prevx=naxes[0];         // keep current x dimension as previous for later  comparison
-	  prevy=naxes[1];         // keep current y dimension as previous for later  comparison
-	}
-    }
-  
-  fits_close_file(infptr, &fitsstatus);
-  
-  return true;
+	RM::rmFITSmerge merger(list);
+	merger.merge(outfilename);
 }
 
 //_______________________________________________________________________________
@@ -431,18 +299,3 @@ void printPlane(float *plane, unsigned int x, unsigned int y)
 	cout << endl;
     }
 }
-
-
-/*!
-  \brief Functions that tries to check frequency header info and  
-  correct it if necessary
-  
-  \param ftpr - FITS file ptr of image to check
-*/
-void correctFreqHeader(vector<string> &list, vector<double> &freqs)
-{
-  for(unsigned int i=0; i < list.size(); i++)
-    {
-      
-    }
-}
@@ -34,14 +34,22 @@
   
   Small helper tool that merges a list of 2-D FITS files provided in a  
   list into one 3-D (spectral / faraday) FITS cube
+
+  Images are read in parallel and written in list order (RM::rmFITSmerge);
+  the frequency axis of the cube is taken from the input headers.
+
+  fitsmerge [-t nthreads] [-c rice|gzip] [-f freqlist.txt] <list.txt> <output.fits>
 */
 
 #include <iostream>
 #include <fstream>                      // file stream functions
 #include <vector>                       // vector used to keep list of input images
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "fitsio.h"
 #include "../implement/rmLib/rmFITS.h"	 // rmFITS class
+#include "../implement/rmLib/rmFITSmerge.h"	 // parallel merge of 2-D images
 
 using namespace std;
 
@@ -52,9 +60,8 @@ using namespace std;
 // ==============================================================================
 
 void readList(const string &listfilename, vector<string> &list);
-bool checkFiles(const vector<string> &list);
-void merge2Dto3D(const vector<string> &list, const string  
-&outfilename);
+void merge2Dto3D(const vector<string> &list, const string &outfilename,
+                 unsigned int nthreads, int compression, const string &freqlist);
 
 /*
 void preemptivelyDeleteFITS(const string &filename);
@@ -106,29 +113,39 @@ void printPlane (float *plane,
 //_______________________________________________________________________________
 //                                                                           main
 int main (int argc, const char * argv[]) {
-        string listfilename, outfilename;
+        string listfilename, outfilename, freqlist;
+        unsigned int nthreads=4;          // number of reader threads
+        int compression=0;                // tile compression of output cube
+        int arg=1;
 	
         //-------------------------------------
         // Command line argument parsing
-        if(argc!=3)
+        for(; arg+1 < argc && argv[arg][0]=='-'; arg+=2)
+        {
+           if(strcmp(argv[arg], "-t")==0)
+              nthreads=atoi(argv[arg+1]);
+           else if(strcmp(argv[arg], "-c")==0)
+              compression=strcmp(argv[arg+1], "gzip")==0 ? GZIP_2 : RICE_1;
+           else if(strcmp(argv[arg], "-f")==0)
+              freqlist=argv[arg+1];
+        }
+        if(argc-arg!=2 || nthreads==0)
         {
-		     cout << "usage: fitsmerge <list.txt> <output.fits>" << endl;
+		     cout << "usage: fitsmerge [-t nthreads] [-c rice|gzip] [-f freqlist.txt] <list.txt> <output.fits>" << endl;
            cout << endl;
            cout << "This program reads in a list of 2-D FITS images from <list.tx>" << endl;
            cout << "and merges them into a 3-D cube." << endl;
+           return 1;
         }
-        else
-        {
-           listfilename=argv[1];					// 1st cmd argument is filename for input list
-           outfilename="!" + (string) argv[2];    // 2nd cmd argument is output filename, exclamation mark for overwriting with fits_create_file
-        }
+        listfilename=argv[arg];					// 1st cmd argument is filename for input list
+        outfilename="!" + (string) argv[arg+1];    // 2nd cmd argument is output filename, exclamation mark for overwriting with fits_create_file
                 
         //-------------------------------------
         try {
 			 vector<string> list;            // vector to contain list of FITS files
                 
 			 readList(listfilename, list);
-			 merge2Dto3D(list, outfilename);
+			 merge2Dto3D(list, outfilename, nthreads, compression, freqlist);
         }
         
         catch (const char* s) {
@@ -175,180 +192,24 @@ void readList(const string &listfilename, vector<string> &list)
 /*!
   \param list - vector containing a list of 2-D FITS files
   \param outfilename - filename of 3-D FITS file to be created
- // \param freqlist - text file the frequencies of the input files is written to
+  \param nthreads - number of threads reading input images
+  \param compression - cfitsio tile compression of the cube (0 for none)
+  \param freqlist - text file the frequencies of the input files are written to (optional)
 */
-void merge2Dto3D(const vector<string> &list, const string  
-&outfilename)
+void merge2Dto3D(const vector<string> &list, const string &outfilename,
+                 unsigned int nthreads, int compression, const string &freqlist)
 {
-	RM::rmFITS inFITS;						// rmFITS input image
-	RM::rmFITS outFITS;						// rmFITS output image
-
-  // These are now all handled in rmFITS objects:
-  //     fitsfile *infptr=NULL, *outfptr=NULL;                           // fileptr for current input  and (one) output file
-  //      ofstream outfile(const_cast<const char*>(freqlist.c_str()),  ofstream::out); // output filestream to create frequency list file
-  //      int fitsstatus=0;                                                                       // status returned from cfitsio functions
-  //      int naxis=0;													// number of axes for output image
-  //      long *naxes;													// array holding dimensions for each axis
-	unsigned long z=0;
-	long nelements=0;												// number of elements in a plane
-	
 	// Check input parameters
    if(list.size()==0)
 		throw "fitsmerge::merge2Dto3D file list has length 0";
 	if(outfilename=="")
 		throw "fitsmerge::merge2Dto3D no filename given";
-        
-   //-----------------------------------------------
-	checkFiles(list);		
-
-	//fits_open_image(&infptr, list[0].c_str(), READONLY, &fitsstatus);
-	//fits_get_img_dim(infptr, &naxis, &fitsstatus);
-	inFITS.open(list[0], READONLY);
-	int naxis=inFITS.getImgDim();
-	
-	cout << "naxis = " << naxis << endl;	
-	
-	// Prepare creation of 3D FITS image
-//naxis=3;
-//	naxes=new long[naxis];
-// naxes[2]=list.size();                   // Length of list = z-axis of output  FITS
-	
-	//	fits_get_img_size(infptr, naxis, naxes, &fitsstatus);					// check  img  dimensions of input FITS
-	inFITS.updateImageDimensions();			 // get image size of input images
-	z=list.size();
-	nelements=inFITS.getX()*inFITS.getY()*z;
-	
-	/*
-	fits_create_file(&outfptr, outfilename.c_str(),  &fitsstatus);      // create output fits image
-	if(fitsstatus)
-	{
-		fits_get_errstatus(fitsstatus, errortext);	
-		cout << "fitserror: " << errortext << endl;
-		throw "fitsmerge::merge2Dto3D could not create output file";    //  throw exception
-	}
-			
-	// Create the primary array image (32-bit float pixels)
-	fits_create_img(outfptr, FLOAT_IMG, naxis, naxes, &fitsstatus);
-	if(fitsstatus)
-	{
-		fits_get_errstatus(fitsstatus, errortext);	
-		cout << "fitserror: " << errortext << endl;
-		throw "fitsmerge::merge2Dto3D could not create image extension";    //  throw exception
-	}
-	
-	if(fitsstatus)
-	{
-		fits_get_errstatus(fitsstatus, errortext);	
-		cout << "fitserror: " << errortext << endl;
-		throw "fitsmerge::merge2Dto3D could not copy header from source to destination";    //  throw exception
-	}
 
-	outFITS.createImg(FLOAT_IMG, naxis, naxes);
-	nelements=naxes[0]*naxes[1];		// number of elements in one image plane
-	*/
-	
-	
-	//double *cube=new double[inFITS.X()*inFITS.Y()*z];		// create buffer to read cube into
-	double *plane=new double[inFITS.getX()*inFITS.getY()];
-	
-//	long fpixel[3]={1,1,1};
-	
+	RM::rmFITSmerge merger(list, nthreads);
+	merger.merge(outfilename, compression);
 
-	inFITS.setNulval(0.0);											// set nulval
-   // Loop over list and copy 2-D FITS files into output file
-   for(unsigned long int i=0; i<list.size(); i++)
-   {
-//		fits_open_image(&infptr, list[i].c_str(), READONLY , &fitsstatus);			// update infptr
-		inFITS.open(list[i], READONLY);		// open current file in list
-		
-//		fits_file_name(infptr, errortext, &fitsstatus);
-//		cout << "i = " << i << "\t" << list[i].c_str() << "\t" << errortext << endl;
-//		fits_read_pix(infptr, TFLOAT, fpixel, nelements, &nulval, cube+(i*nelements), NULL, &fitsstatus);			
-			
-//			readPlane(infptr, cube+(i*nelements), 1, &nulval, fitsstatus);				// read plane from input file: FITS start with index 1!							
-			
-//			writePlane(outfptr, plane, naxes[0], naxes[1], i+1, &nulval, fitsstatus);	// write to i-th plane in output file
-
-		inFITS.readPlane(plane, 1);
-		outFITS.writePlane(plane, 1);
-	//	fits_close_file(infptr, &fitsstatus);
-		inFITS.close();
-	}
-			
-	//writeCube(outfptr, cube, &nulval);	
-   // Close input and output files
-   //fits_close_file(outfptr, &fitsstatus);
-	//	delete[] naxes;
-		delete[] plane;
-	//	delete[] cube;
-
-	//outFITS.writeCube(cube);
-	outFITS.close();
-}
-
-//_______________________________________________________________________________
-//                                                                     checkFiles
-
-/*!
-  \param &list - vector containing list of FITS files
-*/
-bool checkFiles(const vector<string> &list)
-{
-	fitsfile *infptr=NULL;											// fileptr for current input file
-	//      ofstream outfile(const_cast<const char*>(freqlist.c_str()),  ofstream::out); // output filestream to create frequency list file
-	int fitsstatus=0;                                  // status returned from cfitsio functions
-	int prevx=0, prevy=0;                              // x and y dimensions of previous  image in list
-	int naxis=1;													// number of axes for output image
-	long naxes[3];                                     // array holding dimensions for each axis
-	//	void *nulval;												// null value to be used if nan is encountered in FITS file
-	char errortext[255];											// char string to contain fits error message
-	int hdu=1;														// HDU containing image
-	
-	// Check input parameters
-	if(list.size()==0)
-		throw "fitsmerge::merge2Dto3D file list has length 0";
-	
-	//-----------------------------------------------
-	// For each image in list... (a) check if it is an image extension  (b) check dimensions
-	for(unsigned int i=0; i < list.size(); i++)
-	{
-		int hdutype=0;          // hdutype variable needed to check we have an image  HDU
-//		double freq=0;          // frequency to be read from keyword
-		string filename;        // name of current file
-		
-		//-----------------------------------------------
-		filename=list[i];       // get filename from list
-		
-		if(filename=="")
-			throw "fitsmerge::merge2Dto3D filename is empty";
-		
-		fits_open_image(&infptr, filename.c_str(), READONLY, &fitsstatus);    // Open Image
-		fits_movabs_hdu(infptr, hdu, NULL, &fitsstatus);
-		
-		if(fitsstatus)
-		{
-			fits_get_errstatus(fitsstatus, errortext);
-			throw "fitsmerge::merge2Dto3D could not open image " + filename;
-      }                
-		fits_get_hdu_type(infptr, &hdutype ,&fitsstatus);                 // Check if  current HDU is an image extension
-		if(fitsstatus)
-			throw "fitsmerge::merge2Dto3D";
-		
-		fits_get_img_dim(infptr, &naxis, &fitsstatus);
-		fits_get_img_size(infptr, naxis, naxes, &fitsstatus);					// check  img  dimensions of input FITS
-		
-		if((prevx!=naxes[0] || prevy!=naxes[1]) && i>0)                   // only compare  2nd image to 1st and so on...
-			throw "fitsmerge::merge2Dto3D input images differ in size";
-		else
-		{
-			prevx=naxes[0];         // keep current x dimension as previous for later  comparison
-			prevy=naxes[1];         // keep current y dimension as previous for later  comparison
-		}
-	}
-	
-	fits_close_file(infptr, &fitsstatus);
-	
-	return true;
+	if(freqlist!="")
+		merger.writeFrequencyList(freqlist);
 }
 
 //_______________________________________________________________________________
@@ -588,22 +449,6 @@ void printPlane (float *plane,
 }
 */
 
-/*!
-  \brief Functions that tries to check frequency header info and  
-correct it if necessary
-
-  \param list - vector of list of filenames
-  \param freqs - vector containing corresponding frequencies
-*/
-void correctFreqHeaders(vector<string> &list, vector<double> &freqs)
-{
-        for(unsigned int i=0; i < list.size(); i++)
-        {
-
-        }
-}
-
-
 /*!
  \brief Add necessary information to incomplete FITS headers (legacy interface)
  
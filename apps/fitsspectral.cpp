@@ -1,5 +1,10 @@
 // Program that reads in a fits cube and takes out a spectral line
 //
+// Batch mode (-p): extract the spectra at all positions listed in a text
+// file ("x y" pixels, or "ra dec" in degrees with -w) in one pass over the
+// cube and write them into one FITS table (-o *.fits) or one binary file
+// of doubles [position][channel].
+//
 // File:		fitsspectral.cpo
 // Author:		Sven Duscha (sduscha@mpa-garching.mpg.de)
 // Date:		23-10-2009
@@ -8,9 +13,14 @@
 
 #include <iostream>
 #include <fstream>                      // file stream functions
+#include <sstream>                      // TFORM of the spectrum column
+#include <algorithm>
 #include <vector>                       // vector used to keep list of input images
+#include <math.h>
+#include <unistd.h>                     // getopt
 #include "fitsio.h"
 #include <rmFITS.h>
+#include <rmFITStable.h>
 #include <rmIO.h>
 
 #define debug_
@@ -19,6 +29,8 @@
 using namespace std;
 
 bool checkCube(string filename, long *naxes);
+void extractBatch(const string &fitsfilename, const string &positionfilename,
+                  bool world, const string &outfilename);
 
 
 int main (int argc, char * const argv[]) 
@@ -27,6 +39,8 @@ int main (int argc, char * const argv[])
   string fitsfilename;						// filename of FITS file to extract spectrum from
   string spectralfilename="spectral.dat";	// default output name for spectral line file
   string coordfilename;						// text file containing
+  string positionfilename;					// text file with positions (batch mode)
+  bool world=false;								// batch positions are RA/Dec in degrees
   unsigned long xpos=0, ypos=0;				// x and y coordinate to read spectral line in cube
   
   // Internal variables
@@ -38,6 +52,7 @@ int main (int argc, char * const argv[])
   if(argc<2)
     {
       cout << endl << "Usage: " << argv[0]  << " -f <cube.fits> -o <spectral.dat> -x <xpos> -y <ypos>" << endl;
+      cout << "       " << argv[0]  << " -f <cube.fits> -o <spectra.fits|spectra.bin> -p <positions.txt> [-w]" << endl;
       exit(0);
     }
   else
@@ -46,7 +61,7 @@ int main (int argc, char * const argv[])
       opterr = 0;
       
       // Parse command line parameters
-      while ((c = getopt (argc, argv, "x:y:f:o:l:")) != -1)
+      while ((c = getopt (argc, argv, "x:y:f:o:l:p:w")) != -1)
 	{
 	  switch (c)
 	    {
@@ -65,6 +80,12 @@ int main (int argc, char * const argv[])
 	    case 'l':			// optionaly provide text file with frequencies / Faraday depths
 	      coordfilename = optarg;
 	      break;
+	    case 'p':			// batch mode: text file with positions
+	      positionfilename = optarg;
+	      break;
+	    case 'w':			// batch positions are world coordinates (RA/Dec)
+	      world = true;
+	      break;
 	    case '?':
 	      if (optopt=='s' || optopt=='n'  || optopt=='c' )
 		fprintf (stderr, "Option -%c requires an argument.\n", optopt);
@@ -86,6 +107,22 @@ int main (int argc, char * const argv[])
   
   
   //*****************************************************
+  if(positionfilename!="")
+    {
+      try
+	{
+	  if(spectralfilename=="spectral.dat")
+	    spectralfilename="spectra.fits";
+	  extractBatch(fitsfilename, positionfilename, world, spectralfilename);
+	}
+      catch (const char *s)
+	{
+	  cerr << s << endl;
+	  return 1;
+	}
+      return 0;
+    }
+
   try 
     {		
       checkCube(fitsfilename, naxes);				// check if FITS file is a 3D-cube
@@ -128,6 +165,112 @@ int main (int argc, char * const argv[])
 }
 
 
+//_______________________________________________________________________________
+//                                                                   extractBatch
+
+/*!
+  \brief Extract the spectra at all positions of a list in one pass over the cube
+
+  \param fitsfilename - cube to read (plane- or spectral-major layout)
+  \param positionfilename - text file with one "x y" (1-based pixels) or
+  "ra dec" (degrees, world=true) pair per line
+  \param world - positions are celestial coordinates
+  \param outfilename - FITS table (*.fits) or binary file of doubles
+*/
+void extractBatch(const string &fitsfilename, const string &positionfilename,
+                  bool world, const string &outfilename)
+{
+  vector<double> a, b;		// positions as given in the list
+  double first=0, second=0;
+
+  ifstream infile(positionfilename.c_str(), ifstream::in);
+  if(infile.fail())
+    throw "fitsspectral::extractBatch failed to open position list";
+  while(infile >> first >> second)
+    {
+      a.push_back(first);
+      b.push_back(second);
+    }
+  infile.close();
+  if(a.size()==0)
+    throw "fitsspectral::extractBatch position list is empty";
+
+  RM::rmFITS image(fitsfilename, READONLY);
+  const RM::rmFITSheader &header=image.getHeader();
+  const size_t npos=a.size();
+  const int64_t length=image.getSpectrumLength();
+  const bool spectralMajor=image.isSpectralMajor();
+  const double nx=header.getAxes()[spectralMajor ? 1 : 0];
+  const double ny=header.getAxes()[spectralMajor ? 2 : 1];
+
+  // pixel positions (nearest pixel for world coordinates)
+  vector<unsigned long> x(npos), y(npos);
+  for(size_t i=0; i<npos; i++)
+    {
+      double px=a[i], py=b[i];
+      if(world)
+	header.worldToPixel(a[i], b[i], px, py);
+      if(!(px >= 0.5 && px < nx+0.5 && py >= 0.5 && py < ny+0.5))	// also NaN
+	throw "fitsspectral::extractBatch position outside of the image";
+      x[i]=static_cast<unsigned long>(floor(px+0.5));
+      y[i]=static_cast<unsigned long>(floor(py+0.5));
+    }
+
+  vector<double> spectra(npos*length);
+  image.readSpectraAt(x, y, &spectra[0]);
+
+  cout << "extracted " << npos << " spectra of " << length << " channels" << endl;
+
+  //-------------------------------------------------------
+  // Output: FITS table, one row per position, or raw doubles. All spectra
+  // have the same length, so they go into a fixed-length vector column
+  // that is written in blocks like the scalar columns.
+  if(outfilename.find(".fits")!=string::npos)
+    {
+      ostringstream tform;
+      tform << length << "D";
+      // stage at most 4M spectrum values (32 MB) per block
+      const uint64_t blockRows=min<uint64_t>(npos, max<int64_t>(1, (1 << 22)/length));
+
+      RM::rmFITStable table(outfilename, true, blockRows);
+      unsigned int colx=table.addColumn("X", "K", "pixel");
+      unsigned int coly=table.addColumn("Y", "K", "pixel");
+      unsigned int colra=0, coldec=0;
+      if(world)
+	{
+	  colra=table.addColumn("RA", "D", "deg");
+	  coldec=table.addColumn("DEC", "D", "deg");
+	}
+      unsigned int colspectrum=table.addColumn("SPECTRUM", tform.str());
+      table.create("SPECTRA");
+
+      vector<double> spectrum(length);
+      for(size_t i=0; i<npos; i++)
+	{
+	  table.setInteger(colx, x[i]);
+	  table.setInteger(coly, y[i]);
+	  if(world)
+	    {
+	      table.setValue(colra, a[i]);
+	      table.setValue(coldec, b[i]);
+	    }
+	  spectrum.assign(spectra.begin()+i*length, spectra.begin()+(i+1)*length);
+	  table.setArray(colspectrum, spectrum);
+	  table.nextRow();
+	}
+      table.close();
+    }
+  else
+    {
+      ofstream outfile(outfilename.c_str(), ofstream::out | ofstream::binary);
+      if(outfile.fail())
+	throw "fitsspectral::extractBatch could not open output file";
+      outfile.write(reinterpret_cast<const char*>(&spectra[0]), spectra.size()*sizeof(double));
+      outfile.close();
+    }
+}
+
+
 // Check if FITS file is a 3D-Cube
 bool checkCube(string filename, long *naxes)
 {
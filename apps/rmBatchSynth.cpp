@@ -0,0 +1,300 @@
+/***************************************************************************
+ *   Copyright (C) 2009                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*!
+  \file rmBatchSynth.cpp
+
+  \ingroup RM
+
+  \brief RM-Synthesis and RM-CLEAN of a whole batch of spectra in one process
+
+  \author Sven Duscha
+
+  \date 17.06.10.
+
+  <h3>Synopsis</h3>
+
+  Reads an rmBatch container (as written by rmPolSynth -E) and transforms
+  all of its spectra in a single call of rmSynthesisPlanCache::synthesize,
+  treating the batch like one tile of lines of sight (NaN samples are
+  flagged per spectrum). The dirty Faraday spectra are written as a
+  complex128 .npy array [phi][spectrum]. With -C every spectrum is also
+  cleaned (rmclean::rmsfClean) by an RM::rmCleanCube pool of -p threads
+  with one RMSF computed over twice the Faraday depth range, and the clean
+  spectra are written in the same layout. With -K only the non-zero CLEAN
+  components of every spectrum are written, as a FITS table of
+  variable-length arrays (RM::rmCleanComponents), from which rmrestore
+  rebuilds restored spectra. FFTW wisdom is kept in rmclean.wisdom in
+  the run directory. With -N every spectrum is cleaned down to that
+  multiple of its own noise level, estimated from the outer -r fraction of
+  the Faraday depths (or the whole residual), and -S writes the number of
+  iterations, the noise level and the largest residual of every spectrum.
+*/
+
+#include <iostream>
+#include <unistd.h>		// getopt
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+
+#include <rmCube.h>		// RMSF and utilities
+#include <rmNpy.h>		// .npy output
+#include <rmBatch.h>		// container of spectra
+#include <rmSynthesisPlan.h>	// batched RM-Synthesis
+#include <rmCleanCube.h>	// parallel RM-CLEAN
+
+using namespace std;
+
+//_______________________________________________________________________________
+//                                                                          usage
+
+/*!
+  \brief Show usage of command line arguments
+*/
+void usage(char * const argv[])
+{
+  cout << "usage: " << argv[0] << " <options>" << endl;
+  cout << "-i <batch.fits> container of spectra (rmBatch)" << endl;
+  cout << "-d <faradaydepths> (or -a/-b/-c)" << endl;
+  cout << "-a <min> (Minimum Faraday depth)" << endl;
+  cout << "-b <max> (Maximum Faraday depth)" << endl;
+  cout << "-c <step> (Faraday depth step)" << endl;
+  cout << "-o <dirty.npy> dirty Faraday spectra [phi][spectrum]" << endl;
+  cout << "-C <clean.npy> clean Faraday spectra [phi][spectrum] (enables CLEAN)" << endl;
+  cout << "-K <components.fits> sparse CLEAN component lists (enables CLEAN)" << endl;
+  cout << "-t <threshold> CLEAN threshold (default 0.01, 0 with -N)" << endl;
+  cout << "-N <multiple> CLEAN down to multiple times the noise of each spectrum" << endl;
+  cout << "-r <fraction> estimate the noise from this fraction at each end (default 0: all)" << endl;
+  cout << "-S <stats.npy> CLEAN statistics [spectrum][iterations, noise, residual]" << endl;
+  cout << "-n <maxiter> CLEAN iterations per spectrum (default 1000)" << endl;
+  cout << "-g <gain> CLEAN loop gain (default 0.1)" << endl;
+  cout << "-p <nthreads> CLEAN worker threads (default 1)" << endl;
+  cout << "-h shows this usage help info" << endl;
+}
+
+//_______________________________________________________________________________
+//                                                                           main
+
+int main (int argc, char * const argv[])
+{
+  int c;
+  string filenameBatch;			// input container
+  string filenameFaradayDepths;		// Faraday depths to probe for
+  string filenameDirty;			// dirty Faraday spectra output
+  string filenameClean;			// clean Faraday spectra output
+  string filenameComponents;		// CLEAN component lists output
+  string filenameStats;			// per-spectrum CLEAN statistics output
+  double minFaradayDepth (0.0);
+  double maxFaradayDepth (0.0);
+  double stepFaradayDepth (0.0);
+  double threshold (0.01);
+  bool thresholdGiven (false);
+  double noiseMultiple (0.0);
+  double noiseRange (0.0);
+  unsigned int maxIterations (1000);
+  double gain (0.1);
+  unsigned int nthreads (1);
+
+  try {
+    if(argc<3) {
+      usage(argv);
+      return 0;
+    }
+
+    while ((c = getopt (argc, argv, "i:d:a:b:c:o:C:K:t:N:r:S:n:g:p:h")) != -1)
+      {
+	switch (c)
+	  {
+	  case 'i':
+	    filenameBatch=optarg;
+	    break;
+	  case 'd':
+	    filenameFaradayDepths=optarg;
+	    break;
+	  case 'a':
+	    minFaradayDepth=atof(optarg);
+	    break;
+	  case 'b':
+	    maxFaradayDepth=atof(optarg);
+	    break;
+	  case 'c':
+	    stepFaradayDepth=atof(optarg);
+	    break;
+	  case 'o':
+	    filenameDirty=optarg;
+	    break;
+	  case 'C':
+	    filenameClean=optarg;
+	    break;
+	  case 'K':
+	    filenameComponents=optarg;
+	    break;
+	  case 't':
+	    threshold=atof(optarg);
+	    thresholdGiven=true;
+	    break;
+	  case 'N':
+	    noiseMultiple=atof(optarg);
+	    break;
+	  case 'r':
+	    noiseRange=atof(optarg);
+	    break;
+	  case 'S':
+	    filenameStats=optarg;
+	    break;
+	  case 'n':
+	    maxIterations=atoi(optarg);
+	    break;
+	  case 'g':
+	    gain=atof(optarg);
+	    break;
+	  case 'p':
+	    nthreads=atoi(optarg);
+	    break;
+	  case 'h':
+	    usage(argv);
+	    return 0;
+	  default:
+	    usage(argv);
+	    return 1;
+	  }
+      }
+
+    if(filenameBatch=="")
+      throw "rmBatchSynth: no input container given (-i)";
+    if(filenameDirty=="" && filenameClean=="" && filenameComponents=="")
+      throw "rmBatchSynth: no output given (-o, -C or -K)";
+    if(filenameStats!="" && filenameClean=="" && filenameComponents=="")
+      throw "rmBatchSynth: CLEAN statistics (-S) need -C or -K";
+
+    RM::rmCube RM;
+    RM::rmBatch batch(filenameBatch);
+    const uint64_t nspectra=batch.getNumSpectra();
+    const uint64_t nchannels=batch.getNumChannels();
+    if(nspectra==0)
+      throw "rmBatchSynth: container holds no spectra";
+
+    // Faraday depths from file or from min/max/step
+    vector<double> phis;
+    if(filenameFaradayDepths!="")
+      RM.readVectorFromFile(phis, filenameFaradayDepths);
+    else
+      {
+	if(stepFaradayDepth<=0 || minFaradayDepth>=maxFaradayDepth)
+	  throw "rmBatchSynth: invalid Faraday depth range";
+	for(double phi=minFaradayDepth; phi<=maxFaradayDepth; phi+=stepFaradayDepth)
+	  phis.push_back(phi);
+      }
+    const uint64_t nphis=phis.size();
+
+    //________________________________________________________
+    // RM-Synthesis of all spectra as one tile
+
+    cout << "rmBatchSynth: " << nspectra << " spectra, " << nchannels
+	 << " channels, " << nphis << " Faraday depths" << endl;
+
+    RM::rmValidityMask mask(nspectra, nchannels);
+    for(uint64_t ch=0; ch<nchannels; ch++)
+      {
+	mask.setPlaneFromValues(ch, batch.getQ()+ch*nspectra);
+	for(uint64_t s=0; s<nspectra; s++)	// U may be blanked independently
+	  if(!isfinite(batch.getU()[ch*nspectra+s]))
+	    mask.set(s, ch, false);
+      }
+
+    RM::rmSynthesisPlanCache plans(phis,
+				   batch.getLambdaSquareds(),
+				   batch.getWeights(),
+				   batch.getDeltaLambdaSquareds());
+    vector<complex<double> > dirty(nphis*nspectra);
+    plans.synthesize(batch.getQ(), batch.getU(), mask, &dirty[0]);
+
+    if(filenameDirty!="")
+      RM::rmNpy::write(filenameDirty, reinterpret_cast<const double*>(&dirty[0]), nphis, nspectra, true);
+
+    //________________________________________________________
+    // RM-CLEAN of every spectrum with a pool of CLEAN workers
+
+    if(filenameClean!="" || filenameComponents!="")
+      {
+	if(nphis < 2)
+	  throw "rmBatchSynth: CLEAN needs at least 2 Faraday depths";
+
+	// RMSF over twice the Faraday depth range, centred on 0
+	double step=phis[1]-phis[0];
+	vector<double> rmsfPhis(2*nphis);
+	for(uint64_t i=0; i<2*nphis; i++)
+	  rmsfPhis[i]=(static_cast<double>(i)-nphis)*step;
+
+	vector<complex<double> > rmsf=RM.RMSF(rmsfPhis,
+					      batch.getLambdaSquareds(),
+					      batch.getWeights(),
+					      batch.getDeltaLambdaSquareds());
+	RM.normalizeRMSF(rmsf);
+
+	RM::rmCleanCube clean(rmsf, nphis, nthreads);
+	clean.setGain(gain);
+	clean.setThreshold((noiseMultiple > 0 && !thresholdGiven) ? 0 : threshold);
+	clean.setNoiseMultiple(noiseMultiple);
+	clean.setNoiseRange(noiseRange);
+	clean.setMaxIterations(maxIterations);
+
+	// spectrum s is dirty[i*nspectra+s]: Faraday depth stride nspectra, spectrum stride 1
+	if(filenameClean!="")
+	  {
+	    vector<complex<double> > cleanSpectra(nphis*nspectra);
+	    clean.clean(&dirty[0], &cleanSpectra[0], nspectra, nspectra, 1);
+
+	    RM::rmNpy::write(filenameClean, reinterpret_cast<const double*>(&cleanSpectra[0]), nphis, nspectra, true);
+	  }
+
+	// restoring beam: FWHM of the RMSF ~ 2*sqrt(3)/(lambda^2 range)
+	if(filenameComponents!="")
+	  {
+	    const vector<double> &lambdaSquareds=batch.getLambdaSquareds();
+	    double range=*max_element(lambdaSquareds.begin(), lambdaSquareds.end())
+	      -*min_element(lambdaSquareds.begin(), lambdaSquareds.end());
+	    RM::rmCleanComponents components(nphis, phis[0], step, (range > 0) ? 2*sqrt(3.0)/range : 0);
+	    clean.clean(&dirty[0], components, nspectra, nspectra, 1);
+
+	    cout << "rmBatchSynth: " << components.getNumComponents() << " CLEAN components" << endl;
+	    components.write(filenameComponents);
+	  }
+
+	if(filenameStats!="")
+	  {
+	    vector<double> stats(3*nspectra);
+	    for(uint64_t s=0; s<nspectra; s++)
+	      {
+		stats[3*s]=clean.getIterations()[s];
+		stats[3*s+1]=clean.getNoiseLevels()[s];
+		stats[3*s+2]=clean.getResidualPeaks()[s];
+	      }
+	    RM::rmNpy::write(filenameStats, &stats[0], nspectra, 3);
+	  }
+      }
+  }
+  catch (const char *s) {
+    cerr << s << endl;
+    return 1;
+  }
+
+  return 0;
+}
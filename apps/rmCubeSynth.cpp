@@ -0,0 +1,300 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*!
+  \file rmCubeSynth.cpp
+
+  \ingroup RM
+
+  \brief RM-Synthesis of Q/U FITS image cubes
+
+  \author Sven Duscha
+
+  \date 19.06.10.
+
+  <h3>Synopsis</h3>
+
+  Reads the Q and U planes of every channel, either straight from a 4-D
+  IQUV cube (-i, rmFITS::readStokesPlanesFlags) or from separate 3-D Q and
+  U cubes (-q, -u, rmFITS::readPlaneFlags), and transforms the cube in
+  bands of -r image rows with rmSynthesisPlanCache::synthesize. Blanked
+  samples (NaN, or BLANK pixels of integer cubes) are flagged per line of
+  sight and channel in an rmValidityMask, so partially blanked lines of
+  sight are transformed with the plan of their valid channels.
+  The channel frequencies are taken from the FREQ axis of the cube or
+  from a text file (-f). Every channel of a band of rows is read straight
+  into the synthesis buffers, so only one band is held in memory. The Faraday
+  products Q, U, |P| and angle are written band by band with
+  rmFITSproducts, as separate files or (-s) as HDUs of one file.
+*/
+
+#include <iostream>
+#include <unistd.h>		// getopt
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+
+#include <rmCube.h>		// lambda squareds and image cube checks
+#include <rmFITS.h>		// Stokes cube input
+#include <rmFITSproducts.h>	// Faraday product output
+#include <rmSynthesisPlan.h>	// batched RM-Synthesis
+
+using namespace std;
+
+//_______________________________________________________________________________
+//                                                                          usage
+
+/*!
+  \brief Show usage of command line arguments
+*/
+void usage(char * const argv[])
+{
+  cout << "usage: " << argv[0] << " <options>" << endl;
+  cout << "-i <iquv.fits> 4-D cube with a STOKES axis containing Q and U" << endl;
+  cout << "-q <q.fits> 3-D Q cube (with -u, instead of -i)" << endl;
+  cout << "-u <u.fits> 3-D U cube (with -q, instead of -i)" << endl;
+  cout << "-f <frequencies> channel frequencies in Hz (default: FREQ axis)" << endl;
+  cout << "-d <faradaydepths> (or -a/-b/-c)" << endl;
+  cout << "-a <min> (Minimum Faraday depth)" << endl;
+  cout << "-b <max> (Maximum Faraday depth)" << endl;
+  cout << "-c <step> (Faraday depth step)" << endl;
+  cout << "-o <basename> output basename of the Faraday products" << endl;
+  cout << "-s write all products as HDUs of one file" << endl;
+  cout << "-r <rows> image rows transformed at once (default 32)" << endl;
+  cout << "-h shows this usage help info" << endl;
+}
+
+//_______________________________________________________________________________
+//                                                                           main
+
+int main (int argc, char * const argv[])
+{
+  int c;
+  string filenameStokes;		// 4-D IQUV cube
+  string filenameQ;			// 3-D Q cube
+  string filenameU;			// 3-D U cube
+  string filenameFrequencies;		// channel frequencies
+  string filenameFaradayDepths;		// Faraday depths to probe for
+  string basename;			// output basename
+  double minFaradayDepth (0.0);
+  double maxFaradayDepth (0.0);
+  double stepFaradayDepth (0.0);
+  bool singleFile (false);
+  uint64_t bandRows (32);
+
+  try {
+    if(argc<3) {
+      usage(argv);
+      return 0;
+    }
+
+    while ((c = getopt (argc, argv, "i:q:u:f:d:a:b:c:o:sr:h")) != -1)
+      {
+	switch (c)
+	  {
+	  case 'i':
+	    filenameStokes=optarg;
+	    break;
+	  case 'q':
+	    filenameQ=optarg;
+	    break;
+	  case 'u':
+	    filenameU=optarg;
+	    break;
+	  case 'f':
+	    filenameFrequencies=optarg;
+	    break;
+	  case 'd':
+	    filenameFaradayDepths=optarg;
+	    break;
+	  case 'a':
+	    minFaradayDepth=atof(optarg);
+	    break;
+	  case 'b':
+	    maxFaradayDepth=atof(optarg);
+	    break;
+	  case 'c':
+	    stepFaradayDepth=atof(optarg);
+	    break;
+	  case 'o':
+	    basename=optarg;
+	    break;
+	  case 's':
+	    singleFile=true;
+	    break;
+	  case 'r':
+	    bandRows=atoi(optarg);
+	    break;
+	  case 'h':
+	    usage(argv);
+	    return 0;
+	  default:
+	    usage(argv);
+	    return 1;
+	  }
+      }
+
+    const bool iquv=(filenameStokes!="");
+    if(!iquv && (filenameQ=="" || filenameU==""))
+      throw "rmCubeSynth: no input given (-i, or -q and -u)";
+    if(basename=="")
+      throw "rmCubeSynth: no output basename given (-o)";
+    if(bandRows==0)
+      throw "rmCubeSynth: band of 0 rows (-r)";
+
+    RM::rmCube RM;
+
+    //________________________________________________________
+    // Open the input cube(s) and get their dimensions
+
+    RM::rmFITS *qcube=NULL;		// Q cube, or the IQUV cube
+    RM::rmFITS *ucube=NULL;		// U cube, NULL for an IQUV cube
+    uint64_t nchannels=0;
+
+    if(iquv)
+      {
+	qcube=new RM::rmFITS(filenameStokes, READONLY);
+	if(!qcube->hasStokesQU())
+	  throw "rmCubeSynth: input cube has no STOKES axis containing Q and U (-i)";
+
+	int stokesAxis=qcube->getStokesAxis();
+	int spectralAxis=qcube->getSpectralAxis();
+	if(spectralAxis==0)	// the remaining axis of a 4-D cube
+	  spectralAxis=(stokesAxis==3) ? 4 : 3;
+	nchannels=qcube->getHeader().getAxes()[spectralAxis-1];
+      }
+    else
+      {
+	if(!RM.checkImageCubeQ(filenameQ, 1))
+	  throw "rmCubeSynth: Q input is not an image cube (-q)";
+	if(!RM.checkImageCubeU(filenameU, 1))
+	  throw "rmCubeSynth: U input is not an image cube (-u)";
+
+	qcube=new RM::rmFITS(filenameQ, READONLY);
+	ucube=new RM::rmFITS(filenameU, READONLY);
+	if(qcube->getHeader().getAxes()!=ucube->getHeader().getAxes())
+	  throw "rmCubeSynth: Q and U cubes differ in dimensions";
+	nchannels=qcube->getHeader().getAxes()[2];
+      }
+
+    const uint64_t nx=qcube->getHeader().getAxes()[0];
+    const uint64_t ny=qcube->getHeader().getAxes()[1];
+
+    //________________________________________________________
+    // Channel frequencies and Faraday depths
+
+    vector<double> frequencies, widths;
+    if(filenameFrequencies!="")
+      {
+	RM.readVectorFromFile(frequencies, filenameFrequencies);
+	if(frequencies.size() < 2)
+	  throw "rmCubeSynth: need at least 2 frequencies (-f)";
+	widths.resize(frequencies.size());
+	for(uint64_t ch=0; ch<frequencies.size(); ch++)
+	  {
+	    uint64_t next=(ch+1 < frequencies.size()) ? ch+1 : ch-1;
+	    widths[ch]=fabs(frequencies[next]-frequencies[ch]);
+	  }
+      }
+    else
+      {
+	frequencies=qcube->getBins();
+	widths=qcube->getBinWidths();
+      }
+    if(frequencies.size()!=nchannels)
+      throw "rmCubeSynth: number of frequencies differs from number of channels";
+
+    vector<double> freqLow(nchannels), freqHigh(nchannels);
+    for(uint64_t ch=0; ch<nchannels; ch++)
+      {
+	freqLow[ch]=frequencies[ch]-0.5*widths[ch];
+	freqHigh[ch]=frequencies[ch]+0.5*widths[ch];
+      }
+    vector<double> lambdaSquareds=RM.freqToLambdaSq(frequencies);
+    vector<double> deltaLambdaSquareds=RM.deltaLambdaSq(freqLow, freqHigh);
+    vector<double> weights(nchannels, 1.0);
+
+    vector<double> phis;
+    if(filenameFaradayDepths!="")
+      RM.readVectorFromFile(phis, filenameFaradayDepths);
+    else
+      {
+	if(stepFaradayDepth<=0 || minFaradayDepth>=maxFaradayDepth)
+	  throw "rmCubeSynth: invalid Faraday depth range";
+	for(double phi=minFaradayDepth; phi<=maxFaradayDepth; phi+=stepFaradayDepth)
+	  phis.push_back(phi);
+      }
+    const uint64_t nphis=phis.size();
+
+    cout << "rmCubeSynth: " << nx << "x" << ny << " pixels, " << nchannels
+	 << " channels, " << nphis << " Faraday depths" << endl;
+
+    //________________________________________________________
+    // RM-Synthesis band by band, plans are shared between bands. Every
+    // channel of a band of rows is read straight into the tile buffers
+    // [channel][row][x], so only one band of the cube is held in memory.
+
+    RM::rmSynthesisPlanCache plans(phis, lambdaSquareds, weights, deltaLambdaSquareds);
+    RM::rmFITSproducts out(basename, RM::PRODUCT_ALL, nx, ny, phis, !singleFile, bandRows);
+
+    const uint64_t maxPixels=min(bandRows, ny)*nx;
+    vector<double> qband(nchannels*maxPixels), uband(nchannels*maxPixels);
+    vector<char> qflags(maxPixels), uflags(maxPixels);	// null flags of one channel
+    vector<complex<double> > faraday(nphis*maxPixels);
+
+    for(uint64_t y0=0; y0<ny; y0+=bandRows)
+      {
+	const uint64_t rows=min(bandRows, ny-y0);
+	const uint64_t npixels=rows*nx;
+
+	RM::rmValidityMask mask(npixels, nchannels);
+	for(uint64_t ch=0; ch<nchannels; ch++)
+	  {
+	    double *qplane=&qband[ch*npixels];
+	    double *uplane=&uband[ch*npixels];
+
+	    if(iquv)
+	      qcube->readStokesPlanesFlags(qplane, uplane, ch+1, &qflags[0], &uflags[0], y0+1, rows);
+	    else
+	      {
+		qcube->readPlaneFlags(qplane, ch+1, &qflags[0], y0+1, rows);
+		ucube->readPlaneFlags(uplane, ch+1, &uflags[0], y0+1, rows);
+	      }
+	    for(uint64_t p=0; p<npixels; p++)	// U may be blanked independently
+	      qflags[p]|=uflags[p];
+	    mask.setPlaneFromNullFlags(ch, &qflags[0]);
+	  }
+
+	plans.synthesize(&qband[0], &uband[0], mask, &faraday[0]);
+	out.writeTile(&faraday[0], 0, y0, nx, rows);
+      }
+    out.close();
+    delete qcube;
+    delete ucube;
+
+    cout << "rmCubeSynth: " << plans.getNumPlans() << " synthesis plans" << endl;
+  }
+  catch (const char *s) {
+    cerr << s << endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -34,14 +34,22 @@
   RMPolSynthesis command line tool that performs the forward transform to create
   polarized intensity observational data from simulated Faraday emission. Noise
   can be added to the data.
+
+  In batch mode (-E) the Faraday emission is a .npy array with one column per
+  realisation (rows are the Faraday depths of -d). All realisations are
+  synthesized in one run and written to a single rmBatch container (-o, FITS)
+  that shares the lambda squareds and weights, for processing with rmBatchSynth.
 */
 
 #include <iostream>
+#include <unistd.h>		// getopt
 
 #include <rm.h>			// RM Synthesis class
 #include <rmIO.h>		// rmio functions
 #include <rmCube.h>		// rmCube object
 #include <rmNoise.h>		// noise generator functions
+#include <rmNpy.h>		// .npy arrays
+#include <rmBatch.h>		// container of spectra
 
 using namespace std;			
 
@@ -58,6 +66,7 @@ void usage(char * const argv[])
   cout << "usage: " << argv[0] << " <options>" << endl;
   cout << "-d <faradaydepths>" << endl;
   cout << "-e simulated Faraday emission vector" << endl;
+  cout << "-E <emissions.npy> batch of Faraday emissions, one realisation per column" << endl;
   cout << "-s <simulation>	containing both Faraday depths and simulated emission" << endl;
   cout << "-f <frequencies>" << endl;
   cout << "-l Frequencies are actually already lambda squareds" << endl;	
@@ -89,6 +98,7 @@ int main (int argc, char * const argv[])
   
   string filenameFaradayDepths;		// filename of file containing FaradayDepths in simulated emission
   string filenameFaradayEmission;		// 
+  string filenameEmissions;		// batch of Faraday emissions (.npy, one per column)
   string filenameSimulation;		// complete Faraday simulation
   string filenameFrequencies;		// filename of file containing Frequencies
   string filenameWeights;			// filename for output file for polarized intensities
@@ -140,7 +150,7 @@ int main (int argc, char * const argv[])
     // -c <step> (Faraday Depth step)
     // -n <sigma> (optional noise to be added in sigma)
     // -o <output>
-    while ((c = getopt (argc, argv, "d:e:f:l:w:o:p:a:b:c:n:h")) != -1)
+    while ((c = getopt (argc, argv, "d:e:E:f:l:w:o:p:a:b:c:n:h")) != -1)
       {
 	switch (c)
 	  {
@@ -153,6 +163,9 @@ int main (int argc, char * const argv[])
 	  case 'e':			// simulated Faraday emission vector
 	    filenameFaradayEmission = optarg;
 	    break;
+	  case 'E':			// batch of simulated Faraday emissions
+	    filenameEmissions = optarg;
+	    break;
 	  case 'f':		  	// File containing frequencies
 	    filenameFrequencies = optarg;
 	    break;
@@ -185,7 +198,7 @@ int main (int argc, char * const argv[])
 	    exit(0);
 	    break;
 	  case '?':
-	    if (optopt=='d' || optopt=='f'  || optopt=='l' || optopt=='p' || optopt=='w' || optopt=='o' || optopt=='a' || optopt=='b' || optopt=='c' || optopt=='n' )
+	    if (optopt=='d' || optopt=='E' || optopt=='f'  || optopt=='l' || optopt=='p' || optopt=='w' || optopt=='o' || optopt=='a' || optopt=='b' || optopt=='c' || optopt=='n' )
 	      fprintf (stderr, "Option -%c requires an argument.\n", optopt);
 	    else if (isprint (optopt))
 	      fprintf (stderr, "Unknown option `-%c'.\n", optopt);
@@ -257,7 +270,7 @@ int main (int argc, char * const argv[])
     if(filenameFaradayEmission!="") {
       RM.readVectorFromFile(simulatedEmission, filenameFaradayEmission);	
     }
-    else {
+    else if(filenameEmissions=="") {
       cout << "RMPolSynthesizer: No filename for Faraday emission simulation given"
 	   << endl;
     }
@@ -273,6 +286,33 @@ int main (int argc, char * const argv[])
       deltaFaradayDepths[i]=1; 				// equidistant faraday depths
     }
     
+    if(filenameEmissions!="")	// batch mode: all realisations into one container
+      {
+	RM::rmNpy emissions(filenameEmissions);
+	if(emissions.isComplex() || emissions.getNumRows()!=nfaradays)
+	  throw "RMPolSynthesizer: emissions must be a real array with one row per Faraday depth";
+	if(filenameOutput=="")
+	  throw "RMPolSyntesizer: outputfilename is not given";
+	
+	RM.computeDeltas(lambdaSquareds, deltaLambdaSquareds);
+	RM::rmBatch batch(lambdaSquareds, deltaLambdaSquareds, weights, emissions.getNumColumns());
+	
+	for(unsigned int s=0; s<emissions.getNumColumns(); s++)
+	  {
+	    emissions.copyColumn(s, simulatedEmission);
+	    polintensities = RM.forwardFourier (lambdaSquareds,
+						simulatedEmission,
+						faradayDepths,
+						weights,
+						deltaFaradayDepths,
+						0);
+	    batch.setSpectrum(s, polintensities);
+	  }
+	
+	batch.write(filenameOutput);
+	return 0;
+      }
+    
     // compute polarized intensities from Faraday emission intensities
     polintensities = RM.forwardFourier (lambdaSquareds,
 					simulatedEmission,
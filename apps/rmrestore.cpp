@@ -0,0 +1,220 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*!
+  \file rmrestore.cpp
+
+  \ingroup RM
+
+  \brief Restore dense Faraday spectra from sparse CLEAN component lists
+
+  \author Sven Duscha
+
+  \date 18.06.10.
+
+  <h3>Synopsis</h3>
+
+  Reads the CLEANCOMPONENTS table written by rmBatchSynth -K (see
+  RM::rmCleanComponents) and convolves the components of the selected
+  lines of sight with the restoring Gaussian. Only the table rows of the
+  selected lines of sight are read, so sub-regions of a large survey are
+  restored on demand. The lines of sight are restored in tiles with
+  batched FFTs (RM::rmBatchConvolver), for which the beam is transformed
+  and planned once (with the FFTW wisdom in rmclean.wisdom of the run
+  directory); with -d the components are summed directly and only
+  the selected Faraday depths are computed.
+  The restored spectra are written as a complex128 .npy array
+  [phi][line of sight], the layout of the rmBatchSynth output. Residuals
+  are not part of the component lists and are not added.
+*/
+
+#include <iostream>
+#include <unistd.h>		// getopt
+#include <stdlib.h>
+#include <math.h>
+
+#include <rmNpy.h>		// .npy output
+#include <rmCleanComponents.h>	// sparse CLEAN models
+#include <rmBatchConvolver.h>	// batched restore
+#include <rmclean.h>		// FFTW wisdom
+
+using namespace std;
+
+//_______________________________________________________________________________
+//                                                                          usage
+
+/*!
+  \brief Show usage of command line arguments
+*/
+void usage(char * const argv[])
+{
+  cout << "usage: " << argv[0] << " <options>" << endl;
+  cout << "-i <components.fits> CLEAN component lists (rmBatchSynth -K)" << endl;
+  cout << "-o <restored.npy> restored Faraday spectra [phi][line of sight]" << endl;
+  cout << "-l <first> first line of sight (0-based, default 0)" << endl;
+  cout << "-n <nlos> number of lines of sight (default: to the end)" << endl;
+  cout << "-a <min> (Minimum Faraday depth, default first of table)" << endl;
+  cout << "-b <max> (Maximum Faraday depth, default last of table)" << endl;
+  cout << "-w <fwhm> FWHM of restoring beam in rad/m^2 (default FWHM of table)" << endl;
+  cout << "-d restore by direct summation instead of batched FFTs" << endl;
+  cout << "-h shows this usage help info" << endl;
+}
+
+//_______________________________________________________________________________
+//                                                                           main
+
+int main (int argc, char * const argv[])
+{
+  int c;
+  string filenameComponents;		// input component lists
+  string filenameRestored;		// restored Faraday spectra output
+  uint64_t firstLos (0);
+  uint64_t nlos (0);
+  double minFaradayDepth (0.0);
+  double maxFaradayDepth (0.0);
+  bool minGiven (false), maxGiven (false);
+  double fwhm (0.0);
+  bool direct (false);
+
+  try {
+    if(argc<3) {
+      usage(argv);
+      return 0;
+    }
+
+    while ((c = getopt (argc, argv, "i:o:l:n:a:b:w:dh")) != -1)
+      {
+	switch (c)
+	  {
+	  case 'i':
+	    filenameComponents=optarg;
+	    break;
+	  case 'o':
+	    filenameRestored=optarg;
+	    break;
+	  case 'l':
+	    firstLos=strtoull(optarg, NULL, 10);
+	    break;
+	  case 'n':
+	    nlos=strtoull(optarg, NULL, 10);
+	    break;
+	  case 'a':
+	    minFaradayDepth=atof(optarg);
+	    minGiven=true;
+	    break;
+	  case 'b':
+	    maxFaradayDepth=atof(optarg);
+	    maxGiven=true;
+	    break;
+	  case 'w':
+	    fwhm=atof(optarg);
+	    break;
+	  case 'd':
+	    direct=true;
+	    break;
+	  case 'h':
+	    usage(argv);
+	    return 0;
+	  default:
+	    usage(argv);
+	    return 1;
+	  }
+      }
+
+    if(filenameComponents=="")
+      throw "rmrestore: no component lists given (-i)";
+    if(filenameRestored=="")
+      throw "rmrestore: no output given (-o)";
+
+    RM::rmCleanComponents components;
+    components.read(filenameComponents, firstLos, nlos);
+    if(fwhm > 0)
+      components.setFWHM(fwhm);
+    if(components.getFWHM() <= 0)
+      throw "rmrestore: table has no restoring FWHM, give one with -w";
+
+    // Faraday depth range as indices into the spectra
+    const double phi0=components.getPhi0();
+    const double dphi=components.getDeltaPhi();
+    if(!minGiven)
+      minFaradayDepth=min(phi0, phi0+(components.getNumPhis()-1.0)*dphi);
+    if(!maxGiven)
+      maxFaradayDepth=max(phi0, phi0+(components.getNumPhis()-1.0)*dphi);
+    double from=(minFaradayDepth-phi0)/dphi, to=(maxFaradayDepth-phi0)/dphi;
+    if(from > to)
+      swap(from, to);
+    long first=max(static_cast<long>(ceil(from-1e-9)), 0L);
+    long last=min(static_cast<long>(floor(to+1e-9)), static_cast<long>(components.getNumPhis())-1);
+    if(first > last)
+      throw "rmrestore: Faraday depth range is empty";
+
+    const unsigned int nphis=last-first+1;
+    const uint64_t nspectra=components.getNumLinesOfSight();
+    if(nspectra==0)
+      throw "rmrestore: no lines of sight selected";
+
+    cout << "rmrestore: " << nspectra << " lines of sight from " << firstLos
+	 << ", Faraday depths " << phi0+first*dphi << " to " << phi0+last*dphi
+	 << " (" << components.getNumComponents() << " components)" << endl;
+
+    // line of sight l is restored[i*nspectra+l]
+    vector<complex<double> > restored(static_cast<uint64_t>(nphis)*nspectra);
+    if(direct)
+      for(uint64_t l=0; l<nspectra; l++)
+	components.restore(l, first, nphis, &restored[l], nspectra);
+    else
+      {
+	vector<complex<double> > beam;
+	unsigned int centre;
+	components.getRestoringBeam(beam, centre);
+	rmclean::importWisdom("rmclean.wisdom");
+	RM::rmBatchConvolver convolver(beam, centre, components.getNumPhis());
+	try
+	  {
+	    rmclean::exportWisdom("rmclean.wisdom");
+	  }
+	catch (const char *s)
+	  {
+	    cerr << "rmclean.wisdom: " << s << endl;
+	  }
+
+	// tiles of whole spectra [los][phi], the selected Faraday depths are copied out
+	const unsigned int ntile=convolver.getBatchSize();
+	const unsigned int nall=components.getNumPhis();
+	vector<complex<double> > tile(static_cast<uint64_t>(ntile)*nall);
+	for(uint64_t t=0; t<nspectra; t+=ntile)
+	  {
+	    const uint64_t rows=min<uint64_t>(ntile, nspectra-t);
+	    components.restore(convolver, t, rows, &tile[0]);
+	    for(uint64_t l=0; l<rows; l++)
+	      for(unsigned int i=0; i<nphis; i++)
+		restored[i*nspectra+t+l]=tile[l*nall+first+i];
+	  }
+      }
+
+    RM::rmNpy::write(filenameRestored, reinterpret_cast<const double*>(&restored[0]), nphis, nspectra, true);
+  }
+  catch (const char *s) {
+    cerr << s << endl;
+    return 1;
+  }
+
+  return 0;
+}
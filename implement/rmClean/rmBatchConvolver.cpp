@@ -0,0 +1,196 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <algorithm>
+#include <string.h>
+#include "rmBatchConvolver.h"
+#include "rmclean.h"
+
+using namespace std;
+
+namespace RM {
+
+  //_____________________________________________________________________________
+  //                                                                      fftSize
+
+  //! Smallest length >= n with only the prime factors 2, 3, 5 and 7
+  static unsigned int fftSize (unsigned int n)
+  {
+    for(unsigned int m=max(n, 1u); ; m++)
+    {
+      unsigned int r=m;
+      const unsigned int primes[4]={2, 3, 5, 7};
+      for(unsigned int p=0; p<4; p++)
+        while(r % primes[p]==0)
+          r/=primes[p];
+      if(r==1)
+        return m;
+    }
+  }
+
+  // ============================================================================
+  //
+  //  Construction / Destruction
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                             rmBatchConvolver
+
+  /*!
+    out[i] = sum_k in[k]*kernel[centre+i-k], so the RMSF of rmclean (2N
+    elements, centre N) and a Gaussian of 2N-1 elements (centre N-1) are
+    both used as they are. Kernel elements further than nphis-1 from the
+    centre cannot reach a spectrum and are ignored.
+
+    \param &kernel - convolution kernel
+    \param centre - index of the kernel element at Faraday depth offset 0
+    \param nphis - number of Faraday depths per spectrum
+    \param batch - number of spectra per FFT call (default 256)
+  */
+  rmBatchConvolver::rmBatchConvolver (const vector<complex<double> > &kernel,
+                                      unsigned int centre,
+                                      unsigned int nphis,
+                                      unsigned int batch)
+  {
+    if(nphis==0)
+      throw "rmBatchConvolver::rmBatchConvolver nphis is 0";
+    if(batch==0)
+      throw "rmBatchConvolver::rmBatchConvolver batch is 0";
+    if(centre>=kernel.size())
+      throw "rmBatchConvolver::rmBatchConvolver centre is outside of kernel";
+
+    this->nphis=nphis;
+    this->batch=batch;
+
+    // offsets [-reachLeft, reachRight] of the kernel a spectrum can see
+    const unsigned int reachLeft=min(centre, nphis-1);
+    const unsigned int reachRight=min(static_cast<unsigned int>(kernel.size())-1-centre, nphis-1);
+    padded=fftSize(nphis+max(reachLeft, reachRight));
+
+    buffer=static_cast<fftw_complex*>(fftw_malloc(sizeof(fftw_complex)*padded*batch));
+    if(buffer==NULL)
+      throw "rmBatchConvolver::rmBatchConvolver could not allocate buffer";
+
+    // the batch plans run many times, the kernel transform only once
+    vector<complex<double> > wrapped(padded, complex<double>(0, 0));
+    FTkernel.resize(padded);
+    int n=padded;
+    rmclean::lockPlanner();
+    planForward=fftw_plan_many_dft(1, &n, batch, buffer, NULL, 1, padded,
+                                   buffer, NULL, 1, padded, FFTW_FORWARD, FFTW_MEASURE);
+    planBackward=fftw_plan_many_dft(1, &n, batch, buffer, NULL, 1, padded,
+                                    buffer, NULL, 1, padded, FFTW_BACKWARD, FFTW_MEASURE);
+    fftw_plan planKernel=fftw_plan_dft_1d(padded, reinterpret_cast<fftw_complex*>(&wrapped[0]),
+                                          reinterpret_cast<fftw_complex*>(&FTkernel[0]),
+                                          FFTW_FORWARD, FFTW_ESTIMATE);
+    rmclean::unlockPlanner();
+    if(planForward==NULL || planBackward==NULL || planKernel==NULL)
+      throw "rmBatchConvolver::rmBatchConvolver could not plan FFTs";
+
+    for(unsigned int d=0; d<=reachRight; d++)
+      wrapped[d]=kernel[centre+d];
+    for(unsigned int d=1; d<=reachLeft; d++)
+      wrapped[padded-d]=kernel[centre-d];
+    fftw_execute(planKernel);
+    for(unsigned int j=0; j<padded; j++)
+      FTkernel[j]/=padded;			// FFTW transforms are not normalised
+
+    rmclean::lockPlanner();
+    fftw_destroy_plan(planKernel);
+    rmclean::unlockPlanner();
+  }
+
+  //_____________________________________________________________________________
+  //                                                            ~rmBatchConvolver
+
+  rmBatchConvolver::~rmBatchConvolver ()
+  {
+    rmclean::lockPlanner();
+    fftw_destroy_plan(planForward);
+    fftw_destroy_plan(planBackward);
+    rmclean::unlockPlanner();
+    fftw_free(buffer);
+  }
+
+  // ============================================================================
+  //
+  //  Methods
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                                     convolve
+
+  /*!
+    \brief Convolve spectra in batches of getBatchSize() with the kernel
+
+    Spectrum l is read from in[l*losStride+i*phiStride], i=0..nphis-1, and
+    its convolution is written to the same position of out, which may be in.
+
+    \param *in - spectra to convolve
+    \param *out - convolved spectra
+    \param nlos - number of spectra
+    \param phiStride - distance between Faraday depths of one spectrum (default 1)
+    \param losStride - distance between spectra (default 0: nphis*phiStride)
+  */
+  void rmBatchConvolver::convolve (const complex<double> *in,
+                                   complex<double> *out,
+                                   uint64_t nlos,
+                                   uint64_t phiStride,
+                                   uint64_t losStride)
+  {
+    if(in==NULL || out==NULL)
+      throw "rmBatchConvolver::convolve data is NULL";
+    if(phiStride==0)
+      throw "rmBatchConvolver::convolve phiStride is 0";
+    if(losStride==0)
+      losStride=nphis*phiStride;
+
+    complex<double> *rows=reinterpret_cast<complex<double>*>(buffer);
+
+    for(uint64_t first=0; first<nlos; first+=batch)
+    {
+      const unsigned int nrows=min<uint64_t>(batch, nlos-first);
+
+      memset(buffer, 0, sizeof(fftw_complex)*padded*nrows);
+      for(unsigned int r=0; r<nrows; r++)
+      {
+        const complex<double> *spectrum=in+(first+r)*losStride;
+        for(unsigned int i=0; i<nphis; i++)
+          rows[r*padded+i]=spectrum[i*phiStride];
+      }
+
+      fftw_execute(planForward);
+      for(unsigned int r=0; r<nrows; r++)
+        for(unsigned int j=0; j<padded; j++)
+          rows[r*padded+j]*=FTkernel[j];
+      fftw_execute(planBackward);
+
+      for(unsigned int r=0; r<nrows; r++)
+      {
+        complex<double> *spectrum=out+(first+r)*losStride;
+        for(unsigned int i=0; i<nphis; i++)
+          spectrum[i*phiStride]=rows[r*padded+i];
+      }
+    }
+  }
+
+}  // END -- namespace RM
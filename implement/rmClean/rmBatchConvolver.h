@@ -0,0 +1,110 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef RMBATCHCONVOLVER_H
+#define RMBATCHCONVOLVER_H
+
+#include <vector>
+#include <complex>
+#include <stdint.h>
+#include <fftw3.h>
+
+namespace RM {
+
+  /*!
+    \class rmBatchConvolver
+
+    \ingroup RM
+
+    \brief Convolution of many spectra with one kernel in batched FFTs
+
+    \author Sven Duscha
+
+    \test trmBatchConvolver.cpp
+
+    <h3>Synopsis</h3>
+
+    All lines of sight of a cube share the channel setup, so the RMSF and
+    the restoring beam are the same for every spectrum. The Fourier
+    transform of the kernel, zero-padded to the linear convolution length,
+    is therefore computed once in the constructor, together with one pair
+    of fftw_plan_many_dft plans that transform batch spectra per call.
+    convolve() copies a batch of spectra into the padded rows, transforms
+    them forward, multiplies every row with the kernel transform and
+    transforms back, so a tile of lines of sight costs two FFTW calls
+    instead of one plan and two transforms per spectrum.
+
+    The plans are made under the rmclean planner lock and measured
+    (FFTW_MEASURE), so they profit from wisdom imported with
+    rmclean::importWisdom. convolve() works on a buffer of the object, use
+    one rmBatchConvolver per thread.
+  */
+  class rmBatchConvolver {
+
+  private:
+
+    //! number of Faraday depths per spectrum
+    unsigned int nphis;
+    //! padded (FFT) length, long enough that the circular convolution does not wrap
+    unsigned int padded;
+    //! number of spectra per FFT call
+    unsigned int batch;
+    //! Fourier transform of the padded kernel, scaled by 1/padded
+    std::vector<std::complex<double> > FTkernel;
+    //! batch rows of padded elements
+    fftw_complex *buffer;
+    fftw_plan planForward;
+    fftw_plan planBackward;
+
+    // no copies of plans and buffer
+    rmBatchConvolver (const rmBatchConvolver &);
+    rmBatchConvolver &operator= (const rmBatchConvolver &);
+
+  public:
+
+    // === Construction =========================================================
+
+    //! Prepare convolving spectra of nphis Faraday depths with kernel
+    rmBatchConvolver (const std::vector<std::complex<double> > &kernel,
+                      unsigned int centre,
+                      unsigned int nphis,
+                      unsigned int batch=256);
+
+    // === Destruction ==========================================================
+
+    ~rmBatchConvolver ();
+
+    // === Methods ==============================================================
+
+    //! Convolve nlos spectra of in with the kernel into out
+    void convolve (const std::complex<double> *in,
+                   std::complex<double> *out,
+                   uint64_t nlos,
+                   uint64_t phiStride=1,
+                   uint64_t losStride=0);
+
+    inline unsigned int getNumPhis () const { return nphis; }
+    inline unsigned int getBatchSize () const { return batch; }
+    inline unsigned int getPaddedLength () const { return padded; }
+  };
+
+}  // END -- namespace RM
+
+#endif
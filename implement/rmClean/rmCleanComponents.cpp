@@ -0,0 +1,403 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <iostream>
+#include <math.h>
+#include "rmCleanComponents.h"
+#include "rmBatchConvolver.h"
+#include "rmFITStable.h"
+
+using namespace std;
+
+namespace RM {
+
+  // ============================================================================
+  //
+  //  Construction
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                            rmCleanComponents
+
+  /*!
+    \param nphis - number of Faraday depths of the dense spectra
+    \param phi0 - first Faraday depth in rad/m^2 (default 0)
+    \param dphi - Faraday depth step in rad/m^2 (default 1)
+    \param fwhm - FWHM of the restoring Gaussian in rad/m^2 (default 0: not set)
+  */
+  rmCleanComponents::rmCleanComponents (unsigned int nphis,
+                                        double phi0,
+                                        double dphi,
+                                        double fwhm)
+  {
+    if(dphi==0)
+      throw "rmCleanComponents::rmCleanComponents dphi is 0";
+    if(fwhm < 0)
+      throw "rmCleanComponents::rmCleanComponents fwhm < 0";
+
+    this->nphis=nphis;
+    this->phi0=phi0;
+    this->dphi=dphi;
+    this->fwhm=fwhm;
+    offsets.assign(1, 0);
+  }
+
+  // ============================================================================
+  //
+  //  Methods
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                                        clear
+
+  void rmCleanComponents::clear ()
+  {
+    offsets.assign(1, 0);
+    phiIndices.clear();
+    fluxes.clear();
+  }
+
+  //_____________________________________________________________________________
+  //                                                                      setFWHM
+
+  void rmCleanComponents::setFWHM (double fwhm)
+  {
+    if(fwhm <= 0)
+      throw "rmCleanComponents::setFWHM fwhm <= 0";
+    this->fwhm=fwhm;
+  }
+
+  //_____________________________________________________________________________
+  //                                                                       append
+
+  /*!
+    \param *model - dense CLEAN model of nphis Faraday depths
+    \param stride - distance between Faraday depths in model (default 1)
+  */
+  void rmCleanComponents::append (const complex<double> *model,
+                                  uint64_t stride)
+  {
+    if(model==NULL)
+      throw "rmCleanComponents::append model is NULL";
+
+    for(unsigned int i=0; i<nphis; i++)
+    {
+      const complex<double> &flux=model[i*stride];
+      if(flux.real()!=0 || flux.imag()!=0)
+      {
+        phiIndices.push_back(i);
+        fluxes.push_back(flux);
+      }
+    }
+    offsets.push_back(fluxes.size());
+  }
+
+  //_____________________________________________________________________________
+  //                                                                       append
+
+  /*!
+    \param &other - component lists to append after the last line of sight
+  */
+  void rmCleanComponents::append (const rmCleanComponents &other)
+  {
+    if(other.nphis!=nphis)
+      throw "rmCleanComponents::append number of Faraday depths differs";
+
+    const uint64_t base=fluxes.size();
+    phiIndices.insert(phiIndices.end(), other.phiIndices.begin(), other.phiIndices.end());
+    fluxes.insert(fluxes.end(), other.fluxes.begin(), other.fluxes.end());
+    for(uint64_t l=1; l<other.offsets.size(); l++)
+      offsets.push_back(base+other.offsets[l]);
+  }
+
+  //_____________________________________________________________________________
+  //                                                                      restore
+
+  /*!
+    \brief Convolve the components of one line of sight with the restoring
+    Gaussian (peak 1), only over the Faraday depths that are asked for
+
+    Gaussian tails beyond 4 FWHM (below 1e-19) are skipped, so the cost is
+    the number of components times the Gaussian support.
+
+    \param los - line of sight
+    \param firstPhi - first Faraday depth (index) to restore
+    \param n - number of Faraday depths to restore
+    \param *restored - restored spectrum, restored[(i-firstPhi)*stride]
+    \param stride - distance between Faraday depths in restored (default 1)
+  */
+  void rmCleanComponents::restore (uint64_t los,
+                                   unsigned int firstPhi,
+                                   unsigned int n,
+                                   complex<double> *restored,
+                                   uint64_t stride) const
+  {
+    if(restored==NULL)
+      throw "rmCleanComponents::restore restored is NULL";
+    if(los >= getNumLinesOfSight())
+      throw "rmCleanComponents::restore line of sight out of range";
+    if(fwhm <= 0)
+      throw "rmCleanComponents::restore no restoring FWHM set";
+
+    const double width=fwhm/fabs(dphi);			// FWHM in channels
+    const double factor=-4*log(2.0)/(width*width);
+    const long support=static_cast<long>(ceil(4*width));
+    const long last=static_cast<long>(firstPhi)+n;
+
+    for(unsigned int i=0; i<n; i++)
+      restored[i*stride]=0;
+
+    for(uint64_t c=offsets[los]; c<offsets[los+1]; c++)
+    {
+      const long pos=phiIndices[c];
+      const long from=max(pos-support, static_cast<long>(firstPhi));
+      const long to=min(pos+support+1, last);
+      for(long i=from; i<to; i++)
+        restored[(i-firstPhi)*stride]+=fluxes[c]*exp(factor*(i-pos)*(i-pos));
+    }
+  }
+
+  //_____________________________________________________________________________
+  //                                                                      restore
+
+  /*!
+    \brief Restore all Faraday depths of many lines of sight with batched FFTs
+
+    The dense models are written into restored and convolved in place with
+    beam, which holds the transform of the restoring Gaussian
+    (getRestoringBeam), so the beam is transformed and planned once for all
+    calls. This is faster than the direct sum when there are many
+    components per line of sight or the beam is wide.
+
+    \param &beam - convolver made from getRestoringBeam for getNumPhis() Faraday depths
+    \param firstLos - first line of sight to restore
+    \param nlos - number of lines of sight
+    \param *restored - restored spectra, line of sight firstLos+l at restored[l*losStride+i*phiStride]
+    \param phiStride - distance between Faraday depths (default 1)
+    \param losStride - distance between spectra (default 0: nphis*phiStride)
+  */
+  void rmCleanComponents::restore (rmBatchConvolver &beam,
+                                   uint64_t firstLos,
+                                   uint64_t nlos,
+                                   complex<double> *restored,
+                                   uint64_t phiStride,
+                                   uint64_t losStride) const
+  {
+    if(restored==NULL)
+      throw "rmCleanComponents::restore restored is NULL";
+    if(firstLos+nlos > getNumLinesOfSight())
+      throw "rmCleanComponents::restore line of sight out of range";
+    if(beam.getNumPhis()!=nphis)
+      throw "rmCleanComponents::restore beam is for a different number of Faraday depths";
+    if(losStride==0)
+      losStride=nphis*phiStride;
+
+    for(uint64_t l=0; l<nlos; l++)
+      model(firstLos+l, restored+l*losStride, phiStride);
+    beam.convolve(restored, restored, nlos, phiStride, losStride);
+  }
+
+  //_____________________________________________________________________________
+  //                                                                        model
+
+  /*!
+    \param los - line of sight
+    \param *model - dense CLEAN model, model[i*stride] for i=0..nphis-1
+    \param stride - distance between Faraday depths in model (default 1)
+  */
+  void rmCleanComponents::model (uint64_t los,
+                                 complex<double> *model,
+                                 uint64_t stride) const
+  {
+    if(model==NULL)
+      throw "rmCleanComponents::model model is NULL";
+    if(los >= getNumLinesOfSight())
+      throw "rmCleanComponents::model line of sight out of range";
+
+    for(unsigned int i=0; i<nphis; i++)
+      model[i*stride]=0;
+    for(uint64_t c=offsets[los]; c<offsets[los+1]; c++)
+      model[phiIndices[c]*stride]+=fluxes[c];
+  }
+
+  //_____________________________________________________________________________
+  //                                                             getRestoringBeam
+
+  /*!
+    \brief Get the restoring Gaussian (peak 1) sampled on the Faraday depth axis
+
+    The Gaussian is cut at 4 FWHM like in the direct restore.
+
+    \param &beam - Gaussian of 2*centre+1 elements
+    \param &centre - index of the peak
+  */
+  void rmCleanComponents::getRestoringBeam (vector<complex<double> > &beam,
+                                            unsigned int &centre) const
+  {
+    if(fwhm <= 0)
+      throw "rmCleanComponents::getRestoringBeam no restoring FWHM set";
+
+    const double width=fwhm/fabs(dphi);			// FWHM in channels
+    const double factor=-4*log(2.0)/(width*width);
+    centre=static_cast<unsigned int>(ceil(4*width));
+
+    beam.resize(2*centre+1);
+    for(unsigned int i=0; i<beam.size(); i++)
+    {
+      const double d=static_cast<double>(i)-centre;
+      beam[i]=exp(factor*d*d);
+    }
+  }
+
+  // ============================================================================
+  //
+  //  FITS I/O
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                                        write
+
+  /*!
+    \param &filename - name of FITS file
+    \param overwrite - replace an existing file, otherwise append the table (default true)
+  */
+  void rmCleanComponents::write (const string &filename,
+                                 bool overwrite) const
+  {
+    rmFITStable table(filename, overwrite);
+    vector<double> indices, q, u;
+
+    table.addColumn("CC_PHI_INDEX", "1PJ");
+    table.addColumn("CC_Q", "1PE", "Jy/beam");
+    table.addColumn("CC_U", "1PE", "Jy/beam");
+    table.create("CLEANCOMPONENTS");
+    table.writeKey("NPHIS", nphis, "number of Faraday depths");
+    table.writeKey("PHI0", phi0, "[rad/m^2] first Faraday depth");
+    table.writeKey("DPHI", dphi, "[rad/m^2] Faraday depth step");
+    table.writeKey("FWHM", fwhm, "[rad/m^2] FWHM of restoring beam");
+
+    for(uint64_t l=0; l<getNumLinesOfSight(); l++)
+    {
+      indices.clear();
+      q.clear();
+      u.clear();
+      for(uint64_t c=offsets[l]; c<offsets[l+1]; c++)
+      {
+        indices.push_back(phiIndices[c]);
+        q.push_back(fluxes[c].real());
+        u.push_back(fluxes[c].imag());
+      }
+      table.setArray(0, indices);
+      table.setArray(1, q);
+      table.setArray(2, u);
+      table.nextRow();
+    }
+
+    table.close();
+  }
+
+  //_____________________________________________________________________________
+  //                                                                         read
+
+  /*!
+    \brief Read the lists of a range of lines of sight from a CLEANCOMPONENTS table
+
+    \param &filename - name of FITS file
+    \param firstLos - first line of sight (0-based) to read (default 0)
+    \param nlos - number of lines of sight to read (default 0: to the end)
+  */
+  void rmCleanComponents::read (const string &filename,
+                                uint64_t firstLos,
+                                uint64_t nlos)
+  {
+    fitsfile *fptr=NULL;
+    int status=0;
+    LONGLONG nrows=0;
+    long keyvalue=0;
+    char fits_error_message[FLEN_STATUS];
+
+    if(fits_open_file(&fptr, filename.c_str(), READONLY, &status) ||
+       fits_movnam_hdu(fptr, BINARY_TBL, const_cast<char*>("CLEANCOMPONENTS"), 0, &status) ||
+       fits_get_num_rowsll(fptr, &nrows, &status) ||
+       fits_read_key(fptr, TLONG, "NPHIS", &keyvalue, NULL, &status) ||
+       fits_read_key(fptr, TDOUBLE, "PHI0", &phi0, NULL, &status) ||
+       fits_read_key(fptr, TDOUBLE, "DPHI", &dphi, NULL, &status) ||
+       fits_read_key(fptr, TDOUBLE, "FWHM", &fwhm, NULL, &status))
+    {
+      fits_get_errstatus(status, fits_error_message);
+      cerr << fits_error_message << endl;
+      status=0;
+      if(fptr!=NULL)
+        fits_close_file(fptr, &status);
+      throw "rmCleanComponents::read could not open CLEANCOMPONENTS table";
+    }
+    nphis=keyvalue;
+
+    if(nlos==0)
+      nlos=(firstLos < static_cast<uint64_t>(nrows)) ? nrows-firstLos : 0;
+    if(firstLos+nlos > static_cast<uint64_t>(nrows))
+    {
+      fits_close_file(fptr, &status);
+      throw "rmCleanComponents::read lines of sight beyond the table";
+    }
+
+    clear();
+    vector<double> q, u;
+    for(uint64_t l=0; l<nlos && status==0; l++)
+    {
+      LONGLONG row=firstLos+l+1;
+      LONGLONG repeat=0, offset=0;
+      fits_read_descriptll(fptr, 1, row, &repeat, &offset, &status);
+
+      const uint64_t first=fluxes.size();
+      phiIndices.resize(first+repeat);
+      fluxes.resize(first+repeat);
+      q.resize(repeat);
+      u.resize(repeat);
+      if(repeat > 0)
+      {
+        fits_read_col(fptr, TUINT, 1, row, 1, repeat, NULL, &phiIndices[first], NULL, &status);
+        fits_read_col(fptr, TDOUBLE, 2, row, 1, repeat, NULL, &q[0], NULL, &status);
+        fits_read_col(fptr, TDOUBLE, 3, row, 1, repeat, NULL, &u[0], NULL, &status);
+      }
+      for(LONGLONG c=0; c<repeat; c++)
+        fluxes[first+c]=complex<double>(q[c], u[c]);
+      offsets.push_back(fluxes.size());
+    }
+
+    if(status)
+    {
+      fits_get_errstatus(status, fits_error_message);
+      cerr << fits_error_message << endl;
+      status=0;
+      fits_close_file(fptr, &status);
+      throw "rmCleanComponents::read could not read components";
+    }
+    fits_close_file(fptr, &status);
+
+    for(uint64_t c=0; c<phiIndices.size(); c++)
+      if(phiIndices[c] >= nphis)
+        throw "rmCleanComponents::read Faraday depth index out of range";
+  }
+
+}  // END -- namespace RM
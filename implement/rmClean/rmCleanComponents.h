@@ -0,0 +1,145 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef RMCLEANCOMPONENTS_H
+#define RMCLEANCOMPONENTS_H
+
+#include <string>
+#include <vector>
+#include <complex>
+#include <stdint.h>
+
+namespace RM {
+
+  class rmBatchConvolver;
+
+  /*!
+    \class rmCleanComponents
+
+    \ingroup RM
+
+    \brief Sparse CLEAN component lists of many lines of sight
+
+    \author Sven Duscha
+
+    \test trmCleanComponents.cpp
+
+    <h3>Synopsis</h3>
+
+    A CLEAN model has only a few non-zero Faraday depths per line of sight.
+    The lists are therefore kept in compressed sparse row (CSR) form: the
+    components of line of sight l are [offsets[l], offsets[l+1]) of the
+    Faraday depth index and flux (Q+iU) arrays.
+
+    In FITS the lists are a binary table CLEANCOMPONENTS with one row per
+    line of sight and the variable-length array columns CC_PHI_INDEX (1PJ),
+    CC_Q and CC_U (1PE). The header keywords NPHIS, PHI0, DPHI and FWHM
+    give the Faraday depth axis and the restoring beam. restore() rebuilds
+    dense restored spectra, or any range of them, from the lists, either by
+    a direct sum over the components or for whole tiles of lines of sight
+    in batched FFTs with an rmBatchConvolver.
+  */
+  class rmCleanComponents {
+
+  private:
+
+    //! number of Faraday depths of the dense spectra
+    unsigned int nphis;
+    //! first Faraday depth (rad/m^2)
+    double phi0;
+    //! Faraday depth step (rad/m^2)
+    double dphi;
+    //! FWHM of the restoring Gaussian (rad/m^2)
+    double fwhm;
+    //! first component of every line of sight, offsets[nlos] is the total
+    std::vector<uint64_t> offsets;
+    //! Faraday depth index of every component
+    std::vector<uint32_t> phiIndices;
+    //! flux (Q+iU) of every component
+    std::vector<std::complex<double> > fluxes;
+
+  public:
+
+    // === Construction =========================================================
+
+    //! Create empty lists for spectra of nphis Faraday depths
+    rmCleanComponents (unsigned int nphis=0,
+                       double phi0=0,
+                       double dphi=1,
+                       double fwhm=0);
+
+    // === Methods ==============================================================
+
+    //! Remove all lines of sight
+    void clear ();
+    //! Append the non-zero elements of a dense model as the next line of sight
+    void append (const std::complex<double> *model,
+                 uint64_t stride=1);
+    //! Append all lines of sight of other
+    void append (const rmCleanComponents &other);
+
+    //! Restore Faraday depths [firstPhi, firstPhi+n) of line of sight los
+    void restore (uint64_t los,
+                  unsigned int firstPhi,
+                  unsigned int n,
+                  std::complex<double> *restored,
+                  uint64_t stride=1) const;
+    //! Restore nlos whole lines of sight from firstLos with a batch convolver
+    void restore (rmBatchConvolver &beam,
+                  uint64_t firstLos,
+                  uint64_t nlos,
+                  std::complex<double> *restored,
+                  uint64_t phiStride=1,
+                  uint64_t losStride=0) const;
+    //! Write the dense CLEAN model of line of sight los
+    void model (uint64_t los,
+                std::complex<double> *model,
+                uint64_t stride=1) const;
+    //! Get the restoring Gaussian (cut at 4 FWHM) and the index of its peak
+    void getRestoringBeam (std::vector<std::complex<double> > &beam,
+                           unsigned int &centre) const;
+
+    //! Write the lists as a binary table to filename
+    void write (const std::string &filename,
+                bool overwrite=true) const;
+    //! Read nlos lines of sight starting at firstLos (nlos=0: all) from filename
+    void read (const std::string &filename,
+               uint64_t firstLos=0,
+               uint64_t nlos=0);
+
+    inline uint64_t getNumLinesOfSight () const { return offsets.size()-1; }
+    inline uint64_t getNumComponents () const { return offsets.back(); }
+    //! Get the number of components of line of sight los
+    inline uint64_t getNumComponents (uint64_t los) const { return offsets[los+1]-offsets[los]; }
+    //! Get the Faraday depth indices of the components of line of sight los
+    inline const uint32_t *getPhiIndices (uint64_t los) const { return phiIndices.empty() ? NULL : &phiIndices[0]+offsets[los]; }
+    //! Get the fluxes (Q+iU) of the components of line of sight los
+    inline const std::complex<double> *getFluxes (uint64_t los) const { return fluxes.empty() ? NULL : &fluxes[0]+offsets[los]; }
+
+    inline unsigned int getNumPhis () const { return nphis; }
+    inline double getPhi0 () const { return phi0; }
+    inline double getDeltaPhi () const { return dphi; }
+    inline double getFWHM () const { return fwhm; }
+    void setFWHM (double fwhm);
+  };
+
+}  // END -- namespace RM
+
+#endif
@@ -0,0 +1,425 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <iostream>
+#include "rmCleanCube.h"
+
+using namespace std;
+
+namespace RM {
+
+  // ============================================================================
+  //
+  //  Construction / Destruction
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                                  rmCleanCube
+
+  /*!
+    \param &rmsf - RMSF over at least twice the Faraday depth range, peak 1 at its centre
+    \param nphis - number of Faraday depths per line of sight
+    \param nthreads - number of worker threads (default 1)
+    \param &wisdomFile - FFTW wisdom file to import and export ("" for none)
+  */
+  rmCleanCube::rmCleanCube (const vector<complex<double> > &rmsf,
+                            unsigned int nphis,
+                            unsigned int nthreads,
+                            const string &wisdomFile)
+  {
+    if(nphis==0)
+      throw "rmCleanCube::rmCleanCube nphis is 0";
+    if(nthreads==0)
+      throw "rmCleanCube::rmCleanCube nthreads is 0";
+    if(rmsf.size() < 2*nphis)
+      throw "rmCleanCube::rmCleanCube RMSF must be at least twice the size of a spectrum";
+
+    this->rmsf=rmsf;
+    this->nphis=nphis;
+    this->nthreads=nthreads;
+    this->wisdomFile=wisdomFile;
+    wisdomExported=false;
+    workspaces.assign(nthreads, static_cast<rmclean*>(NULL));
+    rmsfConvolver=NULL;
+
+    algorithm=CLEAN_RMSF;
+    gain=0.1;
+    threshold=0.01;
+    fwhm=0;
+    maxIterations=1000;
+    noiseMultiple=0;
+    noiseRange=0;
+
+    dirty=NULL;
+    cleaned=NULL;
+    nlos=phiStride=losStride=next=numIterations=0;
+    chunk=64;
+    error=NULL;
+    pthread_mutex_init(&mutex, NULL);
+
+    if(wisdomFile!="")
+      rmclean::importWisdom(wisdomFile);
+  }
+
+  //_____________________________________________________________________________
+  //                                                                 ~rmCleanCube
+
+  rmCleanCube::~rmCleanCube ()
+  {
+    for(unsigned int i=0; i<workspaces.size(); i++)
+      delete workspaces[i];
+    delete rmsfConvolver;
+
+    pthread_mutex_destroy(&mutex);
+  }
+
+  // ============================================================================
+  //
+  //  Parameters
+  //
+  // ============================================================================
+
+  void rmCleanCube::setAlgorithm (int algorithm)
+  {
+    if(algorithm!=CLEAN_RMSF && algorithm!=CLEAN_CLARK)
+      throw "rmCleanCube::setAlgorithm unknown algorithm";
+    this->algorithm=algorithm;
+  }
+
+  void rmCleanCube::setGain (double gain)
+  {
+    if(gain<=0 || gain>=2)
+      throw "rmCleanCube::setGain gain not in (0,2)";
+    this->gain=gain;
+  }
+
+  void rmCleanCube::setThreshold (double threshold)
+  {
+    if(threshold<0)
+      throw "rmCleanCube::setThreshold threshold < 0";
+    this->threshold=threshold;
+  }
+
+  void rmCleanCube::setFWHM (double fwhm)
+  {
+    if(fwhm<=0)
+      throw "rmCleanCube::setFWHM fwhm <= 0";
+    this->fwhm=fwhm;
+  }
+
+  void rmCleanCube::setNoiseMultiple (double multiple)
+  {
+    if(multiple<0)
+      throw "rmCleanCube::setNoiseMultiple multiple < 0";
+    this->noiseMultiple=multiple;
+  }
+
+  void rmCleanCube::setNoiseRange (double fraction)
+  {
+    if(fraction<0 || fraction>=0.5)
+      throw "rmCleanCube::setNoiseRange fraction not in [0,0.5)";
+    this->noiseRange=fraction;
+  }
+
+  // ============================================================================
+  //
+  //  Methods
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                                        clean
+
+  /*!
+    \brief Clean all lines of sight with the worker pool
+
+    Spectrum l is read from dirty[l*losStride+i*phiStride], i=0..nphis-1,
+    and its clean spectrum is written to the same position of cleaned.
+
+    \param *dirty - dirty Faraday spectra
+    \param *cleaned - clean Faraday spectra (may not alias dirty)
+    \param nlos - number of lines of sight
+    \param phiStride - distance between Faraday depths of one spectrum (default 1)
+    \param losStride - distance between spectra (default 0: nphis*phiStride)
+  */
+  void rmCleanCube::clean (const complex<double> *dirty,
+                           complex<double> *cleaned,
+                           uint64_t nlos,
+                           uint64_t phiStride,
+                           uint64_t losStride)
+  {
+    if(cleaned==NULL)
+      throw "rmCleanCube::clean data is NULL";
+
+    this->cleaned=cleaned;
+    run(dirty, nlos, phiStride, losStride);
+  }
+
+  //_____________________________________________________________________________
+  //                                                                        clean
+
+  /*!
+    \brief Clean all lines of sight into sparse CLEAN component lists
+
+    Line of sight l of components holds the CLEAN model of spectrum
+    dirty[l*losStride+i*phiStride] (for Clark CLEAN the components, not
+    the restored spectrum). Existing lists in components are replaced.
+
+    \param *dirty - dirty Faraday spectra
+    \param &components - component lists of spectra with nphis Faraday depths
+    \param nlos - number of lines of sight
+    \param phiStride - distance between Faraday depths of one spectrum (default 1)
+    \param losStride - distance between spectra (default 0: nphis*phiStride)
+  */
+  void rmCleanCube::clean (const complex<double> *dirty,
+                           rmCleanComponents &components,
+                           uint64_t nlos,
+                           uint64_t phiStride,
+                           uint64_t losStride)
+  {
+    if(components.getNumPhis()!=nphis)
+      throw "rmCleanCube::clean component lists have a different number of Faraday depths";
+
+    cleaned=NULL;
+    chunkComponents.assign((nlos+chunk-1)/chunk, rmCleanComponents(nphis));
+    run(dirty, nlos, phiStride, losStride);
+
+    components.clear();
+    for(uint64_t c=0; c<chunkComponents.size(); c++)
+      components.append(chunkComponents[c]);
+    chunkComponents.clear();
+  }
+
+  //_____________________________________________________________________________
+  //                                                                     residual
+
+  /*!
+    \brief Subtract CLEAN models convolved with the RMSF from dirty spectra
+
+    The models are convolved in tiles of lines of sight with batched FFTs
+    of the RMSF, which is transformed once per rmCleanCube. Unlike clean()
+    this runs in the calling thread.
+
+    \param *dirty - dirty Faraday spectra
+    \param *model - CLEAN models (e.g. the output of clean())
+    \param *residual - residual spectra (may be dirty)
+    \param nlos - number of lines of sight
+    \param phiStride - distance between Faraday depths of one spectrum (default 1)
+    \param losStride - distance between spectra (default 0: nphis*phiStride)
+  */
+  void rmCleanCube::residual (const complex<double> *dirty,
+                              const complex<double> *model,
+                              complex<double> *residual,
+                              uint64_t nlos,
+                              uint64_t phiStride,
+                              uint64_t losStride)
+  {
+    if(dirty==NULL || model==NULL || residual==NULL)
+      throw "rmCleanCube::residual data is NULL";
+    if(phiStride==0)
+      throw "rmCleanCube::residual phiStride is 0";
+    if(losStride==0)
+      losStride=nphis*phiStride;
+
+    if(rmsfConvolver==NULL)		// rmsf[centre+i-k] = R(phi_i - phi_k), as in rmclean::clark
+    {
+      const unsigned int centre=static_cast<unsigned int>(0.5*(rmsf.size()-nphis)+0.5)+nphis/2;
+      rmsfConvolver=new rmBatchConvolver(rmsf, centre, nphis);
+    }
+
+    const unsigned int ntile=rmsfConvolver->getBatchSize();
+    vector<complex<double> > tile(static_cast<uint64_t>(ntile)*nphis);
+    for(uint64_t t=0; t<nlos; t+=ntile)
+    {
+      const uint64_t rows=min<uint64_t>(ntile, nlos-t);
+      for(uint64_t l=0; l<rows; l++)
+        for(unsigned int i=0; i<nphis; i++)
+          tile[l*nphis+i]=model[(t+l)*losStride+i*phiStride];
+
+      rmsfConvolver->convolve(&tile[0], &tile[0], rows);
+
+      for(uint64_t l=0; l<rows; l++)
+        for(unsigned int i=0; i<nphis; i++)
+        {
+          const uint64_t pos=(t+l)*losStride+i*phiStride;
+          residual[pos]=dirty[pos]-tile[l*nphis+i];
+        }
+    }
+  }
+
+  //_____________________________________________________________________________
+  //                                                                          run
+
+  /*!
+    \brief Run the worker pool over all lines of sight and export FFTW wisdom
+  */
+  void rmCleanCube::run (const complex<double> *dirty,
+                         uint64_t nlos,
+                         uint64_t phiStride,
+                         uint64_t losStride)
+  {
+    if(dirty==NULL)
+      throw "rmCleanCube::clean data is NULL";
+    if(phiStride==0)
+      throw "rmCleanCube::clean phiStride is 0";
+    if(algorithm==CLEAN_CLARK && fwhm<=0)
+      throw "rmCleanCube::clean Clark CLEAN needs a FWHM";
+    if(threshold==0 && noiseMultiple==0)
+      throw "rmCleanCube::clean needs a threshold or a noise multiple";
+
+    this->dirty=dirty;
+    this->nlos=nlos;
+    this->phiStride=phiStride;
+    this->losStride=(losStride==0) ? nphis*phiStride : losStride;
+    next=0;
+    numIterations=0;
+    error=NULL;
+    iterations.assign(nlos, 0);
+    noiseLevels.assign(nlos, 0);
+    residualPeaks.assign(nlos, 0);
+
+    vector<pthread_t> threads(nthreads);
+    vector<workerArg> args(nthreads);
+    unsigned int started=0;
+    for(; started<nthreads; started++)
+    {
+      args[started].cube=this;
+      args[started].id=started;
+      if(pthread_create(&threads[started], NULL, worker, &args[started]))
+        break;
+    }
+    if(started==0)
+      throw "rmCleanCube::clean could not start worker threads";
+    for(unsigned int i=0; i<started; i++)
+      pthread_join(threads[i], NULL);
+
+    if(error!=NULL)
+      throw error;
+
+    // all plans exist now, later runs only import them
+    if(!wisdomExported && wisdomFile!="")
+    {
+      try
+      {
+        rmclean::exportWisdom(wisdomFile);
+      }
+      catch(const char *s)
+      {
+        cerr << wisdomFile << ": " << s << endl;
+      }
+      wisdomExported=true;
+    }
+  }
+
+  //_____________________________________________________________________________
+  //                                                                       worker
+
+  void *rmCleanCube::worker (void *arg)
+  {
+    workerArg *w=static_cast<workerArg*>(arg);
+
+    try
+    {
+      w->cube->cleanLines(w->id);
+    }
+    catch(const char *s)
+    {
+      pthread_mutex_lock(&w->cube->mutex);
+      if(w->cube->error==NULL)
+        w->cube->error=s;
+      pthread_mutex_unlock(&w->cube->mutex);
+    }
+
+    return NULL;
+  }
+
+  //_____________________________________________________________________________
+  //                                                                   cleanLines
+
+  /*!
+    \brief Worker loop: take chunks of lines of sight until all are cleaned
+
+    \param id - worker number, selects the CLEAN workspace
+  */
+  void rmCleanCube::cleanLines (unsigned int id)
+  {
+    if(workspaces[id]==NULL)
+    {
+      workspaces[id]=new rmclean(nphis);	// plans under the rmclean planner mutex
+      workspaces[id]->RMSF=rmsf;
+    }
+    rmclean &workspace=*workspaces[id];
+    workspace.setGain(gain);
+    workspace.setNoiseMultiple(noiseMultiple);
+    workspace.setNoiseRange(noiseRange);
+    if(fwhm > 0)
+      workspace.setFWHM(fwhm);
+
+    vector<complex<double> > spectrum(nphis), result(nphis);
+    uint64_t iterationSum=0;
+
+    for(;;)
+    {
+      pthread_mutex_lock(&mutex);
+      uint64_t first=next;
+      uint64_t last=(error!=NULL) ? first : min(first+chunk, nlos);
+      next=last;
+      pthread_mutex_unlock(&mutex);
+      if(first>=last)
+        break;
+
+      for(uint64_t l=first; l<last; l++)
+      {
+        const complex<double> *in=dirty+l*losStride;
+        for(unsigned int i=0; i<nphis; i++)
+          spectrum[i]=in[i*phiStride];
+
+        if(algorithm==CLEAN_CLARK)
+          result=workspace.clark(spectrum, threshold, maxIterations);
+        else
+        {
+          result.assign(nphis, complex<double>(0, 0));
+          workspace.rmsfClean(spectrum, result, threshold, maxIterations);
+        }
+        iterationSum+=workspace.getNumIterations();
+        iterations[l]=workspace.getNumIterations();
+        noiseLevels[l]=workspace.getNoiseLevel();
+        residualPeaks[l]=workspace.getResidualPeak();
+
+        if(cleaned==NULL)		// sparse output: model of this line of sight
+        {
+          if(algorithm==CLEAN_CLARK)
+            result=workspace.getCleanComponents();
+          chunkComponents[first/chunk].append(&result[0]);
+          continue;
+        }
+        complex<double> *out=cleaned+l*losStride;
+        for(unsigned int i=0; i<nphis; i++)
+          out[i*phiStride]=result[i];
+      }
+    }
+
+    pthread_mutex_lock(&mutex);
+    numIterations+=iterationSum;
+    pthread_mutex_unlock(&mutex);
+  }
+
+}  // END -- namespace RM
@@ -0,0 +1,208 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef RMCLEANCUBE_H
+#define RMCLEANCUBE_H
+
+#include <string>
+#include <vector>
+#include <complex>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "rmclean.h"
+#include "rmCleanComponents.h"
+#include "rmBatchConvolver.h"
+
+namespace RM {
+
+  //! CLEAN algorithms rmCleanCube can run on every line of sight
+  enum rmCleanAlgorithm {
+    //! rmclean::rmsfClean, writes the CLEAN component model
+    CLEAN_RMSF  = 0,
+    //! rmclean::clark, writes the restored spectrum (needs a FWHM)
+    CLEAN_CLARK = 1
+  };
+
+  /*!
+    \class rmCleanCube
+
+    \ingroup RM
+
+    \brief Parallel RM-CLEAN of all lines of sight of a Faraday cube
+
+    \author Sven Duscha
+
+    \test trmCleanCube.cpp
+
+    <h3>Synopsis</h3>
+
+    A pool of nthreads workers takes chunks of lines of sight from a shared
+    counter. Every worker owns one rmclean object (its CLEAN workspace and
+    FFTW plans), which it creates itself on its first call and keeps for
+    later calls, so plans are made once per worker and never shared.
+    rmclean serialises all FFTW planner calls through one mutex.
+
+    FFTW wisdom is imported from wisdomFile (in the run directory by
+    default) before the first plan is made and exported once after the
+    workspaces exist, so the FFTW_MEASURE cost is paid once per machine
+    rather than once per process or line of sight.
+
+    Spectra are addressed with a stride between Faraday depths and between
+    lines of sight, so both spectral-major cubes ([los][phi], the default)
+    and [phi][los] arrays can be cleaned in place of a copy.
+
+    Instead of a dense clean cube the CLEAN components of every line of
+    sight can be collected into an rmCleanComponents list. Every chunk of
+    lines of sight gets its own list, and the lists are joined in order.
+
+    With setNoiseMultiple every line of sight is cleaned down to a multiple
+    of its own noise level (rmclean::setNoiseMultiple), so noise-only lines
+    of sight stop after few or no iterations. The number of iterations, the
+    noise level and the largest residual of every line of sight of the last
+    clean() are kept for inspection.
+
+    residual() subtracts CLEAN models convolved with the RMSF from the dirty
+    spectra for whole tiles of lines of sight in batched FFTs
+    (rmBatchConvolver), with the RMSF transformed and planned once per cube.
+  */
+  class rmCleanCube {
+
+  private:
+
+    //! argument of a worker thread
+    struct workerArg {
+      rmCleanCube *cube;
+      unsigned int id;
+    };
+
+    //! RMSF over (at least) twice the Faraday depth range
+    std::vector<std::complex<double> > rmsf;
+    //! number of Faraday depths per line of sight
+    unsigned int nphis;
+    //! number of worker threads
+    unsigned int nthreads;
+    //! FFTW wisdom file ("" for none)
+    std::string wisdomFile;
+    //! wisdom has been written after the workspaces were planned
+    bool wisdomExported;
+    //! CLEAN workspace of each worker (created by the worker)
+    std::vector<rmclean*> workspaces;
+    //! batched convolution with the RMSF (created by the first residual())
+    rmBatchConvolver *rmsfConvolver;
+
+    //! CLEAN parameters
+    int algorithm;
+    double gain;
+    double threshold;
+    double fwhm;
+    unsigned int maxIterations;
+    double noiseMultiple;
+    double noiseRange;
+
+    //! iterations, noise level and largest residual of each line of sight
+    std::vector<uint32_t> iterations;
+    std::vector<float> noiseLevels;
+    std::vector<float> residualPeaks;
+
+    //! state of the current clean() call, protected by mutex
+    pthread_mutex_t mutex;
+    const std::complex<double> *dirty;
+    std::complex<double> *cleaned;
+    //! component list of each chunk (sparse output)
+    std::vector<rmCleanComponents> chunkComponents;
+    uint64_t nlos, phiStride, losStride;
+    uint64_t next;
+    uint64_t chunk;
+    uint64_t numIterations;
+    const char *error;
+
+    static void *worker (void *arg);
+    void run (const std::complex<double> *dirty,
+              uint64_t nlos,
+              uint64_t phiStride,
+              uint64_t losStride);
+    void cleanLines (unsigned int id);
+
+    // no copies of the workspaces, the convolver and the mutex
+    rmCleanCube (const rmCleanCube &);
+    rmCleanCube &operator= (const rmCleanCube &);
+
+  public:
+
+    // === Construction =========================================================
+
+    //! Prepare cleaning spectra of nphis Faraday depths with nthreads workers
+    rmCleanCube (const std::vector<std::complex<double> > &rmsf,
+                 unsigned int nphis,
+                 unsigned int nthreads=1,
+                 const std::string &wisdomFile="rmclean.wisdom");
+
+    // === Destruction ==========================================================
+
+    ~rmCleanCube ();
+
+    // === Methods ==============================================================
+
+    //! Clean nlos lines of sight of dirty into cleaned
+    void clean (const std::complex<double> *dirty,
+                std::complex<double> *cleaned,
+                uint64_t nlos,
+                uint64_t phiStride=1,
+                uint64_t losStride=0);
+    //! Clean nlos lines of sight of dirty into lists of CLEAN components
+    void clean (const std::complex<double> *dirty,
+                rmCleanComponents &components,
+                uint64_t nlos,
+                uint64_t phiStride=1,
+                uint64_t losStride=0);
+    //! Compute residual = dirty - model*RMSF for nlos lines of sight
+    void residual (const std::complex<double> *dirty,
+                   const std::complex<double> *model,
+                   std::complex<double> *residual,
+                   uint64_t nlos,
+                   uint64_t phiStride=1,
+                   uint64_t losStride=0);
+
+    void setAlgorithm (int algorithm);
+    void setGain (double gain);
+    void setThreshold (double threshold);
+    void setFWHM (double fwhm);
+    inline void setMaxIterations (unsigned int maxIterations) { this->maxIterations=maxIterations; }
+    //! Stop at multiple times the noise of each line of sight (0 = threshold only)
+    void setNoiseMultiple (double multiple);
+    //! Estimate the noise from this fraction of Faraday depths at each end (0 = all)
+    void setNoiseRange (double fraction);
+
+    inline unsigned int getNumThreads () const { return nthreads; }
+    inline unsigned int getNumPhis () const { return nphis; }
+    //! Get the total number of CLEAN iterations of all lines of sight of the last clean()
+    inline uint64_t getNumIterations () const { return numIterations; }
+    //! Get the number of iterations of each line of sight of the last clean()
+    inline const std::vector<uint32_t> &getIterations () const { return iterations; }
+    //! Get the noise level of each line of sight (0 without noise-based stop)
+    inline const std::vector<float> &getNoiseLevels () const { return noiseLevels; }
+    //! Get the largest |residual| left in each line of sight
+    inline const std::vector<float> &getResidualPeaks () const { return residualPeaks; }
+  };
+
+}  // END -- namespace RM
+
+#endif
@@ -0,0 +1,216 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "rmCleanKernels.h"
+
+#if !defined(RM_DISABLE_SIMD) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RM_CLEAN_KERNELS_AVX2
+#include <immintrin.h>
+#endif
+
+namespace RM {
+
+  // ============================================================================
+  //
+  //  Scalar kernels
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                         subtractScaledScalar
+
+  /*!
+    \param *yRe - real part of y, updated in place
+    \param *yIm - imaginary part of y, updated in place
+    \param *xRe - real part of x
+    \param *xIm - imaginary part of x
+    \param cRe - real part of c
+    \param cIm - imaginary part of c
+    \param n - number of elements
+  */
+  void subtractScaledScalar (double *yRe,
+                             double *yIm,
+                             const double *xRe,
+                             const double *xIm,
+                             double cRe,
+                             double cIm,
+                             unsigned int n)
+  {
+    for(unsigned int i=0; i<n; i++)
+    {
+      const double re=xRe[i], im=xIm[i];
+      yRe[i]-=cRe*re-cIm*im;
+      yIm[i]-=cRe*im+cIm*re;
+    }
+  }
+
+  void subtractScaledScalar (float *yRe,
+                             float *yIm,
+                             const float *xRe,
+                             const float *xIm,
+                             float cRe,
+                             float cIm,
+                             unsigned int n)
+  {
+    for(unsigned int i=0; i<n; i++)
+    {
+      const float re=xRe[i], im=xIm[i];
+      yRe[i]-=cRe*re-cIm*im;
+      yIm[i]-=cRe*im+cIm*re;
+    }
+  }
+
+  // ============================================================================
+  //
+  //  AVX2/FMA kernels
+  //
+  // ============================================================================
+
+#ifdef RM_CLEAN_KERNELS_AVX2
+
+  //_____________________________________________________________________________
+  //                                                           subtractScaledAVX2
+
+  // yRe = yRe + cIm*xIm - cRe*xRe, yIm = yIm - cIm*xRe - cRe*xIm: two FMAs each
+  __attribute__((target("avx2,fma")))
+  static void subtractScaledAVX2 (double *yRe,
+                                  double *yIm,
+                                  const double *xRe,
+                                  const double *xIm,
+                                  double cRe,
+                                  double cIm,
+                                  unsigned int n)
+  {
+    const __m256d re=_mm256_set1_pd(cRe);
+    const __m256d im=_mm256_set1_pd(cIm);
+    unsigned int i=0;
+
+    for(; i+4<=n; i+=4)
+    {
+      const __m256d xr=_mm256_loadu_pd(xRe+i);
+      const __m256d xi=_mm256_loadu_pd(xIm+i);
+      __m256d yr=_mm256_loadu_pd(yRe+i);
+      __m256d yi=_mm256_loadu_pd(yIm+i);
+      yr=_mm256_fnmadd_pd(re, xr, _mm256_fmadd_pd(im, xi, yr));
+      yi=_mm256_fnmadd_pd(re, xi, _mm256_fnmadd_pd(im, xr, yi));
+      _mm256_storeu_pd(yRe+i, yr);
+      _mm256_storeu_pd(yIm+i, yi);
+    }
+    subtractScaledScalar(yRe+i, yIm+i, xRe+i, xIm+i, cRe, cIm, n-i);
+  }
+
+  __attribute__((target("avx2,fma")))
+  static void subtractScaledAVX2 (float *yRe,
+                                  float *yIm,
+                                  const float *xRe,
+                                  const float *xIm,
+                                  float cRe,
+                                  float cIm,
+                                  unsigned int n)
+  {
+    const __m256 re=_mm256_set1_ps(cRe);
+    const __m256 im=_mm256_set1_ps(cIm);
+    unsigned int i=0;
+
+    for(; i+8<=n; i+=8)
+    {
+      const __m256 xr=_mm256_loadu_ps(xRe+i);
+      const __m256 xi=_mm256_loadu_ps(xIm+i);
+      __m256 yr=_mm256_loadu_ps(yRe+i);
+      __m256 yi=_mm256_loadu_ps(yIm+i);
+      yr=_mm256_fnmadd_ps(re, xr, _mm256_fmadd_ps(im, xi, yr));
+      yi=_mm256_fnmadd_ps(re, xi, _mm256_fnmadd_ps(im, xr, yi));
+      _mm256_storeu_ps(yRe+i, yr);
+      _mm256_storeu_ps(yIm+i, yi);
+    }
+    subtractScaledScalar(yRe+i, yIm+i, xRe+i, xIm+i, cRe, cIm, n-i);
+  }
+
+#endif
+
+  // ============================================================================
+  //
+  //  Dispatch
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                         haveSIMDCleanKernels
+
+  bool haveSIMDCleanKernels ()
+  {
+#ifdef RM_CLEAN_KERNELS_AVX2
+    static const bool avx2=(__builtin_cpu_init(), __builtin_cpu_supports("avx2") &&
+                            __builtin_cpu_supports("fma"));
+    return avx2;
+#else
+    return false;
+#endif
+  }
+
+  //_____________________________________________________________________________
+  //                                                               subtractScaled
+
+  /*!
+    \param *yRe - real part of y, updated in place
+    \param *yIm - imaginary part of y, updated in place
+    \param *xRe - real part of x
+    \param *xIm - imaginary part of x
+    \param cRe - real part of c
+    \param cIm - imaginary part of c
+    \param n - number of elements
+  */
+  void subtractScaled (double *yRe,
+                       double *yIm,
+                       const double *xRe,
+                       const double *xIm,
+                       double cRe,
+                       double cIm,
+                       unsigned int n)
+  {
+#ifdef RM_CLEAN_KERNELS_AVX2
+    if(haveSIMDCleanKernels())
+    {
+      subtractScaledAVX2(yRe, yIm, xRe, xIm, cRe, cIm, n);
+      return;
+    }
+#endif
+    subtractScaledScalar(yRe, yIm, xRe, xIm, cRe, cIm, n);
+  }
+
+  void subtractScaled (float *yRe,
+                       float *yIm,
+                       const float *xRe,
+                       const float *xIm,
+                       float cRe,
+                       float cIm,
+                       unsigned int n)
+  {
+#ifdef RM_CLEAN_KERNELS_AVX2
+    if(haveSIMDCleanKernels())
+    {
+      subtractScaledAVX2(yRe, yIm, xRe, xIm, cRe, cIm, n);
+      return;
+    }
+#endif
+    subtractScaledScalar(yRe, yIm, xRe, xIm, cRe, cIm, n);
+  }
+
+}  // END -- namespace RM
@@ -0,0 +1,89 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef RMCLEANKERNELS_H
+#define RMCLEANKERNELS_H
+
+namespace RM {
+
+  /*!
+    \file rmCleanKernels.h
+
+    \ingroup RM
+
+    \brief Complex axpy kernels for the CLEAN residual update
+
+    \author Sven Duscha
+
+    \test trmCleanKernels.cpp
+
+    Every CLEAN iteration subtracts a component times the shifted RMSF from
+    the residual, y = y - c*x. With complex<double> the multiplication goes
+    through the operator overloads and their NaN/Inf handling, which keeps
+    compilers from vectorising the loop. These kernels work on separate
+    real and imaginary arrays instead.
+
+    On x86 with GCC (or clang) an AVX2/FMA version is compiled with a
+    function target attribute. It is selected at run time if the CPU
+    supports it, so the library itself needs no -mavx2. Everywhere else,
+    or with RM_DISABLE_SIMD, a plain scalar loop is used, which compilers
+    vectorise with the baseline instruction set.
+  */
+
+  //! y = y - c*x on split complex arrays of n elements
+  void subtractScaled (double *yRe,
+                       double *yIm,
+                       const double *xRe,
+                       const double *xIm,
+                       double cRe,
+                       double cIm,
+                       unsigned int n);
+  //! y = y - c*x on split complex arrays of n elements (single precision)
+  void subtractScaled (float *yRe,
+                       float *yIm,
+                       const float *xRe,
+                       const float *xIm,
+                       float cRe,
+                       float cIm,
+                       unsigned int n);
+
+  //! Portable version of subtractScaled, without SIMD dispatch
+  void subtractScaledScalar (double *yRe,
+                             double *yIm,
+                             const double *xRe,
+                             const double *xIm,
+                             double cRe,
+                             double cIm,
+                             unsigned int n);
+  //! Portable version of subtractScaled, without SIMD dispatch (single precision)
+  void subtractScaledScalar (float *yRe,
+                             float *yIm,
+                             const float *xRe,
+                             const float *xIm,
+                             float cRe,
+                             float cIm,
+                             unsigned int n);
+
+  //! Does subtractScaled use the AVX2/FMA kernels on this machine?
+  bool haveSIMDCleanKernels ();
+
+}  // END -- namespace RM
+
+#endif
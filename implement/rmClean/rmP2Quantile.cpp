@@ -0,0 +1,175 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <algorithm>
+#include "rmP2Quantile.h"
+
+using namespace std;
+
+namespace RM {
+
+  // ============================================================================
+  //
+  //  Construction
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                                 rmP2Quantile
+
+  /*!
+    \param p - quantile to estimate, in (0,1) (default 0.5: median)
+  */
+  rmP2Quantile::rmP2Quantile (double p)
+  {
+    if(p<=0 || p>=1)
+      throw "rmP2Quantile::rmP2Quantile p not in (0,1)";
+
+    this->p=p;
+    reset();
+  }
+
+  // ============================================================================
+  //
+  //  Methods
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                                        reset
+
+  void rmP2Quantile::reset ()
+  {
+    count=0;
+    for(int i=0; i<5; i++)
+    {
+      q[i]=0;
+      n[i]=i;
+    }
+    np[0]=0;
+    np[1]=2*p;
+    np[2]=4*p;
+    np[3]=2+2*p;
+    np[4]=4;
+    dn[0]=0;
+    dn[1]=p/2;
+    dn[2]=p;
+    dn[3]=(1+p)/2;
+    dn[4]=1;
+  }
+
+  //_____________________________________________________________________________
+  //                                                                          add
+
+  /*!
+    \param x - next value of the stream
+  */
+  void rmP2Quantile::add (double x)
+  {
+    if(count < 5)		// collect the first five values in sorted order
+    {
+      int i=count++;
+      for(; i > 0 && q[i-1] > x; i--)
+        q[i]=q[i-1];
+      q[i]=x;
+      return;
+    }
+    count++;
+
+    // cell k the value falls into, the extreme markers follow the range
+    int k;
+    if(x < q[0])
+    {
+      q[0]=x;
+      k=0;
+    }
+    else if(x >= q[4])
+    {
+      q[4]=x;
+      k=3;
+    }
+    else
+      for(k=0; x >= q[k+1]; k++)
+        ;
+
+    for(int i=k+1; i<5; i++)
+      n[i]++;
+    for(int i=0; i<5; i++)
+      np[i]+=dn[i];
+
+    // move the inner markers back towards their desired positions
+    for(int i=1; i<4; i++)
+    {
+      double d=np[i]-n[i];
+      if((d >= 1 && n[i+1]-n[i] > 1) || (d <= -1 && n[i-1]-n[i] < -1))
+      {
+        int s=(d > 0) ? 1 : -1;
+        double height=parabolic(i, s);
+        if(q[i-1] < height && height < q[i+1])
+          q[i]=height;
+        else
+          q[i]=linear(i, s);
+        n[i]+=s;
+      }
+    }
+  }
+
+  //_____________________________________________________________________________
+  //                                                                          get
+
+  /*!
+    \return quantile - estimated p-quantile (0 if no values have been added)
+  */
+  double rmP2Quantile::get () const
+  {
+    if(count==0)
+      return 0;
+    if(count < 5)
+      return q[min<unsigned long>(count-1, static_cast<unsigned long>(p*count))];
+
+    return q[2];
+  }
+
+  //_____________________________________________________________________________
+  //                                                                    parabolic
+
+  /*!
+    \brief Piecewise-parabolic prediction of marker i moved by d positions
+  */
+  double rmP2Quantile::parabolic (int i,
+                                  double d) const
+  {
+    return q[i]+d/(n[i+1]-n[i-1])*((n[i]-n[i-1]+d)*(q[i+1]-q[i])/(n[i+1]-n[i])
+                                   +(n[i+1]-n[i]-d)*(q[i]-q[i-1])/(n[i]-n[i-1]));
+  }
+
+  //_____________________________________________________________________________
+  //                                                                       linear
+
+  /*!
+    \brief Linear prediction of marker i moved by d positions, if the parabola is not monotonic
+  */
+  double rmP2Quantile::linear (int i,
+                               int d) const
+  {
+    return q[i]+d*(q[i+d]-q[i])/(n[i+d]-n[i]);
+  }
+
+}  // END -- namespace RM
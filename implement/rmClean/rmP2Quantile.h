@@ -0,0 +1,89 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef RMP2QUANTILE_H
+#define RMP2QUANTILE_H
+
+namespace RM {
+
+  /*!
+    \class rmP2Quantile
+
+    \ingroup RM
+
+    \brief Streaming quantile estimate with the P^2 algorithm
+
+    \author Sven Duscha
+
+    \test trmP2Quantile.cpp
+
+    Estimates the p-quantile of a stream of values in one pass and constant
+    memory with the P^2 algorithm of Jain & Chlamtac (Communications of the
+    ACM 28, 1985). Five markers hold the minimum, the p/2-, p-, (1+p)/2-
+    quantiles and the maximum; every value moves the marker positions, and
+    markers that drift from their desired positions are adjusted by a
+    piecewise-parabolic prediction of the quantile. Until five values have
+    been added the quantile is taken from the sorted values.
+  */
+  class rmP2Quantile {
+
+  private:
+
+    //! quantile to estimate
+    double p;
+    //! number of values added
+    unsigned long count;
+    //! marker heights (the first count values, sorted, while count < 5)
+    double q[5];
+    //! actual marker positions
+    double n[5];
+    //! desired marker positions
+    double np[5];
+    //! increments of the desired marker positions
+    double dn[5];
+
+    double parabolic (int i,
+                      double d) const;
+    double linear (int i,
+                   int d) const;
+
+  public:
+
+    // === Construction =========================================================
+
+    //! Create an estimator of the p-quantile (default: median)
+    rmP2Quantile (double p=0.5);
+
+    // === Methods ==============================================================
+
+    //! Forget all values, keep p
+    void reset ();
+    //! Add one value to the stream
+    void add (double x);
+    //! Get the estimated p-quantile of the values added so far
+    double get () const;
+
+    inline double getQuantile () const { return p; }
+    inline unsigned long getCount () const { return count; }
+  };
+
+}  // END -- namespace RM
+
+#endif
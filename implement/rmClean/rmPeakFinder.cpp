@@ -0,0 +1,218 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "rmPeakFinder.h"
+
+using namespace std;
+
+namespace RM {
+
+  // ============================================================================
+  //
+  //  Construction
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                                 rmPeakFinder
+
+  /*!
+    \param blockSize - number of elements per leaf block (default 64)
+  */
+  rmPeakFinder::rmPeakFinder (unsigned int blockSize)
+  {
+    if(blockSize==0)
+      throw "rmPeakFinder::rmPeakFinder blockSize is 0";
+
+    this->blockSize=blockSize;
+    length=0;
+    nleaves=1;
+    power.assign(1, -1.0);
+    tree.assign(2, 0);
+  }
+
+  // ============================================================================
+  //
+  //  Methods
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                                        build
+
+  /*!
+    \param *data - complex vector to search
+    \param length - number of elements in data
+  */
+  void rmPeakFinder::build (const complex<double> *data,
+                            unsigned int length)
+  {
+    if(data==NULL)
+      throw "rmPeakFinder::build data is NULL";
+
+    resize(length);
+    for(unsigned int i=0; i<length; i++)
+      power[i]=norm(data[i]);
+    buildTree();
+  }
+
+  //_____________________________________________________________________________
+  //                                                                        build
+
+  /*!
+    \param *re - real parts of the vector to search
+    \param *im - imaginary parts of the vector to search
+    \param length - number of elements
+  */
+  void rmPeakFinder::build (const double *re,
+                            const double *im,
+                            unsigned int length)
+  {
+    if(re==NULL || im==NULL)
+      throw "rmPeakFinder::build data is NULL";
+
+    resize(length);
+    for(unsigned int i=0; i<length; i++)
+      power[i]=re[i]*re[i]+im[i]*im[i];
+    buildTree();
+  }
+
+  //_____________________________________________________________________________
+  //                                                                       update
+
+  /*!
+    \brief Recompute |F|^2 of the changed elements, their blocks and tree paths
+
+    \param *data - complex vector the tree was built for
+    \param first - first changed element
+    \param last - one past the last changed element
+  */
+  void rmPeakFinder::update (const complex<double> *data,
+                             unsigned int first,
+                             unsigned int last)
+  {
+    if(data==NULL)
+      throw "rmPeakFinder::update data is NULL";
+    if(last > length)
+      throw "rmPeakFinder::update range exceeds length";
+    if(first >= last)
+      return;
+
+    for(unsigned int i=first; i<last; i++)
+      power[i]=norm(data[i]);
+    updateTree(first, last);
+  }
+
+  //_____________________________________________________________________________
+  //                                                                       update
+
+  /*!
+    \param *re - real parts of the vector the tree was built for
+    \param *im - imaginary parts of the vector the tree was built for
+    \param first - first changed element
+    \param last - one past the last changed element
+  */
+  void rmPeakFinder::update (const double *re,
+                             const double *im,
+                             unsigned int first,
+                             unsigned int last)
+  {
+    if(re==NULL || im==NULL)
+      throw "rmPeakFinder::update data is NULL";
+    if(last > length)
+      throw "rmPeakFinder::update range exceeds length";
+    if(first >= last)
+      return;
+
+    for(unsigned int i=first; i<last; i++)
+      power[i]=re[i]*re[i]+im[i]*im[i];
+    updateTree(first, last);
+  }
+
+  //_____________________________________________________________________________
+  //                                                                       resize
+
+  void rmPeakFinder::resize (unsigned int length)
+  {
+    if(length==0)
+      throw "rmPeakFinder::build length is 0";
+
+    this->length=length;
+    unsigned int nblocks=(length+blockSize-1)/blockSize;
+    for(nleaves=1; nleaves < nblocks; nleaves*=2);
+
+    power.resize(length+1);
+    power[length]=-1.0;					// sentinel, loses against every element
+    tree.assign(2*nleaves, length);
+  }
+
+  //_____________________________________________________________________________
+  //                                                                    buildTree
+
+  void rmPeakFinder::buildTree ()
+  {
+    unsigned int nblocks=(length+blockSize-1)/blockSize;
+
+    for(unsigned int b=0; b<nblocks; b++)
+      updateBlock(b);
+    for(unsigned int k=nleaves-1; k>0; k--)
+      tree[k]=power[tree[2*k+1]] > power[tree[2*k]] ? tree[2*k+1] : tree[2*k];
+  }
+
+  //_____________________________________________________________________________
+  //                                                                   updateTree
+
+  void rmPeakFinder::updateTree (unsigned int first,
+                                 unsigned int last)
+  {
+    unsigned int lo=first/blockSize;
+    unsigned int hi=(last-1)/blockSize;
+    for(unsigned int b=lo; b<=hi; b++)
+      updateBlock(b);
+
+    // replay the matches above the changed leaves, one level at a time
+    lo+=nleaves;
+    hi+=nleaves;
+    while(lo > 1)
+    {
+      lo/=2;
+      hi/=2;
+      for(unsigned int k=lo; k<=hi; k++)
+        tree[k]=power[tree[2*k+1]] > power[tree[2*k]] ? tree[2*k+1] : tree[2*k];
+    }
+  }
+
+  //_____________________________________________________________________________
+  //                                                                  updateBlock
+
+  void rmPeakFinder::updateBlock (unsigned int block)
+  {
+    unsigned int first=block*blockSize;
+    unsigned int last=first+blockSize < length ? first+blockSize : length;
+    unsigned int maxpos=first;
+
+    for(unsigned int i=first+1; i<last; i++)
+      if(power[i] > power[maxpos])
+        maxpos=i;
+
+    tree[nleaves+block]=maxpos;
+  }
+
+}  // END -- namespace RM
@@ -0,0 +1,103 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef RMPEAKFINDER_H
+#define RMPEAKFINDER_H
+
+#include <vector>
+#include <complex>
+
+namespace RM {
+
+  /*!
+    \class rmPeakFinder
+
+    \ingroup RM
+
+    \brief Incremental peak search on the squared magnitude of a complex vector
+
+    \author Sven Duscha
+
+    \test trmPeakFinder.cpp
+
+    Keeps |F|^2 of every element (no sqrt) and a tournament tree over blocks
+    of blockSize elements whose leaves hold the position of the block
+    maximum. After a CLEAN subtraction only the blocks of the changed range
+    and their paths to the root are recomputed, so the peak of the whole
+    vector is available at the root without a full pass.
+  */
+  class rmPeakFinder {
+
+  private:
+
+    //! number of elements
+    unsigned int length;
+    //! number of elements per leaf block
+    unsigned int blockSize;
+    //! number of leaves (power of two >= number of blocks)
+    unsigned int nleaves;
+    //! squared magnitudes, power[length] is a -1 sentinel for empty leaves
+    std::vector<double> power;
+    //! tournament tree, node k holds the position of the maximum below it
+    std::vector<unsigned int> tree;
+
+    void updateBlock (unsigned int block);
+    void resize (unsigned int length);
+    void buildTree ();
+    void updateTree (unsigned int first,
+                     unsigned int last);
+
+  public:
+
+    // === Construction =========================================================
+
+    //! Create a peak finder with blocks of blockSize elements
+    rmPeakFinder (unsigned int blockSize=64);
+
+    // === Methods ==============================================================
+
+    //! Compute |F|^2 and the tree for data of length elements
+    void build (const std::complex<double> *data,
+                unsigned int length);
+    //! Compute |F|^2 and the tree for split real and imaginary parts
+    void build (const double *re,
+                const double *im,
+                unsigned int length);
+    //! Recompute |F|^2 and the tree for the elements [first, last) of data
+    void update (const std::complex<double> *data,
+                 unsigned int first,
+                 unsigned int last);
+    //! Recompute |F|^2 and the tree for the elements [first, last) of split data
+    void update (const double *re,
+                 const double *im,
+                 unsigned int first,
+                 unsigned int last);
+
+    //! Get the position of the element with the largest |F|^2
+    inline unsigned int getPeakPos () const { return tree[1]; }
+    //! Get the largest |F|^2
+    inline double getPeakPower () const { return power[tree[1]]; }
+    inline unsigned int getLength () const { return length; }
+    inline unsigned int getBlockSize () const { return blockSize; }
+  };
+
+}  // END -- namespace RM
+
+#endif
@@ -1,13 +1,18 @@
 
 #include <iostream>
 #include <algorithm>
+#include <stdio.h>
 #include <math.h>
 #include <limits>   /* maximum value for variables on architecture/compiler */
 #include <fftw3.h>
 #include "rmclean.h"
+#include "rmCleanKernels.h"
 
 using namespace std;
 
+// FFTW planning is not thread-safe, all planner calls go through this mutex
+pthread_mutex_t rmclean::plannerMutex=PTHREAD_MUTEX_INITIALIZER;
+
 // ==============================================================================
 //
 //  Construction
@@ -20,9 +25,19 @@ using namespace std;
 rmclean::rmclean (const unsigned int length)
 {
   numIterations=0;			// initialize current number of iterations
+  gain=0.1;					// default CLEAN loop gain
+  fullwidthhalfmaximum=0;	// FWHM has to be set before restoring
+  gaussianFWHM=0;			// FTGaussian has not been computed yet
+  rmsfCutoff=0;				// subtract the full RMSF
+  clarkPatch=0;				// Clark patch from the RMSF main lobe
+  noiseMultiple=0;			// stop at the threshold only
+  noiseRange=0;				// estimate the noise from the whole residual
+  noiseLevel=0;
+  residualPeak=0;
 
 	if(length==0)
 		throw "rmclean::rmclean length is 0";
+	this->length=length;
 	
 	//-----------------------------------------------------
 	
@@ -39,10 +54,13 @@ rmclean::rmclean (const unsigned int length)
 	FTrestoredComponent = (fftw_complex*) fftw_malloc(sizeof(fftw_complex)*length);
 
 	// Use FFTW_MEASURE, because this plan will be executed millions of times (for every
-	// line-of-sight) and we want to have the best performing FFT
+	// line-of-sight) and we want to have the best performing FFT; with imported
+	// wisdom (importWisdom) the measurement is not repeated
+	pthread_mutex_lock(&plannerMutex);
 	planGaussian=fftw_plan_dft_r2c_1d(length, gaussian, FTGaussian, FFTW_MEASURE);
 	planCleanComponent=fftw_plan_dft_r2c_1d(length, cleanComponent, FTcleanComponent, FFTW_MEASURE);
 	planRestoredComponent=fftw_plan_dft_c2r_1d(length, FTrestoredComponent, restoredComponent, FFTW_MEASURE);
+	pthread_mutex_unlock(&plannerMutex);
 }
 
 
@@ -53,16 +71,20 @@ rmclean::~rmclean(void)
 {
 	
 	// clean up FFTW variables
+	pthread_mutex_lock(&plannerMutex);
 	fftw_destroy_plan(planGaussian);
 	fftw_destroy_plan(planCleanComponent);
 	fftw_destroy_plan(planRestoredComponent);
+	for(unsigned int i=0; i < fftPlans.size(); i++)
+		fftw_destroy_plan(fftPlans[i].plan);
+	pthread_mutex_unlock(&plannerMutex);
 	fftw_free(FTGaussian);
 	fftw_free(FTcleanComponent);
-	
+	fftw_free(FTrestoredComponent);
 	
 	free(gaussian);
 	free(cleanComponent);
-	free(FTrestoredComponent);
+	free(restoredComponent);
 }
 
 
@@ -125,6 +147,13 @@ vector<complex<double> > rmclean::hogbom(const vector<complex<double> > &data, c
 /*!
 	\brief Hogbom CLEAN on a (Q or U) RM data vector, uses either threshold or number of iterations as break condition
 
+	The loop only finds the peak, adds gain*peak to the component buffer and
+	subtracts the (real part of the) RMSF shifted to the peak, so an
+	iteration is O(N) and allocates nothing. The restoring Gaussian with the
+	FWHM set by setFWHM is Fourier transformed once and cached; all
+	components are convolved with it in one FFT after the loop and the
+	residual map is added.
+
 	\param data - RM data to be cleaned
 	\param threshold - noise threshold after which CLEAN stops
 	\param maxiter - or maximum number of iterations after CLEAN stops (default=0 i.e. work down to noise level)
@@ -134,90 +163,86 @@ vector<complex<double> > rmclean::hogbom(const vector<complex<double> > &data, c
 vector<double> rmclean::hogbom(const vector<double> &data, const double threshold, const unsigned int maxIterations=0)
 {	
 	vector<double> cleanedMap(data.size());	// vector that will hold the final cleaned map
-//	vector<double> dirtyMap(data);				// create a copy of data, called the dirty map, to work on
-//	vector<double> cleanComp(data);				// vector containing single CLEAN component of cycle
-//	vector<double> gaussian(data.size());		// vector to hold Gaussian to convolve CLEAN components with
-//	vector<double> gaussianFT(data.size());			// Fourier transformed gaussian
-//	vector<double> cleancomponentFT(data.size());	// Fourier transformed CLEAN component
-	vector<double> restoredComponent(data.size());
 
 	// Helper variables
-	unsigned int length=data.size();				// length of data vector
-	double fwhm=0;										// FWHM of RMSF used to create Gaussian
-	double max=numeric_limits<double>::max( );		// initiliaze with architecture/compiler maximum value
+	double max=0;										// peak value found
 	unsigned int maxpos=0;							// position of maximum found
 	
-// 	double *Gauss=NULL;          /*  Input array for FFTW FT   */
-// 	double *Dirac=NULL;          /*  Input array for FFTW FT   */
-// 	fftw_complex *fftwGauss;     /*  Output array for FFTW FT  */
-// 	fftw_complex  *fftwDirac;    /*  Output array for FFTW FT  */
-// 	fftw_plan fftwplanGauss;     /*  FFTW plan for Gauss data  */
-// 	fftw_plan fftwplanDirac;     /*  FFTW plan for Dirac data  */
-	
 	//-------------------------------------------------------------
 	// Data integrity checks
 	//
 	if(data.size()==0)
 		throw "rmclean::hogbom data has size 0";
+	if(data.size()!=length)
+		throw "rmclean::hogbom data size differs from FFT length";
 	if(threshold<=0)
 		throw "rmclean::hogbom threshold <= 0";
 	if(gain<=0)
 		throw "rmclean:hogbom gain <= 0";
 	if(gain>=2)
 		throw "rmclean::hogbom gain > 2";
+	if(fullwidthhalfmaximum<=0)
+		throw "rmclean::hogbom FWHM is not set";
 	
 	//-------------------------------------------------------------
-	//
-	// Work on only one part of the cleaned Image
-	//
-	//-------------------------------------------------------------
+	// Work on the real part of the dirtyMap, collect components in cleanComponent
+	dirtyMap.resize(length);
+	for(unsigned int i=0; i < length; i++)
+	{
+		dirtyMap[i]=data[i];
+		cleanComponent[i]=0;
+	}
 	
 	// Major cycle: Hogbom only has major cycle:
-	while(max > threshold)		// as long as the maximum found is above the threshold
+	for(numIterations=0; maxIterations==0 || numIterations < maxIterations; numIterations++)
 	{
-		// Maximum number of iterations break condition, if these were set
-		if(maxIterations!=0 && numIterations > maxIterations)
-			break;													// stop cleaning loop
-		
 		// Find peak in dirty image, break when peak intensity < threshold (1.2*noise level)
-		maxpos=max_element(data.begin(), data.end())-data.begin();
-		max=data[maxpos];
+		maxpos=0;
+		for(unsigned int i=1; i < length; i++)
+		{
+			if(fabs(dirtyMap[i].real()) > fabs(dirtyMap[maxpos].real()))
+				maxpos=i;
+		}
+		max=dirtyMap[maxpos].real();
+		if(fabs(max) < threshold)
+			break;													// stop cleaning loop
 
-		// multiply peak intensity with reduction factor gamma = 0.4
-		cleanComponent[maxpos]=gain*max;									// single CLEAN component for FFT
-		cleanComponents[maxpos]=gain*max;								// Set clean component in cleanmap
+		// multiply peak intensity with reduction factor gamma
+		cleanComponent[maxpos]+=gain*max;								// CLEAN component for restoring FFT
 		
-		gaussian=createGaussianArray(length, max, fwhm);			// create Gaussian (Array) with that FWHM
-
-		fftw_execute(planGaussian);										// Fourier transform Gaussian
-		fftw_execute(planCleanComponent);								// Fourier transform CLEAN component
- 
-
-		// Convolve Gaussian with Dirac in Fourier Space (Multiplication)
-		for(unsigned int i=0; i < length; i++)			// element-wise multiplication
+		// Substract the RMSF shifted to the peak and scaled by the component
+		const complex<double> *shiftedRMSF=shiftRMSF(maxpos, length);
+		for(unsigned int i=0; i < length; i++)
 		{
-			restoredComponent[i]=FTcleanComponent[i][0]*FTGaussian[i][0];		// multiply only real part
+			dirtyMap[i]-=gain*max*shiftedRMSF[i].real();		// real part only
 		}
-		
-		numIterations++;			// increment iterations counter
-		
-		writeRMtoFile(restoredComponent, "fftrestored.dat");
-		// Inverse Fourier Transform back into data space:
-		fftw_execute(planRestoredComponent);
-		
-		writeRMtoFile(restoredComponent, "restored.dat");	
 	}	// CLEAN algortihm loop over all found peaks
 	
-
-		
-	// convolve clean componentswith Gaussian
+	cleanComponents.resize(length);
+	for(unsigned int i=0; i < length; i++)
+	{
+		cleanComponents[i]=cleanComponent[i];
+	}
 	
-	// Add convolved function to dirty image 
+	//-------------------------------------------------------------
+	// Restore: convolve CLEAN components with Gaussian in Fourier space and
+	// add the residual
+	transformGaussian(fullwidthhalfmaximum);
+	fftw_execute(planCleanComponent);								// Fourier transform CLEAN components
 	
-	// multiply peak intensity with reduction factor gamma = 0.4
+	for(unsigned int i=0; i < length/2+1; i++)			// element-wise complex multiplication
+	{
+		FTrestoredComponent[i][0]=FTcleanComponent[i][0]*FTGaussian[i][0] - FTcleanComponent[i][1]*FTGaussian[i][1];
+		FTrestoredComponent[i][1]=FTcleanComponent[i][0]*FTGaussian[i][1] + FTcleanComponent[i][1]*FTGaussian[i][0];
+	}
 	
-	// set clean component at peak position in cleaned image	
+	// Inverse Fourier Transform back into data space (FFTW does not normalize)
+	fftw_execute(planRestoredComponent);
 	
+	for(unsigned int i=0; i < length; i++)
+	{
+		cleanedMap[i]=restoredComponent[i]/length + dirtyMap[i].real();
+	}
 	
 	return cleanedMap;
 }
@@ -228,16 +253,28 @@ vector<double> rmclean::hogbom(const vector<double> &data, const double threshol
 	
 	\param data - complex RM vector to be cleaned
 	\param cleanedMap - complex vector of cleaned RM
-	\param threshold - threshold to clean down to
+	\param threshold - threshold to clean down to (0 = noise-based stop only)
 	\param maxinterations - optional parameter to limit algorithm to a maximum number of iterations	
+	
+	The peak search keeps |F|^2 in an RM::rmPeakFinder tournament tree that is
+	only updated where the shifted RMSF changed the dirtyMap. With
+	setRMSFCutoff the RMSF is truncated where |R| falls below cutoff times its
+	peak, which restricts both subtraction and update to that range. The
+	subtraction works on split real and imaginary copies of residual and
+	RMSF with the RM::subtractScaled kernel; the residual is copied back into
+	the dirtyMap at the end.
+	
+	With setNoiseMultiple CLEAN stops at the larger of threshold and that
+	multiple of the noise estimated from the residual (noiseThreshold). The
+	sidelobes of bright sources raise the first estimate, so when the peak
+	falls below the stopping threshold the noise is estimated again from the
+	cleaned residual, and CLEAN goes on while the peak lies above the lowered
+	threshold. On return the residual is below noiseMultiple times
+	getNoiseLevel (unless maxIterations was reached).
 */
 void rmclean::rmsfClean(const vector<complex<double> > &data, vector<complex<double> > &cleanedMap, const double threshold, const unsigned int maxIterations=0)
 {
-	double max;									// initiliaze with architecture/compiler maximum value
-	unsigned int maxpos=0;					// position of maximum found
-	unsigned int length=data.size();
-	vector<double> power(data.size());	// vector to contain absolute power of RM data vector
-	vector<complex<double> > shiftedRMSF(data.size());
+	const unsigned int length=data.size();
 	
 	//------------------------------------------------------
 	// Data integrity checks
@@ -245,63 +282,447 @@ void rmclean::rmsfClean(const vector<complex<double> > &data, vector<complex<dou
 		throw "rmclean::rmsfClean data vector has size 0";
 	if(RMSF.size()<2*data.size())
 		throw "rmclean::rmsfClean RMSF should be at least twice the size of data vector";
-	if(threshold==0)
+	if(threshold<0 || (threshold==0 && noiseMultiple==0))
 		throw "rmclean::rmsfClean threshold is 0";
 		
 	//------------------------------------------------------
-	max=numeric_limits<double>::max( );		// set maximum to local numerical max value
+	// Work on split real and imaginary parts for the SIMD subtraction kernel
+	residualRe.resize(length);
+	residualIm.resize(length);
+	for(unsigned int i=0; i < length; i++)
+	{
+		residualRe[i]=data[i].real();
+		residualIm[i]=data[i].imag();
+	}
+	splitRMSF();
+	if(cleanedMap.size()!=length)
+		cleanedMap.resize(length);
+	
+	// Support of the RMSF: outside of it a subtraction does not change the dirtyMap
+	double rmsfPeak=0;
+	for(unsigned int j=0; j < RMSF.size(); j++)
+		rmsfPeak=std::max(rmsfPeak, norm(RMSF[j]));
+	const double cutoffsq=rmsfCutoff*rmsfCutoff*rmsfPeak;
+	int rmsfFirst=0, rmsfLast=RMSF.size();
+	while(rmsfFirst < rmsfLast && norm(RMSF[rmsfFirst]) <= cutoffsq)
+		rmsfFirst++;
+	while(rmsfLast > rmsfFirst && norm(RMSF[rmsfLast-1]) <= cutoffsq)
+		rmsfLast--;
+	
+	peakFinder.build(&residualRe[0], &residualIm[0], length);
+	
+	double stop=noiseThreshold(&residualRe[0], &residualIm[0], length, 1, threshold);
+	double thresholdsq=stop*stop;
+	for(numIterations=0; numIterations < maxIterations; numIterations++)
+	{	
+		// Peak of |F|^2 in the dirty map is at the root of the tournament tree
+		const unsigned int maxpos=peakFinder.getPeakPos();
+		
+		// break when peak intensity < threshold (1.2*noise level)
+		if(peakFinder.getPeakPower() < thresholdsq)
+		{
+			if(noiseMultiple==0)
+				break;
+			// re-estimate from the cleaned residual, go on if the peak is above the new threshold
+			stop=noiseThreshold(&residualRe[0], &residualIm[0], length, 1, threshold);
+			if(peakFinder.getPeakPower() < stop*stop)
+				break;
+			thresholdsq=stop*stop;
+		}
+		
+		// Add CLEAN component to cleanedMap (="Model Map")
+		// M[phi_max] = M[phi_max] + gain * F_k[phi_max]
+		const complex<double> component=gain*complex<double>(residualRe[maxpos], residualIm[maxpos]);
+		cleanedMap[maxpos]+=component;
+		
+		// Substract the RMSF shifted to phi_max and scaled by the component from the dirtyMap
+		// F_{k+1}[phi] = F_k[phi] - gain*F_k[phi_max]*R(phi-phi_max)
+		// only over the part of the dirtyMap the shifted RMSF support covers
+		const int offset=shiftRMSF(maxpos, length)-&RMSF[0];
+		const unsigned int first=std::max(rmsfFirst-offset, 0);
+		const unsigned int last=std::max(std::min(rmsfLast-offset, static_cast<int>(length)), 0);
+		if(first < last)
+			RM::subtractScaled(&residualRe[first], &residualIm[first], &rmsfRe[offset+first], &rmsfIm[offset+first],
+									 component.real(), component.imag(), last-first);
+		peakFinder.update(&residualRe[0], &residualIm[0], first, last);
+	}
+	residualPeak=sqrt(peakFinder.getPeakPower());
+	
+	dirtyMap.resize(length);
+	for(unsigned int i=0; i < length; i++)
+		dirtyMap[i]=complex<double>(residualRe[i], residualIm[i]);
+}
 
-	copyDataToDirtyMap(data);
 
-	// Check for both real and imaginary (Q and U) components to be above threshold
-	//while(max > threshold)
-	for(unsigned int i=0; i < maxIterations; i++)
-	{	
-		// Compute absolute power of dirtyMap vector to look for maximum
+/*!
+	\brief Clark CLEAN on a complex RM data vector with a truncated-RMSF minor cycle and FFT major cycle
+	
+	The minor cycle works only on the candidates whose |F| lies above the
+	larger of threshold and the peak times the highest RMSF sidelobe outside
+	the patch. It subtracts the RMSF truncated to +/- the patch half-width
+	from the candidates. The major cycle then recomputes the full residual as
+	data minus the FFT convolution of all components with the RMSF, whose
+	transform is kept for later calls with the same RMSF. The components are finally restored
+	with a Gaussian of the FWHM set by setFWHM and the residual is added.
+	With setNoiseMultiple the noise is estimated from the residual of every
+	major cycle, and the stopping threshold follows it (noiseThreshold).
+	
+	\param data - complex RM vector to be cleaned
+	\param threshold - threshold to clean down to (0 = noise-based stop only)
+	\param nmaxiter - maximum number of CLEAN components (0 = clean down to threshold)
+	
+	\return cleanedMap - restored cleaned RM vector
+*/
+vector<complex<double> > rmclean::clark(const vector<complex<double> > &data, const double threshold, const unsigned int nmaxiter=0)
+{
+	const unsigned int length=data.size();
+	vector<complex<double> > cleanedMap(length);		// restored map to be returned
+	vector<complex<double> > convolved;					// components convolved with RMSF or Gaussian
+	vector<unsigned int> candidates;						// positions worked on in the minor cycle
+	
+	//------------------------------------------------------
+	// Data integrity checks
+	if(length==0)
+		throw "rmclean::clark data vector has size 0";
+	if(RMSF.size()<2*length)
+		throw "rmclean::clark RMSF should be at least twice the size of data vector";
+	if(threshold<0 || (threshold==0 && noiseMultiple==0))
+		throw "rmclean::clark threshold <= 0";
+	if(gain<=0 || gain>=2)
+		throw "rmclean::clark gain not in (0,2)";
+	if(fullwidthhalfmaximum<=0)
+		throw "rmclean::clark FWHM is not set";
+	
+	//------------------------------------------------------
+	// RMSF patch: centre, peak and highest sidelobe outside of the patch
+	const int centre=round(0.5*(RMSF.size()-length))+length/2;	// RMSF[centre+i-k] = R(phi_i - phi_k)
+	const double rmsfPeak=abs(RMSF[centre]);
+	if(rmsfPeak==0)
+		throw "rmclean::clark RMSF is 0 at its centre";
+	
+	int patch=clarkPatch;
+	if(patch==0)		// 5 half widths at half maximum of |R| cover main lobe and first sidelobes
+	{
+		int hwhm=1;
+		while(centre+hwhm < static_cast<int>(RMSF.size()) && abs(RMSF[centre+hwhm]) > 0.5*rmsfPeak)
+			hwhm++;
+		patch=5*hwhm;
+	}
+	patch=std::min(patch, static_cast<int>(length)-1);
+	
+	double sidelobe=0;
+	for(int d=patch+1; d < static_cast<int>(length); d++)
+	{
+		sidelobe=std::max(sidelobe, abs(RMSF[centre+d])/rmsfPeak);
+		sidelobe=std::max(sidelobe, abs(RMSF[centre-d])/rmsfPeak);
+	}
+	
+	// Fourier transform of the RMSF zero-padded to the linear convolution length,
+	// the same for every line of sight of a cube and computed once per RMSF
+	vector<complex<double> > padded(length+RMSF.size()-1);
+	if(FTRMSF.size()!=padded.size() || FTRMSFsource!=RMSF)
+	{
+		std::copy(RMSF.begin(), RMSF.end(), padded.begin());
+		fft(padded, FTRMSF);
+		FTRMSFsource=RMSF;
+	}
+	
+	//------------------------------------------------------
+	copyDataToDirtyMap(data);									// residual
+	cleanComponents.assign(length, complex<double>(0,0));
+	
+	numIterations=0;
+	while(nmaxiter==0 || numIterations < nmaxiter)
+	{
+		// Major cycle peak and minor cycle threshold, both compared with abs()
+		// so that the peak is always a candidate
+		double peak=0;
+		for(unsigned int i=0; i < length; i++)
+			peak=std::max(peak, abs(dirtyMap[i]));
+		const double *residual=reinterpret_cast<const double*>(&dirtyMap[0]);
+		const double stop=noiseThreshold(residual, residual+1, length, 2, threshold);
+		if(peak < stop)
+			break;
+		const double minorThreshold=std::min(peak, std::max(stop, sidelobe*peak));
+		
+		candidates.clear();
 		for(unsigned int i=0; i < length; i++)
+			if(abs(dirtyMap[i]) >= minorThreshold)
+				candidates.push_back(i);
+		if(candidates.empty())								// e.g. NaN in the residual
+			break;
+		
+		//----------------------------------------------------
+		// Minor cycle on the candidate list with the truncated RMSF
+		while(nmaxiter==0 || numIterations < nmaxiter)
 		{
-			power[i]=sqrt(dirtyMap[i].real()*dirtyMap[i].real() + dirtyMap[i].imag()*dirtyMap[i].imag());
+			unsigned int maxpos=candidates[0];
+			for(unsigned int c=1; c < candidates.size(); c++)
+				if(norm(dirtyMap[candidates[c]]) > norm(dirtyMap[maxpos]))
+					maxpos=candidates[c];
+			if(abs(dirtyMap[maxpos]) < minorThreshold)
+				break;
+			
+			const complex<double> component=gain*dirtyMap[maxpos]/RMSF[centre];
+			cleanComponents[maxpos]+=component;
+			numIterations++;
+			
+			for(unsigned int c=0; c < candidates.size(); c++)
+			{
+				const int d=static_cast<int>(candidates[c])-static_cast<int>(maxpos);
+				if(d >= -patch && d <= patch)
+					dirtyMap[candidates[c]]-=component*RMSF[centre+d];
+			}
 		}
 		
-		// Find peak in dirty image, break when peak intensity < threshold (1.2*noise level)
-		maxpos=max_element(power.begin(), power.end())-power.begin();
-		max=power[maxpos];
-
-		// Maximum number of iterations break condition, if these were set
-		if(max < threshold)
-			break;													// stop cleaning loop		
+		//----------------------------------------------------
+		// Major cycle: residual = data - components * RMSF with one FFT convolution
+		padded.assign(FTRMSF.size(), complex<double>(0,0));
+		std::copy(cleanComponents.begin(), cleanComponents.end(), padded.begin());
+		fft(padded, convolved);
+		for(unsigned int i=0; i < convolved.size(); i++)
+			convolved[i]*=FTRMSF[i];
+		ifft(convolved, padded);
 		
-		// Shift RMSF to peak position of maxpos: R(phi-phi_max,k)
-		// If a preshifted entry for that maxpos exists use preshiftedRMSF table
-		if(preshiftedRMSF[maxpos].size()==RMSF.size())
+		for(unsigned int i=0; i < length; i++)
+			dirtyMap[i]=data[i]-padded[centre+i];
+	}
+	residualPeak=0;
+	for(unsigned int i=0; i < length; i++)
+		residualPeak=std::max(residualPeak, abs(dirtyMap[i]));
+	
+	//------------------------------------------------------
+	// Restore components with a Gaussian of the RMSF's FWHM and add the residual
+	vector<double> gaussian(2*length-1);
+	createGaussian(gaussian, 1, fullwidthhalfmaximum, length-1);
+	vector<complex<double> > restoringBeam(gaussian.begin(), gaussian.end());
+	convolution(cleanComponents, restoringBeam, convolved);
+	
+	for(unsigned int i=0; i < length; i++)
+		cleanedMap[i]=convolved[length-1+i]+dirtyMap[i];
+	
+	return cleanedMap;
+}
+
+
+/*!
+	\brief Multi-scale CLEAN for Faraday-thick structures
+	
+	Models the data as a sum of Gaussian scale kernels (created with
+	createGaussian, peak 1) of the FWHMs in scales, plus point components.
+	The RMSF convolved with every pair of kernels is computed once for a
+	set of scales and RMSF (computeScaleRMSFs). The dirty data is smoothed
+	with every kernel. Each iteration then picks the scale and position
+	whose component reduces the residual most (with a small bias towards
+	smaller scales), adds the scaled kernel to the model
+	and subtracts the cross-term RMSFs from all smoothed residuals. The
+	point-scale residual is left in the dirtyMap (getResidualMap). The
+	noise-based stop (setNoiseMultiple) works on the point-scale residual
+	as in rmsfClean.
+	
+	\param data - complex RM vector to be cleaned
+	\param cleanedMap - complex vector of the CLEAN model
+	\param scales - FWHMs of the scale kernels in Faraday depth channels (a point scale 0 is always used)
+	\param threshold - threshold for the point-scale residual to clean down to (0 = noise-based stop only)
+	\param maxIterations - maximum number of iterations
+*/
+void rmclean::multiscaleClean(const vector<complex<double> > &data, vector<complex<double> > &cleanedMap, const vector<double> &scales, const double threshold, const unsigned int maxIterations)
+{
+	const unsigned int length=data.size();
+	vector<complex<double> > in(data), convolved;
+	
+	//------------------------------------------------------
+	// Data integrity checks
+	if(length==0)
+		throw "rmclean::multiscaleClean data vector has size 0";
+	if(RMSF.size()<2*length)
+		throw "rmclean::multiscaleClean RMSF should be at least twice the size of data vector";
+	if(threshold<0 || (threshold==0 && noiseMultiple==0))
+		throw "rmclean::multiscaleClean threshold <= 0";
+	if(gain<=0 || gain>=2)
+		throw "rmclean::multiscaleClean gain not in (0,2)";
+	
+	//------------------------------------------------------
+	computeScaleRMSFs(scales, length);
+	const unsigned int nscales=msScales.size();
+	
+	// Residual smoothed with every scale kernel (kernels are centred at length-1),
+	// split into real and imaginary parts for the subtraction kernel
+	vector<vector<double> > smoothedRe(nscales, vector<double>(length));
+	vector<vector<double> > smoothedIm(nscales, vector<double>(length));
+	for(unsigned int s=0; s < nscales; s++)
+	{
+		convolution(in, msKernels[s], convolved);
+		for(unsigned int i=0; i < length; i++)
 		{
-			shiftedRMSF=preshiftedRMSF[maxpos];
+			const complex<double> value=convolved[length-1+i]/msKernelSums[s];	// smoothing kernels have unit sum
+			smoothedRe[s][i]=value.real();
+			smoothedIm[s][i]=value.imag();
 		}
-		else	// if there is no preshifted RMSF at that position, compute it now (and store it in preshiftedRMSF vector)
+	}
+	
+	cleanedMap.assign(length, complex<double>(0,0));
+	double stop=noiseThreshold(&smoothedRe[0][0], &smoothedIm[0][0], length, 1, threshold);
+	double thresholdsq=stop*stop;
+	
+	for(numIterations=0; numIterations < maxIterations; numIterations++)
+	{
+		// stop when the (point-scale) residual is below threshold
+		double residualsq=0;
+		for(unsigned int i=0; i < length; i++)
+			residualsq=std::max(residualsq, smoothedRe[0][i]*smoothedRe[0][i]+smoothedIm[0][i]*smoothedIm[0][i]);
+		if(residualsq < thresholdsq)
 		{
-			shiftRMSF(maxpos, shiftedRMSF);
-
-			if(keepshiftedRMSF==true)						// if variable to precompute RMSF is set to true
-				preshiftedRMSF[maxpos]=shiftedRMSF;		// shiftRMSF and store it in vector of precomputed RMSFs
+			if(noiseMultiple==0)
+				break;
+			stop=noiseThreshold(&smoothedRe[0][0], &smoothedIm[0][0], length, 1, threshold);
+			if(residualsq < stop*stop)
+				break;
+			thresholdsq=stop*stop;
 		}
 		
-		
-		// Add newly computed dirty map component to cleanedMap (="Model Map")
-		// M[phi_max,k] = M[phi_max,k] + gain * dirtyMap[phi_max,k]
-		for(unsigned int i=0; i < length; i++)
+		// best (scale, position) by weighted residual reduction |I_s|^2/B_ss
+		unsigned int scale=0, maxpos=0;
+		double best=-1;
+		for(unsigned int s=0; s < nscales; s++)
 		{
-			cleanedMap[maxpos]=cleanedMap[maxpos]+gain*dirtyMap[maxpos];
+			if(msWeights[s]==0)
+				continue;
+			for(unsigned int i=msMargins[s]; i < length-msMargins[s]; i++)
+			{
+				double value=msWeights[s]*(smoothedRe[s][i]*smoothedRe[s][i]+smoothedIm[s][i]*smoothedIm[s][i]);
+				if(value > best)
+				{
+					best=value;
+					scale=s;
+					maxpos=i;
+				}
+			}
 		}
 		
-		cout << "shiftedRMSF.size() = " << shiftedRMSF.size() << endl;
+		// component amplitude: smoothed peak over the kernel's own RMSF response
+		const complex<double> component=gain*complex<double>(smoothedRe[scale][maxpos], smoothedIm[scale][maxpos])
+			/complex<double>(msRMSFre[scale][scale][length], msRMSFim[scale][scale][length]);
 		
-		// Substract RMSF scaled by maximum peak times gain factor from the dirtyMap
-		// F_{k+1}[phi] =  F_{k}[phi] - gain*F_{k}[phi]*shiftedRMSF[i]		
+		// M = M + component * K_scale(phi - phi_max)
 		for(unsigned int i=0; i < length; i++)
+			cleanedMap[i]+=component*msKernels[scale][length-1+i-maxpos];
+		
+		// I_t = I_t - component * (K_scale * K_t * R)(phi - phi_max) / sum(K_t)
+		for(unsigned int t=0; t < nscales; t++)
+			RM::subtractScaled(&smoothedRe[t][0], &smoothedIm[t][0], &msRMSFre[t][scale][length-maxpos],
+									 &msRMSFim[t][scale][length-maxpos], component.real(), component.imag(), length);
+	}
+	
+	residualPeak=0;
+	for(unsigned int i=0; i < length; i++)
+		residualPeak=std::max(residualPeak, smoothedRe[0][i]*smoothedRe[0][i]+smoothedIm[0][i]*smoothedIm[0][i]);
+	residualPeak=sqrt(residualPeak);
+	dirtyMap.resize(length);
+	for(unsigned int i=0; i < length; i++)
+		dirtyMap[i]=complex<double>(smoothedRe[0][i], smoothedIm[0][i]);
+	cleanComponents=cleanedMap;
+}
+
+
+/*!
+	\brief Compute scale kernels and the RMSF convolved with every pair of them
+	
+	Nothing is computed if scales and RMSF are the ones of the last call, so
+	the kernels and cross terms are made once per set of scales.
+	
+	The RMSF is centred at round(0.5*(RMSF.size()-length))+length/2, as in
+	shiftRMSF, so it may be longer than twice the data.
+	
+	\param scales - FWHMs of the scale kernels in Faraday depth channels, 0 is added as the point scale
+	\param length - number of Faraday depths of the data
+*/
+void rmclean::computeScaleRMSFs(const vector<double> &scales, const unsigned int length)
+{
+	const unsigned int centre=round(0.5*(RMSF.size()-length))+length/2;	// RMSF[centre] = R(0)
+	vector<double> widths(1, 0.0);								// point scale first
+	vector<complex<double> > pair, convolved;
+	
+	for(unsigned int s=0; s < scales.size(); s++)
+	{
+		if(scales[s] < 0)
+			throw "rmclean::computeScaleRMSFs scale < 0";
+		if(scales[s] > 0)
+			widths.push_back(scales[s]);
+	}
+	if(widths==msScales && RMSF==msScaleRMSFsource && msKernels[0].size()==2*length-1)	// cached
+		return;
+	
+	//------------------------------------------------------
+	// Kernels of length 2*length-1 with peak 1 at length-1
+	const unsigned int nscales=widths.size();
+	vector<double> gaussian(2*length-1);
+	
+	msKernels.assign(nscales, vector<complex<double> >(2*length-1));
+	msKernelSums.resize(nscales);
+	msMargins.resize(nscales);
+	for(unsigned int s=0; s < nscales; s++)
+	{
+		if(widths[s]==0)							// point scale: delta function
 		{
-			dirtyMap[i]=dirtyMap[i]-gain*dirtyMap[i]*shiftedRMSF[i];
+			gaussian.assign(2*length-1, 0.0);
+			gaussian[length-1]=1;
 		}
+		else
+			createGaussian(gaussian, 1, widths[s], length-1);
+		std::copy(gaussian.begin(), gaussian.end(), msKernels[s].begin());
+		msKernelSums[s]=0;
+		for(unsigned int i=0; i < gaussian.size(); i++)
+			msKernelSums[s]+=gaussian[i];
+		// kernel tails cut off at the ends are not in the model, keep them below 0.2%
+		msMargins[s]=static_cast<unsigned int>(ceil(1.5*widths[s]));
 	}
+	
+	//------------------------------------------------------
+	// Cross terms K_s * K_t * R / sum(K_t): response of the residual smoothed
+	// with (unit sum) kernel t to a component of scale s, centred at length
+	msRMSFre.assign(nscales, vector<vector<double> >(nscales, vector<double>(2*length)));
+	msRMSFim.assign(nscales, vector<vector<double> >(nscales, vector<double>(2*length)));
+	for(unsigned int s=0; s < nscales; s++)
+		for(unsigned int t=s; t < nscales; t++)
+		{
+			convolution(msKernels[s], msKernels[t], pair);		// centred at 2*length-2
+			convolution(pair, RMSF, convolved);					// centred at 2*length-2+centre
+			for(unsigned int i=0; i < 2*length; i++)
+			{
+				const complex<double> value=convolved[length-2+centre+i];
+				msRMSFre[t][s][i]=value.real()/msKernelSums[t];
+				msRMSFim[t][s][i]=value.imag()/msKernelSums[t];
+				msRMSFre[s][t][i]=value.real()/msKernelSums[s];
+				msRMSFim[s][t][i]=value.imag()/msKernelSums[s];
+			}
+		}
+	
+	//------------------------------------------------------
+	// Selection weights: bias^2 * sum(K_s) / B_ss(0) turns the smoothed peak into
+	// the residual reduction of a component. Scales over which the RMSF averages
+	// to less than 5% of its peak (e.g. wider than a rotating RMSF) are dropped.
+	const double maxscale=std::max(1.0, *max_element(widths.begin(), widths.end()));
+	const double rmsfpeak=abs(RMSF[centre]);
+	
+	if(rmsfpeak==0)
+		throw "rmclean::computeScaleRMSFs RMSF is 0 at its centre";
+	
+	msWeights.resize(nscales);
+	for(unsigned int s=0; s < nscales; s++)
+	{
+		const double response=abs(complex<double>(msRMSFre[s][s][length], msRMSFim[s][s][length]));
+		const double bias=1-0.3*widths[s]/maxscale;
+		
+		if(response < 0.05*rmsfpeak*msKernelSums[s] || 2*msMargins[s] >= length)
+			msWeights[s]=0;
+		else
+			msWeights[s]=bias*bias*msKernelSums[s]/response;
+	}
+	msWeights[0]=1/rmsfpeak;							// point scale is always used
+	
+	msScales=widths;
+	msScaleRMSFsource=RMSF;
 }
 
 
@@ -316,6 +737,68 @@ void rmclean::copyDataToDirtyMap(const vector<complex<double> > &data)
 }
 
 
+/*!
+	\brief Split the RMSF into real and imaginary parts for the subtraction kernel
+*/
+void rmclean::splitRMSF()
+{
+	rmsfRe.resize(RMSF.size());
+	rmsfIm.resize(RMSF.size());
+	for(unsigned int i=0; i < RMSF.size(); i++)
+	{
+		rmsfRe[i]=RMSF[i].real();
+		rmsfIm[i]=RMSF[i].imag();
+	}
+}
+
+
+/*!
+	\brief Estimate the noise of a residual and return the threshold to stop CLEAN at
+	
+	The noise in Q and U of a Faraday spectrum has zero mean, so its median
+	absolute deviation is the median of |Q| and |U| and needs no separate
+	pass for the median itself. The median is estimated in one pass with
+	the P^2 algorithm over the noiseRange fraction of the spectrum at each
+	end (the outer Faraday depths, where few sources are expected), or over
+	the whole residual if noiseRange is 0; a few source channels do not move
+	the median. The noise level is sigma=1.4826*MAD.
+	
+	\param re - real parts of the residual
+	\param im - imaginary parts of the residual
+	\param length - number of Faraday depths
+	\param stride - distance between Faraday depths in re and im
+	\param threshold - fixed threshold
+	
+	\return stop - larger of threshold and noiseMultiple times the noise level
+*/
+double rmclean::noiseThreshold(const double *re, const double *im, const unsigned int length,
+										 const unsigned int stride, const double threshold)
+{
+	if(noiseMultiple==0)
+	{
+		noiseLevel=0;
+		return threshold;
+	}
+	
+	unsigned int outer=static_cast<unsigned int>(noiseRange*length);
+	if(outer==0 || 2*outer >= length)
+		outer=length;				// whole residual
+	
+	noiseMedian.reset();
+	for(unsigned int i=0; i < length; i++)
+	{
+		if(i==outer)				// skip the inner Faraday depths
+			i=length-outer;
+		noiseMedian.add(fabs(re[i*stride]));
+		noiseMedian.add(fabs(im[i*stride]));
+	}
+	noiseLevel=1.4826*noiseMedian.get();
+	
+	// a noise-free residual must still stop
+	return std::max(std::max(threshold, noiseMultiple*noiseLevel), numeric_limits<double>::min());
+}
+
+
 /*
 	\brief Determine the FWHM of a data vector
 	
@@ -579,11 +1062,45 @@ void rmclean::createGaussian(vector<complex<double> > &gaussian, const double pe
 double* rmclean::createGaussianArray(const int length, const double peak, const double fwhm)
 {
 	double *gaussian=NULL;			// vector to keep Gaussian data
+
+	if(length<=0)
+		throw "rmclean::createGaussian length<=0";
+	if(!(gaussian=(double*) calloc(length, sizeof(double)))) // allocate memory
+	{
+		throw "rmclean:createGaussian could not allocate memory for Gaussian";
+	}
+	
+	try
+	{
+		createGaussianArray(gaussian, length, peak, fwhm);
+	}
+	catch(const char *)
+	{
+		free(gaussian);
+		throw;
+	}
+
+	return gaussian;
+}
+
+
+/*
+	\brief Fill a double array with a Gaussian over length with given peak value and FWHM
+	
+	\param *gaussian - array of length doubles to fill
+	\param length - length of data vector to create
+	\param peak - peak value of Gaussian
+	\param fwhm - Full Width Half Maximum of Gaussian to create
+*/
+void rmclean::createGaussianArray(double *gaussian, const int length, const double peak, const double fwhm)
+{
 	double sigma=fwhm/(2*sqrt(2*log(2)));	// standard deviation sigma dependence on fwhm
 	double normalizationfactor=1, factor=0;				// normalization factor to scale Gaussian to desired peak value
 	double sigmafactor=0;						// 2*sigma*sigma division in exponential
 
 	// Check for data consistency
+	if(gaussian==NULL)
+		throw "rmclean::createGaussian gaussian is NULL";
 	if(length<=0)
 		throw "rmclean::createGaussian length<=0";
 	if(peak<=0)
@@ -591,12 +1108,6 @@ double* rmclean::createGaussianArray(const int length, const double peak, const
 	if(fwhm<=0)
 		throw "rmclean::createGaussian fwhm<=0";
 		
-	//----------------------------------------
-	if(!(gaussian=(double*) calloc(length, sizeof(double)))) // allocate memory
-	{
-		throw "rmclean:createGaussian could not allocate memory for Gaussian";
-	}
-	
 	//------------------------------------------------------------
 	// Period Gaussian with specified FWHM and peak
 	//
@@ -605,16 +1116,37 @@ double* rmclean::createGaussianArray(const int length, const double peak, const
 	factor=normalizationfactor*(1/(sigma*sqrt(2*M_PI)));
 	sigmafactor=1/(2*sigma*sigma);
 	
-	for(int i=0; i < floor(length/2); i++)
+	for(int i=0; i < length; i++)
+	{
+		gaussian[i]=0;
+	}
+	for(int i=0; i < floor(length/2.0); i++)
 	{
 		gaussian[i]=factor*exp(-sigmafactor*i*i);
 	}
-	for(int i=ceil(length/2); i < length; i++)
+	for(int i=ceil(length/2.0); i < length; i++)
 	{
 		gaussian[i]=factor*exp(-sigmafactor*(length-i)*(length-i));
 	}
+}
 
-	return gaussian;
+
+/*!
+	\brief Fourier transform the restoring Gaussian for fwhm into FTGaussian
+	
+	The transform is kept until a different fwhm is requested, so restoring
+	costs one Gaussian FFT per FWHM instead of one per CLEAN component.
+	
+	\param fwhm - Full Width Half Maximum of restoring Gaussian
+*/
+void rmclean::transformGaussian(const double fwhm)
+{
+	if(fwhm==gaussianFWHM)		// FTGaussian is still valid
+		return;
+
+	createGaussianArray(gaussian, length, 1, fwhm);	// unit peak, in the buffer planGaussian was made for
+	fftw_execute(planGaussian);
+	gaussianFWHM=fwhm;
 }
 
 
@@ -675,89 +1207,102 @@ void rmclean::createGaussian(vector<complex<double> > &complexGaussian, const do
 
 
 /*!
-	\brief Shift the RMSF to a maximum given at maxpos and store it in shiftedRMSF
+	\brief View of the RMSF shifted to a maximum at maxpos
+	
+	A shift is only an offset into the RMSF, which is computed over at least
+	twice the range of the data, so no copy is made.
 	
 	\param maxpos - position of maximum to shift RMSF to
-	\param shiftedRMSF - vector to hold shifted RMSF
+	\param length - number of Faraday depths of the data being cleaned
+	
+	\return shiftedRMSF - pointer to length values R(phi - phi_maxpos), valid until RMSF changes
 */
-void rmclean::shiftRMSF(const unsigned int maxpos, vector<complex<double> > &shiftedRMSF)
+const complex<double> *rmclean::shiftRMSF(const unsigned int maxpos, const unsigned int length) const
 {
-	const unsigned int length=shiftedRMSF.size();
 	int shift=0;								// shift RMSF by this (depending on length and maxpos)
-	int sizedifference=0;					// difference in size of RMSF and dirtyMap
+	int sizedifference=0;					// difference in size of RMSF and data
 
 	if(RMSF.size()==0)		// if RMSF has zero size, i.e. is not computed yet
 		throw "rmclean::shiftRMSF RMSF has size 0";
-	else if(RMSF.size() < 2*dirtyMap.size())
-		throw "rmclean::shiftRMSF RMSF must be at least twice the size of the dirtyMap for shifting";
-	else if(maxpos > dirtyMap.size())
-		throw "rmclean::shiftRMSF requested shift exceeds dirtyMap";
+	else if(RMSF.size() < 2*length)
+		throw "rmclean::shiftRMSF RMSF must be at least twice the size of the data for shifting";
+	else if(maxpos >= length)
+		throw "rmclean::shiftRMSF requested shift exceeds data";
 
 	//-------------------------------------------------------------------
-	// Calculate size difference of RMSF and dirtyMap to map RMSF correctly
-	sizedifference=round(0.5*(RMSF.size()-dirtyMap.size()));
-	// Calculate shift from maxpos and length, need to round if length is odd
-	shift=round(maxpos-0.5*dirtyMap.size());
+	// Calculate size difference of RMSF and data to map RMSF correctly
+	sizedifference=round(0.5*(RMSF.size()-length));
+	// Calculate shift from maxpos and length, the centre of an odd length is its middle element
+	shift=static_cast<int>(maxpos)-static_cast<int>(length/2);
 
-	if(shiftedRMSF.size()!=length)								// if shiftedRMSF vector has wrong size...
-		shiftedRMSF.resize(length);								// ...resize it to the required length
-	for(unsigned int i=0; i < length; i++)
-	{
-		shiftedRMSF[i] = RMSF[sizedifference+i-shift];		// shiftedRMSF = R(phi - maxpos)
-	}
+	return &RMSF[0]+sizedifference-shift;			// shiftedRMSF[i] = R(phi_i - phi_maxpos)
 }
 
 
-/*!
-	\brief Compute preshifted RMSFs for all positions given in dirtyMap vector
-*/
-void rmclean::computePreshiftedRMSF()
-{
-	const unsigned int length=dirtyMap.size();
-		
-	if(dirtyMap.size()==0)
-		throw "rmclean::computePreshiftedRMSF dirtyMap has size 0";
-
-	// Resize preshiftedRMSF vector to hold length shifted RMSFs
-	if(preshiftedRMSF.size()!=length)
-		preshiftedRMSF.resize(length);
-
-	for(unsigned int k=0; k < length; k++)				// loop over k positions to shift to
-	{
-		if(preshiftedRMSF[k].size()!=length)			// if preshiftedRMSF has wrong size...
-			preshiftedRMSF[k].resize(length);			// ... then resize k-th preshiftedRMSF
-		
-		shiftRMSF(k, preshiftedRMSF[k]);				// compute shiftedRMSF at maxpos i
-	}
-}
+//************************************************************
+//
+// FFT helper functions
+//
+//************************************************************
 
 
 /*!
-	\brief Compute preshifted RMSFs for positions 0 to length-1
+	\brief Get the FFTW plan of a vector transform, planning it on first use
+	
+	Plans are kept per object for the lifetime of the rmclean object, so Clark
+	and multi-scale CLEAN take the planner mutex only for the first major cycle
+	of a size. They are made with FFTW_UNALIGNED on scratch arrays and executed
+	on the vectors with the new-array interface (fftw_execute_dft etc.).
+	
+	\param kind - fftKind of the transform
+	\param size - transform length
+	\param inplace - plan an in-place transform (input and output arrays are the same)
+	
+	\return plan - FFTW plan owned by this object
 */
-void rmclean::computePreshiftedRMSF(const unsigned int length)
+fftw_plan rmclean::cachedPlan(const int kind, const unsigned int size, const bool inplace)
 {
-	if(length==0)
-		throw "rmclean::computePreshiftedRMSF length is 0";
-	
-	preshiftedRMSF.resize(length);						// resize vector holding k-th shifted RMSF vector
-	for(unsigned int k=0; k < length; k++)
+	for(unsigned int i=0; i < fftPlans.size(); i++)
+		if(fftPlans[i].kind==kind && fftPlans[i].size==size && fftPlans[i].inplace==inplace)
+			return fftPlans[i].plan;
+	
+	fftw_complex *in=(fftw_complex*) fftw_malloc(sizeof(fftw_complex)*(size+2));
+	fftw_complex *out=inplace ? in : (fftw_complex*) fftw_malloc(sizeof(fftw_complex)*(size+2));
+	const unsigned flags=FFTW_ESTIMATE | FFTW_UNALIGNED;
+	
+	fftPlan entry;
+	entry.kind=kind;
+	entry.size=size;
+	entry.inplace=inplace;
+	pthread_mutex_lock(&plannerMutex);
+	switch(kind)
 	{
-		if(preshiftedRMSF[k].size()!=length)			// if preshiftedRMSF has wrong size...
-			preshiftedRMSF[k].resize(length);			// ... then resize k-th preshiftedRMSF
-		
-		shiftRMSF(k, preshiftedRMSF[k]);				// compute shiftedRMSF at maxpos i
+		case FFT_C2C_FORWARD:
+			entry.plan=fftw_plan_dft_1d(size, in, out, FFTW_FORWARD, flags);
+			break;
+		case FFT_C2C_BACKWARD:
+			entry.plan=fftw_plan_dft_1d(size, in, out, FFTW_BACKWARD, flags);
+			break;
+		case FFT_R2C:
+			entry.plan=fftw_plan_dft_r2c_1d(size, reinterpret_cast<double*>(in), out, flags);
+			break;
+		default:
+			entry.plan=fftw_plan_dft_c2r_1d(size, in, reinterpret_cast<double*>(out), flags);
+			break;
 	}
+	pthread_mutex_unlock(&plannerMutex);
+	
+	if(out!=in)
+		fftw_free(out);
+	fftw_free(in);
+	if(entry.plan==NULL)
+		throw "rmclean::cachedPlan FFTW could not plan the transform";
+	fftPlans.push_back(entry);
+	
+	return entry.plan;
 }
 
 
-//************************************************************
-//
-// FFT helper functions
-//
-//************************************************************
-
-
 /*!
 	\brief FFT r2r: Real to real Fourier transform
 	
@@ -786,11 +1331,16 @@ void rmclean::ifft_real(vector<double> &in, vector<double> &out)
 	\brief FFT r2c: real to complex Fourier Transform
 	
 	\param data - vector with data to be Fourier Transformed
-	\param vector<complex> - complex Fourier Transform of data vector
+	\param vector<complex> - complex Fourier Transform of data vector, in.size()/2+1 non-negative frequencies
 */
 void rmclean::fft(vector<double> &in, vector<complex<double> > &out)
 {
+	if(in.size()==0)
+		throw "rmclean::fft input vector has size 0";
 
+	out.resize(in.size()/2+1);
+	fftw_plan plan=cachedPlan(FFT_R2C, in.size(), false);
+	fftw_execute_dft_r2c(plan, &in[0], reinterpret_cast<fftw_complex*>(&out[0]));
 }
 
 
@@ -802,49 +1352,150 @@ void rmclean::fft(vector<double> &in, vector<complex<double> > &out)
 */
 void rmclean::fft(vector<complex<double> > &in, vector<complex<double> > &out)
 {
-	
-	
+	if(in.size()==0)
+		throw "rmclean::fft input vector has size 0";
+
+	out.resize(in.size());
+	fftw_plan plan=cachedPlan(FFT_C2C_FORWARD, in.size(), &in==&out);
+	fftw_execute_dft(plan, reinterpret_cast<fftw_complex*>(&in[0]), reinterpret_cast<fftw_complex*>(&out[0]));
 }
 
 
 /*!
 	\brief Inverse FFT c2r: inverse complex vector to real Fourier transform
 	
-	\param &a - vector to be inverse Fourier transformed
-	\param &b - inverse Fourier Transform double vector
+	\param &a - non-negative frequencies to be inverse Fourier transformed (a.size()/2+1 of b.size())
+	\param &b - inverse Fourier Transform double vector, normalized; its size gives the transform length (default 2*(a.size()-1))
 */
 void rmclean::ifft(vector<complex<double> > &a, vector<double> &b)
 {
-	
+	if(a.size()==0)
+		throw "rmclean::ifft input vector has size 0";
+	if(b.size()==0)
+		b.resize(2*(a.size()-1));
+	if(b.size()/2+1!=a.size())
+		throw "rmclean::ifft output size does not match input size";
+
+	vector<complex<double> > in(a);		// c2r overwrites its input
+	fftw_plan plan=cachedPlan(FFT_C2R, b.size(), false);
+	fftw_execute_dft_c2r(plan, reinterpret_cast<fftw_complex*>(&in[0]), &b[0]);
+	
+	for(unsigned int i=0; i < b.size(); i++)
+		b[i]/=b.size();
 }
 
 
 /*!
 	\brief Inverse FFT c2c: inverse complex to complex Fourier transform
 	
-	\param data - vector to be inverse Fourier transformed
-	
-	\return iFFT - inverse Fourier Transform complex<double> vector
+	\param a - vector to be inverse Fourier transformed
+	\param b - inverse Fourier Transform complex<double> vector, normalized
 */
 void rmclean::ifft(vector<complex<double> > &a, vector<complex<double> > &b)
 {
+	if(a.size()==0)
+		throw "rmclean::ifft input vector has size 0";
+
+	b.resize(a.size());
+	fftw_plan plan=cachedPlan(FFT_C2C_BACKWARD, a.size(), &a==&b);
+	fftw_execute_dft(plan, reinterpret_cast<fftw_complex*>(&a[0]), reinterpret_cast<fftw_complex*>(&b[0]));
 	
-	
+	for(unsigned int i=0; i < b.size(); i++)
+		b[i]/=b.size();
 }
 
 
 /*!
 	\brief Convolve vector a and b
 	
+	Linear convolution: both vectors are zero-padded to a.size()+b.size()-1
+	and multiplied in Fourier space.
+	
 	\param &a - vector<complex<double> > &a
 	\param &b - vector<complex<double> > &b
-	\param &c - convolution of vectors a and b, i.e. multiplication in Fourier Space
+	\param &c - convolution of vectors a and b, c[m] = sum_k a[k]*b[m-k], of size a.size()+b.size()-1
 */
 void rmclean::convolution(vector<complex<double> > &a , vector<complex<double> > &b, vector<complex<double> > &c)
 {
+	if(a.size()==0 || b.size()==0)
+		throw "rmclean::convolution input vector has size 0";
+
+	const unsigned int length=a.size()+b.size()-1;
+	vector<complex<double> > paddedA(length), paddedB(length);
+	vector<complex<double> > FTa, FTb;
+	
+	std::copy(a.begin(), a.end(), paddedA.begin());
+	std::copy(b.begin(), b.end(), paddedB.begin());
+	fft(paddedA, FTa);
+	fft(paddedB, FTb);
+	for(unsigned int i=0; i < length; i++)
+		FTa[i]*=FTb[i];
+	ifft(FTa, c);
+}
+
+
+//***********************************************************
+//
+// FFTW wisdom
+//
+//***********************************************************
+
+
+/*!
+	\brief Import FFTW wisdom from a file, so that FFTW_MEASURE plans are not measured again
 	
+	\param filename - wisdom file (e.g. in the run directory)
 	
+	\return imported - true if the file existed and was read
+*/
+bool rmclean::importWisdom(const string &filename)
+{
+	FILE *file=fopen(filename.c_str(), "r");
+	if(file==NULL)
+		return false;
+
+	pthread_mutex_lock(&plannerMutex);
+	int imported=fftw_import_wisdom_from_file(file);
+	pthread_mutex_unlock(&plannerMutex);
+	fclose(file);
+	
+	return imported!=0;
+}
+
+
+/*!
+	\brief Export the FFTW wisdom accumulated by all plans of this process to a file
 	
+	\param filename - wisdom file (e.g. in the run directory)
+*/
+void rmclean::exportWisdom(const string &filename)
+{
+	FILE *file=fopen(filename.c_str(), "w");
+	if(file==NULL)
+		throw "rmclean::exportWisdom could not open wisdom file";
+
+	pthread_mutex_lock(&plannerMutex);
+	fftw_export_wisdom_to_file(file);
+	pthread_mutex_unlock(&plannerMutex);
+	fclose(file);
+}
+
+
+/*!
+	\brief Lock the FFTW planner, for plans made outside of rmclean (e.g. RM::rmBatchConvolver)
+*/
+void rmclean::lockPlanner()
+{
+	pthread_mutex_lock(&plannerMutex);
+}
+
+
+/*!
+	\brief Unlock the FFTW planner locked with lockPlanner
+*/
+void rmclean::unlockPlanner()
+{
+	pthread_mutex_unlock(&plannerMutex);
 }
 
 
@@ -866,6 +1517,17 @@ vector<complex<double> > rmclean::getCleanComponents(void)
 }
 
 
+/*!
+	\brief Get the residual map left by the last CLEAN
+	
+	\return dirtyMap - residual after the CLEAN components were subtracted
+*/
+vector<complex<double> > rmclean::getResidualMap(void)
+{
+	return this->dirtyMap;
+}
+
+
 /*!
 	\brief Get the FWHM
 	
@@ -917,33 +1579,133 @@ void rmclean::setGain(double gain)
 
 
 /*!
-	\brief Get current number of iterations in CLEAN loop
+	\brief Get the RMSF cutoff
 	
-	\return numIterations - current number of iterations
+	\return rmsfCutoff - fraction of the RMSF peak below which rmsfClean ignores the RMSF
 */
-unsigned int rmclean::getNumIterations()
+double rmclean::getRMSFCutoff()
 {
-	return numIterations;
+	return rmsfCutoff;
 }
 
 
 /*!
-	\brief Get truth variable if shifted RMSF should be saved
+	\brief Set the RMSF cutoff
+	
+	\param cutoff - fraction of the RMSF peak below which rmsfClean ignores the RMSF (0 = full RMSF)
+*/
+void rmclean::setRMSFCutoff(double cutoff)
+{
+	if(cutoff<0 || cutoff>=1)
+		throw "rmclean::setRMSFCutoff cutoff not in [0,1)";
+	else
+		this->rmsfCutoff=cutoff;
+}
 
-	\return bool - truth variable (true or false), if shifted RMSF that are computed should be stored in preshiftedRMSF
+
+/*!
+	\brief Get the multiple of the noise level CLEAN stops at
+	
+	\return noiseMultiple - multiple of the estimated noise (0 = threshold only)
 */
-bool rmclean::getKeepShiftedRMSF()
+double rmclean::getNoiseMultiple()
 {
-	return keepshiftedRMSF;
+	return noiseMultiple;
 }
 
 
 /*!
-	\brief Set truth variable if shifted RMSF should be saved
+	\brief Set the multiple of the noise level CLEAN stops at
 	
-	\param bool - truth variable (true or false), if shifted RMSF that are computed are stored in preshiftedRMSF
+	rmsfClean, clark and multiscaleClean then stop at the larger of their
+	threshold and multiple times the noise estimated from the residual.
+	
+	\param multiple - multiple of the estimated noise (0 = threshold only)
 */
-void rmclean::setKeepShiftedRMSF(bool keepRMSF)
+void rmclean::setNoiseMultiple(double multiple)
 {
-	this->keepshiftedRMSF=keepRMSF;
+	if(multiple<0)
+		throw "rmclean::setNoiseMultiple multiple < 0";
+	else
+		this->noiseMultiple=multiple;
+}
+
+
+/*!
+	\brief Get the fraction of the spectrum the noise is estimated from
+	
+	\return noiseRange - fraction of the Faraday depths at each end (0 = whole residual)
+*/
+double rmclean::getNoiseRange()
+{
+	return noiseRange;
+}
+
+
+/*!
+	\brief Set the fraction of the spectrum the noise is estimated from
+	
+	\param fraction - fraction of the Faraday depths at each end (0 = whole residual)
+*/
+void rmclean::setNoiseRange(double fraction)
+{
+	if(fraction<0 || fraction>=0.5)
+		throw "rmclean::setNoiseRange fraction not in [0,0.5)";
+	else
+		this->noiseRange=fraction;
+}
+
+
+/*!
+	\brief Get the noise level estimated by the last CLEAN
+	
+	\return noiseLevel - sigma of Q and U (0 without noise-based stop)
+*/
+double rmclean::getNoiseLevel()
+{
+	return noiseLevel;
+}
+
+
+/*!
+	\brief Get the largest residual left by the last CLEAN
+	
+	\return residualPeak - largest |residual| after the last iteration
+*/
+double rmclean::getResidualPeak()
+{
+	return residualPeak;
+}
+
+
+/*!
+	\brief Get the half-width of the RMSF patch used in the Clark minor cycle
+	
+	\return clarkPatch - half-width in Faraday depth channels (0 = 5 HWHM of |RMSF|)
+*/
+unsigned int rmclean::getClarkPatch()
+{
+	return clarkPatch;
+}
+
+
+/*!
+	\brief Set the half-width of the RMSF patch used in the Clark minor cycle
+	
+	\param halfwidth - half-width in Faraday depth channels (0 = 5 HWHM of |RMSF|)
+*/
+void rmclean::setClarkPatch(unsigned int halfwidth)
+{
+	this->clarkPatch=halfwidth;
+}
+
+
+/*!
+	\brief Get current number of iterations in CLEAN loop
+	
+	\return numIterations - current number of iterations
+*/
+unsigned int rmclean::getNumIterations()
+{
+	return numIterations;
 }
@@ -29,8 +29,12 @@
 
 #include <vector>
 #include <complex>
+#include <string>
+#include <pthread.h>
 #include <fftw3.h>
 #include "rmIO.h"
+#include "rmPeakFinder.h"
+#include "rmP2Quantile.h"
 
 using namespace std;
 
@@ -41,6 +45,8 @@ class rmclean : public RM::rmIO
   vector<complex<double> > cleanComponents;			//! vector containing CLEAN components
   //	vector<complex<double> > cleanedimage;				//! final cleaned image, this will be returned by the methods, so no need to keep that as attribute in the class
   double fullwidthhalfmaximum;							//! FWHM needs to be computed only once
+  double gaussianFWHM;										//! FWHM FTGaussian was computed for (0 = not yet)
+  unsigned int length;										//! length of FFTs and their buffers
   double gain;												//! gainfactor for CLEAN iterations
   vector<double> gaussianSubstraction;				//! Gaussian used in substraction from dirty map
   double *gaussian;											//! non Fourier tranformed function (e.g. Gaussian / Dirac)
@@ -48,6 +54,16 @@ class rmclean : public RM::rmIO
   double *restoredComponent;								//! inverse Fourier Transformed restored Component
   
   unsigned int numIterations;							//! current number of iterations
+  double rmsfCutoff;											//! fraction of RMSF peak below which rmsfClean ignores the RMSF
+  unsigned int clarkPatch;									//! half-width of RMSF patch in Clark minor cycle (0 = automatic)
+  RM::rmPeakFinder peakFinder;							//! incremental peak search on |dirtyMap|^2
+  
+  // Noise-based stopping
+  double noiseMultiple;										//! stop at this multiple of the estimated noise (0 = threshold only)
+  double noiseRange;											//! fraction of the spectrum at each end the noise is estimated from (0 = all)
+  double noiseLevel;											//! noise (sigma of Q and U) estimated by the last CLEAN
+  double residualPeak;										//! largest |residual| left by the last CLEAN
+  RM::rmP2Quantile noiseMedian;							//! streaming median of |Q| and |U|
   
   // FFTW related attributes for (inverse) Fast Fourier Transforms
   fftw_complex *FTGaussian;								//! Fourier Transform of Gaussian (with RMSF' FWHM)
@@ -58,18 +74,50 @@ class rmclean : public RM::rmIO
   fftw_plan planCleanComponent;							//! FFTW3 plan for Fourier Transform of CleanComponent
   fftw_plan planRestoredComponent;						//! FFTW3 plan for Inverse Fourier Transform back into data space
   
+  static pthread_mutex_t plannerMutex;					//! serialises FFTW planner calls of all rmclean objects
+  
+  // FFTW plans of the vector fft/ifft helpers, made once per transform kind and size
+  enum fftKind { FFT_C2C_FORWARD, FFT_C2C_BACKWARD, FFT_R2C, FFT_C2R };
+  struct fftPlan {
+    int kind;													//! fftKind of the plan
+    unsigned int size;										//! transform length
+    bool inplace;												//! planned for in == out
+    fftw_plan plan;
+  };
+  vector<fftPlan> fftPlans;									//! plans of this object, executed with the new-array interface
+  
   //	vector<complex<double> > RMSF;						//! RMSF, must be at least computed over twice the range as the data RM to be cleaned
   vector<complex<double> > FTRMSF;						//! Fourier Transform of RMSF
-  vector<vector<complex<double> > > preshiftedRMSF;			//! vector containing a set of preshifted RMSFs
+  vector<complex<double> > FTRMSFsource;				//! RMSF FTRMSF was computed for
+  
+  // Split real/imaginary working arrays of the RM::subtractScaled kernel
+  vector<double> residualRe, residualIm;					//! residual while cleaning
+  vector<double> rmsfRe, rmsfIm;							//! RMSF
+  
+  // Multi-scale CLEAN, computed once per set of scales and RMSF
+  vector<double> msScales;									//! FWHMs of scale kernels, msScales[0]=0 is the point scale
+  vector<double> msWeights;									//! peak selection weight of each scale, 0 for unusable scales
+  vector<unsigned int> msMargins;							//! distance of extended components from the ends of the data
+  vector<vector<complex<double> > > msKernels;			//! scale kernels of length 2N-1, peak 1 at N-1
+  vector<double> msKernelSums;								//! sum of each scale kernel
+  vector<vector<vector<double> > > msRMSFre, msRMSFim;	//! cross terms [t][s] K_s*K_t*R/sum(K_t) of length 2N, centred at N
+  vector<complex<double> > msScaleRMSFsource;			//! RMSF the cross terms were computed for
   
   // private helper functions
   
-  bool keepshiftedRMSF;									//! keep shifted RMSF true or false
   void copyDataToDirtyMap(const vector<complex<double> > &data);							//! make a copy of data in dirtyMap vector
+  void splitRMSF();												//! copy RMSF into rmsfRe and rmsfIm
+  double noiseThreshold(const double *re, const double *im, const unsigned int length,
+								const unsigned int stride, const double threshold);	//! estimate noise and return the stopping threshold
   
-  void shiftRMSF(const unsigned int maxpos, vector<complex<double> > &shiftedRMSF);				//! shift RMSF to one phi_max position
-  void computePreshiftedRMSF();							//! compute shifted RMSF for positions 0 to length of dirtyMap
-  void computePreshiftedRMSF(const unsigned int length);	//! compute shifted RMSF for positions 0 to length
+  const complex<double> *shiftRMSF(const unsigned int maxpos, const unsigned int length) const;				//! view of the RMSF shifted to one phi_max position
+  void transformGaussian(const double fwhm);				//! Fourier transform restoring Gaussian, cached per FWHM
+  void computeScaleRMSFs(const vector<double> &scales, const unsigned int length);	//! compute scale kernels and cross-term RMSFs
+  fftw_plan cachedPlan(const int kind, const unsigned int size, const bool inplace);	//! get (or make) the plan of a vector transform
+  
+  // no copies of the FFTW plans and buffers
+  rmclean(const rmclean &);
+  rmclean &operator=(const rmclean &);
   
  public:
   
@@ -84,7 +132,6 @@ class rmclean : public RM::rmIO
   
   // Test functions...
   vector<complex<double> > RMSF;						//! RMSF, must be at least computed over twice the range as the data RM to be cleaned	
-  //	vector<vector<complex<double> > > preshiftedRMSF;			//! vector containing a set of preshifted RMSFs
   //...//
   
   // Hogbom CLEAN algorithms, this perforrms only the Major cycle on all components
@@ -98,18 +145,20 @@ class rmclean : public RM::rmIO
   // Brentjens RM CLEAN algorithms, convolve with full RMSF function
   void rmsfClean(const vector<complex<double> > &, vector<complex<double> > &, const double threshold, const unsigned int maxiter);
   
+  // Multi-scale CLEAN with Gaussian scale kernels for Faraday-thick structures
+  void multiscaleClean(const vector<complex<double> > &, vector<complex<double> > &, const vector<double> &scales, const double threshold, const unsigned int maxiter);
+  
   // Helper functions
   void createGaussian(vector<double> &, const double peak, const double fwhm, const unsigned int peakpos);					// create a Gaussian with equivalent FWHM and peak height shifted to peakpos
   void createGaussian(vector<complex<double> > &, const double peak, const double fwhm, const unsigned int peakpos);	// create a complex Gaussian with equivalent FWHM and peak height shifted to peakpos
   void createGaussian(vector<double>  &, const double peak, const double fwhm);											// create a Gaussian with equivalent FWHM and peak height
   void createGaussian(vector<complex<double> > &, const double peak, const double fwhm);											// create a complex Gaussian with equivalent FWHM and peak height
 	double* createGaussianArray(const int length, const double peak, const double fwhm);								// create a double array with a Gaussian function
+	void createGaussianArray(double *gaussian, const int length, const double peak, const double fwhm);			// fill a double array with a Gaussian function
 
 	double FWHM(const vector<double> &data);								// determine the FWHM of a data vector
 	complex<double> FWHM(const vector<complex<double> > &data);		// determine the real and imaginary FWHM of a complex data vector
 
-	void computePreshiftedRMSF(vector<int> shiftpositions);			// compute
-	
 	// FFT helper functions with vectors
 	void fft_real(vector<double> &, vector<double> &);
 	void fft(vector<double> &, vector<complex<double> > &);	
@@ -123,15 +172,29 @@ class rmclean : public RM::rmIO
 
 	void setPlan();
 	
+	// FFTW wisdom shared by all rmclean objects of the process
+	static bool importWisdom(const std::string &filename);		// import wisdom from file, false if there is none
+	static void exportWisdom(const std::string &filename);		// export wisdom to file
+	static void lockPlanner();										// serialise FFTW planner calls with all rmclean objects
+	static void unlockPlanner();									// release the FFTW planner
+	
 	// Member access functions
 //	vector<complex<double> > getCleanedMap();				// return the final cleaned image
 	vector<complex<double> > getCleanComponents();		// return vector with CLEAN components
+	vector<complex<double> > getResidualMap();			// return residual of last CLEAN
 	double getFWHM();												// get the calculated FHWM
 	void setFWHM(double fwhm);									// set the FWHM value
 	double getGain();												// get the currently set gain for cleaning
 	void setGain(double gain);									// set the gain for cleaning
 	unsigned int getNumIterations();							// get current number of iterations
-
-	bool getKeepShiftedRMSF();									// get truth variable if shifted RMSF should be kept in vector
-	void setKeepShiftedRMSF(bool);							// set truth variable if shifted RMSF should be kept in vector
+	double getRMSFCutoff();										// get the RMSF cutoff used in rmsfClean
+	unsigned int getClarkPatch();								// get the half-width of the Clark RMSF patch
+	void setClarkPatch(unsigned int halfwidth);			// set the half-width of the Clark RMSF patch
+	void setRMSFCutoff(double cutoff);						// set the RMSF cutoff used in rmsfClean
+	double getNoiseMultiple();									// get the multiple of the noise CLEAN stops at
+	void setNoiseMultiple(double multiple);				// set the multiple of the noise CLEAN stops at (0 = off)
+	double getNoiseRange();										// get the fraction of the spectrum the noise is estimated from
+	void setNoiseRange(double fraction);					// set the fraction of the spectrum at each end the noise is estimated from
+	double getNoiseLevel();										// get the noise estimated by the last CLEAN
+	double getResidualPeak();									// get the largest |residual| left by the last CLEAN
 };
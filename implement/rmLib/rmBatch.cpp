@@ -0,0 +1,277 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <iostream>
+#include <fitsio.h>
+#include "rmBatch.h"
+
+using namespace std;
+
+namespace RM {
+
+  //_____________________________________________________________________________
+  //                                                              reportFITSerror
+
+  //! Print the cfitsio error message of status and throw message
+  static void reportFITSerror (int status,
+                               const char *message)
+  {
+    char fits_error_message[FLEN_STATUS];
+
+    fits_get_errstatus(status, fits_error_message);
+    cerr << fits_error_message << endl;
+    throw message;
+  }
+
+  // ============================================================================
+  //
+  //  Construction
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                                      rmBatch
+
+  rmBatch::rmBatch ()
+  {
+    nspectra=0;
+  }
+
+  //_____________________________________________________________________________
+  //                                                                      rmBatch
+
+  /*!
+    \param &lambdaSquareds - lambda squareds of the channels (m^2)
+    \param &deltaLambdaSquareds - channel widths in lambda squared (m^2)
+    \param &weights - channel weights
+    \param nspectra - number of spectra
+  */
+  rmBatch::rmBatch (const vector<double> &lambdaSquareds,
+                    const vector<double> &deltaLambdaSquareds,
+                    const vector<double> &weights,
+                    uint64_t nspectra)
+  {
+    if(lambdaSquareds.size()==0)
+      throw "rmBatch::rmBatch lambdaSquareds has size 0";
+    if(deltaLambdaSquareds.size()!=lambdaSquareds.size() ||
+       weights.size()!=lambdaSquareds.size())
+      throw "rmBatch::rmBatch channel vectors differ in size";
+
+    this->lambdaSquareds=lambdaSquareds;
+    this->deltaLambdaSquareds=deltaLambdaSquareds;
+    this->weights=weights;
+    this->nspectra=nspectra;
+    q.assign(lambdaSquareds.size()*nspectra, 0.0);
+    u.assign(lambdaSquareds.size()*nspectra, 0.0);
+  }
+
+  //_____________________________________________________________________________
+  //                                                                      rmBatch
+
+  /*!
+    \param &filename - name of FITS file to read the container from
+  */
+  rmBatch::rmBatch (const string &filename)
+  {
+    nspectra=0;
+    read(filename);
+  }
+
+  // ============================================================================
+  //
+  //  Methods
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                                  setSpectrum
+
+  /*!
+    \param s - (0-based) index of spectrum
+    \param &spectrum - complex values of all channels
+  */
+  void rmBatch::setSpectrum (uint64_t s,
+                             const vector<complex<double> > &spectrum)
+  {
+    if(s >= nspectra)
+      throw "rmBatch::setSpectrum spectrum out of range";
+    if(spectrum.size()!=lambdaSquareds.size())
+      throw "rmBatch::setSpectrum spectrum length differs from number of channels";
+
+    for(uint64_t c=0; c<spectrum.size(); c++)
+    {
+      q[c*nspectra+s]=spectrum[c].real();
+      u[c*nspectra+s]=spectrum[c].imag();
+    }
+  }
+
+  //_____________________________________________________________________________
+  //                                                                  getSpectrum
+
+  /*!
+    \param s - (0-based) index of spectrum
+    \param &spectrum - vector to hold the complex values of all channels
+  */
+  void rmBatch::getSpectrum (uint64_t s,
+                             vector<complex<double> > &spectrum) const
+  {
+    if(s >= nspectra)
+      throw "rmBatch::getSpectrum spectrum out of range";
+
+    spectrum.resize(lambdaSquareds.size());
+    for(uint64_t c=0; c<spectrum.size(); c++)
+      spectrum[c]=complex<double>(q[c*nspectra+s], u[c*nspectra+s]);
+  }
+
+  //_____________________________________________________________________________
+  //                                                                         read
+
+  /*!
+    \param &filename - name of FITS file to read the container from
+  */
+  void rmBatch::read (const string &filename)
+  {
+    fitsfile *fptr=NULL;
+    int status=0;
+    int naxis=0;
+    LONGLONG naxes[3]={0, 0, 0};
+
+    if(fits_open_file(&fptr, filename.c_str(), READONLY, &status))
+      reportFITSerror(status, "rmBatch::read could not open file");
+
+    try {
+      if(fits_get_img_dim(fptr, &naxis, &status) ||
+         naxis!=3 || fits_get_img_sizell(fptr, 3, naxes, &status) || naxes[2]!=2)
+      {
+        if(status)
+          reportFITSerror(status, "rmBatch::read could not get image size");
+        throw "rmBatch::read primary HDU is not a N x channels x 2 cube";
+      }
+
+      const uint64_t n=naxes[0], nchannels=naxes[1];
+      vector<double> newq(n*nchannels), newu(n*nchannels);
+      vector<double> newLambdaSquareds(nchannels), newDeltas(nchannels), newWeights(nchannels);
+
+      double nulval=0;
+      int anynul=0;
+      LONGLONG fpixel[3]={1, 1, 1};
+      if(n*nchannels > 0)
+      {
+        if(fits_read_pixll(fptr, TDOUBLE, fpixel, n*nchannels, &nulval, &newq[0], &anynul, &status))
+          reportFITSerror(status, "rmBatch::read could not read Q");
+        fpixel[2]=2;
+        if(fits_read_pixll(fptr, TDOUBLE, fpixel, n*nchannels, &nulval, &newu[0], &anynul, &status))
+          reportFITSerror(status, "rmBatch::read could not read U");
+      }
+
+      // channel setup
+      LONGLONG nrows=0;
+      char lambdaName[]="LAMBDASQ", deltaName[]="DLAMBDASQ", weightName[]="WEIGHT";
+      int colLambda=0, colDelta=0, colWeight=0;
+      if(fits_movnam_hdu(fptr, BINARY_TBL, const_cast<char*>("CHANNELS"), 0, &status) ||
+         fits_get_num_rowsll(fptr, &nrows, &status) ||
+         fits_get_colnum(fptr, CASEINSEN, lambdaName, &colLambda, &status) ||
+         fits_get_colnum(fptr, CASEINSEN, deltaName, &colDelta, &status) ||
+         fits_get_colnum(fptr, CASEINSEN, weightName, &colWeight, &status))
+        reportFITSerror(status, "rmBatch::read could not find CHANNELS table");
+      if(static_cast<uint64_t>(nrows)!=nchannels)
+        throw "rmBatch::read CHANNELS table does not match number of channels";
+
+      if(nchannels > 0 &&
+         (fits_read_col(fptr, TDOUBLE, colLambda, 1, 1, nchannels, &nulval, &newLambdaSquareds[0], &anynul, &status) ||
+          fits_read_col(fptr, TDOUBLE, colDelta, 1, 1, nchannels, &nulval, &newDeltas[0], &anynul, &status) ||
+          fits_read_col(fptr, TDOUBLE, colWeight, 1, 1, nchannels, &nulval, &newWeights[0], &anynul, &status)))
+        reportFITSerror(status, "rmBatch::read could not read CHANNELS table");
+
+      nspectra=n;
+      q.swap(newq);
+      u.swap(newu);
+      lambdaSquareds.swap(newLambdaSquareds);
+      deltaLambdaSquareds.swap(newDeltas);
+      weights.swap(newWeights);
+    }
+    catch (const char *) {
+      int closestatus=0;
+      fits_close_file(fptr, &closestatus);
+      throw;
+    }
+
+    fits_close_file(fptr, &status);
+  }
+
+  //_____________________________________________________________________________
+  //                                                                        write
+
+  /*!
+    \param &filename - name of FITS file to write the container to
+  */
+  void rmBatch::write (const string &filename) const
+  {
+    fitsfile *fptr=NULL;
+    int status=0;
+    const uint64_t nchannels=lambdaSquareds.size();
+
+    if(nchannels==0)
+      throw "rmBatch::write container has no channels";
+
+    if(fits_create_file(&fptr, ("!"+filename).c_str(), &status))
+      reportFITSerror(status, "rmBatch::write could not create file");
+
+    try {
+      LONGLONG naxes[3]={static_cast<LONGLONG>(nspectra), static_cast<LONGLONG>(nchannels), 2};
+      double stokesQ=2, one=1;
+      char stokes[]="STOKES";
+      if(fits_create_imgll(fptr, DOUBLE_IMG, 3, naxes, &status) ||
+         fits_write_key(fptr, TSTRING, "CTYPE3", stokes, "Q and U", &status) ||
+         fits_write_key(fptr, TDOUBLE, "CRVAL3", &stokesQ, "", &status) ||
+         fits_write_key(fptr, TDOUBLE, "CDELT3", &one, "", &status) ||
+         fits_write_key(fptr, TDOUBLE, "CRPIX3", &one, "", &status))
+        reportFITSerror(status, "rmBatch::write could not create image");
+
+      LONGLONG fpixel[3]={1, 1, 1};
+      if(nspectra > 0)
+      {
+        if(fits_write_pixll(fptr, TDOUBLE, fpixel, nspectra*nchannels, const_cast<double*>(&q[0]), &status))
+          reportFITSerror(status, "rmBatch::write could not write Q");
+        fpixel[2]=2;
+        if(fits_write_pixll(fptr, TDOUBLE, fpixel, nspectra*nchannels, const_cast<double*>(&u[0]), &status))
+          reportFITSerror(status, "rmBatch::write could not write U");
+      }
+
+      char *ttype[]={const_cast<char*>("LAMBDASQ"), const_cast<char*>("DLAMBDASQ"), const_cast<char*>("WEIGHT")};
+      char *tform[]={const_cast<char*>("D"), const_cast<char*>("D"), const_cast<char*>("D")};
+      char *tunit[]={const_cast<char*>("m^2"), const_cast<char*>("m^2"), const_cast<char*>("")};
+      if(fits_create_tbl(fptr, BINARY_TBL, nchannels, 3, ttype, tform, tunit, "CHANNELS", &status) ||
+         fits_write_col(fptr, TDOUBLE, 1, 1, 1, nchannels, const_cast<double*>(&lambdaSquareds[0]), &status) ||
+         fits_write_col(fptr, TDOUBLE, 2, 1, 1, nchannels, const_cast<double*>(&deltaLambdaSquareds[0]), &status) ||
+         fits_write_col(fptr, TDOUBLE, 3, 1, 1, nchannels, const_cast<double*>(&weights[0]), &status))
+        reportFITSerror(status, "rmBatch::write could not write CHANNELS table");
+    }
+    catch (const char *) {
+      int closestatus=0;
+      fits_close_file(fptr, &closestatus);
+      throw;
+    }
+
+    if(fits_close_file(fptr, &status))
+      reportFITSerror(status, "rmBatch::write could not close file");
+  }
+
+}  // END -- namespace RM
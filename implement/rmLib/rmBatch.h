@@ -0,0 +1,115 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef RM_BATCH_H
+#define RM_BATCH_H
+
+#include <string>
+#include <vector>
+#include <complex>
+#include <stdint.h>
+
+namespace RM {
+
+  /*!
+    \class rmBatch
+
+    \ingroup RM
+
+    \brief Container of many polarized spectra sharing one channel setup
+
+    \author Sven Duscha
+
+    \test trmBatch.cpp
+
+    <h3>Synopsis</h3>
+
+    Holds N complex spectra P=Q+iU (e.g. simulated realisations or
+    extracted lines of sight) that were observed with the same channels.
+    The lambda squareds, their widths and the channel weights are stored
+    once. Q and U are kept channel-major, [channel][spectrum], which is the
+    tile layout of rmSynthesisPlanCache::synthesize, so the whole set can
+    be transformed in one call without reordering.
+
+    On disk the container is a FITS file: the primary HDU is a double
+    image of NAXIS1=N, NAXIS2=channels, NAXIS3=2 (STOKES Q, U), followed by
+    a binary table CHANNELS with the columns LAMBDASQ, DLAMBDASQ and
+    WEIGHT. Both are read and written in bulk.
+  */
+  class rmBatch {
+
+  private:
+
+    //! lambda squareds of the channels (m^2)
+    std::vector<double> lambdaSquareds;
+    //! channel widths in lambda squared (m^2)
+    std::vector<double> deltaLambdaSquareds;
+    //! channel weights
+    std::vector<double> weights;
+    //! number of spectra
+    uint64_t nspectra;
+    //! Stokes Q and U [channel][spectrum]
+    std::vector<double> q;
+    std::vector<double> u;
+
+  public:
+
+    // === Construction =========================================================
+
+    //! Default constructor, creating an empty container
+    rmBatch ();
+    //! Create a container of nspectra spectra (all zero) for a channel setup
+    rmBatch (const std::vector<double> &lambdaSquareds,
+             const std::vector<double> &deltaLambdaSquareds,
+             const std::vector<double> &weights,
+             uint64_t nspectra);
+    //! Read a container from a FITS file
+    rmBatch (const std::string &filename);
+
+    // === Methods ==============================================================
+
+    //! Read the container from a FITS file
+    void read (const std::string &filename);
+    //! Write the container to a FITS file (overwriting it)
+    void write (const std::string &filename) const;
+
+    //! Set spectrum s from a complex vector of channel values
+    void setSpectrum (uint64_t s,
+                      const std::vector<std::complex<double> > &spectrum);
+    //! Get spectrum s as a complex vector of channel values
+    void getSpectrum (uint64_t s,
+                      std::vector<std::complex<double> > &spectrum) const;
+
+    inline uint64_t getNumSpectra () const { return nspectra; }
+    inline uint64_t getNumChannels () const { return lambdaSquareds.size(); }
+
+    inline const std::vector<double> &getLambdaSquareds () const { return lambdaSquareds; }
+    inline const std::vector<double> &getDeltaLambdaSquareds () const { return deltaLambdaSquareds; }
+    inline const std::vector<double> &getWeights () const { return weights; }
+
+    //! Get Stokes Q [channel][spectrum]
+    inline const double *getQ () const { return q.empty() ? NULL : &q[0]; }
+    //! Get Stokes U [channel][spectrum]
+    inline const double *getU () const { return u.empty() ? NULL : &u[0]; }
+  };
+
+}  // END -- namespace RM
+
+#endif
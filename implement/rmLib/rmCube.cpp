@@ -156,19 +156,19 @@ namespace RM {
 //
 //===============================================================================
 
-int rmCube::getXSize()
+int64_t rmCube::getXSize()
 {
   return xSize;
 }
 
 
-int rmCube::getYSize()
+int64_t rmCube::getYSize()
 {
   return ySize;
 }
 
 
-int rmCube::getFaradaySize()
+int64_t rmCube::getFaradaySize()
 {
   return faradaySize;
 }
@@ -323,7 +323,7 @@ void rmCube::setFaradayHigh(double faradayHigh)
 }
     
     
-void rmCube::createBuffer(long long size)
+void rmCube::createBuffer(int64_t size)
 {    
   if(buffer==NULL)	// check if we have already a buffer
   {
@@ -347,7 +347,8 @@ void rmCube::deleteBuffer()
   if(this->buffer!=NULL)
   {
 //    free(this->buffer); 
-    delete buffer;
+    delete[] buffer;
+    buffer=NULL;
   }
   else
   {
@@ -377,7 +378,7 @@ void rmCube::createBufferPlane()
 
 void rmCube::createBufferCube()
 {
-  vector<int> dimensions(3);
+  vector<int64_t> dimensions(3);
 
   if(this->buffer==NULL)	// check if we have already a buffer
   {
@@ -409,13 +410,13 @@ void rmCube::createBufferCube()
 }
 
 
-vector<int> rmCube::getBufferDimensions()
+vector<int64_t> rmCube::getBufferDimensions()
 {
   return this->bufferDimensions;
 }
 
 
-void rmCube::setBufferDimensions(vector<int> &dimensions)
+void rmCube::setBufferDimensions(vector<int64_t> &dimensions)
 {
   this->bufferDimensions=dimensions;
 }
@@ -3,6 +3,7 @@
 #define RM_CUBE_H
 
 #include <vector>
+#include <stdint.h>
 #include "rm.h"
 #include "rmIO.h"
 
@@ -42,11 +43,11 @@ namespace RM {
   private:
     
     //! Horizontal size in pixels
-    int xSize;
+    int64_t xSize;
     //! Vertical size in pixels
-    int ySize;
+    int64_t ySize;
     //! Total Farday range covered
-    int faradaySize;
+    int64_t faradaySize;
     
     int currentX;	              //!> current X position in cube
     int currentY;	              //!> current Y position in cube
@@ -69,7 +70,7 @@ namespace RM {
     std::string errorEstimationAlgorithm;	//!> algorithm used for error estimation
     
     double *buffer; 									//!> pointer to buffer for computed Faraday depths
-    std::vector<int> bufferDimensions;			//!> dimensions of buffer (line, tile, plane,...)
+    std::vector<int64_t> bufferDimensions;		//!> dimensions of buffer (line, tile, plane,...)
   
     // Keep variables that do not need to be computed for every single RM
     std::vector<double> lambdaSqs;				//!> lambda squareds of channels
@@ -107,11 +108,11 @@ namespace RM {
     // === Parameter access =====================================================
 
     //! Get XSize of Faraday cube
-    int getXSize();
+    int64_t getXSize();
     //! Get YSize of Faraday cube
-    int getYSize();
+    int64_t getYSize();
     //! Get FaradaySize of Faraday cube
-    int getFaradaySize();
+    int64_t getFaradaySize();
     //! Get current X position in Faraday cube
     int getCurrentX();
     //! Get current Y position in Faraday cube
@@ -142,13 +143,13 @@ namespace RM {
     void setFaradayLow(double faradayLow);	//! set the lower limit of Faraday depth of the Faraday cube
     void setFaradayHigh(double faradayHigh);	//! set the higher limit of Faraday depth of the Faraday cube
     
-    void createBuffer(long long size);						//! create buffer for computed Faraday depths
+    void createBuffer(int64_t size);						//! create buffer for computed Faraday depths
     void deleteBuffer();										//! delete associated buffer
     void createBufferPlane();									//! create buffer for one Faraday plane
     void createBufferCube();									//! create buffer for the whole cube
 
-    std::vector<int> getBufferDimensions();				//! get dimensions of buffer
-    void setBufferDimensions(std::vector<int> &dimensions);	//! set dimensions of buffer (i.e. plane, cube)
+    std::vector<int64_t> getBufferDimensions();				//! get dimensions of buffer
+    void setBufferDimensions(std::vector<int64_t> &dimensions);	//! set dimensions of buffer (i.e. plane, cube)
  
     std::string getWeightingAlgorithm();					//! get weihting Algorithm
     void setWeightingAlgorithm(std::string &);			//! set weighting Algorithm
@@ -22,7 +22,9 @@
  ***************************************************************************/
 
 #include <iostream>
+#include <algorithm>
 #include <string.h>
+#include <math.h>
 #include <sys/stat.h>	// needed to check for existence of a file
 #include "rmFITS.h"
 
@@ -47,6 +49,7 @@ namespace RM {
     nulval     = 0;
     anynul     = 0;
     iomode     = 0;   /* default READONLY mode */
+    verifyReads= false;
     
     memset(this->fits_error_message, 0, MAX_MESSAGE_LENGTH); 	  
     
@@ -71,6 +74,7 @@ namespace RM {
     fitsstatus		= 0;       // initialise FITS status
     nulval			= 0.0;
     anynul			= 0;
+    verifyReads		= false;
     
     memset(this->fits_error_message, 0, MAX_MESSAGE_LENGTH);  
     
@@ -226,6 +230,7 @@ namespace RM {
       {
 	throw "rmFITS::open failed to open file";
       }
+    header.invalidate();
   }
   
   
@@ -241,6 +246,7 @@ namespace RM {
       {
         throw "rmFITS::openData";
       }
+    header.invalidate();
     
     if (getHDUType()==IMAGE_HDU)	 // if it is an image extension
       {
@@ -262,6 +268,7 @@ namespace RM {
       {
         throw "rmFITS::openImage";
       }
+    header.invalidate();
     
     if (getHDUType()==IMAGE_HDU)	 // if it is an image extension
       {
@@ -282,6 +289,7 @@ namespace RM {
       {
         throw "rmFITS::openTable";
       }
+    header.invalidate();
     
   }
   
@@ -353,6 +361,7 @@ namespace RM {
     else
       {
 	this->fptr=NULL;		// after successful closing set the fitsfile pointer to NULL
+	header.invalidate();
       }
   }
   
@@ -555,6 +564,7 @@ namespace RM {
     if (fits_movabs_hdu(fptr, hdu, NULL, &fitsstatus)) {
       throw "rmFITS::moveAbsoluteHDU";
     }
+    header.invalidate();
     
     /* If it is an image extension, update dimensions-vector. */
     if (getHDUType()==IMAGE_HDU) {
@@ -576,6 +586,7 @@ namespace RM {
       {
         throw "rmFITS::moveRelativeHDU";
     }
+    header.invalidate();
 
     if (getHDUType()==IMAGE_HDU)	 // if it is an image extension
     {
@@ -618,6 +629,7 @@ namespace RM {
       {
         throw "rmFITS::moveNameHDU";
       }
+    header.invalidate();
 
     if (getHDUType()==IMAGE_HDU)	 // if it is an image extension
       {
@@ -702,7 +714,7 @@ namespace RM {
   */
   vector<int64_t> rmFITS::getImageDimensions()
   {
-    updateImageDimensions();
+    getHeader();
     return this->dimensions;
   }
   
@@ -715,22 +727,56 @@ namespace RM {
   */
   void rmFITS::updateImageDimensions()
   {
-    int i=0;
-    int naxis=0;
-    long *naxes=0;
-    
-    if (getHDUType()==IMAGE_HDU) {
-      naxis=getImgDim();			// get number of axis
-      naxes=(long*) calloc(sizeof(long), naxis);// allocate memory for axis dimensions
-      
-      dimensions.resize(naxis);		// resize dimensions vector
-      getImgSize(naxis, naxes);		// get the size of each axis
-      
-      for (i=0; i<naxis; i++)
-	{
-	  dimensions[i]=naxes[i];
-	}
+    header.invalidate();
+    getHeader();				// updates dimensions vector
+  }
+
+
+  //_____________________________________________________________________________
+  //                                                                    getHeader
+
+  /*!
+    \brief Get the header model of the CHDU
+
+    The header is parsed once and then served from memory until it is
+    invalidated by an HDU move or a header write through this object. For
+    image HDUs the dimensions vector and, if there is a FREQ axis, the bins
+    and binWidths are updated from the model.
+
+    \return header - cached header model
+  */
+  const rmFITSheader &rmFITS::getHeader()
+  {
+    if(!header.isValid())
+    {
+      header.read(fptr);
+      if(header.getHDUType()==IMAGE_HDU)
+      {
+        dimensions=header.getAxes();
+        if(header.getFrequencies().size() > 0)
+        {
+          bins=header.getFrequencies();
+          binWidths=header.getFrequencyWidths();
+          binType=frequency;
+          binUnit=Hz;
+        }
+      }
     }
+
+    return header;
+  }
+
+
+  //_____________________________________________________________________________
+  //                                                             invalidateHeader
+
+  /*!
+    \brief Mark the cached header model as stale, e.g. after the file was
+    modified through the fitsfile pointer directly
+  */
+  void rmFITS::invalidateHeader()
+  {
+    header.invalidate();
   }
   
   //_____________________________________________________________________________
@@ -948,6 +994,9 @@ namespace RM {
   {
     int bitpix=0;
 
+    if (getHeader().getHDUType()==IMAGE_HDU)
+      return header.getBitpix();
+
     if (fits_get_img_type(fptr, &bitpix, &fitsstatus))
 	 {
        throw "rmFITS::getImgType";
@@ -969,6 +1018,9 @@ namespace RM {
   {
     int naxis=0;
 
+    if (getHeader().getHDUType()==IMAGE_HDU)
+      return header.getNaxis();
+
     if (fits_get_img_dim(fptr, &naxis,  &fitsstatus))
 	 {
 	    throw "rmFITS::getImgDim";
@@ -990,18 +1042,18 @@ namespace RM {
   */
   std::vector<int64_t> rmFITS::getImgSize()
   {
-    unsigned int i=0;			// loop variable
+    if (getHeader().getHDUType()==IMAGE_HDU)
+      return dimensions;
+
     int maxdim=getImgDim();	// maximum number of dimensions
-    long *naxes=(long *) calloc(maxdim, sizeof(long));
+    std::vector<LONGLONG> naxes(maxdim);
 
-    if (fits_get_img_size(fptr, maxdim, naxes , &fitsstatus))
+    if (maxdim > 0 && fits_get_img_sizell(fptr, maxdim, &naxes[0], &fitsstatus))
 	 {
         throw "rmFITS::getImageSize";
     }
 
-	 dimensions.resize(maxdim); 
-    for (i=0; i<dimensions.size(); i++)
-      dimensions[i]=naxes[i];
+	 dimensions.assign(naxes.begin(), naxes.end());
 	  
 	 return dimensions;
   }
@@ -1030,6 +1082,26 @@ namespace RM {
 	     dimensions[i]=naxes[i];
   }
 
+
+  //___________________________________________________________________________
+  //	 																				  getImgSize
+
+  /*!
+     \brief Get image size of the FITS image for axes longer than 2^31
+
+     \param maxdim - Maximum number of dimensions
+     \param &naxes - Array to hold axes lengths
+  */
+  void rmFITS::getImgSize(int maxdim,  LONGLONG *naxes)
+  {
+     if (fits_get_img_sizell(fptr, maxdim, naxes , &fitsstatus))
+	  {
+	    throw "rmFITS::getImageSize";
+	  }
+      
+	  dimensions.assign(naxes, naxes+maxdim);
+  }
+
 	
   //___________________________________________________________________________
   //                                                                getImgParam	
@@ -1079,6 +1151,7 @@ namespace RM {
     {
         throw "rmFITS::createImg";
     }
+    header.invalidate();
   }
 
   
@@ -1093,9 +1166,6 @@ namespace RM {
   void rmFITS::createImg(int bitpix,
 			 std::vector<int64_t> &dimensions)
   {
-    long naxis=0;
-    long *naxes=NULL;
-    
     if(bitpix != -32)		// we currently only support TDOUBLE FITS images
       {
 	throw "rmFITS::createImg bitpix is not TDOUBLE_IMG";
@@ -1103,21 +1173,62 @@ namespace RM {
     if(dimensions.size()==0)
       throw "rmFITS::createImg dimensions is 0";
     
-    naxis=dimensions.size();
-    naxes=static_cast<long *>(calloc(naxis, sizeof(long)));
-    
-    for(long i=0; i < naxis; i++)
-      naxes[i]=dimensions[i];
+    std::vector<LONGLONG> naxes(dimensions.begin(), dimensions.end());
     
-    if (fits_create_img(fptr, bitpix, naxis , naxes, &fitsstatus))
+    if (fits_create_imgll(fptr, bitpix, naxes.size(), &naxes[0], &fitsstatus))
       {
 	throw "rmFITS::createImg";
       }
     
-    free(naxes);
+    header.invalidate();
+    this->dimensions=dimensions;
   }
   
+  //___________________________________________________________________________
+  //                                                               setCompression
+
+  /*!
+    \brief Tile-compress images created after this call (row-by-row tiles)
+
+    \param comptype - cfitsio compression algorithm (RICE_1, GZIP_1, GZIP_2,
+    HCOMPRESS_1, PLIO_1), 0 to switch compression off
+    \param quantizeLevel - quantization of floating point pixels; 0 stores
+    them losslessly (default), >0 quantizes to sigma/quantizeLevel
+  */
+  void rmFITS::setCompression(int comptype, float quantizeLevel)
+  {
+    if (fits_set_compression_type(fptr, comptype, &fitsstatus) ||
+        fits_set_quantize_level(fptr, quantizeLevel, &fitsstatus))
+      {
+	throw "rmFITS::setCompression";
+      }
+  }
   
+  
+  //___________________________________________________________________________
+  //                                                                readPixNull
+
+  /*!
+    \brief Read pixels and flag undefined ones in nullarray (no substitution)
+
+    \param datatype - data type of array
+    \param *fpixel - first pixel to read (1-based)
+    \param nelements - number of elements to read
+    \param *array - array to read into
+    \param *nullarray - set to 1 for each undefined pixel, 0 otherwise
+    \param *anynul - set if any undefined pixel was encountered
+  */
+  void rmFITS::readPixNull(int datatype, LONGLONG *fpixel, LONGLONG nelements, void *array, char *nullarray, int *anynul)
+  {
+    if (fits_read_pixnullll(fptr, datatype, fpixel, nelements, array, nullarray, anynul, &fitsstatus))
+    {
+      fits_get_errstatus(fitsstatus, fits_error_message);
+      cout << fits_error_message << endl;
+      throw "rmFITS::readPixNull";
+    }
+  }
+
+
   //___________________________________________________________________________
   //                                                                   writePix
   
@@ -1129,9 +1240,9 @@ namespace RM {
     \param nelements - Number of elements to write
     \param *array - Array containing data
   */
-  void rmFITS::writePix(int datatype, long *fpixel, long nelements, void *array)
+  void rmFITS::writePix(int datatype, LONGLONG *fpixel, LONGLONG nelements, void *array)
   {
-    if (fits_write_pix(fptr, datatype, fpixel, nelements, array, &fitsstatus))
+    if (fits_write_pixll(fptr, datatype, fpixel, nelements, array, &fitsstatus))
       {
         throw "rmFITS::writePix";
       }
@@ -1150,9 +1261,9 @@ namespace RM {
     \param *array - Array containing data
     \param *nulval - Nullvalue to be written to file
   */
-  void rmFITS::writePixNull(int datatype, long *fpixel, long nelements, void *array, void *nulval)
+  void rmFITS::writePixNull(int datatype, LONGLONG *fpixel, LONGLONG nelements, void *array, void *nulval)
   {
-    if (fits_write_pixnull(fptr, datatype, fpixel , nelements, array, nulval, &fitsstatus))
+    if (fits_write_pixnullll(fptr, datatype, fpixel , nelements, array, nulval, &fitsstatus))
 	 {
         throw "rmFITS::writePix";
     }
@@ -1172,9 +1283,9 @@ namespace RM {
     \param *array - Array containing data
     \param *anynul - If any null value was encountered
   */
-  void rmFITS::readPix(int datatype, long *fpixel, long nelements, void *nulval, void *array, int *anynul)
+  void rmFITS::readPix(int datatype, LONGLONG *fpixel, LONGLONG nelements, void *nulval, void *array, int *anynul)
   {
-    if (fits_read_pix(fptr, datatype, fpixel, nelements, nulval, array, anynul, &fitsstatus))
+    if (fits_read_pixll(fptr, datatype, fpixel, nelements, nulval, array, anynul, &fitsstatus))
       {
         throw "rmFITS::readPix";
       }
@@ -1192,9 +1303,9 @@ namespace RM {
     \param nelements - Number of elements to write
     \param *array - Array containing data
 	*/
-	void rmFITS::readPix(int datatype, long *fpixel, long nelements, void *array)
+	void rmFITS::readPix(int datatype, LONGLONG *fpixel, LONGLONG nelements, void *array)
 	{
-		if (fits_read_pix(fptr, datatype, fpixel, nelements, &nulval, array, &anynul, &fitsstatus))
+		if (fits_read_pixll(fptr, datatype, fpixel, nelements, &nulval, array, &anynul, &fitsstatus))
       {
 			throw "rmFITS::readPix";
       }
@@ -1247,7 +1358,7 @@ namespace RM {
                            long *lpixel, long *inc, void *nulval,  vector<double> &vec,
                            int *anynul)
   {
-      unsigned int nelements=1;		// compute number of elements to read
+      LONGLONG nelements=1;		// compute number of elements to read
   
       if(fpixel==NULL)
 			throw "rmFITS::readSubset lpixel is NULL pointer";
@@ -1261,7 +1372,7 @@ namespace RM {
       }
       cout.flush();
   
-      if(nelements > vec.size())
+      if(nelements > static_cast<LONGLONG>(vec.size()))
 			throw "rmFITS::readSubset nelements to read exceeds vec.size()";
   
       cout << "nelements = " << nelements << endl;
@@ -1409,6 +1520,8 @@ void rmFITS::write2D(double *array, const long long dim1)
         throw "rmFITS::readLine CHDU is not an image";
     }
 
+    getHeader();	// make sure dimensions are those of the CHDU
+
     // Define first pixel to read, read along one line of sight
     fpixel[0]=x;
     fpixel[1]=y;
@@ -1420,9 +1533,9 @@ void rmFITS::write2D(double *array, const long long dim1)
 	 //-------------------------------------------------------
 	 // Check consistency of pixel data
 	 //
-	 if(x > static_cast<unsigned int>(dimensions[0]))
+	 if(x > static_cast<unsigned long>(dimensions[0]))
 		throw "rmFITS::readLine x is out of range";
-	 if(y > static_cast<unsigned int>(dimensions[1]))
+	 if(y > static_cast<unsigned long>(dimensions[1]))
 		throw "rmFITS::readLine y is out of range";
 	 if(dimensions[2]==0)
 		throw "rmFITS::readLine image is only 2-D";
@@ -1464,6 +1577,8 @@ void rmFITS::write2D(double *array, const long long dim1)
        throw "rmFITS::readLine CHDU is not an image";
    }
 
+   getHeader();	// make sure dimensions are those of the CHDU
+
    // Define first pixel to read, read along one line of sight
    fpixel[0]=x;
    fpixel[1]=y;
@@ -1475,9 +1590,9 @@ void rmFITS::write2D(double *array, const long long dim1)
  //-------------------------------------------------------
  // Check consistency of pixel data
  //
- if(x > static_cast<unsigned int>(dimensions[0]))
+ if(x > static_cast<unsigned long>(dimensions[0]))
 	throw "rmFITS::readLine x is out of range";
- if(y > static_cast<unsigned int>(dimensions[1]))
+ if(y > static_cast<unsigned long>(dimensions[1]))
 	throw "rmFITS::readLine y is out of range";
  if(line==NULL)
 	throw "rmFITS::readLine line is NULL pointer";
@@ -1529,6 +1644,8 @@ void rmFITS::readZLine (double *line,
 	 if(nulval==NULL)
 	    nulval=&this->nulval;
 	
+    getHeader();	// make sure dimensions are those of the CHDU
+
     // Define first pixel to read, read along one line of sight
     fpixel[0]=x;
     fpixel[1]=y;
@@ -1540,9 +1657,9 @@ void rmFITS::readZLine (double *line,
 	 //-------------------------------------------------------
 	 // Check consistency of pixel data
 	 //
-	 if(x > static_cast<unsigned int>(dimensions[0]))
+	 if(x > static_cast<unsigned long>(dimensions[0]))
 		throw "rmFITS::readLine x is out of range";
-	 if(y > static_cast<unsigned int>(dimensions[1]))
+	 if(y > static_cast<unsigned long>(dimensions[1]))
 		throw "rmFITS::readLine y is out of range";
   	 if(line==NULL)
 		throw "rmFITS::readLine NULL pointer";
@@ -1553,7 +1670,7 @@ void rmFITS::readZLine (double *line,
 
 	 //-------------------------------------------------------
     // Read subset from FITS file
-    readSubset(TDOUBLE, &fpixel[0], &lpixel[0], &inc[0], &nulval, line, &anynul);
+    readSubset(TDOUBLE, &fpixel[0], &lpixel[0], &inc[0], nulval, line, &anynul);
     if(fitsstatus)
     {
 		fits_get_errstatus(fitsstatus, fits_error_message);		
@@ -1572,17 +1689,14 @@ void rmFITS::readZLine (double *line,
   */
   void rmFITS::readPlane(double *plane, const unsigned long z, void *nulval)
   {
-		long fpixel[3];		// read vector where reading starts
-		int hdutype=0;			// HDU type which is checked for
-		int nelements=0;		// number of elements to read
-//		int anynul=0;			// indicator if any nul value has been read
-		int naxis=0;			// number axes present in image
-		long naxes[3];			// dimensions of these axes
+		LONGLONG fpixel[3];	// read vector where reading starts
+		LONGLONG nelements=0;	// number of elements to read
+		const rmFITSheader &hdr=getHeader();	// cached header of CHDU
 		
 		//-------------------------------------------------------------
-		if (fits_get_hdu_type(this->fptr, &hdutype ,&this->fitsstatus)!=IMAGE_HDU)	// Check if current HDU is an image extension
+		if (hdr.getHDUType()!=IMAGE_HDU)	// Check if current HDU is an image extension
 		{
-			throw "fitsmerge::readPlane CHDU is not an image";
+			throw "rmFITS::readPlane CHDU is not an image";
 		}
 
 	   if(nulval==NULL)							// if no nulval was given as parameter...
@@ -1593,24 +1707,71 @@ void rmFITS::readZLine (double *line,
 		fpixel[1]=1;
 		fpixel[2]=z;
 		
-		fits_get_img_dim(this->fptr, &naxis, &this->fitsstatus);
-		fits_get_img_size(this->fptr, naxis, naxes, &this->fitsstatus); // get image dimensions
-		
-		nelements=naxes[0]*naxes[1];	// compute number of elements in plane
+		if(hdr.getNaxis() < 3)
+			throw "rmFITS::readPlane image is not a cube";
 		
-		fits_file_name(this->fptr, fits_error_message, &this->fitsstatus);
+		nelements=hdr.getPlaneSize();	// compute number of elements in plane
 		
 		if (plane!=NULL)	// only if valid pointer is given
 		{
-			fits_read_pix(this->fptr, TDOUBLE, fpixel, nelements, nulval, plane, &this->anynul, &fitsstatus);
+			readPix(TDOUBLE, fpixel, nelements, nulval, plane, &this->anynul);
+			if(verifyReads)	// planes are word-aligned in the data unit
+				readChecksum.addValues(plane, nelements, hdr.getBitpix());
 		}
 		else
 		{
-			throw "fitsmerge::readPlane pointer is NULL";
+			throw "rmFITS::readPlane pointer is NULL";
 		}
   }
 
 
+  //_____________________________________________________________________________
+  //                                                               readPlaneFlags
+
+  /*!
+    \brief Read a 2-D plane from a FITS cube and flag undefined pixels
+
+    Blanked pixels (NaN for floating point images, BLANK for integer images)
+    are not replaced by a nulval; instead nullflags[i] is set to 1, so they
+    can be excluded from RM-Synthesis (see rmValidityMask).
+
+    Rows are contiguous in the file, so a band of rows is read with one
+    call straight into the caller's buffer.
+
+    \param *plane - array of NAXIS1*nrows values
+    \param z - plane to read (1-based)
+    \param *nullflags - array of NAXIS1*nrows flags, 1 for undefined pixels
+    \param y - first row to read (1-based, default 1)
+    \param nrows - number of rows to read (default 0: to the last row)
+  */
+  void rmFITS::readPlaneFlags(double *plane, unsigned long z, char *nullflags,
+                              unsigned long y, unsigned long nrows)
+  {
+    const rmFITSheader &hdr=getHeader();	// cached header of CHDU
+
+    if (hdr.getHDUType()!=IMAGE_HDU)
+      throw "rmFITS::readPlaneFlags CHDU is not an image";
+    if (hdr.getNaxis() < 3)
+      throw "rmFITS::readPlaneFlags image is not a cube";
+    if (plane==NULL || nullflags==NULL)
+      throw "rmFITS::readPlaneFlags pointer is NULL";
+    if (z < 1 || z > static_cast<unsigned long>(dimensions[2]))
+      throw "rmFITS::readPlaneFlags z out of range";
+    if (y < 1 || y > static_cast<unsigned long>(dimensions[1]))
+      throw "rmFITS::readPlaneFlags y out of range";
+    if (nrows==0)
+      nrows=dimensions[1]-y+1;
+    if (y+nrows-1 > static_cast<unsigned long>(dimensions[1]))
+      throw "rmFITS::readPlaneFlags nrows out of range";
+
+    std::vector<LONGLONG> fpixel(hdr.getNaxis(), 1);
+    fpixel[1]=y;
+    fpixel[2]=z;
+
+    readPixNull(TDOUBLE, &fpixel[0], dimensions[0]*nrows, plane, nullflags, &this->anynul);
+  }
+
+
 //_____________________________________________________________________________
 //                                                                     readCube
 
@@ -1646,14 +1807,15 @@ void rmFITS::readCube (double *cube,
 			inc[i]=1;							// default increment is 1
 		}
 
+		if(nulval==NULL)							// if no nulval was given as parameter...
+			nulval=(void*) &this->nulval;		// .. use default one in class definition
+
 		// Read subset from FITS file
-		readSubset(TDOUBLE, &fpixel[0], &lpixel[0], &inc[0], &nulval, cube, &anynul);
-		if(fitsstatus)
-		{
-			fits_get_errstatus(fitsstatus, fits_error_message);		
-			cout << fits_error_message << endl;
-			throw "rmFITS::readSubCube readSubset failed";
-		}
+		readSubset(TDOUBLE, &fpixel[0], &lpixel[0], &inc[0], nulval, cube, &anynul);
+
+		free(fpixel);
+		free(lpixel);
+		free(inc);
    }
 
 	
@@ -1678,35 +1840,34 @@ void rmFITS::readCube (double *cube,
   {
     long fpixel[3];	// first pixel definition
     long lpixel[3];	// last pixel definition
-	 long inc[3]={0,0,1};
-	 double nulval=0.0;
-	 int anynul=0;
+	 long inc[3]={1,1,1};
+
+	 getHeader();	// make sure dimensions are those of the CHDU
 
 	 //-------------------------------------------------------
 	 // Check consistency of pixel data
 	 //
-	 if(x_pos > static_cast<unsigned int>(dimensions[0]))
+	 if(x_pos < 1 || x_pos > static_cast<unsigned long>(dimensions[0]))
 		throw "rmFITS::readSubCube x_pos is out of range";
-	 if(y_pos > static_cast<unsigned int>(dimensions[1]))
+	 if(y_pos < 1 || y_pos > static_cast<unsigned long>(dimensions[1]))
 		throw "rmFITS::readSubCube y_pos is out of range";
-	 if(x_pos+x_size > static_cast<unsigned int>(dimensions[0]))
+	 if(x_pos+x_size-1 > static_cast<unsigned long>(dimensions[0]))
 		throw "rmFITS::readSubCube x_size is out of range";
-	 if(y_pos+y_size > static_cast<unsigned int>(dimensions[1]))
+	 if(y_pos+y_size-1 > static_cast<unsigned long>(dimensions[1]))
 		throw "rmFITS::readSubCube y_size is out of range";
   	 if(subCube==NULL)
 		throw "rmFITS::readSubCube NULL pointer";
 
 	 //-------------------------------------------------------
-	 if(nulvalue==NULL)			// if no nulval was given as parameter...
-		 nulval=this->nulval;	// ... use class default (double nulval=0.0)
-	  
+	 if(nulvalue==NULL)				// if no nulval was given as parameter...
+		 nulvalue=&this->nulval;	// ... use class default (double nulval=0.0)
 	  
     fpixel[0]=x_pos;
 	 fpixel[1]=y_pos;
 	 fpixel[2]=1;
 
-	 lpixel[0]=dimensions[0]+x_size;
-	 lpixel[1]=dimensions[1]+y_size;
+	 lpixel[0]=x_pos+x_size-1;
+	 lpixel[1]=y_pos+y_size-1;
 	 lpixel[2]=dimensions[2];
 
     if (getHDUType()!=IMAGE_HDU)   // Check if current HDU is an image extension
@@ -1714,20 +1875,423 @@ void rmFITS::readCube (double *cube,
     	throw "rmFITS::readSubCube CHDU is not an image";
     }
 
-	//	 void rmFITS::readSubset(int  datatype, long *fpixel,
-	//		                           long *lpixel, long *inc, void *nulval,  void *array,
-	//	                           int *anynul)
-
 	 //-------------------------------------------------------
     // Read subset from FITS file
-    readSubset(TDOUBLE, &fpixel[0], &lpixel[0], &inc[0], &nulval, subCube, &anynul);
-    if(fitsstatus)
+    readSubset(TDOUBLE, &fpixel[0], &lpixel[0], &inc[0], nulvalue, subCube, &anynul);
+  }
+
+
+  // ============================================================================
+  //
+  //  Stokes cube (IQUV) input functions
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                                getStokesAxis
+
+  /*!
+    \brief Find the STOKES axis from the CTYPEn keywords of the CHDU
+
+    \return stokesAxis - (1-based) axis number of STOKES axis, 0 if not present
+  */
+  int rmFITS::getStokesAxis ()
+  {
+    return getHeader().getStokesAxis();
+  }
+
+  //_____________________________________________________________________________
+  //                                                              getSpectralAxis
+
+  /*!
+    \brief Find the spectral (frequency) axis from the CTYPEn keywords of the CHDU
+
+    \return spectralAxis - (1-based) axis number of spectral axis, 0 if not present
+  */
+  int rmFITS::getSpectralAxis ()
+  {
+    return getHeader().getSpectralAxis();
+  }
+
+  //_____________________________________________________________________________
+  //                                                               getStokesPixel
+
+  /*!
+    \brief Convert a Stokes parameter into a pixel on the STOKES axis using
+    CRVALn, CDELTn and CRPIXn (FITS convention: 1=I, 2=Q, 3=U, 4=V)
+
+    \param stokes - Stokes parameter code
+
+    \return pixel - (1-based) pixel on the STOKES axis, 0 if not in image
+  */
+  long rmFITS::getStokesPixel (int stokes)
+  {
+    return getHeader().getStokesPixel(stokes);
+  }
+
+  //_____________________________________________________________________________
+  //                                                                  hasStokesQU
+
+  /*!
+    \return true if the image has a STOKES axis with Q and U planes
+  */
+  bool rmFITS::hasStokesQU ()
+  {
+    if(getStokesAxis()==0)
+      return false;
+
+    return getStokesPixel(2)!=0 && getStokesPixel(3)!=0;
+  }
+
+  //_____________________________________________________________________________
+  //                                                             stokesFirstPixel
+
+  /*!
+    \brief First pixel of a band of rows of one channel of a 4-D (RA, Dec,
+    Freq, Stokes) or (RA, Dec, Stokes, Freq) cube
+
+    \param channel - (1-based) channel on the spectral axis
+    \param y - first row (1-based)
+    \param &nrows - number of rows (0: set to the rows up to the last one)
+
+    \return fpixel - first pixel, the STOKES axis is left to the caller
+  */
+  std::vector<LONGLONG> rmFITS::stokesFirstPixel (unsigned long channel,
+                                                  unsigned long y,
+                                                  unsigned long &nrows)
+  {
+    const rmFITSheader &hdr=getHeader();
+    if (hdr.getHDUType()!=IMAGE_HDU)
+      throw "rmFITS::stokesFirstPixel CHDU is not an image";
+
+    int naxis=hdr.getNaxis();
+    int stokesAxis=hdr.getStokesAxis();
+    int spectralAxis=hdr.getSpectralAxis();
+
+    if(stokesAxis < 3)
+      throw "rmFITS::stokesFirstPixel image has no STOKES axis after the celestial axes";
+    if(spectralAxis==0)		// take the remaining non-degenerate axis
     {
-		fits_get_errstatus(fitsstatus, fits_error_message);		
-		cout << fits_error_message << endl;
-		throw "rmFITS::readSubCube readSubset failed";
+      for(int n=3; n<=naxis; n++)
+        if(n!=stokesAxis)
+        {
+          spectralAxis=n;
+          break;
+        }
+    }
+    if(spectralAxis < 3)
+      throw "rmFITS::stokesFirstPixel image has no spectral axis";
+    if(channel < 1 || channel > static_cast<unsigned long>(dimensions[spectralAxis-1]))
+      throw "rmFITS::stokesFirstPixel channel out of range";
+    if(y < 1 || y > static_cast<unsigned long>(dimensions[1]))
+      throw "rmFITS::stokesFirstPixel y out of range";
+    if(nrows==0)
+      nrows=dimensions[1]-y+1;
+    if(y+nrows-1 > static_cast<unsigned long>(dimensions[1]))
+      throw "rmFITS::stokesFirstPixel nrows out of range";
+
+    std::vector<LONGLONG> fpixel(naxis, 1);
+    fpixel[1]=y;
+    fpixel[spectralAxis-1]=channel;
+
+    return fpixel;
+  }
+
+  //_____________________________________________________________________________
+  //                                                             readStokesPlanes
+
+  /*!
+    \brief Read the Q, U and optionally I image planes of one channel from a
+    4-D (RA, Dec, Freq, Stokes) or (RA, Dec, Stokes, Freq) cube
+
+    Each plane (and each band of rows of it) is contiguous in the file and
+    is read directly into the caller's buffer, so no intermediate copy or
+    split of the cube is needed.
+
+    \param *q - buffer of NAXIS1*nrows values for Stokes Q
+    \param *u - buffer of NAXIS1*nrows values for Stokes U
+    \param channel - (1-based) channel on the spectral axis
+    \param *i - buffer for Stokes I (optional, NULL if not needed)
+    \param *nulval - value to substitute for undefined pixels (optional)
+    \param y - first row to read (1-based, default 1)
+    \param nrows - number of rows to read (default 0: to the last row)
+  */
+  void rmFITS::readStokesPlanes (double *q,
+                                 double *u,
+                                 unsigned long channel,
+                                 double *i,
+                                 void *nulval,
+                                 unsigned long y,
+                                 unsigned long nrows)
+  {
+    if(q==NULL || u==NULL)
+      throw "rmFITS::readStokesPlanes NULL pointer";
+
+    std::vector<LONGLONG> fpixel=stokesFirstPixel(channel, y, nrows);
+    const rmFITSheader &hdr=getHeader();
+    LONGLONG nelements=dimensions[0]*nrows;
+
+    if(nulval==NULL)
+      nulval=&this->nulval;
+
+    int stokes[3]={2, 3, 1};
+    double *planes[3]={q, u, i};
+    for(int p=0; p<3; p++)
+    {
+      if(planes[p]==NULL)
+        continue;
+
+      long pixel=hdr.getStokesPixel(stokes[p]);
+      if(pixel==0)
+        throw "rmFITS::readStokesPlanes requested Stokes parameter not in image";
+
+      fpixel[hdr.getStokesAxis()-1]=pixel;
+      readPix(TDOUBLE, &fpixel[0], nelements, nulval, planes[p], &this->anynul);
     }
+  }
+
+  //_____________________________________________________________________________
+  //                                                        readStokesPlanesFlags
+
+  /*!
+    \brief Read the Q and U image planes of one channel from an IQUV cube and
+    flag undefined pixels
+
+    As readPlaneFlags: NaN pixels of floating point and BLANK pixels of
+    integer images are not replaced by a nulval, their flags are set to 1.
 
+    \param *q - buffer of NAXIS1*nrows values for Stokes Q
+    \param *u - buffer of NAXIS1*nrows values for Stokes U
+    \param channel - (1-based) channel on the spectral axis
+    \param *qflags - NAXIS1*nrows flags of Q, 1 for undefined pixels
+    \param *uflags - NAXIS1*nrows flags of U, 1 for undefined pixels
+    \param y - first row to read (1-based, default 1)
+    \param nrows - number of rows to read (default 0: to the last row)
+  */
+  void rmFITS::readStokesPlanesFlags (double *q,
+                                      double *u,
+                                      unsigned long channel,
+                                      char *qflags,
+                                      char *uflags,
+                                      unsigned long y,
+                                      unsigned long nrows)
+  {
+    if(q==NULL || u==NULL || qflags==NULL || uflags==NULL)
+      throw "rmFITS::readStokesPlanesFlags NULL pointer";
+
+    std::vector<LONGLONG> fpixel=stokesFirstPixel(channel, y, nrows);
+    const rmFITSheader &hdr=getHeader();
+    LONGLONG nelements=dimensions[0]*nrows;
+
+    if(hdr.getStokesPixel(2)==0 || hdr.getStokesPixel(3)==0)
+      throw "rmFITS::readStokesPlanesFlags image has no Q and U";
+
+    fpixel[hdr.getStokesAxis()-1]=hdr.getStokesPixel(2);
+    readPixNull(TDOUBLE, &fpixel[0], nelements, q, qflags, &this->anynul);
+    fpixel[hdr.getStokesAxis()-1]=hdr.getStokesPixel(3);
+    readPixNull(TDOUBLE, &fpixel[0], nelements, u, uflags, &this->anynul);
+  }
+
+
+  // ============================================================================
+  //
+  //  Faraday spectrum (line of sight) functions
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                              isSpectralMajor
+
+  /*!
+    \return true if NAXIS1 is the Faraday axis (CTYPE1='FARADAY'), i.e. the
+    spectrum of every line of sight is contiguous on disk
+  */
+  bool rmFITS::isSpectralMajor ()
+  {
+    return getHeader().getFaradayAxis()==1;
+  }
+
+  //_____________________________________________________________________________
+  //                                                            getSpectrumLength
+
+  int64_t rmFITS::getSpectrumLength ()
+  {
+    const rmFITSheader &hdr=getHeader();
+    if (hdr.getHDUType()!=IMAGE_HDU || hdr.getNaxis() < 3)
+      throw "rmFITS::getSpectrumLength CHDU is not a cube";
+
+    return hdr.getFaradayAxis()==1 ? dimensions[0] : dimensions[2];
+  }
+
+  //_____________________________________________________________________________
+  //                                                                 readSpectrum
+
+  /*!
+    \brief Read the Faraday spectrum of one line of sight
+
+    In spectral-major layout this is one contiguous read, otherwise the
+    spectrum is gathered along the third axis.
+
+    \param *spectrum - array of getSpectrumLength() values
+    \param x - x position (1-based)
+    \param y - y position (1-based)
+    \param *nulval - value to substitute for undefined pixels (optional)
+  */
+  void rmFITS::readSpectrum (double *spectrum,
+                             unsigned long x,
+                             unsigned long y,
+                             void *nulval)
+  {
+    readSpectra(spectrum, x, y, 1, nulval);
+  }
+
+  //_____________________________________________________________________________
+  //                                                                  readSpectra
+
+  /*!
+    \brief Read the Faraday spectra of n consecutive pixels of one image row
+
+    \param *spectra - array of n*getSpectrumLength() values, spectrum by spectrum
+    \param x - x position (1-based) of first pixel
+    \param y - y position (1-based)
+    \param n - number of pixels
+    \param *nulval - value to substitute for undefined pixels (optional)
+  */
+  void rmFITS::readSpectra (double *spectra,
+                            unsigned long x,
+                            unsigned long y,
+                            unsigned long n,
+                            void *nulval)
+  {
+    if(spectra==NULL)
+      throw "rmFITS::readSpectra NULL pointer";
+
+    int64_t length=getSpectrumLength();
+    bool spectralMajor=isSpectralMajor();
+    int64_t nx=spectralMajor ? dimensions[1] : dimensions[0];
+    int64_t ny=spectralMajor ? dimensions[2] : dimensions[1];
+
+    if(x < 1 || y < 1 || n==0 ||
+       static_cast<int64_t>(x+n-1) > nx || static_cast<int64_t>(y) > ny)
+      throw "rmFITS::readSpectra position out of range";
+
+    if(nulval==NULL)
+      nulval=&this->nulval;
+
+    if(spectralMajor)
+    {
+      std::vector<LONGLONG> fpixel(getImgDim(), 1);
+      fpixel[1]=x;
+      fpixel[2]=y;
+      readPix(TDOUBLE, &fpixel[0], n*length, nulval, spectra, &this->anynul);
+    }
+    else	// one subset read of the row segment, then transpose [z][i] to [i][z]
+    {
+      int naxis=getImgDim();
+      std::vector<long> fpixel(naxis, 1), lpixel(naxis, 1), inc(naxis, 1);
+      std::vector<double> buffer(n*length);
+
+      fpixel[0]=x;
+      fpixel[1]=y;
+      lpixel[0]=x+n-1;
+      lpixel[1]=y;
+      lpixel[2]=length;
+      readSubset(TDOUBLE, &fpixel[0], &lpixel[0], &inc[0], nulval, &buffer[0], &this->anynul);
+
+      for(int64_t z=0; z<length; z++)
+        for(unsigned long i=0; i<n; i++)
+          spectra[i*length+z]=buffer[z*n+i];
+    }
+  }
+
+  //_____________________________________________________________________________
+  //                                                                readSpectraAt
+
+  /*!
+    \brief Read the Faraday (or frequency) spectra at a list of pixel positions
+
+    Positions are sorted by row. In plane-major layout every plane is then
+    read row by row, each needed row once and only over the span of x
+    covered by positions on it, so the number of reads grows with
+    planes*rows rather than planes*positions. In spectral-major layout each
+    spectrum is one contiguous read, done in file order.
+
+    \param &x - x positions (1-based)
+    \param &y - y positions (1-based), same length as x
+    \param *spectra - array of x.size()*getSpectrumLength() values, spectra in
+    the order of the positions
+    \param *nulval - value to substitute for undefined pixels (optional)
+  */
+  void rmFITS::readSpectraAt (const std::vector<unsigned long> &x,
+                              const std::vector<unsigned long> &y,
+                              double *spectra,
+                              void *nulval)
+  {
+    const size_t npos=x.size();
+
+    if(spectra==NULL)
+      throw "rmFITS::readSpectraAt NULL pointer";
+    if(y.size()!=npos)
+      throw "rmFITS::readSpectraAt x and y differ in length";
+    if(npos==0)
+      return;
+
+    int64_t length=getSpectrumLength();
+    bool spectralMajor=isSpectralMajor();
+    int64_t nx=spectralMajor ? dimensions[1] : dimensions[0];
+    int64_t ny=spectralMajor ? dimensions[2] : dimensions[1];
+
+    // positions in file order: by row, then by column
+    std::vector<std::pair<std::pair<unsigned long, unsigned long>, size_t> > order(npos);
+    for(size_t i=0; i<npos; i++)
+    {
+      if(x[i] < 1 || y[i] < 1 ||
+         static_cast<int64_t>(x[i]) > nx || static_cast<int64_t>(y[i]) > ny)
+        throw "rmFITS::readSpectraAt position out of range";
+      order[i]=std::make_pair(std::make_pair(y[i], x[i]), i);
+    }
+    std::sort(order.begin(), order.end());
+
+    if(nulval==NULL)
+      nulval=&this->nulval;
+
+    std::vector<LONGLONG> fpixel(getImgDim(), 1);
+    if(spectralMajor)
+    {
+      for(size_t k=0; k<npos; k++)
+      {
+        fpixel[1]=order[k].first.second;
+        fpixel[2]=order[k].first.first;
+        readPix(TDOUBLE, &fpixel[0], length, nulval, spectra+order[k].second*length, &this->anynul);
+      }
+      return;
+    }
+
+    // rows: [first, last) range in order and the span of x needed on it
+    std::vector<size_t> rowStart;
+    for(size_t k=0; k<npos; k++)
+      if(k==0 || order[k].first.first!=order[k-1].first.first)
+        rowStart.push_back(k);
+    rowStart.push_back(npos);
+
+    std::vector<double> row(nx);
+    for(int64_t z=0; z<length; z++)
+    {
+      fpixel[2]=z+1;
+      for(size_t r=0; r+1<rowStart.size(); r++)
+      {
+        size_t first=rowStart[r], last=rowStart[r+1];
+        unsigned long xmin=order[first].first.second;
+        unsigned long xmax=order[last-1].first.second;
+
+        fpixel[0]=xmin;
+        fpixel[1]=order[first].first.first;
+        readPix(TDOUBLE, &fpixel[0], xmax-xmin+1, nulval, &row[0], &this->anynul);
+
+        for(size_t k=first; k<last; k++)
+          spectra[order[k].second*length+z]=row[order[k].first.second-xmin];
+      }
+    }
   }
 
 
@@ -1748,12 +2312,8 @@ void rmFITS::readCube (double *cube,
 	*/
 	void rmFITS::writeCube(double *cube, void *nulval)
 	{
-		unsigned long nelements=1;	// number of elements to write
-//		int fitsstatus=0;
-//		char errormessage[MAX_MESSAGE_LENGTH];		// fits error message char array
+		LONGLONG nelements=1;	// number of elements to write
 		int naxis=0;
-		long *naxes=NULL;
-		long *fpixel;
 		
 		//----------------------------------------
 		if(cube==NULL)
@@ -1761,30 +2321,17 @@ void rmFITS::readCube (double *cube,
 		
 		//----------------------------------------
 		
-		fits_get_img_dim(this->fptr, &naxis, &this->fitsstatus);			// get image dimensions
-		if(this->fitsstatus)
-		{
-			fits_get_errstatus(this->fitsstatus, this->fits_error_message);
-			cout << this->fits_error_message << endl;
-			throw "rmFITS::writeCube fits_get_img_dim failed";		
-		}
-		
-		naxes=new long[naxis];									// get memory for naxes to hold axes sizes 
-		fits_get_img_size(this->fptr, naxis, naxes, &this->fitsstatus);		// get axes sizes
-		
-		fpixel=(long*)malloc(sizeof(long)*naxis);
-		for(int i=0; i < naxis; i++)
-			fpixel[i]=1;
+		naxis=getImgDim();									// cached image dimensions
 		
+		std::vector<LONGLONG> fpixel(naxis, 1);				// first pixel
 		for(int i=0; i < naxis; i++)					// loop over (hyper)cube's axes
 		{
-			nelements*=naxes[i];								// compute nelements in cube
-			cout << nelements << endl;
+			nelements*=dimensions[i];						// compute nelements in cube
 		}
-		if(nelements==0)
-			throw "fitsmerge::writeCube nelements is 0";
+		if(naxis==0 || nelements==0)
+			throw "rmFITS::writeCube nelements is 0";
 		
-		fits_write_pixnull(this->fptr, TFLOAT, fpixel, nelements, cube, nulval, &this->fitsstatus);
+		fits_write_pixnullll(this->fptr, TDOUBLE, &fpixel[0], nelements, cube, nulval, &this->fitsstatus);
 		if(this->fitsstatus)
 		{
 			fits_get_errstatus(this->fitsstatus, this->fits_error_message);
@@ -1804,8 +2351,10 @@ void rmFITS::readCube (double *cube,
 	 */
 	void rmFITS::writePlane (double *plane, unsigned long z, void *nulval)
 	{
-		long fpixel[3]; 	// first pixel position to read
-		long nelements=0;	// number of elements to write
+		LONGLONG fpixel[3]; 	// first pixel position to read
+		LONGLONG nelements=0;	// number of elements to write
+
+		getHeader();	// make sure dimensions are those of the CHDU
 
 		// check if plane counter is above limit
 		if (z > (unsigned long) dimensions[2]) {
@@ -1854,17 +2403,17 @@ void rmFITS::readCube (double *cube,
                            unsigned long z,
 									void *nulval)
   {
-    long fpixel[3]; 	// first pixel position to read
-    long nelements=0;	// number of elements to write
+    LONGLONG fpixel[3]; 	// first pixel position to read
+    LONGLONG nelements=0;	// number of elements to write
 	  
     // Check if Faraday plane has the same x-/y-dimensions as naxes dimensions of FITS
-	 updateImageDimensions();
+	 getHeader();
     if ((int64_t)x > dimensions[0] || (int64_t)y > dimensions[1]) {
       throw "rmFITS::writePlane dimensions do not match";
     }
     
     // check if plane counter is above limit
-    if (z > (unsigned) dimensions[2]) {
+    if (z > (unsigned long) dimensions[2]) {
       throw "rmFITS::writePlane z out of range";
     }
     
@@ -1900,17 +2449,52 @@ void rmFITS::readCube (double *cube,
   //                                                                    writeLine
 
   /*!
-    \param faradayLine - contains line of sight along Faraday Depths with RM intensity
-    \param x - x position in pixels to write line to
-    \param y - y position in pixels to write line to
+    \brief Write a line of sight, contiguously in spectral-major layout
+
+    \param line - contains line of sight along Faraday Depths with RM intensity
+    \param x - x position (1-based) in pixels to write line to
+    \param y - y position (1-based) in pixels to write line to
+    \param nulval - values equal to *nulval are written as undefined (optional)
   */
   void rmFITS::writeLine(double *line,
                           const long x,
                           const long y,
                           void *nulval)
   {
+    if (line==NULL)
+      throw "rmFITS::writeLine NULL pointer";
 
+    int64_t length=getSpectrumLength();
+    bool spectralMajor=isSpectralMajor();
+    int64_t nx=spectralMajor ? dimensions[1] : dimensions[0];
+    int64_t ny=spectralMajor ? dimensions[2] : dimensions[1];
 
+    if (x < 1 || y < 1 || x > nx || y > ny)
+      throw "rmFITS::writeLine position out of range";
+
+    std::vector<LONGLONG> fpixel(getImgDim(), 1);
+    if (spectralMajor)	// one contiguous write
+    {
+      fpixel[1]=x;
+      fpixel[2]=y;
+      if (nulval==NULL)
+        writePix(TDOUBLE, &fpixel[0], length, line);
+      else
+        writePixNull(TDOUBLE, &fpixel[0], length, line, nulval);
+    }
+    else	// one pixel per plane
+    {
+      fpixel[0]=x;
+      fpixel[1]=y;
+      for (int64_t z=0; z<length; z++)
+      {
+        fpixel[2]=z+1;
+        if (nulval==NULL)
+          writePix(TDOUBLE, &fpixel[0], 1, &line[z]);
+        else
+          writePixNull(TDOUBLE, &fpixel[0], 1, &line[z], nulval);
+      }
+    }
   }
 
   //_____________________________________________________________________________
@@ -2140,6 +2724,7 @@ void rmFITS::readCube (double *cube,
       {
         throw "rmFITS::writeKey";
       }
+    header.invalidate();
   }
 
 
@@ -2166,6 +2751,7 @@ void rmFITS::readCube (double *cube,
       {
         throw "rmFITS::updateKey";
       }
+    header.invalidate();
   }
 
 
@@ -2180,6 +2766,7 @@ void rmFITS::readCube (double *cube,
       {
         throw "rmFITS:writeRecord";
       }
+    header.invalidate();
   }
 
 
@@ -2212,6 +2799,7 @@ void rmFITS::readCube (double *cube,
       {
         throw "rmFITS::writeKeyUnit";
       }
+    header.invalidate();
   }
 
   //_____________________________________________________________________________
@@ -2265,6 +2853,7 @@ void rmFITS::readCube (double *cube,
       {
         throw "rmFITS::deleteRecord";
       }
+    header.invalidate();
   }
 
   //_____________________________________________________________________________
@@ -2279,6 +2868,7 @@ void rmFITS::readCube (double *cube,
       {
         throw "rmFITS::deleteKey";
       }
+    header.invalidate();
   }
 
   //_____________________________________________________________________________
@@ -2293,6 +2883,7 @@ void rmFITS::readCube (double *cube,
       {
         throw "rmFITS::copyHeader";
       }
+    other.invalidateHeader();
   }
 
   //_____________________________________________________________________________
@@ -2307,6 +2898,7 @@ void rmFITS::readCube (double *cube,
       {
         throw "rmFITS::deleteHDU";
       }
+    header.invalidate();
   }
 
   //_____________________________________________________________________________
@@ -2320,6 +2912,55 @@ void rmFITS::readCube (double *cube,
       }
   }
 
+  //_____________________________________________________________________________
+  //                                                                writeChecksum
+
+  /*!
+    \brief Write DATASUM and CHECKSUM of the CHDU without re-reading its data
+
+    \param datasum - DATASUM accumulated while writing (see rmFITSchecksum)
+  */
+  void rmFITS::writeChecksum(uint32_t datasum)
+  {
+    rmFITSchecksum::writeKeywords(fptr, datasum);
+    header.invalidate();
+  }
+
+  //_____________________________________________________________________________
+  //                                                     setStreamingVerification
+
+  /*!
+    \brief Accumulate the DATASUM of all planes read by readPlane
+
+    Each plane must be read exactly once and with the default nulval 0 (no
+    null substitution); only floating point images are supported.
+
+    \param enable - enable (and reset) or disable accumulation
+  */
+  void rmFITS::setStreamingVerification(bool enable)
+  {
+    verifyReads=enable;
+    readChecksum.reset();
+  }
+
+  //_____________________________________________________________________________
+  //                                                       verifyStreamedChecksum
+
+  /*!
+    \return ok - true if the DATASUM of the planes read equals the DATASUM keyword
+  */
+  bool rmFITS::verifyStreamedChecksum()
+  {
+    uint32_t datasum=0;
+
+    if(!verifyReads)
+      throw "rmFITS::verifyStreamedChecksum streaming verification is not enabled";
+    if(!rmFITSchecksum::readDatasum(fptr, datasum))
+      throw "rmFITS::verifyStreamedChecksum CHDU has no DATASUM keyword";
+
+    return readChecksum.getDatasum()==datasum;
+  }
+
   //_____________________________________________________________________________
   //                                                               verifyChecksum
 
@@ -34,6 +34,9 @@
 // CFITSIO header files
 #include <fitsio.h>
 
+#include "rmFITSheader.h"
+#include "rmFITSchecksum.h"
+
 // AIPS++/CASA header files
 #ifdef HAVE_CASA
 #include <casa/aips.h>
@@ -109,6 +112,14 @@ namespace RM {
     
     //! dimensions of FITS image
     std::vector<int64_t> dimensions;
+
+    //! cached header model of the CHDU
+    rmFITSheader header;
+
+    //! accumulate DATASUM of planes read (streaming verification)
+    bool verifyReads;
+    //! DATASUM accumulated from planes read
+    rmFITSchecksum readChecksum;
     
     //! define types of bins
     enum DALbinType {
@@ -148,6 +159,11 @@ namespace RM {
     
     DALimageType imageType;
 
+    //! First pixel of rows y to y+nrows-1 of a channel of an IQUV cube (Stokes axis unset)
+    std::vector<LONGLONG> stokesFirstPixel (unsigned long channel,
+                                            unsigned long y,
+                                            unsigned long &nrows);
+
   public:
 
     // === Construction =========================================================
@@ -226,6 +242,10 @@ namespace RM {
     int64_t getY();
     int64_t getZ();
     void updateImageDimensions();
+    //! Get the cached header model of the CHDU (parsed on first use)
+    const rmFITSheader &getHeader();
+    //! Mark the cached header model as stale
+    void invalidateHeader();
     int getHDUType();
     std::string getFilename();
     int getFileMode();
@@ -245,7 +265,7 @@ namespace RM {
 	 //
 	 // ============================================================================	  
 	    
-	 void preemptivelyDelete(const string &filename); 
+	 void preemptivelyDelete(const std::string &filename); 
 
 	  
     // ============================================================================
@@ -263,6 +283,9 @@ namespace RM {
     //! Get the size of the image (legacy interface)
 	 void getImgSize(int maxdim,
 						  long *naxes);
+    //! Get the size of the image (64-bit axes)
+	 void getImgSize(int maxdim,
+						  LONGLONG *naxes);
     void getImgParam(int maxdim,
 							int &bitpix,
 							int &naxis,
@@ -272,23 +295,32 @@ namespace RM {
 		   long *naxes);
 	 void createImg(int bitpix,
 						 std::vector<int64_t> &dimensions); 
+    //! Tile-compress images created after this call
+    void setCompression(int comptype,
+                        float quantizeLevel=0);
     void readPix(int datatype,
-		 long *fpixel,
-		 long nelements,
+		 LONGLONG *fpixel,
+		 LONGLONG nelements,
 		 void *nulval,
 		 void *array,
 		 int *anynul);
 	 void readPix(int datatype,
-					  long *fpixel,
-					  long nelements,
+					  LONGLONG *fpixel,
+					  LONGLONG nelements,
 					  void *array);	    
+    void readPixNull(int datatype,
+		     LONGLONG *fpixel,
+		     LONGLONG nelements,
+		     void *array,
+		     char *nullarray,
+		     int *anynul);
     void writePix(int datatype,
-		  long *fpixel,
-		  long nelements,
+		  LONGLONG *fpixel,
+		  LONGLONG nelements,
 		  void *array);
     void writePixNull(int datatype,
-		      long *fpixel,
-		      long nelements,
+		      LONGLONG *fpixel,
+		      LONGLONG nelements,
 		      void *array,
 		      void *nulval);
     void readSubset(int  datatype,
@@ -394,6 +426,12 @@ namespace RM {
     void deleteHDU(int *hdutype);
     //! Write the Header checksum to the CHDU
     void writeChecksum();
+    //! Write DATASUM/CHECKSUM to the CHDU from an incrementally computed DATASUM
+    void writeChecksum(uint32_t datasum);
+    //! Enable accumulation of the DATASUM of all planes read with readPlane
+    void setStreamingVerification(bool enable);
+    //! Compare the DATASUM accumulated while reading with the DATASUM keyword
+    bool verifyStreamedChecksum();
     //! Verify checksum of the CHDU
     void verifyChecksum(bool &dataok, bool &hduok);
     //! Parse a record card into value and comment
@@ -463,6 +501,13 @@ namespace RM {
 						  unsigned long z,
 						  void *nulval=NULL);
     
+	 //! Read a plane (or rows y to y+nrows-1 of it) and flag blanked pixels instead of substituting a nulval
+    void readPlaneFlags (double *plane,
+								 unsigned long z,
+								 char *nullflags,
+								 unsigned long y=1,
+								 unsigned long nrows=0);
+
 	 //! Read a 2D plane form an image at dim1 (obsolete functions)
 	 void read2D(double *array, unsigned long long dim1);
 
@@ -497,6 +542,66 @@ namespace RM {
 							 unsigned long y_size,
 							 void *nulval=NULL);
     
+    // ============================================================================
+    //
+    //  Stokes cube (IQUV) input functions
+    //
+    // ============================================================================
+
+    //! Get the (1-based) axis number of the STOKES axis, 0 if there is none
+    int getStokesAxis ();
+    //! Get the (1-based) axis number of the spectral axis, 0 if there is none
+    int getSpectralAxis ();
+    //! Get the (1-based) pixel of Stokes parameter stokes (1=I, 2=Q, 3=U, 4=V)
+    long getStokesPixel (int stokes);
+    //! Check if the image has a STOKES axis containing Q and U
+    bool hasStokesQU ();
+
+    //! Read the Q, U (and optionally I) planes (or rows y to y+nrows-1) of channel from an IQUV cube
+    void readStokesPlanes (double *q,
+                           double *u,
+                           unsigned long channel,
+                           double *i=NULL,
+                           void *nulval=NULL,
+                           unsigned long y=1,
+                           unsigned long nrows=0);
+    //! Read the Q and U planes (or rows) of channel and flag blanked pixels instead of substituting a nulval
+    void readStokesPlanesFlags (double *q,
+                                double *u,
+                                unsigned long channel,
+                                char *qflags,
+                                char *uflags,
+                                unsigned long y=1,
+                                unsigned long nrows=0);
+
+    // ============================================================================
+    //
+    //  Faraday spectrum (line of sight) functions
+    //
+    // ============================================================================
+
+    //! Check if the Faraday depth is the first axis (spectral-major layout)
+    bool isSpectralMajor ();
+    //! Get the number of Faraday depths of a line of sight
+    int64_t getSpectrumLength ();
+
+    //! Read the Faraday spectrum at pixel x, y (1-based) from either layout
+    void readSpectrum (double *spectrum,
+                       unsigned long x,
+                       unsigned long y,
+                       void *nulval=NULL);
+    //! Read the spectra of n consecutive pixels of row y, starting at x
+    void readSpectra (double *spectra,
+                      unsigned long x,
+                      unsigned long y,
+                      unsigned long n,
+                      void *nulval=NULL);
+    //! Read the spectra at many pixel positions, each needed row read once per plane
+    void readSpectraAt (const std::vector<unsigned long> &x,
+                        const std::vector<unsigned long> &y,
+                        double *spectra,
+                        void *nulval=NULL);
+
     // ============================================================================
     //
     //  RM-Cube output functions
@@ -518,7 +623,7 @@ namespace RM {
 	 //! Write a 2D array into a FITS image (obsolete)
 	 void write2D(double *array, const long long dim1);
 		
-    //! Write a line of sight to a FITS file
+    //! Write a line of sight (Faraday spectrum) to a FITS file
     void writeLine(double *line,
 		   const long x,
 		   const long y,
@@ -0,0 +1,312 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <iostream>
+#include <string>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "rmFITSchecksum.h"
+
+using namespace std;
+
+namespace RM {
+
+  //! number of words added before carries are folded (keeps sum below 2^63)
+  static const size_t foldInterval=1UL << 30;
+
+  // ============================================================================
+  //
+  //  Construction
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                               rmFITSchecksum
+
+  rmFITSchecksum::rmFITSchecksum ()
+  {
+    sum=0;
+  }
+
+  // ============================================================================
+  //
+  //  Accumulation
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                                    addFloats
+
+  /*!
+    \brief Add floats as they are stored in a BITPIX=-32 data unit
+
+    Each IEEE float is one aligned big-endian word on disk, whose value is
+    the bit pattern of the native float, so no byte swapping is needed.
+
+    \param *values - float values
+    \param n - number of values
+  */
+  void rmFITSchecksum::addFloats (const float *values,
+                                  size_t n)
+  {
+    uint32_t word;
+
+    for(size_t i=0; i<n; i++)
+    {
+      memcpy(&word, &values[i], sizeof(word));
+      sum+=word;
+      if((i & (foldInterval-1))==foldInterval-1)
+        fold();
+    }
+    fold();
+  }
+
+  //_____________________________________________________________________________
+  //                                                                   addDoubles
+
+  /*!
+    \brief Add doubles as they are stored in a BITPIX=-64 data unit (two words)
+
+    \param *values - double values
+    \param n - number of values
+  */
+  void rmFITSchecksum::addDoubles (const double *values,
+                                   size_t n)
+  {
+    uint64_t bits;
+
+    for(size_t i=0; i<n; i++)
+    {
+      memcpy(&bits, &values[i], sizeof(bits));
+      sum+=(bits >> 32)+(bits & 0xffffffffULL);
+      if((i & (foldInterval-1))==foldInterval-1)
+        fold();
+    }
+    fold();
+  }
+
+  //_____________________________________________________________________________
+  //                                                                    addValues
+
+  /*!
+    \brief Add values that were read as TDOUBLE from a floating point image
+
+    Floats convert to double and back without loss, so the stored words can
+    be reconstructed from the values read (with null checking disabled).
+
+    \param *values - values as read from the image
+    \param n - number of values
+    \param bitpix - BITPIX of image (-32 or -64)
+  */
+  void rmFITSchecksum::addValues (const double *values,
+                                  size_t n,
+                                  int bitpix)
+  {
+    uint32_t word;
+    float value;
+
+    if(bitpix==-64)
+    {
+      addDoubles(values, n);
+      return;
+    }
+    if(bitpix!=-32)
+      throw "rmFITSchecksum::addValues only floating point images supported";
+
+    for(size_t i=0; i<n; i++)
+    {
+      value=static_cast<float>(values[i]);
+      memcpy(&word, &value, sizeof(word));
+      sum+=word;
+      if((i & (foldInterval-1))==foldInterval-1)
+        fold();
+    }
+    fold();
+  }
+
+  //_____________________________________________________________________________
+  //                                                                     addBytes
+
+  /*!
+    \brief Add on-disk bytes at an arbitrary byte offset of the data unit
+
+    \param *bytes - bytes as stored in the file (big-endian)
+    \param n - number of bytes
+    \param offset - byte offset of bytes[0] from the start of the data unit
+  */
+  void rmFITSchecksum::addBytes (const unsigned char *bytes,
+                                 size_t n,
+                                 uint64_t offset)
+  {
+    size_t i=0;
+
+    // leading bytes up to the next word boundary
+    for(; i<n && ((offset+i) & 3); i++)
+      sum+=static_cast<uint64_t>(bytes[i]) << (8*(3-((offset+i) & 3)));
+
+    // aligned words
+    for(size_t w=0; i+4<=n; i+=4, w++)
+    {
+      sum+=(static_cast<uint64_t>(bytes[i]) << 24) | (bytes[i+1] << 16) |
+           (bytes[i+2] << 8) | bytes[i+3];
+      if((w & (foldInterval-1))==foldInterval-1)
+        fold();
+    }
+
+    // trailing bytes
+    for(; i<n; i++)
+      sum+=static_cast<uint64_t>(bytes[i]) << (8*(3-((offset+i) & 3)));
+
+    fold();
+  }
+
+  //_____________________________________________________________________________
+  //                                                                          add
+
+  /*!
+    \param &other - partial sum (e.g. of another thread) to merge
+  */
+  void rmFITSchecksum::add (const rmFITSchecksum &other)
+  {
+    sum+=other.getDatasum();
+    fold();
+  }
+
+  //_____________________________________________________________________________
+  //                                                                          add
+
+  /*!
+    \param partialSum - 32-bit 1's complement sum to add
+  */
+  void rmFITSchecksum::add (uint32_t partialSum)
+  {
+    sum+=partialSum;
+    fold();
+  }
+
+  //_____________________________________________________________________________
+  //                                                                   getDatasum
+
+  uint32_t rmFITSchecksum::getDatasum () const
+  {
+    uint64_t folded=sum;
+
+    while(folded >> 32)
+      folded=(folded & 0xffffffffULL)+(folded >> 32);
+
+    return static_cast<uint32_t>(folded);
+  }
+
+  // ============================================================================
+  //
+  //  Keywords
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                                writeKeywords
+
+  /*!
+    \brief Write DATASUM and CHECKSUM of the CHDU
+
+    Follows the procedure of fits_write_chksum, but takes the DATASUM from
+    the caller instead of reading the data unit: CHECKSUM is written as
+    '0000000000000000', the 1's complement sum of the header blocks is
+    computed from the header records and combined with datasum, and the
+    complement of the total is ASCII encoded into CHECKSUM. Only the
+    header is read.
+
+    \param *fptr - cfitsio file handle, CHDU is the HDU whose data was summed
+    \param datasum - DATASUM of the complete data unit
+  */
+  void rmFITSchecksum::writeKeywords (fitsfile *fptr,
+                                      uint32_t datasum)
+  {
+    int status=0;
+    char value[FLEN_VALUE];
+    char zeros[]="0000000000000000";
+    char fits_error_message[FLEN_STATUS];
+
+    sprintf(value, "%u", datasum);
+    fits_update_key(fptr, TSTRING, "CHECKSUM", zeros, "HDU checksum", &status);
+    fits_update_key(fptr, TSTRING, "DATASUM", value, "data unit checksum", &status);
+
+    // the header as it will be stored: records, END, blank fill up to the data
+    int keysexist=0, morekeys=0;
+    LONGLONG headstart=0, datastart=0, dataend=0;
+    fits_get_hdrspace(fptr, &keysexist, &morekeys, &status);
+    fits_get_hduaddrll(fptr, &headstart, &datastart, &dataend, &status);
+    if(status)
+    {
+      fits_get_errstatus(status, fits_error_message);
+      cerr << fits_error_message << endl;
+      throw "rmFITSchecksum::writeKeywords could not get header layout";
+    }
+
+    string header(datastart-headstart, ' ');
+    char card[FLEN_CARD];
+    for(int k=1; k<=keysexist; k++)
+    {
+      if(fits_read_record(fptr, k, card, &status))
+        throw "rmFITSchecksum::writeKeywords could not read header record";
+      header.replace(80*(k-1), strlen(card), card);
+    }
+    header.replace(80*keysexist, 3, "END");
+
+    rmFITSchecksum total;
+    total.addBytes(reinterpret_cast<const unsigned char*>(header.data()), header.size(), 0);
+    total.add(datasum);
+
+    char ascii[17];
+    fits_encode_chksum(total.getDatasum(), 1, ascii);	// complement: HDU sums to -0
+    fits_modify_key_str(fptr, "CHECKSUM", ascii, "&", &status);
+    if(status)
+    {
+      fits_get_errstatus(status, fits_error_message);
+      cerr << fits_error_message << endl;
+      throw "rmFITSchecksum::writeKeywords could not write CHECKSUM";
+    }
+  }
+
+  //_____________________________________________________________________________
+  //                                                                  readDatasum
+
+  /*!
+    \param *fptr - cfitsio file handle
+    \param &datasum - DATASUM of CHDU
+
+    \return present - false if the CHDU has no DATASUM keyword
+  */
+  bool rmFITSchecksum::readDatasum (fitsfile *fptr,
+                                    uint32_t &datasum)
+  {
+    int status=0;
+    char value[FLEN_VALUE];
+
+    if(fits_read_key(fptr, TSTRING, "DATASUM", value, NULL, &status))
+      return false;
+
+    datasum=static_cast<uint32_t>(strtoul(value, NULL, 10));
+
+    return true;
+  }
+
+}  // END -- namespace RM
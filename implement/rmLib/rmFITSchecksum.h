@@ -0,0 +1,107 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef RMFITSCHECKSUM_H
+#define RMFITSCHECKSUM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// CFITSIO header files
+#include <fitsio.h>
+
+namespace RM {
+
+  /*!
+    \class rmFITSchecksum
+
+    \ingroup RM
+
+    \brief Incremental FITS DATASUM (32-bit 1's complement sum) accumulator
+
+    \author Sven Duscha
+
+    \test trmFITSchecksum.cpp
+
+    The DATASUM of a FITS data unit is the 1's complement sum of its bytes
+    read as big-endian 32-bit words. 1's complement addition is commutative
+    and associative, and a word can be split into partial words with
+    disjoint bytes, so the sum can be accumulated from pixel blocks handed
+    in in any order, as long as the byte offset of each block within the
+    data unit is known. Zero padding does not contribute.
+
+    Accumulators of different threads can be merged with add(). The final
+    DATASUM/CHECKSUM keywords are written by writeKeywords() from the
+    accumulated sum and the (small) header only, without re-reading the data.
+  */
+  class rmFITSchecksum {
+
+  private:
+
+    //! running sum, carries above bit 31 are folded back regularly
+    uint64_t sum;
+
+    //! Fold carries above bit 31 back into the low word (end-around carry)
+    inline void fold () { while(sum >> 32) sum=(sum & 0xffffffffULL)+(sum >> 32); }
+
+  public:
+
+    // === Construction =========================================================
+
+    rmFITSchecksum ();
+
+    // === Methods ==============================================================
+
+    //! Reset the sum to 0
+    inline void reset () { sum=0; }
+
+    //! Add native floats written as BITPIX=-32
+    void addFloats (const float *values,
+                    size_t n);
+    //! Add native doubles written as BITPIX=-64
+    void addDoubles (const double *values,
+                     size_t n);
+    //! Add values read as TDOUBLE from a BITPIX=-32 or -64 data unit
+    void addValues (const double *values,
+                    size_t n,
+                    int bitpix);
+    //! Add raw (big-endian, on-disk) bytes at byte offset of the data unit
+    void addBytes (const unsigned char *bytes,
+                   size_t n,
+                   uint64_t offset);
+    //! Merge another (partial) sum
+    void add (const rmFITSchecksum &other);
+    //! Add a 32-bit 1's complement sum
+    void add (uint32_t partialSum);
+
+    //! Get the 32-bit 1's complement DATASUM
+    uint32_t getDatasum () const;
+
+    //! Write DATASUM and CHECKSUM keywords of the CHDU from a known DATASUM
+    static void writeKeywords (fitsfile *fptr,
+                               uint32_t datasum);
+    //! Read the DATASUM keyword of the CHDU, false if it is not present
+    static bool readDatasum (fitsfile *fptr,
+                             uint32_t &datasum);
+  };
+
+}  // END -- namespace RM
+
+#endif
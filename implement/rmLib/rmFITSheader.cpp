@@ -0,0 +1,358 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <iostream>
+#include <string.h>
+#include <strings.h>
+#include <stdio.h>
+#include <math.h>
+#include "rmFITSheader.h"
+
+using namespace std;
+
+namespace RM {
+
+  // ============================================================================
+  //
+  //  Construction
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                                 rmFITSheader
+
+  rmFITSheader::rmFITSheader ()
+  {
+    invalidate();
+  }
+
+  //_____________________________________________________________________________
+  //                                                                 rmFITSheader
+
+  /*!
+    \param *fptr - cfitsio file handle, the header of its CHDU is parsed
+  */
+  rmFITSheader::rmFITSheader (fitsfile *fptr)
+  {
+    invalidate();
+    read(fptr);
+  }
+
+  // ============================================================================
+  //
+  //  Methods
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                                   invalidate
+
+  void rmFITSheader::invalidate ()
+  {
+    valid=false;
+    hdutype=ANY_HDU;
+    bitpix=0;
+    bscale=1.0;
+    bzero=0.0;
+    spectralAxis=stokesAxis=longitudeAxis=latitudeAxis=faradayAxis=0;
+    celestial=false;
+    xrefval=yrefval=xrefpix=yrefpix=xinc=yinc=rot=0.0;
+    memset(coordtype, 0, sizeof(coordtype));
+
+    axes.clear();
+    ctype.clear();
+    cunit.clear();
+    crval.clear();
+    cdelt.clear();
+    crpix.clear();
+    frequencies.clear();
+    frequencyWidths.clear();
+  }
+
+  //_____________________________________________________________________________
+  //                                                                         read
+
+  /*!
+    \brief Parse the header of the CHDU of fptr into the model
+
+    Missing WCS keywords take their FITS default values (CRVAL=0, CDELT=1,
+    CRPIX=1), so a plain image without WCS is a valid model.
+
+    \param *fptr - cfitsio file handle
+  */
+  void rmFITSheader::read (fitsfile *fptr)
+  {
+    int status=0;
+    int naxis=0;
+
+    if(fptr==NULL)
+      throw "rmFITSheader::read fptr is NULL";
+
+    invalidate();
+
+    if(fits_get_hdu_type(fptr, &hdutype, &status))
+      throw "rmFITSheader::read could not get HDU type";
+
+    if(hdutype!=IMAGE_HDU)	// tables only record their type
+    {
+      valid=true;
+      return;
+    }
+
+    if(fits_get_img_type(fptr, &bitpix, &status) ||
+       fits_get_img_dim(fptr, &naxis, &status))
+      throw "rmFITSheader::read could not get image parameters";
+
+    vector<LONGLONG> naxes(naxis);
+    if(naxis > 0 && fits_get_img_sizell(fptr, naxis, &naxes[0], &status))
+      throw "rmFITSheader::read could not get image size";
+    axes.assign(naxes.begin(), naxes.end());
+
+    // optional keys
+    status=0;
+    fits_read_key(fptr, TDOUBLE, "BSCALE", &bscale, NULL, &status);
+    status=0;
+    fits_read_key(fptr, TDOUBLE, "BZERO", &bzero, NULL, &status);
+
+    ctype.resize(naxis);
+    cunit.resize(naxis);
+    crval.resize(naxis, 0.0);
+    cdelt.resize(naxis, 1.0);
+    crpix.resize(naxis, 1.0);
+    for(int n=1; n<=naxis; n++)
+      readAxisKeys(fptr, n);
+
+    computeFrequencies();
+
+    // celestial WCS in the (AIPS) convention used by cfitsio
+    if(longitudeAxis==1 && latitudeAxis==2)
+    {
+      status=0;
+      if(fits_read_img_coord(fptr, &xrefval, &yrefval, &xrefpix, &yrefpix,
+                             &xinc, &yinc, &rot, coordtype, &status)==0)
+        celestial=true;
+    }
+
+    valid=true;
+  }
+
+  //_____________________________________________________________________________
+  //                                                                 readAxisKeys
+
+  /*!
+    \brief Read the WCS keywords of one axis and classify the axis by CTYPE
+
+    \param *fptr - cfitsio file handle
+    \param axis - (1-based) axis number
+  */
+  void rmFITSheader::readAxisKeys (fitsfile *fptr,
+                                   int axis)
+  {
+    char keyname[FLEN_KEYWORD];
+    char value[FLEN_VALUE];
+    int status=0;
+    int i=axis-1;
+
+    sprintf(keyname, "CTYPE%d", axis);
+    if(fits_read_key(fptr, TSTRING, keyname, value, NULL, &status)==0)
+      ctype[i]=value;
+    status=0;
+    sprintf(keyname, "CUNIT%d", axis);
+    if(fits_read_key(fptr, TSTRING, keyname, value, NULL, &status)==0)
+      cunit[i]=value;
+    status=0;
+    sprintf(keyname, "CRVAL%d", axis);
+    fits_read_key(fptr, TDOUBLE, keyname, &crval[i], NULL, &status);
+    status=0;
+    sprintf(keyname, "CDELT%d", axis);
+    fits_read_key(fptr, TDOUBLE, keyname, &cdelt[i], NULL, &status);
+    status=0;
+    sprintf(keyname, "CRPIX%d", axis);
+    fits_read_key(fptr, TDOUBLE, keyname, &crpix[i], NULL, &status);
+
+    const string &type=ctype[i];
+    if(type.compare(0, 6, "STOKES")==0)
+      stokesAxis=axis;
+    else if(type.compare(0, 7, "FARADAY")==0)
+      faradayAxis=axis;
+    else if(type.compare(0, 4, "FREQ")==0 || type.compare(0, 4, "FELO")==0 ||
+            type.compare(0, 4, "VELO")==0 || type.compare(0, 4, "VRAD")==0 ||
+            type.compare(0, 4, "WAVE")==0)
+      spectralAxis=axis;
+    else if(type.compare(0, 2, "RA")==0 || type.compare(0, 4, "GLON")==0 ||
+            type.compare(0, 4, "ELON")==0)
+      longitudeAxis=axis;
+    else if(type.compare(0, 3, "DEC")==0 || type.compare(0, 4, "GLAT")==0 ||
+            type.compare(0, 4, "ELAT")==0)
+      latitudeAxis=axis;
+  }
+
+  //_____________________________________________________________________________
+  //                                                           computeFrequencies
+
+  /*!
+    \brief Convert a FREQ axis into channel centre frequencies and widths in Hz
+  */
+  void rmFITSheader::computeFrequencies ()
+  {
+    if(spectralAxis==0 || ctype[spectralAxis-1].compare(0, 4, "FREQ")!=0)
+      return;
+
+    int i=spectralAxis-1;
+    double scale=1.0;
+    const char *unit=cunit[i].c_str();
+
+    if(strcasecmp(unit, "kHz")==0)
+      scale=1e3;
+    else if(strcasecmp(unit, "MHz")==0)
+      scale=1e6;
+    else if(strcasecmp(unit, "GHz")==0)
+      scale=1e9;
+
+    frequencies.resize(axes[i]);
+    frequencyWidths.assign(axes[i], fabs(cdelt[i])*scale);
+    for(int64_t c=0; c<axes[i]; c++)
+      frequencies[c]=(crval[i]+(c+1-crpix[i])*cdelt[i])*scale;
+  }
+
+  //_____________________________________________________________________________
+  //                                                                 getPlaneSize
+
+  int64_t rmFITSheader::getPlaneSize () const
+  {
+    if(axes.size() < 2)
+      throw "rmFITSheader::getPlaneSize image has less than 2 axes";
+
+    return axes[0]*axes[1];
+  }
+
+  //_____________________________________________________________________________
+  //                                                           per-axis keywords
+
+  std::string rmFITSheader::getCtype (int axis) const
+  {
+    if(axis < 1 || axis > getNaxis())
+      throw "rmFITSheader::getCtype axis out of range";
+    return ctype[axis-1];
+  }
+
+  std::string rmFITSheader::getCunit (int axis) const
+  {
+    if(axis < 1 || axis > getNaxis())
+      throw "rmFITSheader::getCunit axis out of range";
+    return cunit[axis-1];
+  }
+
+  double rmFITSheader::getCrval (int axis) const
+  {
+    if(axis < 1 || axis > getNaxis())
+      throw "rmFITSheader::getCrval axis out of range";
+    return crval[axis-1];
+  }
+
+  double rmFITSheader::getCdelt (int axis) const
+  {
+    if(axis < 1 || axis > getNaxis())
+      throw "rmFITSheader::getCdelt axis out of range";
+    return cdelt[axis-1];
+  }
+
+  double rmFITSheader::getCrpix (int axis) const
+  {
+    if(axis < 1 || axis > getNaxis())
+      throw "rmFITSheader::getCrpix axis out of range";
+    return crpix[axis-1];
+  }
+
+  //_____________________________________________________________________________
+  //                                                               getStokesPixel
+
+  /*!
+    \param stokes - Stokes parameter code (FITS convention: 1=I, 2=Q, 3=U, 4=V)
+
+    \return pixel - (1-based) pixel on the STOKES axis, 0 if not in image
+  */
+  long rmFITSheader::getStokesPixel (int stokes) const
+  {
+    if(stokesAxis==0)
+      throw "rmFITSheader::getStokesPixel image has no STOKES axis";
+
+    int i=stokesAxis-1;
+    if(cdelt[i]==0)
+      throw "rmFITSheader::getStokesPixel CDELT of STOKES axis is 0";
+
+    double pixel=crpix[i]+(stokes-crval[i])/cdelt[i];
+    long ipixel=static_cast<long>(floor(pixel+0.5));
+
+    if(fabs(pixel-ipixel) > 1e-6 || ipixel < 1 || ipixel > axes[i])
+      return 0;
+
+    return ipixel;
+  }
+
+  //_____________________________________________________________________________
+  //                                                                 pixelToWorld
+
+  /*!
+    \param x - (1-based) pixel on axis 1
+    \param y - (1-based) pixel on axis 2
+    \param &lon - longitude (e.g. RA) in degrees
+    \param &lat - latitude (e.g. Dec) in degrees
+  */
+  void rmFITSheader::pixelToWorld (double x,
+                                   double y,
+                                   double &lon,
+                                   double &lat) const
+  {
+    int status=0;
+
+    if(!celestial)
+      throw "rmFITSheader::pixelToWorld no celestial WCS";
+
+    if(fits_pix_to_world(x, y, xrefval, yrefval, xrefpix, yrefpix, xinc, yinc,
+                         rot, const_cast<char*>(coordtype), &lon, &lat, &status))
+      throw "rmFITSheader::pixelToWorld conversion failed";
+  }
+
+  //_____________________________________________________________________________
+  //                                                                 worldToPixel
+
+  /*!
+    \param lon - longitude (e.g. RA) in degrees
+    \param lat - latitude (e.g. Dec) in degrees
+    \param &x - (1-based) pixel on axis 1
+    \param &y - (1-based) pixel on axis 2
+  */
+  void rmFITSheader::worldToPixel (double lon,
+                                   double lat,
+                                   double &x,
+                                   double &y) const
+  {
+    int status=0;
+
+    if(!celestial)
+      throw "rmFITSheader::worldToPixel no celestial WCS";
+
+    if(fits_world_to_pix(lon, lat, xrefval, yrefval, xrefpix, yrefpix, xinc, yinc,
+                         rot, const_cast<char*>(coordtype), &x, &y, &status))
+      throw "rmFITSheader::worldToPixel conversion failed";
+  }
+
+}  // END -- namespace RM
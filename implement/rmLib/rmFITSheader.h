@@ -21,36 +21,137 @@
 #ifndef RMFITS_HEADER_H
 #define RMFITS_HEADER_H
 
+#include <string>
+#include <vector>
+#include <stdint.h>
 
+// CFITSIO header files
+#include <fitsio.h>
 
 namespace RM {
-	
-	/*!
-	 \class rmFITSheader
-    
+
+  /*!
+    \class rmFITSheader
+
     \ingroup RM
-    
+
     \brief DAL class to provide access to FITS headers
-    
+
     \author Sven Duscha
-    
+
     \test trmFITSheader.cpp
-	 */
-	
 
-class rmFITSheader {
+    Parses the header of an image HDU once into an in-memory model: axis
+    lengths, BITPIX, BSCALE/BZERO, the CTYPE/CUNIT/CRVAL/CDELT/CRPIX of every
+    axis, the spectral axis converted into a frequency vector and the
+    celestial WCS. rmFITS keeps one model per CHDU and only re-reads it
+    after an HDU move or an explicit header write.
+  */
+  class rmFITSheader {
+
+  private:
+
+    //! model reflects the header of the CHDU
+    bool valid;
+    //! type of HDU (IMAGE_HDU, ASCII_TBL, BINARY_TBL)
+    int hdutype;
+    //! bits per pixel
+    int bitpix;
+    //! length of each axis
+    std::vector<int64_t> axes;
+    //! scaling of stored values
+    double bscale;
+    //! offset of stored values
+    double bzero;
+
+    //! per-axis world coordinate keywords (index 0 is axis 1)
+    std::vector<std::string> ctype;
+    std::vector<std::string> cunit;
+    std::vector<double> crval;
+    std::vector<double> cdelt;
+    std::vector<double> crpix;
+
+    //! (1-based) axis numbers, 0 if not present
+    int spectralAxis;
+    int stokesAxis;
+    int longitudeAxis;
+    int latitudeAxis;
+    int faradayAxis;
+
+    //! channel centre frequencies in Hz (empty if no FREQ axis)
+    std::vector<double> frequencies;
+    //! channel widths in Hz
+    std::vector<double> frequencyWidths;
+
+    //! celestial WCS present
+    bool celestial;
+    //! celestial reference values, pixels, increments (degrees) and rotation
+    double xrefval, yrefval, xrefpix, yrefpix, xinc, yinc, rot;
+    //! projection code (e.g. -SIN, -TAN)
+    char coordtype[5];
+
+    void readAxisKeys (fitsfile *fptr,
+                       int axis);
+    void computeFrequencies ();
+
+  public:
+
+    // === Construction =========================================================
+
+    //! Default constructor, creating an invalid (empty) model
+    rmFITSheader ();
+    //! Construct and parse the header of the CHDU of fptr
+    rmFITSheader (fitsfile *fptr);
+
+    // === Methods ==============================================================
+
+    //! Parse the header of the CHDU of fptr
+    void read (fitsfile *fptr);
+    //! Mark the model as stale (after a header write or HDU change)
+    void invalidate ();
+
+    inline bool isValid () const { return valid; }
+    inline int getHDUType () const { return hdutype; }
+    inline int getBitpix () const { return bitpix; }
+    inline int getNaxis () const { return axes.size(); }
+    inline const std::vector<int64_t> &getAxes () const { return axes; }
+    inline double getBscale () const { return bscale; }
+    inline double getBzero () const { return bzero; }
+
+    //! Get number of pixels in one plane (NAXIS1*NAXIS2)
+    int64_t getPlaneSize () const;
+
+    std::string getCtype (int axis) const;
+    std::string getCunit (int axis) const;
+    double getCrval (int axis) const;
+    double getCdelt (int axis) const;
+    double getCrpix (int axis) const;
 
-private:
-	
-	
-	
-public:
-	
-	
-}
+    inline int getSpectralAxis () const { return spectralAxis; }
+    inline int getStokesAxis () const { return stokesAxis; }
+    inline int getLongitudeAxis () const { return longitudeAxis; }
+    inline int getLatitudeAxis () const { return latitudeAxis; }
+    inline int getFaradayAxis () const { return faradayAxis; }
 
+    //! Get the (1-based) pixel of Stokes parameter stokes, 0 if not in image
+    long getStokesPixel (int stokes) const;
 
+    inline const std::vector<double> &getFrequencies () const { return frequencies; }
+    inline const std::vector<double> &getFrequencyWidths () const { return frequencyWidths; }
 
+    inline bool hasCelestial () const { return celestial; }
+    //! Convert (1-based) pixel coordinates to celestial coordinates (degrees)
+    void pixelToWorld (double x,
+                       double y,
+                       double &lon,
+                       double &lat) const;
+    //! Convert celestial coordinates (degrees) to (1-based) pixel coordinates
+    void worldToPixel (double lon,
+                       double lat,
+                       double &x,
+                       double &y) const;
+  };
 
+}  // END -- namespace RM
 
 #endif
@@ -0,0 +1,545 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <iostream>
+#include <fstream>
+#include <math.h>
+#include <stdio.h>
+#include "rmFITSmerge.h"
+
+using namespace std;
+
+namespace RM {
+
+  // ============================================================================
+  //
+  //  Construction / Destruction
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                                  rmFITSmerge
+
+  /*!
+    \param &list - 2-D FITS images, in the order of the output planes
+    \param nthreads - number of reader threads (default 4)
+    \param maxPlanes - maximum number of planes in memory (default 2*nthreads)
+  */
+  rmFITSmerge::rmFITSmerge (const vector<string> &list,
+                            unsigned int nthreads,
+                            unsigned int maxPlanes)
+  {
+    if(list.size()==0)
+      throw "rmFITSmerge::rmFITSmerge file list has length 0";
+    if(nthreads==0)
+      throw "rmFITSmerge::rmFITSmerge nthreads is 0";
+
+    this->list=list;
+    this->nthreads=nthreads;
+    this->maxPlanes=maxPlanes > 0 ? maxPlanes : 2*nthreads;
+    nx=ny=0;
+    referenceFptr=NULL;
+    nextRead=nextWrite=0;
+    error=NULL;
+    frequencies.assign(list.size(), NAN);
+    frequencyWidths.assign(list.size(), NAN);
+
+    reentrant=fits_is_reentrant();
+    pthread_mutex_init(&fitsMutex, NULL);
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&planeRead, NULL);
+    pthread_cond_init(&planeWritten, NULL);
+  }
+
+  //_____________________________________________________________________________
+  //                                                                 ~rmFITSmerge
+
+  rmFITSmerge::~rmFITSmerge ()
+  {
+    closeReference();
+    pthread_cond_destroy(&planeWritten);
+    pthread_cond_destroy(&planeRead);
+    pthread_mutex_destroy(&mutex);
+    pthread_mutex_destroy(&fitsMutex);
+  }
+
+  // ============================================================================
+  //
+  //  Reading
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                                    readImage
+
+  /*!
+    \brief Open image i, validate its header, read its plane and frequency,
+    and close it again
+
+    \param i - index of image in list
+    \param &plane - buffer to read nx*ny values into (resized if necessary)
+  */
+  void rmFITSmerge::readImage (size_t i,
+                               vector<float> &plane)
+  {
+    fitsfile *fptr=NULL;
+    int status=0;
+    int anynul=0;
+    float nulval=NAN;
+    const char *failure=NULL;
+
+    if(list[i]=="")
+      throw "rmFITSmerge::readImage filename is empty";
+
+    if(!reentrant)
+      pthread_mutex_lock(&fitsMutex);
+
+    if(i==0 && referenceFptr!=NULL)	// still open from merge
+    {
+      fptr=referenceFptr;
+      referenceFptr=NULL;
+    }
+    else if(fits_open_image(&fptr, list[i].c_str(), READONLY, &status))
+      failure="rmFITSmerge::readImage could not open image";
+
+    if(failure==NULL)
+    {
+      try
+      {
+        rmFITSheader header(fptr);
+        const vector<int64_t> &axes=header.getAxes();
+
+        if(header.getHDUType()!=IMAGE_HDU || axes.size() < 2)
+          failure="rmFITSmerge::readImage input is not an image";
+        else if(axes[0]!=nx || axes[1]!=ny)
+          failure="rmFITSmerge::readImage input images differ in size";
+        for(unsigned int n=2; failure==NULL && n<axes.size(); n++)
+          if(axes[n]!=1)
+            failure="rmFITSmerge::readImage input image is not 2-D";
+
+        if(failure==NULL)
+        {
+          vector<LONGLONG> fpixel(axes.size(), 1);
+          plane.resize(nx*ny);
+          if(fits_read_pixll(fptr, TFLOAT, &fpixel[0], nx*ny, &nulval, &plane[0], &anynul, &status))
+            failure="rmFITSmerge::readImage could not read plane";
+        }
+
+        // frequency from a FREQ axis, otherwise from a frequency keyword
+        if(failure==NULL && header.getFrequencies().size() > 0)
+        {
+          frequencies[i]=header.getFrequencies()[0];
+          frequencyWidths[i]=header.getFrequencyWidths()[0];
+        }
+        else if(failure==NULL)
+        {
+          const char *keys[3]={"FREQ", "RESTFRQ", "RESTFREQ"};
+          double value=0;
+          for(int k=0; k<3; k++)
+          {
+            status=0;
+            if(fits_read_key(fptr, TDOUBLE, keys[k], &value, NULL, &status)==0)
+            {
+              frequencies[i]=value;
+              break;
+            }
+          }
+        }
+      }
+      catch(const char *s)
+      {
+        failure=s;
+      }
+
+      status=0;
+      fits_close_file(fptr, &status);
+    }
+
+    if(!reentrant)
+      pthread_mutex_unlock(&fitsMutex);
+
+    if(failure!=NULL)
+    {
+      cerr << list[i] << ": " << failure << endl;
+      throw failure;
+    }
+  }
+
+  //_____________________________________________________________________________
+  //                                                               closeReference
+
+  /*!
+    \brief Close the first image if merge left it open and no reader took it
+  */
+  void rmFITSmerge::closeReference ()
+  {
+    int status=0;
+    if(referenceFptr!=NULL)
+      fits_close_file(referenceFptr, &status);
+    referenceFptr=NULL;
+  }
+
+  //_____________________________________________________________________________
+  //                                                                     setError
+
+  void rmFITSmerge::setError (const char *s)
+  {
+    pthread_mutex_lock(&mutex);
+    if(error==NULL)
+      error=s;
+    pthread_cond_broadcast(&planeRead);
+    pthread_cond_broadcast(&planeWritten);
+    pthread_mutex_unlock(&mutex);
+  }
+
+  //_____________________________________________________________________________
+  //                                                                   readWorker
+
+  /*!
+    \brief Reader thread: take the next image, unless maxPlanes planes are
+    already waiting for the writer
+  */
+  void *rmFITSmerge::readWorker (void *arg)
+  {
+    rmFITSmerge *merge=static_cast<rmFITSmerge*>(arg);
+    const size_t n=merge->list.size();
+
+    for(;;)
+    {
+      vector<float> plane;
+
+      pthread_mutex_lock(&merge->mutex);
+      while(merge->error==NULL && merge->nextRead < n &&
+            merge->nextRead >= merge->nextWrite+merge->maxPlanes)
+        pthread_cond_wait(&merge->planeWritten, &merge->mutex);
+      if(merge->error!=NULL || merge->nextRead >= n)
+      {
+        pthread_mutex_unlock(&merge->mutex);
+        break;
+      }
+      size_t i=merge->nextRead++;
+      if(!merge->freePlanes.empty())
+      {
+        plane.swap(merge->freePlanes.back());
+        merge->freePlanes.pop_back();
+      }
+      pthread_mutex_unlock(&merge->mutex);
+
+      try
+      {
+        merge->readImage(i, plane);
+      }
+      catch(const char *s)
+      {
+        merge->setError(s);
+        break;
+      }
+
+      pthread_mutex_lock(&merge->mutex);
+      merge->ready[i].swap(plane);
+      pthread_cond_broadcast(&merge->planeRead);
+      pthread_mutex_unlock(&merge->mutex);
+    }
+
+    return NULL;
+  }
+
+  // ============================================================================
+  //
+  //  Writing
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                                        merge
+
+  /*!
+    \brief Read all images in parallel and write them in list order as planes
+    of a new cube
+
+    \param &outfilename - name of cube to create ("!" prefix to overwrite)
+    \param compression - cfitsio tile compression (e.g. RICE_1, GZIP_2),
+    0 for an uncompressed image (default)
+    \param quantizeLevel - quantization of compressed floats, 0 keeps them
+    lossless (default 0)
+  */
+  void rmFITSmerge::merge (const string &outfilename,
+                           int compression,
+                           float quantizeLevel)
+  {
+    const size_t n=list.size();
+
+    if(outfilename=="")
+      throw "rmFITSmerge::merge no filename given";
+
+    // plane size and celestial WCS are those of the first image, which
+    // stays open for the reader of plane 0
+    {
+      int status=0;
+      closeReference();
+      if(fits_open_image(&referenceFptr, list[0].c_str(), READONLY, &status))
+      {
+        referenceFptr=NULL;
+        throw "rmFITSmerge::merge could not open first image";
+      }
+      try
+      {
+        reference.read(referenceFptr);
+      }
+      catch(const char *)
+      {
+        closeReference();
+        throw;
+      }
+    }
+    if(reference.getHDUType()!=IMAGE_HDU || reference.getNaxis() < 2)
+    {
+      closeReference();
+      throw "rmFITSmerge::merge first input is not an image";
+    }
+    nx=reference.getAxes()[0];
+    ny=reference.getAxes()[1];
+
+    // create the cube with the frequency keywords reserved
+    rmFITS out(outfilename, READWRITE);
+    if(compression!=0)
+      out.setCompression(compression, quantizeLevel);
+    vector<int64_t> dimensions(3);
+    dimensions[0]=nx;
+    dimensions[1]=ny;
+    dimensions[2]=n;
+    out.createImg(FLOAT_IMG, dimensions);
+
+    for(int axis=1; axis<=2; axis++)
+    {
+      char keyname[FLEN_KEYWORD];
+      double value=0;
+      string text;
+
+      sprintf(keyname, "CTYPE%d", axis);
+      text=reference.getCtype(axis);
+      if(text!="")
+        out.writeKey(TSTRING, keyname, const_cast<char*>(text.c_str()), "");
+      sprintf(keyname, "CUNIT%d", axis);
+      text=reference.getCunit(axis);
+      if(text!="")
+        out.writeKey(TSTRING, keyname, const_cast<char*>(text.c_str()), "");
+      sprintf(keyname, "CRVAL%d", axis);
+      value=reference.getCrval(axis);
+      out.writeKey(TDOUBLE, keyname, &value, "");
+      sprintf(keyname, "CDELT%d", axis);
+      value=reference.getCdelt(axis);
+      out.writeKey(TDOUBLE, keyname, &value, "");
+      sprintf(keyname, "CRPIX%d", axis);
+      value=reference.getCrpix(axis);
+      out.writeKey(TDOUBLE, keyname, &value, "");
+    }
+    {
+      char ctype[]="FREQ";
+      char cunit[]="Hz";
+      double zero=0, one=1;
+      out.writeKey(TSTRING, "CTYPE3", ctype, "");
+      out.writeKey(TSTRING, "CUNIT3", cunit, "");
+      out.writeKey(TDOUBLE, "CRVAL3", &zero, "");
+      out.writeKey(TDOUBLE, "CDELT3", &one, "");
+      out.writeKey(TDOUBLE, "CRPIX3", &one, "");
+    }
+
+    // start the readers
+    nextRead=nextWrite=0;
+    error=NULL;
+    ready.clear();
+    freePlanes.clear();
+
+    unsigned int nreaders=nthreads < n ? nthreads : n;
+    vector<pthread_t> threads(nreaders);
+    unsigned int started=0;
+    for(; started<nreaders; started++)
+      if(pthread_create(&threads[started], NULL, readWorker, this))
+        break;
+    if(started==0)
+    {
+      closeReference();
+      throw "rmFITSmerge::merge could not start reader threads";
+    }
+
+    // write planes in list order as they become available
+    vector<float> plane;
+    for(size_t z=0; z<n; z++)
+    {
+      pthread_mutex_lock(&mutex);
+      while(error==NULL && ready.find(z)==ready.end())
+        pthread_cond_wait(&planeRead, &mutex);
+      if(error!=NULL)
+      {
+        pthread_mutex_unlock(&mutex);
+        break;
+      }
+      plane.swap(ready[z]);
+      ready.erase(z);
+      pthread_mutex_unlock(&mutex);
+
+      try
+      {
+        LONGLONG fpixel[3]={1, 1, static_cast<LONGLONG>(z+1)};
+        if(!reentrant)
+          pthread_mutex_lock(&fitsMutex);
+        try
+        {
+          out.writePix(TFLOAT, fpixel, nx*ny, &plane[0]);
+        }
+        catch(const char *)
+        {
+          if(!reentrant)
+            pthread_mutex_unlock(&fitsMutex);
+          throw;
+        }
+        if(!reentrant)
+          pthread_mutex_unlock(&fitsMutex);
+      }
+      catch(const char *s)
+      {
+        setError(s);
+        break;
+      }
+
+      // hand the buffer back and let the readers advance
+      pthread_mutex_lock(&mutex);
+      freePlanes.push_back(vector<float>());
+      freePlanes.back().swap(plane);
+      nextWrite=z+1;
+      pthread_cond_broadcast(&planeWritten);
+      pthread_mutex_unlock(&mutex);
+    }
+
+    for(unsigned int t=0; t<started; t++)
+      pthread_join(threads[t], NULL);
+    closeReference();
+    ready.clear();
+    freePlanes.clear();
+
+    if(error!=NULL)
+      throw error;
+
+    correctFreqHeaders(out);
+    out.close();
+  }
+
+  //_____________________________________________________________________________
+  //                                                           correctFreqHeaders
+
+  /*!
+    \brief Write the frequency axis (NAXIS3) of out from the input frequencies
+
+    A linear axis is described exactly by CRVAL3/CDELT3. Otherwise CDELT3
+    is the mean channel spacing and the exact frequencies should be taken
+    from writeFrequencyList. If any image has no frequency, the axis is
+    marked as a CHANNEL axis (CRVAL3=1, CDELT3=1) rather than left as a
+    FREQ axis starting at 0 Hz.
+
+    \param &out - cube written by merge, with the NAXIS3 keywords reserved
+  */
+  void rmFITSmerge::correctFreqHeaders (rmFITS &out)
+  {
+    const size_t n=frequencies.size();
+
+    for(size_t i=0; i<n; i++)
+      if(isnan(frequencies[i]))
+      {
+        cerr << "rmFITSmerge::correctFreqHeaders no frequency in " << list[i]
+             << ", NAXIS3 is written as a channel axis" << endl;
+
+        char ctype[]="CHANNEL";
+        char cunit[]="";
+        double one=1;
+        string key="CTYPE3", comment="input without frequency";
+        out.updateKey(TSTRING, key, ctype, comment);
+        key="CUNIT3";
+        comment="";
+        out.updateKey(TSTRING, key, cunit, comment);
+        key="CRVAL3";
+        out.updateKey(TDOUBLE, key, &one, comment);
+        return;
+      }
+
+    double crval=frequencies[0];
+    double cdelt=n > 1 ? (frequencies[n-1]-frequencies[0])/(n-1) : frequencyWidths[0];
+    if(isnan(cdelt) || cdelt==0)
+      cdelt=1.0;
+
+    string key, comment;
+    key="CRVAL3";
+    out.updateKey(TDOUBLE, key, &crval, comment);
+    key="CDELT3";
+    out.updateKey(TDOUBLE, key, &cdelt, comment);
+
+    if(!isLinearFrequencyAxis())
+      cerr << "rmFITSmerge::correctFreqHeaders frequencies are not linearly spaced, "
+           << "CDELT3 is the mean spacing" << endl;
+  }
+
+  //_____________________________________________________________________________
+  //                                                        isLinearFrequencyAxis
+
+  bool rmFITSmerge::isLinearFrequencyAxis () const
+  {
+    const size_t n=frequencies.size();
+    if(n < 3)
+      return true;
+
+    double cdelt=(frequencies[n-1]-frequencies[0])/(n-1);
+    for(size_t i=1; i<n-1; i++)
+      if(fabs(frequencies[i]-(frequencies[0]+i*cdelt)) > 1e-6*fabs(cdelt))
+        return false;
+
+    return true;
+  }
+
+  //_____________________________________________________________________________
+  //                                                           writeFrequencyList
+
+  /*!
+    \brief Write frequency and channel width of each plane, one line per
+    plane, as read by rmIO::readFrequenciesAndDeltaFrequencies
+
+    Widths unknown from the headers are taken from the channel spacing.
+
+    \param &filename - name of text file
+  */
+  void rmFITSmerge::writeFrequencyList (const string &filename)
+  {
+    const size_t n=frequencies.size();
+    ofstream outfile(filename.c_str(), ofstream::out);
+
+    if(outfile.fail())
+      throw "rmFITSmerge::writeFrequencyList could not open file";
+
+    outfile.precision(12);
+    for(size_t i=0; i<n; i++)
+    {
+      double width=frequencyWidths[i];
+      if(isnan(width) && n > 1)
+        width=fabs(i+1<n ? frequencies[i+1]-frequencies[i] : frequencies[i]-frequencies[i-1]);
+      outfile << frequencies[i] << "\t" << width << endl;
+    }
+    outfile.close();
+  }
+
+}  // END -- namespace RM
@@ -0,0 +1,144 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef RMFITS_MERGE_H
+#define RMFITS_MERGE_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "rmFITS.h"
+
+namespace RM {
+
+  /*!
+    \class rmFITSmerge
+
+    \ingroup RM
+
+    \brief Merge a list of 2-D FITS channel images into one 3-D cube
+
+    \author Sven Duscha
+
+    \test trmFITSmerge.cpp
+
+    <h3>Synopsis</h3>
+
+    Input images are opened exactly once each: a pool of reader threads
+    validates the header of an image (image HDU, same x/y size as the
+    first image, all further axes degenerate), takes its frequency from the
+    header and reads its plane, then closes the file again. Planes are
+    handed to a single writer which appends them to the cube strictly in
+    list order. At most maxPlanes planes are held in memory; readers wait
+    when they get too far ahead of the writer.
+
+    The frequency axis (CTYPE3='FREQ') is written from the frequencies of
+    the inputs in the same pass. Its keywords are reserved when the cube is
+    created and updated at the end, so the header never grows after data
+    has been written. Non-linear frequency lists are written as a text
+    list (frequency, width per line) as read by rmIO. If any input has no
+    frequency, NAXIS3 is written as a CHANNEL axis numbered from 1 instead.
+
+    If cfitsio was not built reentrant, all cfitsio calls are serialised and
+    only the non-FITS work overlaps.
+  */
+  class rmFITSmerge {
+
+  private:
+
+    //! input images in output order
+    std::vector<std::string> list;
+    //! number of reader threads
+    unsigned int nthreads;
+    //! maximum number of planes buffered between readers and writer
+    unsigned int maxPlanes;
+    //! plane dimensions (taken from the first image)
+    int64_t nx, ny;
+    //! header of the first image (celestial WCS of the cube)
+    rmFITSheader reference;
+    //! first image, kept open by merge until its plane has been read
+    fitsfile *referenceFptr;
+    //! frequency and channel width of each image in Hz (NaN if unknown)
+    std::vector<double> frequencies;
+    std::vector<double> frequencyWidths;
+
+    //! cfitsio is thread-safe
+    bool reentrant;
+    //! serialises cfitsio calls if cfitsio is not reentrant
+    pthread_mutex_t fitsMutex;
+    //! protects the reader/writer state below
+    pthread_mutex_t mutex;
+    pthread_cond_t planeRead;
+    pthread_cond_t planeWritten;
+    //! next image to be read, next plane to be written
+    size_t nextRead, nextWrite;
+    //! planes read but not yet written, by list index
+    std::map<size_t, std::vector<float> > ready;
+    //! buffers returned by the writer for reuse
+    std::vector<std::vector<float> > freePlanes;
+    //! first error of any thread
+    const char *error;
+
+    void readImage (size_t i,
+                    std::vector<float> &plane);
+    static void *readWorker (void *arg);
+    void setError (const char *s);
+    void closeReference ();
+
+    // no copies of the open reference file, the mutexes and conditions
+    rmFITSmerge (const rmFITSmerge &);
+    rmFITSmerge &operator= (const rmFITSmerge &);
+
+  public:
+
+    // === Construction =========================================================
+
+    //! Prepare merging list with nthreads readers
+    rmFITSmerge (const std::vector<std::string> &list,
+                 unsigned int nthreads=4,
+                 unsigned int maxPlanes=0);
+
+    // === Destruction ==========================================================
+
+    ~rmFITSmerge ();
+
+    // === Methods ==============================================================
+
+    //! Merge the list into outfilename, optionally tile-compressed
+    void merge (const std::string &outfilename,
+                int compression=0,
+                float quantizeLevel=0);
+    //! Write the frequency axis of the cube from the input frequencies
+    void correctFreqHeaders (rmFITS &out);
+    //! Write frequencies and channel widths as a text list
+    void writeFrequencyList (const std::string &filename);
+
+    //! Check if the input frequencies are linearly spaced
+    bool isLinearFrequencyAxis () const;
+    inline const std::vector<double> &getFrequencies () const { return frequencies; }
+    inline const std::vector<double> &getFrequencyWidths () const { return frequencyWidths; }
+  };
+
+}  // END -- namespace RM
+
+#endif
@@ -0,0 +1,494 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <math.h>
+#include <stdio.h>
+#include "rmFITSproducts.h"
+
+using namespace std;
+
+namespace RM {
+
+  // ============================================================================
+  //
+  //  Construction / Destruction
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                               rmFITSproducts
+
+  /*!
+    \param &basename - output filename without .fits extension
+    \param products - bitmask of rmProduct values to write
+    \param xSize - x dimension of Faraday cube
+    \param ySize - y dimension of Faraday cube
+    \param &faradayDepths - Faraday depths (must be linearly spaced)
+    \param separateFiles - write each product into its own file (default true)
+    \param bandRows - number of image rows staged before writing (default 32)
+    \param spectralMajor - write Faraday depth as NAXIS1 (default false)
+  */
+  rmFITSproducts::rmFITSproducts (const string &basename,
+                                  int products,
+                                  uint64_t xSize,
+                                  uint64_t ySize,
+                                  const vector<double> &faradayDepths,
+                                  bool separateFiles,
+                                  uint64_t bandRows,
+                                  bool spectralMajor)
+  {
+    const int allproducts[4]={PRODUCT_Q, PRODUCT_U, PRODUCT_P, PRODUCT_ANGLE};
+    const char *suffix[4]={"_Q", "_U", "_P", "_PA"};
+
+    if((products & PRODUCT_ALL)==0)
+      throw "rmFITSproducts::rmFITSproducts no products requested";
+    if(xSize==0 || ySize==0 || faradayDepths.size()==0)
+      throw "rmFITSproducts::rmFITSproducts cube dimension is 0";
+    if(bandRows==0)
+      throw "rmFITSproducts::rmFITSproducts bandRows is 0";
+
+    this->products=products;
+    this->separateFiles=separateFiles;
+    this->spectralMajor=spectralMajor;
+    this->xSize=xSize;
+    this->ySize=ySize;
+    this->faradaySize=faradayDepths.size();
+    this->bandRows=bandRows < ySize ? bandRows : ySize;
+    this->writeMode=0;
+
+    pthread_mutex_init(&mutex, NULL);
+
+    rmFITS *fits=NULL;
+    for(int i=0; i<4; i++)
+    {
+      if(!(products & allproducts[i]))
+        continue;
+
+      // "!" makes cfitsio overwrite an existing file
+      if(separateFiles)
+        fits=new rmFITS("!" + basename + suffix[i] + ".fits", READWRITE);
+      else if(fits==NULL)
+        fits=new rmFITS("!" + basename + ".fits", READWRITE);
+
+      createProductImage(fits, allproducts[i], faradayDepths);
+
+      productList.push_back(allproducts[i]);
+      files.push_back(fits);
+      hdus.push_back(fits->getCurrentHDU());
+      checksums.push_back(rmFITSchecksum());
+    }
+  }
+
+  //_____________________________________________________________________________
+  //                                                              ~rmFITSproducts
+
+  rmFITSproducts::~rmFITSproducts ()
+  {
+    try
+    {
+      close();
+    }
+    catch(const char *s)
+    {
+      cerr << s << endl;
+    }
+    pthread_mutex_destroy(&mutex);
+  }
+
+  //_____________________________________________________________________________
+  //                                                           createProductImage
+
+  /*!
+    \brief Append a float image for product and write its Faraday depth axis
+
+    \param *fits - FITS file to append image to
+    \param product - product flag (determines EXTNAME and BUNIT)
+    \param &faradayDepths - Faraday depths of the Faraday axis (NAXIS3, or
+    NAXIS1 in spectral-major layout)
+  */
+  void rmFITSproducts::createProductImage (rmFITS *fits,
+                                           int product,
+                                           const vector<double> &faradayDepths)
+  {
+    vector<int64_t> dimensions(3);
+    if(spectralMajor)
+    {
+      dimensions[0]=faradaySize;
+      dimensions[1]=xSize;
+      dimensions[2]=ySize;
+    }
+    else
+    {
+      dimensions[0]=xSize;
+      dimensions[1]=ySize;
+      dimensions[2]=faradaySize;
+    }
+
+    fits->createImg(-32, dimensions);
+
+    string extname, bunit;
+    switch(product)
+    {
+      case PRODUCT_Q:
+        extname="Q";
+        bunit="JY/BEAM";
+        break;
+      case PRODUCT_U:
+        extname="U";
+        bunit="JY/BEAM";
+        break;
+      case PRODUCT_P:
+        extname="P";
+        bunit="JY/BEAM";
+        break;
+      case PRODUCT_ANGLE:
+        extname="ANGLE";
+        bunit="rad";
+        break;
+    }
+
+    double crval=faradayDepths[0];
+    double cdelt=faradayDepths.size() > 1 ? faradayDepths[1]-faradayDepths[0] : 1.0;
+    double crpix=1.0;
+    char ctype[]="FARADAY";
+    char cunit[]="rad/m^2";
+    int axis=spectralMajor ? 1 : 3;
+    char keyname[FLEN_KEYWORD];
+
+    fits->writeKey(TSTRING, "EXTNAME", const_cast<char*>(extname.c_str()), "Faraday product");
+    fits->writeKey(TSTRING, "BUNIT", const_cast<char*>(bunit.c_str()), "");
+    sprintf(keyname, "CTYPE%d", axis);
+    fits->writeKey(TSTRING, keyname, ctype, "Faraday depth");
+    sprintf(keyname, "CUNIT%d", axis);
+    fits->writeKey(TSTRING, keyname, cunit, "");
+    sprintf(keyname, "CRVAL%d", axis);
+    fits->writeKey(TDOUBLE, keyname, &crval, "");
+    sprintf(keyname, "CDELT%d", axis);
+    fits->writeKey(TDOUBLE, keyname, &cdelt, "");
+    sprintf(keyname, "CRPIX%d", axis);
+    fits->writeKey(TDOUBLE, keyname, &crpix, "");
+  }
+
+  //_____________________________________________________________________________
+  //                                                                 productValue
+
+  /*!
+    \brief Derive the value of product from a complex Faraday value
+
+    \param product - product flag
+    \param &c - complex Faraday value (Q + iU)
+  */
+  static inline float productValue (int product,
+                                    const complex<double> &c)
+  {
+    switch(product)
+    {
+      case PRODUCT_Q:
+        return c.real();
+      case PRODUCT_U:
+        return c.imag();
+      case PRODUCT_P:
+        return sqrt(c.real()*c.real()+c.imag()*c.imag());
+      case PRODUCT_ANGLE:
+        return 0.5*atan2(c.imag(), c.real());
+    }
+    return 0;
+  }
+
+  // ============================================================================
+  //
+  //  Output functions
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                                    writeTile
+
+  /*!
+    \brief Stage a complex Faraday tile; bands are written once they are complete
+
+    Must not be mixed with writePlane on the same sink.
+
+    \param *tile - complex Faraday tile [faradaySize][ny][nx]
+    \param x - x position (0-based) of tile
+    \param y - y position (0-based) of tile
+    \param nx - x size of tile
+    \param ny - y size of tile
+  */
+  void rmFITSproducts::writeTile (const complex<double> *tile,
+                                  uint64_t x,
+                                  uint64_t y,
+                                  uint64_t nx,
+                                  uint64_t ny)
+  {
+    if(tile==NULL)
+      throw "rmFITSproducts::writeTile tile is NULL";
+    if(x+nx > xSize || y+ny > ySize)
+      throw "rmFITSproducts::writeTile tile exceeds cube dimensions";
+
+    const uint64_t nproducts=productList.size();
+
+    pthread_mutex_lock(&mutex);
+    if(writeMode==2)
+    {
+      pthread_mutex_unlock(&mutex);
+      throw "rmFITSproducts::writeTile planes were already written with writePlane";
+    }
+    writeMode=1;
+
+    // a tile may straddle band boundaries: stage its rows band by band
+    for(uint64_t j=0; j<ny; j++)
+    {
+      uint64_t row=y+j;
+      uint64_t bandnum=row/bandRows;
+      uint64_t bandy0=bandnum*bandRows;
+      uint64_t rows=min(bandRows, ySize-bandy0);
+
+      band &b=bands[bandnum];
+      if(b.data.size()==0)
+      {
+        b.data.resize(nproducts*faradaySize*rows*xSize);
+        b.filled=0;
+      }
+
+      if(spectralMajor)	// gather each spectrum into its contiguous slot
+      {
+        for(uint64_t p=0; p<nproducts; p++)
+        {
+          for(uint64_t i=0; i<nx; i++)
+          {
+            float *dst=&b.data[((p*rows+(row-bandy0))*xSize+x+i)*faradaySize];
+            for(uint64_t z=0; z<faradaySize; z++)
+              dst[z]=productValue(productList[p], tile[(z*ny+j)*nx+i]);
+          }
+        }
+      }
+      else for(uint64_t z=0; z<faradaySize; z++)
+      {
+        const complex<double> *src=tile+(z*ny+j)*nx;
+        for(uint64_t p=0; p<nproducts; p++)
+        {
+          float *dst=&b.data[((p*faradaySize+z)*rows+(row-bandy0))*xSize+x];
+          switch(productList[p])
+          {
+            case PRODUCT_Q:
+              for(uint64_t i=0; i<nx; i++)
+                dst[i]=src[i].real();
+              break;
+            case PRODUCT_U:
+              for(uint64_t i=0; i<nx; i++)
+                dst[i]=src[i].imag();
+              break;
+            case PRODUCT_P:
+              for(uint64_t i=0; i<nx; i++)
+                dst[i]=sqrt(src[i].real()*src[i].real()+src[i].imag()*src[i].imag());
+              break;
+            case PRODUCT_ANGLE:
+              for(uint64_t i=0; i<nx; i++)
+                dst[i]=0.5*atan2(src[i].imag(), src[i].real());
+              break;
+          }
+        }
+      }
+
+      b.filled+=nx;
+      if(b.filled==rows*xSize)
+      {
+        try
+        {
+          flushBand(bandnum, b);
+        }
+        catch(const char *)
+        {
+          pthread_mutex_unlock(&mutex);
+          throw;
+        }
+        bands.erase(bandnum);
+      }
+    }
+
+    pthread_mutex_unlock(&mutex);
+  }
+
+  //_____________________________________________________________________________
+  //                                                                    flushBand
+
+  /*!
+    \brief Write a band: one contiguous write per product and Faraday plane
+    (one per product in spectral-major layout)
+
+    \param bandnum - number of band (first row is bandnum*bandRows)
+    \param &b - staged band
+  */
+  void rmFITSproducts::flushBand (uint64_t bandnum,
+                                  band &b)
+  {
+    uint64_t bandy0=bandnum*bandRows;
+    uint64_t rows=min(bandRows, ySize-bandy0);
+    LONGLONG fpixel[3];
+
+    for(uint64_t p=0; p<productList.size(); p++)
+    {
+      if(files[p]->getCurrentHDU()!=hdus[p])
+        files[p]->moveAbsoluteHDU(hdus[p]);
+
+      if(spectralMajor)
+      {
+        uint64_t nelements=rows*xSize*faradaySize;
+        fpixel[0]=1;
+        fpixel[1]=1;
+        fpixel[2]=bandy0+1;
+        files[p]->writePix(TFLOAT, fpixel, nelements, &b.data[p*nelements]);
+        checksums[p].addFloats(&b.data[p*nelements], nelements);
+        continue;
+      }
+
+      for(uint64_t z=0; z<faradaySize; z++)
+      {
+        fpixel[0]=1;
+        fpixel[1]=bandy0+1;
+        fpixel[2]=z+1;
+        files[p]->writePix(TFLOAT, fpixel, rows*xSize, &b.data[(p*faradaySize+z)*rows*xSize]);
+        checksums[p].addFloats(&b.data[(p*faradaySize+z)*rows*xSize], rows*xSize);
+      }
+    }
+  }
+
+  //_____________________________________________________________________________
+  //                                                                   writePlane
+
+  /*!
+    \brief Write all products of one complex Faraday plane
+
+    In spectral-major layout a plane is strided on disk and written through
+    fits_write_subset; use writeTile for bulk output in that layout.
+    Must not be mixed with writeTile on the same sink.
+
+    \param *plane - complex Faraday plane [ySize][xSize]
+    \param z - Faraday depth index (0-based)
+  */
+  void rmFITSproducts::writePlane (const complex<double> *plane,
+                                   uint64_t z)
+  {
+    if(plane==NULL)
+      throw "rmFITSproducts::writePlane plane is NULL";
+    if(z >= faradaySize)
+      throw "rmFITSproducts::writePlane z out of range";
+
+    const uint64_t nelements=xSize*ySize;
+    vector<float> buffer(nelements);
+    vector<double> strided;
+    LONGLONG fpixel[3]={1, 1, static_cast<LONGLONG>(z+1)};
+    long first[3]={static_cast<long>(z+1), 1, 1};
+    long last[3]={static_cast<long>(z+1), static_cast<long>(xSize), static_cast<long>(ySize)};
+
+    pthread_mutex_lock(&mutex);
+    if(writeMode==1)
+    {
+      pthread_mutex_unlock(&mutex);
+      throw "rmFITSproducts::writePlane tiles were already written with writeTile";
+    }
+    writeMode=2;
+    try
+    {
+      for(uint64_t p=0; p<productList.size(); p++)
+      {
+        for(uint64_t i=0; i<nelements; i++)
+        {
+          switch(productList[p])
+          {
+            case PRODUCT_Q:
+              buffer[i]=plane[i].real();
+              break;
+            case PRODUCT_U:
+              buffer[i]=plane[i].imag();
+              break;
+            case PRODUCT_P:
+              buffer[i]=sqrt(plane[i].real()*plane[i].real()+plane[i].imag()*plane[i].imag());
+              break;
+            case PRODUCT_ANGLE:
+              buffer[i]=0.5*atan2(plane[i].imag(), plane[i].real());
+              break;
+          }
+        }
+
+        if(files[p]->getCurrentHDU()!=hdus[p])
+          files[p]->moveAbsoluteHDU(hdus[p]);
+        if(spectralMajor)
+        {
+          strided.assign(buffer.begin(), buffer.end());
+          files[p]->writeSubset(TDOUBLE, first, last, &strided[0]);
+        }
+        else
+          files[p]->writePix(TFLOAT, fpixel, nelements, &buffer[0]);
+        checksums[p].addFloats(&buffer[0], nelements);
+      }
+    }
+    catch(const char *)
+    {
+      pthread_mutex_unlock(&mutex);
+      throw;
+    }
+    pthread_mutex_unlock(&mutex);
+  }
+
+  //_____________________________________________________________________________
+  //                                                                        close
+
+  /*!
+    \brief Write bands which are still staged (e.g. incompletely covered) and
+    close all files
+  */
+  void rmFITSproducts::close ()
+  {
+    pthread_mutex_lock(&mutex);
+
+    try
+    {
+      for(map<uint64_t, band>::iterator it=bands.begin(); it!=bands.end(); ++it)
+        flushBand(it->first, it->second);
+      bands.clear();
+
+      for(uint64_t p=0; p<files.size(); p++)
+      {
+        files[p]->moveAbsoluteHDU(hdus[p]);
+        files[p]->writeChecksum(checksums[p].getDatasum());
+      }
+    }
+    catch(const char *)
+    {
+      pthread_mutex_unlock(&mutex);
+      throw;
+    }
+
+    // files may be shared between products (HDU mode): delete each once
+    for(uint64_t p=0; p<files.size(); p++)
+    {
+      if(p==0 || files[p]!=files[p-1])
+        delete files[p];
+    }
+    files.clear();
+    hdus.clear();
+    checksums.clear();
+
+    pthread_mutex_unlock(&mutex);
+  }
+
+}  // END -- namespace RM
@@ -0,0 +1,175 @@
+/***************************************************************************
+*   Copyright (C) 2010                                                    *
+*   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+*                                                                         *
+*   This program is free software; you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation; either version 2 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program; if not, write to the                         *
+*   Free Software Foundation, Inc.,                                       *
+*   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+***************************************************************************/
+
+#ifndef RMFITSPRODUCTS_H
+#define RMFITSPRODUCTS_H
+
+// C++ Standard library
+#include <string>
+#include <vector>
+#include <map>
+#include <complex>
+#include <pthread.h>
+
+#include "rmFITS.h"
+
+namespace RM {
+
+  //! Derived Faraday products that can be written by rmFITSproducts (bitmask)
+  enum rmProduct {
+    //! Faraday Q (real part)
+    PRODUCT_Q     = 1,
+    //! Faraday U (imaginary part)
+    PRODUCT_U     = 2,
+    //! polarized intensity |P|
+    PRODUCT_P     = 4,
+    //! polarization angle 0.5*atan2(U,Q) in rad
+    PRODUCT_ANGLE = 8,
+    //! all of the above
+    PRODUCT_ALL   = 15
+  };
+
+  /*!
+    \class rmFITSproducts
+
+    \ingroup RM
+
+    \brief Single-pass output sink writing Q, U, |P| and angle Faraday cubes
+
+    \author Sven Duscha
+
+    \test trmFITSproducts.cpp
+
+    <h3>Synopsis</h3>
+
+    The sink accepts the complex Faraday spectrum of a tile of pixels, as it
+    comes out of RM-Synthesis, and derives all requested products from it
+    in one go. Products are written either as separate FITS files
+    (basename_Q.fits, basename_U.fits, basename_P.fits, basename_PA.fits)
+    or as image HDUs in one file (EXTNAME Q, U, P, ANGLE).
+
+    Tiles are staged per band of full-width image rows. Once a band is
+    complete it is written with one contiguous fits_write_pix per Faraday
+    plane and product, so the FITS files see large sequential writes
+    regardless of the tile shape. All writes are serialised by a mutex,
+    so worker threads may hand in tiles concurrently.
+
+    The DATASUM of every product is accumulated from the staged floats as
+    they are written and DATASUM/CHECKSUM are inserted at close, so the
+    cubes are not read a second time. Every pixel must be written once,
+    and a sink is written either with writeTile or with writePlane; mixing
+    both throws, as staged bands would overwrite planes at close.
+
+    With spectralMajor the cubes are written "Faraday axis first"
+    (NAXIS1=phi, NAXIS2=x, NAXIS3=y), so the spectrum of every line of sight
+    is contiguous on disk and a band is written with one fits_write_pix per
+    product. rmFITS::readSpectrum reads either layout.
+  */
+  class rmFITSproducts {
+
+  private:
+    //! staging buffer of one band of rows: [product][faradaySize][bandRows][xSize]
+    //! ([product][bandRows][xSize][faradaySize] in spectral-major layout)
+    struct band {
+      std::vector<float> data;
+      uint64_t filled;        // number of pixels (LOS) already staged
+    };
+
+    //! bitmask of products to write
+    int products;
+    //! write products into separate files (true) or HDUs of one file (false)
+    bool separateFiles;
+    //! Faraday depth is the first (fastest) axis of the cubes
+    bool spectralMajor;
+    //! product flags in output order
+    std::vector<int> productList;
+    //! output FITS file for each product (may point to the same object)
+    std::vector<rmFITS*> files;
+    //! HDU number of each product
+    std::vector<int> hdus;
+    //! DATASUM of each product, accumulated as its data is written
+    std::vector<rmFITSchecksum> checksums;
+
+    //! cube dimensions
+    uint64_t xSize, ySize, faradaySize;
+    //! number of image rows staged per band
+    uint64_t bandRows;
+    //! bands currently staged, indexed by band number
+    std::map<uint64_t, band> bands;
+
+    //! write mode in use: 0 = none yet, 1 = writeTile, 2 = writePlane
+    int writeMode;
+
+    //! serialises all writes
+    pthread_mutex_t mutex;
+
+    // no copies of the open files and the mutex
+    rmFITSproducts (const rmFITSproducts &);
+    rmFITSproducts &operator= (const rmFITSproducts &);
+
+    //! Create one image HDU for product and write its Faraday WCS
+    void createProductImage(rmFITS *fits,
+                            int product,
+                            const std::vector<double> &faradayDepths);
+    //! Write a completed band to all product images
+    void flushBand(uint64_t bandnum, band &b);
+
+  public:
+
+    // === Construction =========================================================
+
+    //! Create the product images for a cube of xSize*ySize*faradayDepths
+    rmFITSproducts (const std::string &basename,
+                    int products,
+                    uint64_t xSize,
+                    uint64_t ySize,
+                    const std::vector<double> &faradayDepths,
+                    bool separateFiles=true,
+                    uint64_t bandRows=32,
+                    bool spectralMajor=false);
+
+    // === Destruction ==========================================================
+
+    //! Destructor, flushes remaining bands and closes files
+    ~rmFITSproducts ();
+
+    // === Methods ==============================================================
+
+    //! Put a complex Faraday tile [faradaySize][ny][nx] at pixel x, y (0-based)
+    void writeTile (const std::complex<double> *tile,
+                    uint64_t x,
+                    uint64_t y,
+                    uint64_t nx,
+                    uint64_t ny);
+    //! Write all products of a complete complex Faraday plane z (0-based)
+    void writePlane (const std::complex<double> *plane,
+                     uint64_t z);
+    //! Flush incompletely staged bands and close all files
+    void close ();
+
+    //! Get bitmask of products written
+    inline int getProducts () const { return products; }
+    //! Check if the cubes are written Faraday axis first
+    inline bool isSpectralMajor () const { return spectralMajor; }
+  };
+
+}  // END -- namespace RM
+
+#endif
@@ -0,0 +1,296 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <iostream>
+#include "rmFITSreaderPool.h"
+
+using namespace std;
+
+namespace RM {
+
+  // ============================================================================
+  //
+  //  Construction / Destruction
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                             rmFITSreaderPool
+
+  /*!
+    \param &filename - name of FITS file to read from
+    \param nhandles - number of independent handles (i.e. concurrent reads)
+    \param hdu - image HDU to read from (default 1)
+  */
+  rmFITSreaderPool::rmFITSreaderPool (const string &filename,
+                                      unsigned int nhandles,
+                                      int hdu)
+  {
+    int status=0;
+    int hdutype=0;
+    char fits_error_message[FLEN_STATUS];
+
+    if(nhandles==0)
+      throw "rmFITSreaderPool::rmFITSreaderPool nhandles is 0";
+
+    this->filename=filename;
+    reentrant=fits_is_reentrant();
+
+    pthread_mutex_init(&mutex, NULL);
+    pthread_mutex_init(&fitsMutex, NULL);
+    pthread_cond_init(&handleReleased, NULL);
+
+    handles.resize(nhandles, NULL);
+    for(unsigned int i=0; i<nhandles; i++)
+    {
+      if(fits_open_file(&handles[i], filename.c_str(), READONLY, &status) ||
+         fits_movabs_hdu(handles[i], hdu, &hdutype, &status))
+      {
+        fits_get_errstatus(status, fits_error_message);
+        cerr << fits_error_message << endl;
+        for(unsigned int j=0; j<=i; j++)
+        {
+          int closestatus=0;
+          if(handles[j]!=NULL)
+            fits_close_file(handles[j], &closestatus);
+        }
+        throw "rmFITSreaderPool::rmFITSreaderPool could not open file";
+      }
+      freeHandles.push_back(i);
+
+      // handles on one internal file structure share its file position and
+      // buffers, reads through them must not run concurrently
+      for(unsigned int j=0; j<i; j++)
+        if(handles[j]->Fptr==handles[i]->Fptr)
+          reentrant=false;
+    }
+
+    int naxis=0;
+    vector<LONGLONG> naxes;
+    if(hdutype==IMAGE_HDU)
+    {
+      fits_get_img_dim(handles[0], &naxis, &status);
+      naxes.resize(naxis);
+      if(naxis > 0)
+        fits_get_img_sizell(handles[0], naxis, &naxes[0], &status);
+    }
+    if(hdutype!=IMAGE_HDU || naxis==0 || status)
+    {
+      for(unsigned int i=0; i<nhandles; i++)
+      {
+        int closestatus=0;
+        fits_close_file(handles[i], &closestatus);
+      }
+      throw "rmFITSreaderPool::rmFITSreaderPool HDU is not an image";
+    }
+
+    dimensions.assign(naxes.begin(), naxes.end());
+  }
+
+  //_____________________________________________________________________________
+  //                                                            ~rmFITSreaderPool
+
+  rmFITSreaderPool::~rmFITSreaderPool ()
+  {
+    for(unsigned int i=0; i<handles.size(); i++)
+    {
+      int status=0;
+      fits_close_file(handles[i], &status);
+    }
+
+    pthread_cond_destroy(&handleReleased);
+    pthread_mutex_destroy(&fitsMutex);
+    pthread_mutex_destroy(&mutex);
+  }
+
+  // ============================================================================
+  //
+  //  Handle management
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                                      acquire
+
+  unsigned int rmFITSreaderPool::acquire ()
+  {
+    pthread_mutex_lock(&mutex);
+    while(freeHandles.empty())
+      pthread_cond_wait(&handleReleased, &mutex);
+    unsigned int handle=freeHandles.back();
+    freeHandles.pop_back();
+    pthread_mutex_unlock(&mutex);
+
+    return handle;
+  }
+
+  //_____________________________________________________________________________
+  //                                                                      release
+
+  void rmFITSreaderPool::release (unsigned int handle)
+  {
+    pthread_mutex_lock(&mutex);
+    freeHandles.push_back(handle);
+    pthread_cond_signal(&handleReleased);
+    pthread_mutex_unlock(&mutex);
+  }
+
+  //_____________________________________________________________________________
+  //                                                                   readSubset
+
+  /*!
+    \brief Read a subset of the image with unit increment through a free handle
+
+    \param *fpixel - first pixel (1-based) of subset
+    \param *lpixel - last pixel (1-based) of subset
+    \param *array - array to read into
+    \param nulval - value substituted for undefined pixels
+    \param *anynul - set if any undefined pixel was encountered (may be NULL)
+  */
+  void rmFITSreaderPool::readSubset (long *fpixel,
+                                     long *lpixel,
+                                     double *array,
+                                     double nulval,
+                                     int *anynul)
+  {
+    int status=0;
+    int localanynul=0;
+    vector<long> inc(dimensions.size(), 1);
+    char fits_error_message[FLEN_STATUS];
+
+    if(array==NULL)
+      throw "rmFITSreaderPool::readSubset array is NULL";
+
+    unsigned int handle=acquire();
+    if(!reentrant)
+      pthread_mutex_lock(&fitsMutex);
+
+    fits_read_subset(handles[handle], TDOUBLE, fpixel, lpixel, &inc[0], &nulval, array, &localanynul, &status);
+
+    if(!reentrant)
+      pthread_mutex_unlock(&fitsMutex);
+    release(handle);
+
+    if(anynul!=NULL)
+      *anynul=localanynul;
+    if(status)
+    {
+      fits_get_errstatus(status, fits_error_message);
+      cerr << fits_error_message << endl;
+      throw "rmFITSreaderPool::readSubset failed";
+    }
+  }
+
+  // ============================================================================
+  //
+  //  Read functions
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                                  readSubCube
+
+  /*!
+    \brief Read a sub cube over all planes, safe to call from several threads
+
+    \param *subCube - array of x_size*y_size*z values
+    \param x_pos - lower left corner x position (1-based)
+    \param y_pos - lower left corner y position (1-based)
+    \param x_size - size in x direction in pixels
+    \param y_size - size in y direction in pixels
+    \param nulval - value substituted for undefined pixels (default 0)
+    \param *anynul - set if any undefined pixel was encountered (optional)
+  */
+  void rmFITSreaderPool::readSubCube (double *subCube,
+                                      unsigned long x_pos,
+                                      unsigned long y_pos,
+                                      unsigned long x_size,
+                                      unsigned long y_size,
+                                      double nulval,
+                                      int *anynul)
+  {
+    if(dimensions.size() < 3)
+      throw "rmFITSreaderPool::readSubCube image is not a cube";
+    if(x_pos < 1 || y_pos < 1 || x_size==0 || y_size==0)
+      throw "rmFITSreaderPool::readSubCube invalid position or size";
+    if(x_pos+x_size-1 > static_cast<unsigned long>(dimensions[0]) ||
+       y_pos+y_size-1 > static_cast<unsigned long>(dimensions[1]))
+      throw "rmFITSreaderPool::readSubCube sub cube exceeds image";
+
+    vector<long> fpixel(dimensions.size(), 1);
+    vector<long> lpixel(dimensions.size(), 1);
+    fpixel[0]=x_pos;
+    fpixel[1]=y_pos;
+    lpixel[0]=x_pos+x_size-1;
+    lpixel[1]=y_pos+y_size-1;
+    lpixel[2]=dimensions[2];
+
+    readSubset(&fpixel[0], &lpixel[0], subCube, nulval, anynul);
+  }
+
+  //_____________________________________________________________________________
+  //                                                                    readPlane
+
+  /*!
+    \param *plane - array of x*y values
+    \param z - plane to read (1-based)
+    \param nulval - value substituted for undefined pixels (default 0)
+    \param *anynul - set if any undefined pixel was encountered (optional)
+  */
+  void rmFITSreaderPool::readPlane (double *plane,
+                                    unsigned long z,
+                                    double nulval,
+                                    int *anynul)
+  {
+    if(dimensions.size() < 3)
+      throw "rmFITSreaderPool::readPlane image is not a cube";
+    if(z < 1 || z > static_cast<unsigned long>(dimensions[2]))
+      throw "rmFITSreaderPool::readPlane z out of range";
+
+    vector<long> fpixel(dimensions.size(), 1);
+    vector<long> lpixel(dimensions.size(), 1);
+    fpixel[2]=z;
+    lpixel[0]=dimensions[0];
+    lpixel[1]=dimensions[1];
+    lpixel[2]=z;
+
+    readSubset(&fpixel[0], &lpixel[0], plane, nulval, anynul);
+  }
+
+  //_____________________________________________________________________________
+  //                                                                     readLine
+
+  /*!
+    \param *line - array of z values
+    \param x - x position (1-based)
+    \param y - y position (1-based)
+    \param nulval - value substituted for undefined pixels (default 0)
+    \param *anynul - set if any undefined pixel was encountered (optional)
+  */
+  void rmFITSreaderPool::readLine (double *line,
+                                   unsigned long x,
+                                   unsigned long y,
+                                   double nulval,
+                                   int *anynul)
+  {
+    readSubCube(line, x, y, 1, 1, nulval, anynul);
+  }
+
+}  // END -- namespace RM
@@ -0,0 +1,146 @@
+/***************************************************************************
+*   Copyright (C) 2010                                                    *
+*   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+*                                                                         *
+*   This program is free software; you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation; either version 2 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program; if not, write to the                         *
+*   Free Software Foundation, Inc.,                                       *
+*   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+***************************************************************************/
+
+#ifndef RMFITSREADERPOOL_H
+#define RMFITSREADERPOOL_H
+
+// C++ Standard library
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <pthread.h>
+
+// CFITSIO header files
+#include <fitsio.h>
+
+namespace RM {
+
+  /*!
+    \class rmFITSreaderPool
+
+    \ingroup RM
+
+    \brief Pool of independent cfitsio handles for concurrent reads of one image
+
+    \author Sven Duscha
+
+    \test trmFITSreaderPool.cpp
+
+    <h3>Synopsis</h3>
+
+    cfitsio is only thread-safe if every thread works on its own fitsfile
+    handle, while rmFITS wraps exactly one handle and keeps the status of
+    the last operation in its members. The pool opens the same file N times
+    and hands out one handle per read call. All status, nulval and anynul
+    information is local to the call, so the read functions can be called
+    from any number of worker threads; calls block while all handles are in
+    use.
+
+    cfitsio may share one internal file structure (fitsfile::Fptr) between
+    handles on the same file (fits_already_open). The pool compares the
+    structures after opening and serialises reads if any are shared, as it
+    does if cfitsio was not compiled reentrant (fits_is_reentrant);
+    isReentrant tells whether reads really run concurrently.
+  */
+  class rmFITSreaderPool {
+
+  private:
+    //! name of FITS file
+    std::string filename;
+    //! independent cfitsio handles on filename
+    std::vector<fitsfile*> handles;
+    //! indices of handles not in use
+    std::vector<unsigned int> freeHandles;
+    //! dimensions of the image HDU
+    std::vector<int64_t> dimensions;
+    //! cfitsio library is thread-safe and no handles share a file structure
+    bool reentrant;
+
+    //! protects freeHandles
+    pthread_mutex_t mutex;
+    //! signalled when a handle is released
+    pthread_cond_t handleReleased;
+    //! serialises cfitsio calls if library is not reentrant or handles are shared
+    pthread_mutex_t fitsMutex;
+
+    //! Get a free handle, blocks until one is available
+    unsigned int acquire();
+    //! Return a handle to the pool
+    void release(unsigned int handle);
+    //! Read a subset with a local status through a pooled handle
+    void readSubset(long *fpixel,
+                    long *lpixel,
+                    double *array,
+                    double nulval,
+                    int *anynul);
+
+    // no copies of the file handles, the mutexes and the condition
+    rmFITSreaderPool (const rmFITSreaderPool &);
+    rmFITSreaderPool &operator= (const rmFITSreaderPool &);
+
+  public:
+
+    // === Construction =========================================================
+
+    //! Open filename nhandles times and move all handles to image HDU hdu
+    rmFITSreaderPool (const std::string &filename,
+                      unsigned int nhandles,
+                      int hdu=1);
+
+    // === Destruction ==========================================================
+
+    //! Close all handles
+    ~rmFITSreaderPool ();
+
+    // === Methods ==============================================================
+
+    //! Read a sub cube [z][y_size][x_size] at (1-based) x_pos, y_pos
+    void readSubCube (double *subCube,
+                      unsigned long x_pos,
+                      unsigned long y_pos,
+                      unsigned long x_size,
+                      unsigned long y_size,
+                      double nulval=0,
+                      int *anynul=NULL);
+    //! Read a complete plane at (1-based) depth z
+    void readPlane (double *plane,
+                    unsigned long z,
+                    double nulval=0,
+                    int *anynul=NULL);
+    //! Read a line along the z axis at (1-based) x, y
+    void readLine (double *line,
+                   unsigned long x,
+                   unsigned long y,
+                   double nulval=0,
+                   int *anynul=NULL);
+
+    // === Member access ========================================================
+
+    //! Get image dimensions
+    inline std::vector<int64_t> getImageDimensions () const { return dimensions; }
+    //! Get number of handles in pool
+    inline unsigned int getNumHandles () const { return handles.size(); }
+    //! Check if reads really run concurrently
+    inline bool isReentrant () const { return reentrant; }
+  };
+
+}  // END -- namespace RM
+
+#endif
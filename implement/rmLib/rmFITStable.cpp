@@ -0,0 +1,484 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <iostream>
+#include <algorithm>
+#include <ctype.h>
+#include <sys/stat.h>
+#include "rmFITStable.h"
+
+using namespace std;
+
+namespace RM {
+
+  // ============================================================================
+  //
+  //  Construction / Destruction
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                                  rmFITStable
+
+  /*!
+    \param &filename - name of FITS file
+    \param overwrite - replace an existing file; otherwise the table is
+                       appended as a new HDU (default true)
+    \param bufferRows - number of rows staged before a block write (default 65536)
+  */
+  rmFITStable::rmFITStable (const string &filename,
+                            bool overwrite,
+                            uint64_t bufferRows)
+  {
+    int status=0;
+    char fits_error_message[FLEN_STATUS];
+    struct stat fileInfo;
+
+    if(bufferRows==0)
+      throw "rmFITStable::rmFITStable bufferRows is 0";
+
+    fptr=NULL;
+    created=false;
+    catalog=false;
+    staged=0;
+    written=0;
+    this->bufferRows=bufferRows;
+
+    if(!overwrite && stat(filename.c_str(), &fileInfo)==0)
+      fits_open_file(&fptr, filename.c_str(), READWRITE, &status);
+    else		// "!" makes cfitsio overwrite an existing file
+      fits_create_file(&fptr, ("!" + filename).c_str(), &status);
+
+    if(status)
+    {
+      fits_get_errstatus(status, fits_error_message);
+      cerr << fits_error_message << endl;
+      throw "rmFITStable::rmFITStable could not open file";
+    }
+  }
+
+  //_____________________________________________________________________________
+  //                                                                 ~rmFITStable
+
+  rmFITStable::~rmFITStable ()
+  {
+    try
+    {
+      close();
+    }
+    catch(const char *s)
+    {
+      cerr << s << endl;
+    }
+  }
+
+  // ============================================================================
+  //
+  //  Table definition
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                                    addColumn
+
+  /*!
+    \param &name - column name (TTYPE)
+    \param &tform - column format: D, E (floating point), K, J, I (integer),
+                    with a repeat count (e.g. 300D) a fixed-length vector,
+                    or 1PD, 1PE (variable-length array of floating point)
+    \param &unit - physical unit (TUNIT, optional)
+
+    \return col - (0-based) index of column
+  */
+  unsigned int rmFITStable::addColumn (const string &name,
+                                       const string &tform,
+                                       const string &unit)
+  {
+    if(created)
+      throw "rmFITStable::addColumn table has already been created";
+    if(name.size()==0)
+      throw "rmFITStable::addColumn no name given";
+
+    // repeat count
+    string::size_type pos=0;
+    LONGLONG repeat=0;
+    while(pos < tform.size() && isdigit(tform[pos]))
+      repeat=10*repeat+(tform[pos++]-'0');
+    if(pos==tform.size())
+      throw "rmFITStable::addColumn invalid TFORM";
+
+    column c;
+    c.name=name;
+    c.tform=tform;
+    c.unit=unit;
+    c.vla=false;
+    c.repeat=(pos==0) ? 1 : repeat;
+
+    switch(tform[pos])
+    {
+      case 'P':
+      case 'Q':
+        c.vla=true;
+        c.repeat=1;		// one descriptor per row
+        c.datatype=TDOUBLE;
+        break;
+      case 'D':
+      case 'E':
+        c.datatype=TDOUBLE;
+        break;
+      case 'K':
+      case 'J':
+      case 'I':
+        c.datatype=TLONGLONG;
+        break;
+      default:
+        throw "rmFITStable::addColumn unsupported TFORM";
+    }
+    if(c.repeat==0)
+      throw "rmFITStable::addColumn repeat count is 0";
+
+    columns.push_back(c);
+
+    return columns.size()-1;
+  }
+
+  //_____________________________________________________________________________
+  //                                                                       create
+
+  /*!
+    \brief Append the binary table HDU with the columns defined by addColumn
+
+    \param &extname - extension name of the table
+  */
+  void rmFITStable::create (const string &extname)
+  {
+    int status=0;
+    char fits_error_message[FLEN_STATUS];
+
+    if(created)
+      throw "rmFITStable::create table has already been created";
+    if(columns.size()==0)
+      throw "rmFITStable::create no columns defined";
+
+    vector<char*> ttype(columns.size()), tform(columns.size()), tunit(columns.size());
+    for(unsigned int c=0; c<columns.size(); c++)
+    {
+      ttype[c]=const_cast<char*>(columns[c].name.c_str());
+      tform[c]=const_cast<char*>(columns[c].tform.c_str());
+      tunit[c]=const_cast<char*>(columns[c].unit.c_str());
+
+      // stage buffers are allocated once and reused for every block
+      if(columns[c].vla)
+        columns[c].arrays.resize(bufferRows);
+      else if(columns[c].datatype==TDOUBLE)
+        columns[c].doubles.resize(bufferRows*columns[c].repeat, 0.0);
+      else
+        columns[c].integers.resize(bufferRows*columns[c].repeat, 0);
+    }
+
+    if(fits_create_tbl(fptr, BINARY_TBL, 0, columns.size(), &ttype[0], &tform[0],
+                       &tunit[0], const_cast<char*>(extname.c_str()), &status))
+    {
+      fits_get_errstatus(status, fits_error_message);
+      cerr << fits_error_message << endl;
+      throw "rmFITStable::create could not create table";
+    }
+
+    created=true;
+  }
+
+  //_____________________________________________________________________________
+  //                                                                     writeKey
+
+  /*!
+    \param &keyname - name of keyword (updated if it already exists)
+    \param value - value of keyword
+    \param &comment - comment of keyword (optional)
+  */
+  void rmFITStable::writeKey (const string &keyname,
+                              double value,
+                              const string &comment)
+  {
+    int status=0;
+    char fits_error_message[FLEN_STATUS];
+
+    if(!created)
+      throw "rmFITStable::writeKey table has not been created";
+
+    if(fits_update_key(fptr, TDOUBLE, const_cast<char*>(keyname.c_str()), &value,
+                       const_cast<char*>(comment.c_str()), &status))
+    {
+      fits_get_errstatus(status, fits_error_message);
+      cerr << fits_error_message << endl;
+      throw "rmFITStable::writeKey could not write keyword";
+    }
+  }
+
+  //_____________________________________________________________________________
+  //                                                                  checkColumn
+
+  /*!
+    \param col - (0-based) column index
+    \param array - column is set with setArray (variable- or fixed-length)
+  */
+  void rmFITStable::checkColumn (unsigned int col,
+                                 bool array)
+  {
+    if(!created)
+      throw "rmFITStable::checkColumn table has not been created";
+    if(col >= columns.size())
+      throw "rmFITStable::checkColumn column out of range";
+    if((columns[col].vla || columns[col].repeat > 1)!=array)
+      throw "rmFITStable::checkColumn column type does not match";
+  }
+
+  // ============================================================================
+  //
+  //  Row functions
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                                     setValue
+
+  /*!
+    \param col - (0-based) column index
+    \param value - value of column in the current row
+  */
+  void rmFITStable::setValue (unsigned int col,
+                              double value)
+  {
+    checkColumn(col, false);
+
+    if(columns[col].datatype==TDOUBLE)
+      columns[col].doubles[staged]=value;
+    else
+      columns[col].integers[staged]=static_cast<LONGLONG>(value);
+  }
+
+  //_____________________________________________________________________________
+  //                                                                   setInteger
+
+  /*!
+    \param col - (0-based) column index
+    \param value - value of column in the current row
+  */
+  void rmFITStable::setInteger (unsigned int col,
+                                int64_t value)
+  {
+    checkColumn(col, false);
+
+    if(columns[col].datatype==TLONGLONG)
+      columns[col].integers[staged]=value;
+    else
+      columns[col].doubles[staged]=static_cast<double>(value);
+  }
+
+  //_____________________________________________________________________________
+  //                                                                     setArray
+
+  /*!
+    \param col - (0-based) index of array column
+    \param &values - array of the current row, of the repeat count of a
+                     fixed-length column
+  */
+  void rmFITStable::setArray (unsigned int col,
+                              const vector<double> &values)
+  {
+    checkColumn(col, true);
+
+    column &c=columns[col];
+    if(c.vla)
+    {
+      c.arrays[staged]=values;
+      return;
+    }
+    if(static_cast<LONGLONG>(values.size())!=c.repeat)
+      throw "rmFITStable::setArray array length differs from repeat count";
+    if(c.datatype==TDOUBLE)
+      copy(values.begin(), values.end(), c.doubles.begin()+staged*c.repeat);
+    else
+      for(LONGLONG i=0; i<c.repeat; i++)
+        c.integers[staged*c.repeat+i]=static_cast<LONGLONG>(values[i]);
+  }
+
+  //_____________________________________________________________________________
+  //                                                                      nextRow
+
+  void rmFITStable::nextRow ()
+  {
+    if(!created)
+      throw "rmFITStable::nextRow table has not been created";
+
+    staged++;
+    if(staged==bufferRows)
+      flush();
+
+    // columns not set in the next row default to 0 / empty arrays
+    for(unsigned int c=0; c<columns.size(); c++)
+    {
+      column &col=columns[c];
+      if(col.vla)
+        col.arrays[staged].clear();
+      else if(col.datatype==TDOUBLE)
+        fill(col.doubles.begin()+staged*col.repeat, col.doubles.begin()+(staged+1)*col.repeat, 0.0);
+      else
+        fill(col.integers.begin()+staged*col.repeat, col.integers.begin()+(staged+1)*col.repeat, 0);
+    }
+  }
+
+  //_____________________________________________________________________________
+  //                                                                        flush
+
+  /*!
+    \brief Write all staged rows: one call per scalar or fixed-length vector
+    column, one call per row of a variable-length array column; rows with only empty arrays are
+    inserted, so the table always has getNumRows() rows
+  */
+  void rmFITStable::flush ()
+  {
+    int status=0;
+    char fits_error_message[FLEN_STATUS];
+
+    if(!created || staged==0)
+      return;
+
+    LONGLONG firstrow=written+1;
+    for(unsigned int c=0; c<columns.size() && status==0; c++)
+    {
+      column &col=columns[c];
+      if(col.vla)
+      {
+        for(uint64_t r=0; r<staged && status==0; r++)
+        {
+          if(col.arrays[r].size() > 0)
+            fits_write_col(fptr, TDOUBLE, c+1, firstrow+r, 1, col.arrays[r].size(),
+                           &col.arrays[r][0], &status);
+        }
+      }
+      else if(col.datatype==TDOUBLE)
+        fits_write_col(fptr, TDOUBLE, c+1, firstrow, 1, staged*col.repeat, &col.doubles[0], &status);
+      else
+        fits_write_col(fptr, TLONGLONG, c+1, firstrow, 1, staged*col.repeat, &col.integers[0], &status);
+    }
+
+    // rows whose arrays are all empty got no write, extend the table to them
+    // (inserted rows have zero-length array descriptors)
+    LONGLONG nrows=0;
+    if(status==0 && fits_get_num_rowsll(fptr, &nrows, &status)==0 &&
+       nrows < firstrow+static_cast<LONGLONG>(staged)-1)
+      fits_insert_rows(fptr, nrows, firstrow+staged-1-nrows, &status);
+
+    if(status)
+    {
+      fits_get_errstatus(status, fits_error_message);
+      cerr << fits_error_message << endl;
+      throw "rmFITStable::flush could not write rows";
+    }
+
+    written+=staged;
+    staged=0;
+  }
+
+  //_____________________________________________________________________________
+  //                                                                        close
+
+  void rmFITStable::close ()
+  {
+    int status=0;
+
+    if(fptr==NULL)
+      return;
+
+    flush();
+    fits_close_file(fptr, &status);
+    fptr=NULL;
+    if(status)
+      throw "rmFITStable::close error while closing";
+  }
+
+  // ============================================================================
+  //
+  //  RM catalog
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                                createCatalog
+
+  /*!
+    \brief Define the columns of an RM catalog (see rmCatalogEntry) and create
+    the table
+
+    \param &extname - extension name of catalog table (default RMCATALOG)
+  */
+  void rmFITStable::createCatalog (const string &extname)
+  {
+    if(columns.size()!=0)
+      throw "rmFITStable::createCatalog columns have already been defined";
+
+    addColumn("X", "K", "pixel");
+    addColumn("Y", "K", "pixel");
+    addColumn("RA", "D", "deg");
+    addColumn("DEC", "D", "deg");
+    addColumn("PEAK_RM", "D", "rad/m^2");
+    addColumn("PEAK_RM_ERR", "D", "rad/m^2");
+    addColumn("POLINT", "D", "Jy/beam");
+    addColumn("POLINT_ERR", "D", "Jy/beam");
+    addColumn("ANGLE", "D", "rad");
+    addColumn("ANGLE_ERR", "D", "rad");
+    addColumn("CC_PHI", "1PD", "rad/m^2");
+    addColumn("CC_Q", "1PD", "Jy/beam");
+    addColumn("CC_U", "1PD", "Jy/beam");
+
+    create(extname);
+    catalog=true;
+  }
+
+  //_____________________________________________________________________________
+  //                                                            writeCatalogEntry
+
+  /*!
+    \param &entry - catalog entry to append as a row
+  */
+  void rmFITStable::writeCatalogEntry (const rmCatalogEntry &entry)
+  {
+    if(!catalog)
+      throw "rmFITStable::writeCatalogEntry table is not a catalog";
+    if(entry.ccQ.size()!=entry.ccPhi.size() || entry.ccU.size()!=entry.ccPhi.size())
+      throw "rmFITStable::writeCatalogEntry CLEAN component lists differ in length";
+
+    setInteger(0, entry.x);
+    setInteger(1, entry.y);
+    setValue(2, entry.ra);
+    setValue(3, entry.dec);
+    setValue(4, entry.peakRM);
+    setValue(5, entry.peakRMerr);
+    setValue(6, entry.polInt);
+    setValue(7, entry.polIntErr);
+    setValue(8, entry.angle);
+    setValue(9, entry.angleErr);
+    setArray(10, entry.ccPhi);
+    setArray(11, entry.ccQ);
+    setArray(12, entry.ccU);
+    nextRow();
+  }
+
+}  // END -- namespace RM
@@ -21,36 +21,145 @@
 #ifndef RMFITS_TABLE_H
 #define RMFITS_TABLE_H
 
+#include <string>
+#include <vector>
+#include <stdint.h>
 
+// CFITSIO header files
+#include <fitsio.h>
 
 namespace RM {
-	
-	/*!
-	 \class rmFITStable
-    
+
+  /*!
+    \brief One source of an RM catalog (one row of a catalog table)
+  */
+  struct rmCatalogEntry {
+    //! (1-based) pixel position
+    int64_t x, y;
+    //! celestial position in degrees
+    double ra, dec;
+    //! Faraday depth of the peak and its error (rad/m^2)
+    double peakRM, peakRMerr;
+    //! polarized intensity |P| at the peak and its error
+    double polInt, polIntErr;
+    //! polarization angle at the peak and its error (rad)
+    double angle, angleErr;
+    //! CLEAN components: Faraday depth, Q and U of each component
+    std::vector<double> ccPhi, ccQ, ccU;
+  };
+
+  /*!
+    \class rmFITStable
+
     \ingroup RM
-    
+
     \brief DAL class to provide access to FITS tables
-    
+
     \author Sven Duscha
-    
+
     \test trmFITStable.cpp
-	*/
-	
-	
-	class rmFITStable {
-		
-	private:
-		
-		
-		
-	public:
-		
-		
-	}
-	
-	
-	
-	
-	
-#endif
\ No newline at end of file
+
+    Column-oriented binary table writer. Rows are staged per column in memory
+    and written in blocks of bufferRows with one fits_write_col call per
+    scalar or fixed-length vector column (TFORM e.g. 300D). Variable-length
+    array columns (TFORM PD/PE) go to the heap, one array per row.
+  */
+  class rmFITStable {
+
+  private:
+
+    //! staged column
+    struct column {
+      std::string name;
+      std::string tform;
+      std::string unit;
+      //! cfitsio data type values are written with (TDOUBLE or TLONGLONG)
+      int datatype;
+      //! variable-length array column
+      bool vla;
+      //! number of values per cell of a fixed-length column (1 for scalars)
+      LONGLONG repeat;
+      std::vector<double> doubles;
+      std::vector<LONGLONG> integers;
+      std::vector<std::vector<double> > arrays;
+    };
+
+    //! cfitsio file handle
+    fitsfile *fptr;
+    //! table columns
+    std::vector<column> columns;
+    //! table HDU has been created
+    bool created;
+    //! number of rows staged
+    uint64_t staged;
+    //! number of rows already written to the file
+    uint64_t written;
+    //! number of rows staged before a block write
+    uint64_t bufferRows;
+    //! table has the standard catalog columns
+    bool catalog;
+
+    void checkColumn (unsigned int col,
+                      bool array);
+
+    // no copies of the file handle
+    rmFITStable (const rmFITStable &);
+    rmFITStable &operator= (const rmFITStable &);
+
+  public:
+
+    // === Construction =========================================================
+
+    //! Open (or create) filename for table output
+    rmFITStable (const std::string &filename,
+                 bool overwrite=true,
+                 uint64_t bufferRows=65536);
+
+    // === Destruction ==========================================================
+
+    //! Destructor, writes remaining rows and closes the file
+    ~rmFITStable ();
+
+    // === Methods ==============================================================
+
+    //! Define a column (before create), returns its (0-based) index
+    unsigned int addColumn (const std::string &name,
+                            const std::string &tform,
+                            const std::string &unit="");
+    //! Append the binary table HDU with the defined columns
+    void create (const std::string &extname);
+
+    //! Write a numeric keyword into the table header (after create)
+    void writeKey (const std::string &keyname,
+                   double value,
+                   const std::string &comment="");
+
+    //! Set a scalar value of the current row
+    void setValue (unsigned int col,
+                   double value);
+    //! Set an integer value of the current row
+    void setInteger (unsigned int col,
+                     int64_t value);
+    //! Set the (variable- or fixed-length) array of the current row
+    void setArray (unsigned int col,
+                   const std::vector<double> &values);
+    //! Finish the current row, write the block if the buffer is full
+    void nextRow ();
+
+    //! Define the standard RM catalog columns and create the table
+    void createCatalog (const std::string &extname="RMCATALOG");
+    //! Append one catalog entry (table must have been made by createCatalog)
+    void writeCatalogEntry (const rmCatalogEntry &entry);
+
+    //! Write all staged rows to the file
+    void flush ();
+    //! Write remaining rows and close the file
+    void close ();
+
+    //! Get the number of rows (written and staged)
+    inline uint64_t getNumRows () const { return written+staged; }
+  };
+
+}  // END -- namespace RM
+
+#endif
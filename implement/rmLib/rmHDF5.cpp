@@ -0,0 +1,635 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifdef HAVE_HDF5
+
+#include <algorithm>
+#include "rmHDF5.h"
+
+using namespace std;
+
+namespace RM {
+
+  // ============================================================================
+  //
+  //  Construction / Destruction
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                                      rmHDF5
+
+  rmHDF5::rmHDF5 ()
+  {
+    file_id      = -1;
+    cube_id      = -1;
+    iomode       = 0;
+    xSize        = 0;
+    ySize        = 0;
+    faradaySize  = 0;
+    tileX        = 32;    // default chunk: 32x32 pixels x all Faraday depths
+    tileY        = 32;
+    deflateLevel = 0;     // default: no compression
+    shuffle      = true;
+    cacheLimit   = 256UL << 20;   // default: one row of chunks, at most 256 MiB
+
+    // complex<double> is layed out as double[2] {real, imag}
+    complex_id = H5Tcreate(H5T_COMPOUND, sizeof(complex<double>));
+    H5Tinsert(complex_id, "r", 0, H5T_NATIVE_DOUBLE);
+    H5Tinsert(complex_id, "i", sizeof(double), H5T_NATIVE_DOUBLE);
+  }
+
+  //_____________________________________________________________________________
+  //                                                                      rmHDF5
+
+  /*!
+    \param &filename - filename of HDF5 file
+    \param iomode - READONLY (0), READWRITE (1) or CREATE (2)
+  */
+  rmHDF5::rmHDF5 (const string &filename,
+                  int iomode)
+  {
+    file_id      = -1;
+    cube_id      = -1;
+    xSize        = 0;
+    ySize        = 0;
+    faradaySize  = 0;
+    tileX        = 32;
+    tileY        = 32;
+    deflateLevel = 0;
+    shuffle      = true;
+    cacheLimit   = 0;
+
+    complex_id = H5Tcreate(H5T_COMPOUND, sizeof(complex<double>));
+    H5Tinsert(complex_id, "r", 0, H5T_NATIVE_DOUBLE);
+    H5Tinsert(complex_id, "i", sizeof(double), H5T_NATIVE_DOUBLE);
+
+    if(iomode==2)
+    {
+      create(filename);
+    }
+    else
+    {
+      open(filename, iomode);
+    }
+  }
+
+  //_____________________________________________________________________________
+  //                                                                     ~rmHDF5
+
+  rmHDF5::~rmHDF5 ()
+  {
+    close();
+    H5Tclose(complex_id);
+  }
+
+  // ============================================================================
+  //
+  //  File access
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                                        open
+
+  /*!
+    \brief Open an existing HDF5 file and its Faraday cube (if present)
+
+    \param &filename - filename of HDF5 file
+    \param iomode - READONLY (0) or READWRITE (1)
+  */
+  void rmHDF5::open (const string &filename,
+                     int iomode)
+  {
+    close();
+
+    this->iomode=iomode;
+    file_id=H5Fopen(filename.c_str(), iomode ? H5F_ACC_RDWR : H5F_ACC_RDONLY, H5P_DEFAULT);
+    if(file_id < 0)
+    {
+      throw "rmHDF5::open could not open file";
+    }
+
+    if(H5Lexists(file_id, "FaradayCube", H5P_DEFAULT) > 0)
+    {
+      openFaradayCube();
+    }
+  }
+
+  //_____________________________________________________________________________
+  //                                                                      create
+
+  /*!
+    \brief Create a new HDF5 file, an existing file is truncated
+
+    \param &filename - filename of HDF5 file
+  */
+  void rmHDF5::create (const string &filename)
+  {
+    close();
+
+    iomode=1;
+    file_id=H5Fcreate(filename.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+    if(file_id < 0)
+    {
+      throw "rmHDF5::create could not create file";
+    }
+  }
+
+  //_____________________________________________________________________________
+  //                                                                       close
+
+  void rmHDF5::close ()
+  {
+    if(cube_id >= 0)
+    {
+      H5Dclose(cube_id);
+      cube_id=-1;
+    }
+    if(file_id >= 0)
+    {
+      H5Fclose(file_id);
+      file_id=-1;
+    }
+  }
+
+  //_____________________________________________________________________________
+  //                                                               setChunkShape
+
+  /*!
+    \brief Set the pixel tile of a chunk; a chunk always spans all Faraday depths
+
+    \param tileX - chunk size in x
+    \param tileY - chunk size in y
+  */
+  void rmHDF5::setChunkShape (unsigned long tileX,
+                              unsigned long tileY)
+  {
+    if(tileX==0 || tileY==0)
+    {
+      throw "rmHDF5::setChunkShape chunk size is 0";
+    }
+
+    this->tileX=tileX;
+    this->tileY=tileY;
+  }
+
+  //_____________________________________________________________________________
+  //                                                              setCompression
+
+  /*!
+    \brief Set compression filters applied to each chunk
+
+    \param level - deflate level 0-9 (0=no compression)
+    \param shuffle - apply byte shuffle filter before deflate
+  */
+  void rmHDF5::setCompression (int level,
+                               bool shuffle)
+  {
+    if(level < 0 || level > 9)
+    {
+      throw "rmHDF5::setCompression deflate level out of range 0-9";
+    }
+    if(level > 0 && H5Zfilter_avail(H5Z_FILTER_DEFLATE) <= 0)
+    {
+      throw "rmHDF5::setCompression deflate filter not available";
+    }
+
+    deflateLevel=level;
+    this->shuffle=shuffle;
+  }
+
+  // ============================================================================
+  //
+  //  Faraday cube access
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                           createFaradayCube
+
+  /*!
+    \brief Create the complex Faraday cube dataset and write the Faraday depths
+
+    \param xSize - x dimension of cube
+    \param ySize - y dimension of cube
+    \param &faradayDepths - Faraday depths (defines Faraday dimension)
+  */
+  void rmHDF5::createFaradayCube (unsigned long xSize,
+                                  unsigned long ySize,
+                                  const vector<double> &faradayDepths)
+  {
+    if(file_id < 0)
+    {
+      throw "rmHDF5::createFaradayCube no file open";
+    }
+    if(xSize==0 || ySize==0 || faradayDepths.size()==0)
+    {
+      throw "rmHDF5::createFaradayCube cube dimension is 0";
+    }
+
+    this->xSize=xSize;
+    this->ySize=ySize;
+    faradaySize=faradayDepths.size();
+
+    hsize_t dims[3]={faradaySize, ySize, xSize};
+    hsize_t chunk[3]={faradaySize, min(tileY, this->ySize), min(tileX, this->xSize)};
+
+    hid_t dcpl=H5Pcreate(H5P_DATASET_CREATE);
+    H5Pset_chunk(dcpl, 3, chunk);
+    if(deflateLevel > 0)
+    {
+      if(shuffle)
+        H5Pset_shuffle(dcpl);
+      H5Pset_deflate(dcpl, deflateLevel);
+    }
+
+    hid_t dapl=cubeAccessList(chunk);
+
+    hid_t space=H5Screate_simple(3, dims, NULL);
+    if(cube_id >= 0)
+      H5Dclose(cube_id);
+    cube_id=H5Dcreate2(file_id, "FaradayCube", complex_id, space, H5P_DEFAULT, dcpl, dapl);
+    H5Sclose(space);
+    H5Pclose(dapl);
+    H5Pclose(dcpl);
+
+    if(cube_id < 0)
+    {
+      throw "rmHDF5::createFaradayCube could not create dataset";
+    }
+
+    // Faraday depth axis
+    hsize_t nphi=faradaySize;
+    space=H5Screate_simple(1, &nphi, NULL);
+    hid_t phi_id=H5Dcreate2(file_id, "FaradayDepths", H5T_NATIVE_DOUBLE, space, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+    herr_t status=H5Dwrite(phi_id, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, &faradayDepths[0]);
+    H5Dclose(phi_id);
+    H5Sclose(space);
+
+    if(status < 0)
+    {
+      throw "rmHDF5::createFaradayCube could not write Faraday depths";
+    }
+  }
+
+  //_____________________________________________________________________________
+  //                                                             openFaradayCube
+
+  void rmHDF5::openFaradayCube ()
+  {
+    if(file_id < 0)
+    {
+      throw "rmHDF5::openFaradayCube no file open";
+    }
+
+    if(cube_id >= 0)
+      H5Dclose(cube_id);
+    cube_id=H5Dopen2(file_id, "FaradayCube", H5P_DEFAULT);
+    if(cube_id < 0)
+    {
+      throw "rmHDF5::openFaradayCube could not open dataset";
+    }
+
+    hid_t space=H5Dget_space(cube_id);
+    hsize_t dims[3];
+    if(H5Sget_simple_extent_ndims(space)!=3)
+    {
+      H5Sclose(space);
+      throw "rmHDF5::openFaradayCube dataset is not 3-dimensional";
+    }
+    H5Sget_simple_extent_dims(space, dims, NULL);
+    H5Sclose(space);
+
+    faradaySize=dims[0];
+    ySize=dims[1];
+    xSize=dims[2];
+
+    // the cache is set at open time, reopen with one sized to the chunk shape
+    hid_t dcpl=H5Dget_create_plist(cube_id);
+    hsize_t chunk[3];
+    if(H5Pget_layout(dcpl)==H5D_CHUNKED && H5Pget_chunk(dcpl, 3, chunk)==3)
+    {
+      hid_t dapl=cubeAccessList(chunk);
+      H5Dclose(cube_id);
+      cube_id=H5Dopen2(file_id, "FaradayCube", dapl);
+      H5Pclose(dapl);
+    }
+    H5Pclose(dcpl);
+    if(cube_id < 0)
+    {
+      throw "rmHDF5::openFaradayCube could not open dataset";
+    }
+  }
+
+  //_____________________________________________________________________________
+  //                                                              cubeAccessList
+
+  /*!
+    \brief Dataset access property list whose chunk cache holds one row of
+    chunks of the cube (capped at cacheLimit)
+
+    A row of chunks is what a band of tiles (writeTile, readTile) touches.
+    Every chunk holds all Faraday depths, so caching all chunks of a plane
+    would hold the whole uncompressed cube in memory.
+
+    \param *chunk - chunk shape [faraday][y][x] of the cube dataset
+
+    \return dapl - property list, to be closed by the caller
+  */
+  hid_t rmHDF5::cubeAccessList (const hsize_t *chunk) const
+  {
+    const hsize_t chunkBytes=chunk[0]*chunk[1]*chunk[2]*sizeof(complex<double>);
+    hsize_t bytes=((xSize+chunk[2]-1)/chunk[2])*chunkBytes;
+    if(cacheLimit > 0 && bytes > cacheLimit)
+      bytes=cacheLimit;
+    const hsize_t nchunks=std::max<hsize_t>(bytes/chunkBytes, 1);
+
+    // HDF5 recommends about 100 hash slots per cached chunk: take the
+    // smallest prime above 100*nchunks
+    size_t nslots=static_cast<size_t>(100*nchunks)+1;
+    size_t d=3;
+    while(d*d <= nslots)
+    {
+      if(nslots % d==0)
+      {
+        nslots+=2;
+        d=3;
+      }
+      else
+        d+=2;
+    }
+
+    hid_t dapl=H5Pcreate(H5P_DATASET_ACCESS);
+    H5Pset_chunk_cache(dapl, nslots, bytes, 1.0);
+    return dapl;
+  }
+
+  //_____________________________________________________________________________
+  //                                                              cubeHyperslab
+
+  /*!
+    \brief Read or write a contiguous buffer [nz][ny][nx] from/to the cube
+
+    \param *buffer - buffer of nx*ny*nz complex values
+    \param x0, y0, z0 - start position in cube
+    \param nx, ny, nz - size of hyperslab
+    \param write - write (true) or read (false)
+  */
+  void rmHDF5::cubeHyperslab (complex<double> *buffer,
+                              hsize_t x0, hsize_t y0, hsize_t z0,
+                              hsize_t nx, hsize_t ny, hsize_t nz,
+                              bool write)
+  {
+    if(cube_id < 0)
+    {
+      throw "rmHDF5::cubeHyperslab no Faraday cube open";
+    }
+    if(x0+nx > xSize || y0+ny > ySize || z0+nz > faradaySize)
+    {
+      throw "rmHDF5::cubeHyperslab selection exceeds cube dimensions";
+    }
+
+    hsize_t start[3]={z0, y0, x0};
+    hsize_t count[3]={nz, ny, nx};
+
+    hid_t filespace=H5Dget_space(cube_id);
+    H5Sselect_hyperslab(filespace, H5S_SELECT_SET, start, NULL, count, NULL);
+    hid_t memspace=H5Screate_simple(3, count, NULL);
+
+    herr_t status;
+    if(write)
+      status=H5Dwrite(cube_id, complex_id, memspace, filespace, H5P_DEFAULT, buffer);
+    else
+      status=H5Dread(cube_id, complex_id, memspace, filespace, H5P_DEFAULT, buffer);
+
+    H5Sclose(memspace);
+    H5Sclose(filespace);
+
+    if(status < 0)
+    {
+      throw "rmHDF5::cubeHyperslab HDF5 read/write failed";
+    }
+  }
+
+  //_____________________________________________________________________________
+  //                                                                  writePlane
+
+  /*!
+    \param *plane - complex plane of xSize*ySize values
+    \param z - Faraday depth index
+  */
+  void rmHDF5::writePlane (const complex<double> *plane,
+                           unsigned long z)
+  {
+    cubeHyperslab(const_cast<complex<double> *>(plane), 0, 0, z, xSize, ySize, 1, true);
+  }
+
+  //_____________________________________________________________________________
+  //                                                                   readPlane
+
+  /*!
+    \param *plane - complex plane of xSize*ySize values
+    \param z - Faraday depth index
+  */
+  void rmHDF5::readPlane (complex<double> *plane,
+                          unsigned long z)
+  {
+    cubeHyperslab(plane, 0, 0, z, xSize, ySize, 1, false);
+  }
+
+  //_____________________________________________________________________________
+  //                                                                   writeTile
+
+  /*!
+    \brief Write a tile [faradaySize][ny][nx]; tiles aligned to the chunk shape
+    are written without touching any other chunk
+
+    \param *tile - complex tile buffer
+    \param x, y - pixel position of lower left corner of tile
+    \param nx, ny - tile size
+  */
+  void rmHDF5::writeTile (const complex<double> *tile,
+                          unsigned long x,
+                          unsigned long y,
+                          unsigned long nx,
+                          unsigned long ny)
+  {
+    cubeHyperslab(const_cast<complex<double> *>(tile), x, y, 0, nx, ny, faradaySize, true);
+  }
+
+  //_____________________________________________________________________________
+  //                                                                    readTile
+
+  void rmHDF5::readTile (complex<double> *tile,
+                         unsigned long x,
+                         unsigned long y,
+                         unsigned long nx,
+                         unsigned long ny)
+  {
+    cubeHyperslab(tile, x, y, 0, nx, ny, faradaySize, false);
+  }
+
+  //_____________________________________________________________________________
+  //                                                                   writeLine
+
+  void rmHDF5::writeLine (const complex<double> *line,
+                          unsigned long x,
+                          unsigned long y)
+  {
+    cubeHyperslab(const_cast<complex<double> *>(line), x, y, 0, 1, 1, faradaySize, true);
+  }
+
+  //_____________________________________________________________________________
+  //                                                                    readLine
+
+  /*!
+    \brief Read a Faraday spectrum at pixel x, y (touches exactly one chunk)
+
+    \param *line - buffer of faradaySize complex values
+    \param x, y - pixel position
+  */
+  void rmHDF5::readLine (complex<double> *line,
+                         unsigned long x,
+                         unsigned long y)
+  {
+    cubeHyperslab(line, x, y, 0, 1, 1, faradaySize, false);
+  }
+
+  //_____________________________________________________________________________
+  //                                                           readFaradayDepths
+
+  vector<double> rmHDF5::readFaradayDepths ()
+  {
+    if(file_id < 0)
+    {
+      throw "rmHDF5::readFaradayDepths no file open";
+    }
+
+    hid_t phi_id=H5Dopen2(file_id, "FaradayDepths", H5P_DEFAULT);
+    if(phi_id < 0)
+    {
+      throw "rmHDF5::readFaradayDepths could not open dataset";
+    }
+
+    hid_t space=H5Dget_space(phi_id);
+    vector<double> faradayDepths(H5Sget_simple_extent_npoints(space));
+    H5Sclose(space);
+
+    herr_t status=H5Dread(phi_id, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, &faradayDepths[0]);
+    H5Dclose(phi_id);
+
+    if(status < 0)
+    {
+      throw "rmHDF5::readFaradayDepths could not read dataset";
+    }
+
+    return faradayDepths;
+  }
+
+  // ============================================================================
+  //
+  //  Derived maps
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                                    writeMap
+
+  /*!
+    \param &name - name of the map dataset (e.g. "PeakRM")
+    \param *map - map of xSize*ySize values
+  */
+  void rmHDF5::writeMap (const string &name,
+                         const double *map)
+  {
+    if(file_id < 0)
+    {
+      throw "rmHDF5::writeMap no file open";
+    }
+    if(xSize==0 || ySize==0)
+    {
+      throw "rmHDF5::writeMap cube dimensions unknown";
+    }
+
+    hsize_t dims[2]={ySize, xSize};
+    hsize_t chunk[2]={min(tileY, ySize), min(tileX, xSize)};
+
+    hid_t dcpl=H5Pcreate(H5P_DATASET_CREATE);
+    H5Pset_chunk(dcpl, 2, chunk);
+    if(deflateLevel > 0)
+    {
+      if(shuffle)
+        H5Pset_shuffle(dcpl);
+      H5Pset_deflate(dcpl, deflateLevel);
+    }
+
+    hid_t space=H5Screate_simple(2, dims, NULL);
+    hid_t map_id;
+    if(H5Lexists(file_id, name.c_str(), H5P_DEFAULT) > 0)
+      map_id=H5Dopen2(file_id, name.c_str(), H5P_DEFAULT);
+    else
+      map_id=H5Dcreate2(file_id, name.c_str(), H5T_NATIVE_DOUBLE, space, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+    H5Sclose(space);
+    H5Pclose(dcpl);
+
+    if(map_id < 0)
+    {
+      throw "rmHDF5::writeMap could not create dataset";
+    }
+
+    herr_t status=H5Dwrite(map_id, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, map);
+    H5Dclose(map_id);
+
+    if(status < 0)
+    {
+      throw "rmHDF5::writeMap could not write dataset";
+    }
+  }
+
+  //_____________________________________________________________________________
+  //                                                                     readMap
+
+  void rmHDF5::readMap (const string &name,
+                        double *map)
+  {
+    if(file_id < 0)
+    {
+      throw "rmHDF5::readMap no file open";
+    }
+
+    hid_t map_id=H5Dopen2(file_id, name.c_str(), H5P_DEFAULT);
+    if(map_id < 0)
+    {
+      throw "rmHDF5::readMap could not open dataset";
+    }
+
+    herr_t status=H5Dread(map_id, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, map);
+    H5Dclose(map_id);
+
+    if(status < 0)
+    {
+      throw "rmHDF5::readMap could not read dataset";
+    }
+  }
+
+}  // END -- namespace RM
+
+#endif  // HAVE_HDF5
@@ -0,0 +1,195 @@
+/***************************************************************************
+*   Copyright (C) 2010                                                    *
+*   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+*                                                                         *
+*   This program is free software; you can redistribute it and/or modify  *
+*   it under the terms of the GNU General Public License as published by  *
+*   the Free Software Foundation; either version 2 of the License, or     *
+*   (at your option) any later version.                                   *
+*                                                                         *
+*   This program is distributed in the hope that it will be useful,       *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+*   GNU General Public License for more details.                          *
+*                                                                         *
+*   You should have received a copy of the GNU General Public License     *
+*   along with this program; if not, write to the                         *
+*   Free Software Foundation, Inc.,                                       *
+*   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+***************************************************************************/
+
+#ifndef RMHDF5_H
+#define RMHDF5_H
+
+#ifdef HAVE_HDF5
+
+// C++ Standard library
+#include <string>
+#include <vector>
+#include <complex>
+#include <stdint.h>
+
+// HDF5 header files
+#include <hdf5.h>
+
+namespace RM {
+
+  /*!
+    \class rmHDF5
+
+    \ingroup RM
+
+    \brief HDF5 storage of Faraday cubes and derived maps
+
+    \author Sven Duscha
+
+    \test trmHDF5.cpp
+
+    <h3>Synopsis</h3>
+
+    A Faraday cube is stored as a single dataset \e /FaradayCube of shape
+    [faradaySize][ySize][xSize] with a compound complex element {r, i}
+    (the same layout as h5py/numpy complex128). The dataset is chunked as
+    [faradaySize][tileY][tileX], i.e. every chunk holds all Faraday depths
+    of a small pixel tile, so that reading one line-of-sight only touches
+    one chunk. Chunks can optionally be compressed with the shuffle and
+    deflate filters. The Faraday depths are written to \e /FaradayDepths,
+    derived 2D maps (e.g. peak RM, polarized intensity) to named datasets
+    of shape [ySize][xSize].
+
+    Every chunk holds all Faraday depths, so a plane touches all chunks of
+    the cube. The chunk cache of the cube holds one row of chunks (the
+    chunks a band of tiles touches), at most setChunkCacheLimit bytes
+    (256 MiB by default). Cubes should therefore be written with writeTile
+    in bands of tileY rows: writing plane by plane with writePlane evicts,
+    re-reads and re-filters every chunk once per Faraday depth.
+  */
+  class rmHDF5 {
+
+  private:
+    //! HDF5 file handle
+    hid_t file_id;
+    //! Faraday cube dataset handle
+    hid_t cube_id;
+    //! compound datatype for complex<double> {r, i}
+    hid_t complex_id;
+    //! I/O mode of file (READONLY=0, READWRITE=1)
+    int iomode;
+
+    //! Faraday cube dimensions
+    hsize_t xSize, ySize, faradaySize;
+    //! chunk (tile) size in x and y, all Faraday depths are in one chunk
+    hsize_t tileX, tileY;
+    //! deflate level (0=no compression)
+    int deflateLevel;
+    //! use shuffle filter in front of deflate
+    bool shuffle;
+    //! upper limit of the chunk cache in bytes (0 = one row of chunks, no limit)
+    size_t cacheLimit;
+
+    // no copies of the HDF5 handles
+    rmHDF5 (const rmHDF5 &);
+    rmHDF5 &operator= (const rmHDF5 &);
+
+    //! Dataset access property list with a chunk cache for one row of chunks
+    hid_t cubeAccessList (const hsize_t *chunk) const;
+
+    //! Read/write a hyperslab [z0..z0+nz][y0..y0+ny][x0..x0+nx] of the cube
+    void cubeHyperslab(std::complex<double> *buffer,
+                       hsize_t x0, hsize_t y0, hsize_t z0,
+                       hsize_t nx, hsize_t ny, hsize_t nz,
+                       bool write);
+
+  public:
+
+    // === Construction =========================================================
+
+    //! Default constructor
+    rmHDF5 ();
+    //! Constructor opening (iomode 0/1) or creating (iomode 2) a file
+    rmHDF5 (const std::string &filename,
+            int iomode);
+
+    // === Destruction ==========================================================
+
+    //! Destructor, closes file
+    ~rmHDF5 ();
+
+    // === Methods ==============================================================
+
+    //! open an existing HDF5 file for read (0) or readwrite (1)
+    void open (const std::string &filename,
+               int iomode);
+    //! create a new HDF5 file (truncates existing file)
+    void create (const std::string &filename);
+    //! close HDF5 file handles
+    void close ();
+
+    //! Set chunk shape in pixels (all Faraday depths are in one chunk)
+    void setChunkShape (unsigned long tileX,
+                        unsigned long tileY);
+    //! Set compression filters: deflate level 0-9 (0=off), shuffle on/off
+    void setCompression (int level,
+                         bool shuffle=true);
+    //! Cap the chunk cache of the cube at bytes (default 256 MiB, 0 = one row of chunks)
+    inline void setChunkCacheLimit (size_t bytes) { cacheLimit=bytes; }
+
+    //! Create the complex Faraday cube dataset and the Faraday depth axis
+    void createFaradayCube (unsigned long xSize,
+                            unsigned long ySize,
+                            const std::vector<double> &faradayDepths);
+    //! Open an existing Faraday cube dataset and read its dimensions
+    void openFaradayCube ();
+
+    //! Write a complex plane at Faraday depth index z (slow for large cubes, see writeTile)
+    void writePlane (const std::complex<double> *plane,
+                     unsigned long z);
+    //! Read a complex plane at Faraday depth index z
+    void readPlane (std::complex<double> *plane,
+                    unsigned long z);
+    //! Write a tile of all Faraday depths [faradaySize][ny][nx] at x, y
+    void writeTile (const std::complex<double> *tile,
+                    unsigned long x,
+                    unsigned long y,
+                    unsigned long nx,
+                    unsigned long ny);
+    //! Read a tile of all Faraday depths [faradaySize][ny][nx] at x, y
+    void readTile (std::complex<double> *tile,
+                   unsigned long x,
+                   unsigned long y,
+                   unsigned long nx,
+                   unsigned long ny);
+    //! Write a Faraday spectrum (line-of-sight) at pixel x, y
+    void writeLine (const std::complex<double> *line,
+                    unsigned long x,
+                    unsigned long y);
+    //! Read a Faraday spectrum (line-of-sight) at pixel x, y
+    void readLine (std::complex<double> *line,
+                   unsigned long x,
+                   unsigned long y);
+
+    //! Read Faraday depths axis of the cube
+    std::vector<double> readFaradayDepths ();
+
+    //! Write a derived 2D map (e.g. "PeakRM") of cube dimensions
+    void writeMap (const std::string &name,
+                   const double *map);
+    //! Read a derived 2D map of cube dimensions
+    void readMap (const std::string &name,
+                  double *map);
+
+    // === Member access ========================================================
+
+    //! Get x dimension of Faraday cube
+    inline uint64_t getX () const { return xSize; }
+    //! Get y dimension of Faraday cube
+    inline uint64_t getY () const { return ySize; }
+    //! Get number of Faraday depths of Faraday cube
+    inline uint64_t getFaradaySize () const { return faradaySize; }
+  };
+
+}  // END -- namespace RM
+
+#endif  // HAVE_HDF5
+
+#endif
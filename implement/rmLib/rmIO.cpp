@@ -20,27 +20,190 @@
 
 #include <iostream>				// C++/STL iostream
 #include <fstream>				// file stream I/O
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
 #include "rmFITS.h"
+#include "rmNpy.h"
 #include "rmIO.h"
 
 using namespace std;
 
 namespace RM {  //  BEGIN -- namespace RM
 
+  //_____________________________________________________________________________
+  //                                                                    isNpyFile
+
+  //! filename has the extension of a NumPy binary array
+  static bool isNpyFile (const std::string &filename)
+  {
+    return filename.size() > 4 &&
+      (filename.compare(filename.size()-4, 4, ".npy")==0 ||
+       filename.compare(filename.size()-4, 4, ".NPY")==0);
+  }
+
+  //_____________________________________________________________________________
+  //                                                                  isSpaceChar
+
+  //! whitespace separating values in a text file (C locale)
+  static inline bool isSpaceChar (char c)
+  {
+    return c==' ' || c=='\t' || c=='\n' || c=='\r' || c=='\v' || c=='\f';
+  }
+
+  //_____________________________________________________________________________
+  //                                                                  readColumns
+
+  /*!
+    \brief Read ncolumns columns of values from a text or .npy file
+
+    A .npy file is memory mapped and each column is copied out of the mapping
+    (a complex array provides two columns, real and imaginary part). A text
+    file is read with a single fread, the values are counted in a first pass
+    to size the columns exactly, and then parsed in place with strtod, so
+    that no allocation happens per value.
+
+    \param &filename - name of file to read
+    \param ncolumns - number of columns per row
+    \param *columns[] - ncolumns vectors, resized to the number of rows
+  */
+  void rmIO::readColumns (const std::string &filename,
+			  unsigned int ncolumns,
+			  vector<double> *columns[])
+  {
+    if(isNpyFile(filename))
+      {
+	rmNpy array(filename);
+	if(array.getNumColumns()!=ncolumns)
+	  throw "rmIO::readColumns .npy array has wrong number of columns";
+	for(unsigned int c=0; c<ncolumns; c++)
+	  array.copyColumn(c, *columns[c]);
+	return;
+      }
+
+    FILE *file=fopen(filename.c_str(), "rb");
+    if(file==NULL)
+      throw "rmIO::readColumns failed to open file";
+
+    struct stat filestat;
+    if(fstat(fileno(file), &filestat))
+      {
+	fclose(file);
+	throw "rmIO::readColumns could not get file size";
+      }
+
+    vector<char> buffer(filestat.st_size+1);
+    size_t length=fread(&buffer[0], 1, filestat.st_size, file);
+    fclose(file);
+    buffer[length]='\0';
+
+    // count the values to size the columns once
+    uint64_t nvalues=0;
+    bool inValue=false;
+    for(size_t i=0; i<length; i++)
+      {
+	bool space=isSpaceChar(buffer[i]);
+	if(!space && !inValue)
+	  nvalues++;
+	inValue=!space;
+      }
+
+    if(nvalues % ncolumns)
+      throw "rmIO::readColumns number of values is not a multiple of the number of columns";
+
+    uint64_t nrows=nvalues/ncolumns;
+    for(unsigned int c=0; c<ncolumns; c++)
+      columns[c]->resize(nrows);
+
+    const char *p=&buffer[0];
+    for(uint64_t r=0; r<nrows; r++)
+      for(unsigned int c=0; c<ncolumns; c++)
+	{
+	  char *end=NULL;
+	  (*columns[c])[r]=strtod(p, &end);
+	  if(end==p || (*end!='\0' && !isSpaceChar(*end)))
+	    throw "rmIO::readColumns could not parse value";
+	  p=end;
+	}
+  }
+
+  //_____________________________________________________________________________
+  //                                                                 writeColumns
+
+  /*!
+    \brief Write ncolumns columns of values to a text or .npy file
+
+    Text files get one row per line with tab separated values formatted like
+    the default of an ostream (%g). A .npy file gets a float64 array of shape
+    (rows, ncolumns), or a complex128 array if complexData is set, in which
+    case pairs of columns are real and imaginary part.
+
+    \param &filename - name of file to write
+    \param ncolumns - number of columns
+    \param *columns[] - first value of each column
+    \param strides[] - distance between consecutive values of each column
+    \param rows - number of rows
+    \param complexData - write pairs of columns as complex128 to .npy
+  */
+  void rmIO::writeColumns (const std::string &filename,
+			   unsigned int ncolumns,
+			   const double *columns[],
+			   const unsigned int strides[],
+			   size_t rows,
+			   bool complexData)
+  {
+    if(isNpyFile(filename))
+      {
+	vector<double> table(rows*ncolumns);
+	for(size_t r=0; r<rows; r++)
+	  for(unsigned int c=0; c<ncolumns; c++)
+	    table[r*ncolumns+c]=columns[c][r*strides[c]];
+
+	const double *values=table.empty() ? NULL : &table[0];
+	if(complexData)
+	  rmNpy::write(filename, values, rows, ncolumns/2, true);
+	else
+	  rmNpy::write(filename, values, rows, ncolumns);
+	return;
+      }
+
+    FILE *file=fopen(filename.c_str(), "w");
+    if(file==NULL)
+      throw "rmIO::writeColumns failed to open file";
+
+    // format into a block buffer, 32 characters suffice for %g
+    const size_t blocksize=65536;
+    vector<char> buffer(blocksize+32*ncolumns);
+    size_t used=0;
+    bool ok=true;
+    for(size_t r=0; r<rows && ok; r++)
+      {
+	for(unsigned int c=0; c<ncolumns; c++)
+	  used+=sprintf(&buffer[used], (c+1<ncolumns) ? "%g\t" : "%g\n", columns[c][r*strides[c]]);
+	if(used >= blocksize)
+	  {
+	    ok=(fwrite(&buffer[0], 1, used, file)==used);
+	    used=0;
+	  }
+      }
+    if(used > 0 && ok)
+      ok=(fwrite(&buffer[0], 1, used, file)==used);
+
+    if(fclose(file)!=0 || !ok)
+      throw "rmIO::writeColumns failed to write file";
+  }
+
   //_____________________________________________________________________________
   //                                                              readFrequencies
   
   /*!
-    \brief Read the distribution of measured frequencies from a text file
+    \brief Read the distribution of measured frequencies from a text or .npy file
     
     \param filename -- name of txt file with frequency distribution
     \param frequencies -- vector with frequencies
   */
   void rmIO::readFrequencies(const std::string &filename, vector<double> &frequencies)
   {
-    //  vector<double> frequencies;		// hold list of lambda squareds
-    double frequency;			// individual lambda squared read per line
-    
     //----------------------------------------------------------
     // Check if filename is text file FITS file or HDF5 file
     if(filename.find(".hdf5", 1)!=string::npos)	// if HDF5 use dal
@@ -53,24 +216,10 @@ namespace RM {  //  BEGIN -- namespace RM
 	// TODO
 	// use rmFITSTable to read lambda Squareds and deltaLambdaSquareds from file
       }
-    else if(filename.find(".txt", 1)!=string::npos)	// if it is text file
+    else if(isNpyFile(filename) || filename.find(".txt", 1)!=string::npos)	// if it is .npy or text file
       {
-	ifstream infile(const_cast<const char*>(filename.c_str()), ifstream::in);	// open file for reading
-	
-	if(infile.fail())
-	  {
-	    throw "rmIO::readFrequencies failed to open file";
-	  }
-	
-	//	 unsigned int i=0;
-	frequencies.resize(0);
-	while(infile.good())	// as long as we can read from the file...
-	  {
-	    infile >> frequency;	// read double into temporary variable
-	    frequencies.push_back (frequency);	// push back into lambdaSquareds vector
-	  }
-	
-	infile.close();		// close the text file
+	vector<double> *columns[]={&frequencies};
+	readColumns(filename, 1, columns);
       }
   }
   
@@ -78,21 +227,18 @@ namespace RM {  //  BEGIN -- namespace RM
   //                                               readFrequenciesDiffFrequencies
   
   /*!
-    \brief Read the distribution of measured frequencies from a text file
+    \brief Read the distribution of measured frequencies from a text or .npy
+    file and compute the delta frequencies from their differences
     
     \param filename -- name of txt file with frequency distribution
     \param frequencies -- vector with frequencies
-    \param deltafreqs - vector to take delta frequencies (computed from difference)
+    \param deltafreqs - vector to take delta frequencies (difference to the
+    next frequency, the last channel repeats the previous difference)
   */
   void rmIO::readFrequenciesDiffFrequencies (const std::string &filename, 
 					     vector<double> &frequencies,
 					     vector<double> &deltafreqs)
   {
-    //  vector<double> frequencies;		// hold list of lambda squareds
-    double frequency=0;				// individual lambda squared read per line
-    double prev_frequency=0;			// value of previous frequency read
-    double difference=0;					// difference between current and previous frequency
-    
     //----------------------------------------------------------
     // Check if filename is text file FITS file or HDF5 file
     if(filename.find(".hdf5", 1)!=string::npos)	// if HDF5 use dal
@@ -105,45 +251,26 @@ namespace RM {  //  BEGIN -- namespace RM
 	// TODO
 	// use rmFITSTable to read lambda Squareds and deltaLambdaSquareds from file
       }
-    else if(filename.find(".txt", 1)!=string::npos)	// if it is text file
+    else if(isNpyFile(filename) || filename.find(".txt", 1)!=string::npos)	// if it is .npy or text file
       {
-	ifstream infile(const_cast<const char*>(filename.c_str()), ifstream::in);	// open file for reading
-	
-	if(infile.fail())
-	  {
-	    throw "rmIO::readFrequencies failed to open file";
-	  }
-	
-	unsigned int i=0;					// vector index variable
-	while(infile.good())				// as long as we can read from the file...
-	  {
-	    infile >> frequency;				// read double into temporary variable
-	    
-	    if(frequencies.size() > i)					// if there is sufficient space in frequencies vector...
-	      frequencies[i]=frequency;				// write to index i
-	    else												// otherwise
-	      frequencies.push_back (frequency);	// push back into lambdaSquareds vector
-	    
-	    if(prev_frequency!=0)
-	      {
-		difference=frequency-prev_frequency;
-		deltafreqs.push_back (difference);			// write into delta vector
-	      }
-	    prev_frequency=frequency;							// keep as previous frequency
-	  }
-	deltafreqs.push_back (difference);					// write last diff into delta vector
-	
-	infile.close();		// close the text file
+	vector<double> *columns[]={&frequencies};
+	readColumns(filename, 1, columns);
+
+	const size_t n=frequencies.size();
+	deltafreqs.assign(n, 0.0);
+	for(size_t i=0; i+1<n; i++)
+	  deltafreqs[i]=frequencies[i+1]-frequencies[i];
+	if(n > 1)
+	  deltafreqs[n-1]=deltafreqs[n-2];
       }
-    
-    //  return frequencies;	 // return frequencies vector
   }
   
+  
   //_____________________________________________________________________________
   //                                                           readLambdaSquareds
   
   /*!
-    \brief Read the distribution of measured lambda squareds from a text file
+    \brief Read the distribution of measured lambda squareds from a text or .npy file
     
     \param filename -- name of txt file with lambda squared distribution
     \param lambdaSquareds -- vector with lambda squareds
@@ -151,9 +278,6 @@ namespace RM {  //  BEGIN -- namespace RM
   void rmIO::readLambdaSquareds (const std::string &filename,
 				 vector<double> &lambdaSquareds)
   {
-    //  vector<double> lambdaSquareds;	// hold list of lambda squareds
-    double lambdaSq;			// individual lambda squared read per line
-    
     //----------------------------------------------------------
     // Check if filename is text file FITS file or HDF5 file
     if(filename.find(".hdf5", 1)!=string::npos)	// if HDF5 use dal
@@ -166,36 +290,20 @@ namespace RM {  //  BEGIN -- namespace RM
 	// TODO
 	// use rmFITSTable to read lambda Squareds and deltaLambdaSquareds from file
       }
-    else if(filename.find(".txt", 1)!=string::npos)	// if it is text file
+    else if(isNpyFile(filename) || filename.find(".txt", 1)!=string::npos)	// if it is .npy or text file
       {
-	ifstream infile(const_cast<const char*>(filename.c_str()), ifstream::in);	// open file for reading
-	
-	if(infile.fail())
-	  {
-	    throw "rmIO::readLambdaSquareds failed to open file";
-	  }
-	
-	//	 unsigned int i=0;		// vector index variable
-	lambdaSquareds.resize(0);
-	while(infile.good())	// as long as we can read from the file...
-	  {
-	    infile >> lambdaSq;	// read double into temporary variable
-	    lambdaSquareds.push_back (lambdaSq);	// push back into lambdaSquareds vector
-	  }
-	
-	infile.close();		// close the text file
+	vector<double> *columns[]={&lambdaSquareds};
+	readColumns(filename, 1, columns);
       }
-    
-    //  return lambdaSquareds;	 // return frequencies vector
   }
   
   //_____________________________________________________________________________
   //                                           readFrequenciesAndDeltaFrequencies
   
   /*!
-    \brief Read the distribution of measured lambdaSquareds AND deltaLambdaSquareds from a text file
+    \brief Read the distribution of measured frequencies AND delta frequencies from a text or .npy file
     
-    \param filename - name of txt file with lambda squared distribution
+    \param filename - name of txt file with frequency and delta frequency distribution
     \param frequencies - vector with frequencies
     \param deltaFrequencies - vector to keep delta Frequencies
   */
@@ -203,10 +311,6 @@ namespace RM {  //  BEGIN -- namespace RM
 						 vector<double> &frequencies,
 						 vector<double> &deltaFrequencies)
   {
-    double frequency=0;			// individual frequency read per line
-    double deltaFrequency=0;		// individual delta frequency read per line  
-    //  vector<double> frequencies;		// frequencies to be returned
-    
     //----------------------------------------------------------
     // Check if filename is text file FITS file or HDF5 file
     if(filename.find(".hdf5", 1)!=string::npos)	// if HDF5 use dal
@@ -219,47 +323,18 @@ namespace RM {  //  BEGIN -- namespace RM
 	// TODO
 	// use rmFITSTable to read lambda Squareds and deltaLambdaSquareds from file
       }
-    else if(filename.find(".txt", 1)!=string::npos)	// if it is text file
+    else if(isNpyFile(filename) || filename.find(".txt", 1)!=string::npos)	// if it is .npy or text file
       {
-	ifstream infile(const_cast<const char*>(filename.c_str()), ifstream::in);	// open file for reading
-	
-	if(infile.fail())
-	  {
-	    throw "rmIO::readFrequenciesAndDeltaFrequencies failed to open file";
-	  }
-	
-	//    unsigned int i=0;						// vector index variable if vector has sufficient size
-	frequencies.resize(0); 
-	deltaFrequencies.resize(0);
-	
-	while(infile.good())					// as long as we can read from the file...
-	  {
-	    infile >> frequency;					// read frequency (first column)
-	    infile >> deltaFrequency;			// read delta Frequency (2nd coloumn)
-	    
-	    /*
-	      if(frequencies.size() > i)								// if frequencies vector has sufficient size
-	      frequencies[i]=frequency;							// store at index i
-	      else
-	      frequencies.push_back (frequency);				// if delta frequencies vector has sufficient size
-	      if(deltaFrequencies.size() > i)						// store at index i
-	      deltaFrequencies[i]=deltaFrequency;
-	      else
-	      deltaFrequencies.push_back (deltaFrequency);		// store in delta frequencies vector
-	    */
-	  }
-	
-	infile.close();		// close the text file
+	vector<double> *columns[]={&frequencies, &deltaFrequencies};
+	readColumns(filename, 2, columns);
       }
-    
-    //  return frequencies;	  // return frequencies vector
   }
   
   //_____________________________________________________________________________
   //                                           readLambdaSquaredsAndDeltaSquareds
   
   /*!
-    \brief Read the distribution of measured lambdaSquareds AND deltaLambdaSquareds from a text file
+    \brief Read the distribution of measured lambdaSquareds AND deltaLambdaSquareds from a text or .npy file
     
     \param filename - name of txt file with lambda squared and delta lambda squared distribution
     \param lambdaSquareds - vector with lambda squareds
@@ -269,75 +344,32 @@ namespace RM {  //  BEGIN -- namespace RM
 						 vector<double> &lambdaSquareds,
 						 vector<double> &deltaLambdaSquareds)
   {
-    //  vector<double> lambdaSquareds;		// lambda squareds to be returned
-    double lambdaSq=0;						// individual frequency read per line
-    double deltaLambdaSq=0;				// individual delta frequency read per line  
-    
     //----------------------------------------------------------
     // Check if filename is text file FITS file or HDF5 file
     if(filename.find(".hdf5", 1)!=string::npos)	// if HDF5 use dal
       {
 	// TODO
-    // use dal to read lambda Squareds and deltaLambdaSquareds from file
-  }
-  else if(filename.find(".fits", 1)!=string::npos)	// if FITS file  use rmFITS table
-  {
-    // TODO
-    // use rmFITSTable to read lambda Squareds and deltaLambdaSquareds from file
-  }
-  else if(filename.find(".txt", 1)!=string::npos)	// if it is text file
-  {
-    ifstream infile(const_cast<const char*>(filename.c_str()), ifstream::in);	// open file for reading
-  
-    if(infile.fail())
-    {
-      throw "rmIO::readLambdaSquaredsAndDeltaSquareds failed to open file";
-    }
-  
-	 lambdaSquareds.resize(0);
-	 deltaLambdaSquareds.resize(0);
-//	 int i=0;									// vector index variable if vector has sufficient size
-    while(infile.good())					// as long as we can read from the file...
-    {
-      infile >> lambdaSq;					// read frequency (first column)
-      infile >> deltaLambdaSq;			// read delta Frequency (2nd coloumn)
-
-		lambdaSquareds.push_back(lambdaSq);
-	   deltaLambdaSquareds.push_back (deltaLambdaSq);	// store in delta lambda squared vector
-		/*
-		if(static_cast<int>(lambdaSquareds.size()) > i)		// if there is size left in lambdasquareds and delta_lambda_squareds vectors
-		{ 
-			lambdaSquareds[i]=lambdaSq;
-		}
-		else
-		{
-			lambdaSquareds.push_back (lambdaSq);		// store in frequencies vector
-		}	
-		if(static_cast<int>(deltaLambdaSquareds.size()) > i)
-		{
-			deltaLambdaSquareds[i]=deltaLambdaSq;	
-		}	
-		else
-		{
-	      deltaLambdaSquareds.push_back (deltaLambdaSq);	// store in delta lambda squared vector
-		}
-		*/
-    }
-
-    infile.close();		// close the text file
+	// use dal to read lambda Squareds and deltaLambdaSquareds from file
+      }
+    else if(filename.find(".fits", 1)!=string::npos)	// if FITS file  use rmFITS table
+      {
+	// TODO
+	// use rmFITSTable to read lambda Squareds and deltaLambdaSquareds from file
+      }
+    else if(isNpyFile(filename) || filename.find(".txt", 1)!=string::npos)	// if it is .npy or text file
+      {
+	vector<double> *columns[]={&lambdaSquareds, &deltaLambdaSquareds};
+	readColumns(filename, 2, columns);
+      }
   }
 
-//  return lambdaSquareds;	  // return frequencies vector
-}
-
   //_____________________________________________________________________________
   //                                                          readSimDataFromFile
   
-  
   /*!
-    \brief Read lambda squareds, delta lambda squareds and complex data vector from a text file
+    \brief Read lambda squareds, delta lambda squareds and complex data vector from a text or .npy file
     
-    \param &filename - name of text file with simulated polarized emission data
+    \param &filename - name of text (4 columns) or .npy (rows x 4) file with simulated polarized emission data
     \param &lambdasquareds - vector to store lambda squared values in
     \param &delta_lambda_squareds - vector to store delta lambda squared values in
     \param &intensities				-	vector<complex<double> > to store complex polarized intensities
@@ -347,40 +379,14 @@ namespace RM {  //  BEGIN -- namespace RM
 				  vector<double> &delta_lambda_squareds, 
 				  vector<complex<double> > &intensities)
   {
-    /* file with lambda squareds */
-    ifstream infile(const_cast<const char*>(filename.c_str()), ifstream::in);
+    vector<double> real, imag;	// real and imaginary part columns
+    vector<double> *columns[]={&lambdasquareds, &delta_lambda_squareds, &real, &imag};
     
-    int i (0);			// loop variable
-    double lambdasq (0.0);	// temporary variable for lambda sqaured per line
-    double deltalambdasq (0.0); // temporary variable for delta lambda squared per line
-    double real (0.0);          // temporary variable for real part per line
-    double imag (0.0);          // temporary variable for imaginary part per line
-    complex<double> intensity;	// temporary complex intensity
-    
-    if(infile.fail()) {
-      throw "rmIO::readSimDataFromFile failed to open file";
-    }
-    
-    while(infile.good()) {
-      infile >> lambdasq >> deltalambdasq >> real >> imag;
-      
-      if(static_cast<int>(lambdasquareds.size()) > i)		// if there is size left in lambdasquareds and delta_lambda_squareds vectors
-	{
-	  lambdasquareds[i]=lambdasq;
-	  delta_lambda_squareds[i]=deltalambdasq;
-	  intensities[i]=complex<double>(real, imag);		
-	}
-      else		// otherwise use push back function to append at the end of the vector
-	{
-	  lambdasquareds.push_back(lambdasq);
-	  delta_lambda_squareds.push_back(deltalambdasq);			
-	  intensities.push_back(complex<double>(real, imag));		
-	}
-      
-      i++;       // increment index into data vector
-    }
+    readColumns(filename, 4, columns);
     
-    infile.close();
+    intensities.resize(real.size());
+    for(unsigned int i=0; i<real.size(); i++)
+      intensities[i]=complex<double>(real[i], imag[i]);
   }
   
   //_____________________________________________________________________________
@@ -390,58 +396,37 @@ namespace RM {  //  BEGIN -- namespace RM
     \brief Read a complex RMSF from a file
     
     \param rmsf - complex vector containing rmsf intensities
-    \param filename - file to read from (can be FITS/HDF5 or txt file)
+    \param filename - file to read from (txt/dat with real and imaginary column, or .npy complex128 or rows x 2 float64)
   */
   void rmIO::readRMSFfromFile (vector<complex<double> > &rmsf,
 			       const string &filename)
   {
-    double real (0.0);
-    double imag (0.0);
-    unsigned int i (0);
-    
     //----------------------------------------------------------
     // Check if filename is text file FITS file or HDF5 file
     if(filename.find(".hdf5", 1)!=string::npos)	// if HDF5 use dal
       {
     	// TODO
     	// use dal to read lambda Squareds and deltaLambdaSquareds from file
-  	}
-  	else if(filename.find(".fits", 1)!=string::npos)	// if FITS file  use rmFITS table
-  	{
+      }
+    else if(filename.find(".fits", 1)!=string::npos)	// if FITS file  use rmFITS table
+      {
     	// TODO
     	// use rmFITSTable to read lambda Squareds and deltaLambdaSquareds from file
-  	}
-  	else if(filename.find(".txt", 1)!=string::npos || filename.find(".dat", 1)!=string::npos)	// if it is text file
-  	{
-		ifstream infile(const_cast<const char*>(filename.c_str()), ifstream::in);		// file with lambda squareds and RMSF complex intensities	
-
-	   if(infile.fail())
-	   {
-	      throw "rmIO::readRMSFfromFile failed to open file";
-	   }
-	
-		while(infile.good())
-		{
-			infile >> real >>  imag;
-			
-			if(static_cast<unsigned int>(rmsf.size()) > i)		// if there is size left in lambdasquareds and delta_lambda_squareds vectors
-			{
-				rmsf[i]=complex<double>(real, imag);		
-			}
-			else		// otherwise use push back function to append at the end of the vector
-			{
-				rmsf.push_back(complex<double>(real, imag));		
-			}
-
-			i++;										// increment index into data vector
-		}
+      }
+    else if(isNpyFile(filename) || filename.find(".txt", 1)!=string::npos || filename.find(".dat", 1)!=string::npos)	// if it is .npy or text file
+      {
+	vector<double> real, imag;
+	vector<double> *columns[]={&real, &imag};
+	readColumns(filename, 2, columns);
 	
-		infile.close();
-	}
-	else		// otherwise, if file extension was not recognized
-	{
-		throw "rmIO::readRMSFfromFile file extension was not recognized";
-	}
+	rmsf.resize(real.size());
+	for(unsigned int i=0; i<real.size(); i++)
+	  rmsf[i]=complex<double>(real[i], imag[i]);
+      }
+    else		// otherwise, if file extension was not recognized
+      {
+	throw "rmIO::readRMSFfromFile file extension was not recognized";
+      }
   }
   
   //_____________________________________________________________________________
@@ -452,15 +437,12 @@ namespace RM {  //  BEGIN -- namespace RM
     
     \param faradaydepths - vector with faraday depths the RMSF is based on
     \param rmsf - complex vector containing rmsf intensities
-    \param filename - file to read from (can be FITS/HDF5 or txt file)
+    \param filename - file to read from (txt/dat with 3 columns or .npy rows x 3 float64)
   */
   void rmIO::readRMSFfromFile (vector<double> &faradaydepths,
 			       vector<complex<double> > &rmsf,
 			       const string &filename)
   {
-    double faraday=0, real=0, imag=0;		// faraday,  real and imaginary part of RMSF intensity to read per line
-    unsigned int i=0;								// index / loop variable
-    
     //----------------------------------------------------------
     // Check if filename is text file FITS file or HDF5 file
     if(filename.find(".hdf5", 1)!=string::npos)	// if HDF5 use dal
@@ -473,47 +455,21 @@ namespace RM {  //  BEGIN -- namespace RM
     	// TODO
     	// use rmFITSTable to read lambda Squareds and deltaLambdaSquareds from file
       }
-    else if(filename.find(".txt", 1)!=string::npos || filename.find(".dat", 1)!=string::npos)	// if it is text file
-  	{
-		ifstream infile(const_cast<const char*>(filename.c_str()), ifstream::in);		// file with lambda squareds and RMSF complex intensities	
-
-	   if(infile.fail())
-	   {
-	      throw "rmIO::readRMSFfromFile failed to open file";
-	   }
-	
-		while(infile.good())
-		{
-			infile >> faraday >> real >>  imag;
-
-			if(static_cast<unsigned int>(rmsf.size()) > i)		// if there is size left in lambdasquareds and delta_lambda_squareds vectors
-			{
-				faradaydepths[i]=faraday;		
-			}
-			else		// otherwise use push back function to append at the end of the vector
-			{
-				faradaydepths.push_back(faraday);		
-			}
-			
-			if(static_cast<unsigned int>(rmsf.size()) > i)		// if there is size left in lambdasquareds and delta_lambda_squareds vectors
-			{
-				rmsf[i]=complex<double>(real, imag);		
-			}
-			else		// otherwise use push back function to append at the end of the vector
-			{
-				rmsf.push_back(complex<double>(real, imag));		
-			}
-
-			i++;										// increment index into data vector
-		}
+    else if(isNpyFile(filename) || filename.find(".txt", 1)!=string::npos || filename.find(".dat", 1)!=string::npos)	// if it is .npy or text file
+      {
+	vector<double> real, imag;
+	vector<double> *columns[]={&faradaydepths, &real, &imag};
+	readColumns(filename, 3, columns);
 	
-		infile.close();
-	}
-	else		// otherwise, if file extension was not recognized
-	{
-		throw "rmIO::readRMSFfromFile file extension was not recognized";
-	}
-}
+	rmsf.resize(real.size());
+	for(unsigned int i=0; i<real.size(); i++)
+	  rmsf[i]=complex<double>(real[i], imag[i]);
+      }
+    else		// otherwise, if file extension was not recognized
+      {
+	throw "rmIO::readRMSFfromFile file extension was not recognized";
+      }
+  }
 
   //_____________________________________________________________________________
   //                                                           readVectorFromFile
@@ -522,13 +478,11 @@ namespace RM {  //  BEGIN -- namespace RM
     \brief Read a vector<double> from a file
     
     \param v - vector to read into
-    \param filename - name of file to read from (FITS, HDF5 or TXT)
+    \param filename - name of file to read from (FITS, HDF5, TXT or NPY)
   */
   void rmIO::readVectorFromFile (std::vector<double> &v,
 				 const std::string &filename)
   {
-    double value (0.0);
-    
     //----------------------------------------------------------
     // Check if filename is text file FITS file or HDF5 file
     if(filename.find(".hdf5", 1)!=string::npos)	// if HDF5 use dal
@@ -541,23 +495,10 @@ namespace RM {  //  BEGIN -- namespace RM
     	// TODO
     	// use rmFITSTable to read lambda Squareds and deltaLambdaSquareds from file
       }
-    else if(filename.find(".txt", 1)!=string::npos || filename.find(".dat", 1)!=string::npos)	// if it is text file
+    else if(isNpyFile(filename) || filename.find(".txt", 1)!=string::npos || filename.find(".dat", 1)!=string::npos)	// if it is .npy or text file
       {
-	ifstream infile(const_cast<const char*>(filename.c_str()), ifstream::in);		// file with lambda squareds and RMSF complex intensities	
-	
-	if(infile.fail())
-	  {
-	    throw "rmIO::readVectorFromFile failed to open file";
-	  }
-	
-	v.clear();
-	while(infile.good())
-	  {
-	    infile >>  value;	
-	    v.push_back(value);		
-	  }
-	
-	infile.close();
+	vector<double> *columns[]={&v};
+	readColumns(filename, 1, columns);
       }
     else		// otherwise, if file extension was not recognized
       {
@@ -573,15 +514,12 @@ namespace RM {  //  BEGIN -- namespace RM
     
     \param vec1 - real vector 1 to read from first column of file
     \param vec2 - real vector 1 to read from second column of file
-    \param filename - file to read from (can be FITS/HDF5 or txt file)
+    \param filename - file to read from (can be FITS/HDF5, txt or npy file)
   */
   void rmIO::read2VectorsFromFile(vector<double> &vec1,
 				  vector<double> &vec2,
 				  const string &filename)
   {
-    double value1=0, value2=0;		// value1 (1st column) and value2 (2nd column) to read per line
-    unsigned int i=0;				// index / loop variable
-    
     //----------------------------------------------------------
     // Check if filename is text file FITS file or HDF5 file
     if(filename.find(".hdf5", 1)!=string::npos)	// if HDF5 use dal
@@ -594,48 +532,64 @@ namespace RM {  //  BEGIN -- namespace RM
     	// TODO
     	// use rmFITSTable to read lambda Squareds and deltaLambdaSquareds from file
       }
-    else if(filename.find(".txt", 1)!=string::npos || filename.find(".dat", 1)!=string::npos)	// if it is text file
+    else if(isNpyFile(filename) || filename.find(".txt", 1)!=string::npos || filename.find(".dat", 1)!=string::npos)	// if it is .npy or text file
       {
-	ifstream infile(const_cast<const char*>(filename.c_str()), ifstream::in);		// file with lambda squareds and RMSF complex intensities	
-	
-	if(infile.fail())
-	  {
-	    throw "rmIO::readRMSFfromFile failed to open file";
-	  }
-	
-	while(infile.good())
-	  {
-	    infile >>  value1 >>  value2;
-	    
-	    if(static_cast<unsigned int>(vec1.size()) > i)		// if there is size left in lambdasquareds and delta_lambda_squareds vectors
-	      {
-		vec1[i]=value1;		
-	      }
-	    else		// otherwise use push back function to append at the end of the vector
-	      {
-		vec1.push_back(value1);		
-	      }
-	    
-	    if(static_cast<unsigned int>(vec2.size()) > i)		// if there is size left in lambdasquareds and delta_lambda_squareds vectors
-	      {
-		vec2[i]=value2;		
-	      }
-	    else		// otherwise use push back function to append at the end of the vector
-	      {
-		vec2.push_back(value2);		
-	      }
-	    
-	    i++;										// increment index into data vector
-	  }
-	
-	infile.close();
+	vector<double> *columns[]={&vec1, &vec2};
+	readColumns(filename, 2, columns);
       }
     else		// otherwise, if file extension was not recognized
       {
-	throw "rmIO::readRMSFfromFile file extension was not recognized";
+	throw "rmIO::read2VectorsFromFile file extension was not recognized";
       }
   }
   
+  //_____________________________________________________________________________
+  //                                                   readPolIntensitiesFromFile
+  
+  /*!
+    \brief Read complex polarized intensities from a file
+    
+    \param filename - text file with real and imaginary column, or .npy
+                      complex128 or rows x 2 float64 array
+    \param polIntensities - vector to read complex intensities into
+  */
+  void rmIO::readPolIntensitiesFromFile (const std::string &filename,
+					 vector<complex<double> > &polIntensities)
+  {
+    vector<double> real, imag;
+    vector<double> *columns[]={&real, &imag};
+    
+    readColumns(filename, 2, columns);
+    
+    polIntensities.resize(real.size());
+    for(unsigned int i=0; i<real.size(); i++)
+      polIntensities[i]=complex<double>(real[i], imag[i]);
+  }
+  
+  //_____________________________________________________________________________
+  //                                                   readPolIntensitiesFromFile
+  
+  /*!
+    \brief Read lambda squareds and complex polarized intensities from a file
+    
+    \param filename - text file with 3 columns or .npy rows x 3 float64 array
+    \param lambdaSquareds - vector to read lambda squareds into
+    \param polIntensities - vector to read complex intensities into
+  */
+  void rmIO::readPolIntensitiesFromFile (const std::string &filename,
+					 vector<double> &lambdaSquareds,
+					 vector<complex<double> > &polIntensities)
+  {
+    vector<double> real, imag;
+    vector<double> *columns[]={&lambdaSquareds, &real, &imag};
+    
+    readColumns(filename, 3, columns);
+    
+    polIntensities.resize(real.size());
+    for(unsigned int i=0; i<real.size(); i++)
+      polIntensities[i]=complex<double>(real[i], imag[i]);
+  }
+  
   //_____________________________________________________________________________
   //                                                          write2VectorsToFile
   
@@ -644,7 +598,7 @@ namespace RM {  //  BEGIN -- namespace RM
     
     \param vec1 - real vector 1 to write to first column of file
     \param vec2 - real vector 1 to write to second column of file 
-    \param filename - fileanme to write to (can be FITS/HDF5 or txt file)
+    \param filename - fileanme to write to (can be FITS/HDF5, txt or npy file)
   */
   void rmIO::write2VectorsToFile (const vector<double> &vec1,
 				  const vector<double> &vec2,
@@ -655,7 +609,8 @@ namespace RM {  //  BEGIN -- namespace RM
       throw "rmIO::write2VectorsToFile vec1 has size 0";
     if(vec2.size()==0)
       throw "rmIO::write2VectorsToFile vec2 has size 0";
-    
+    if(vec1.size()!=vec2.size())
+      throw "rmIO::write2VectorsToFile vec1 and vec2 differ in size";
     
     //----------------------------------------------------------
     // Check if filename is text file FITS file or HDF5 file
@@ -669,23 +624,11 @@ namespace RM {  //  BEGIN -- namespace RM
 	// TODO
 	// use rmFITSTable to read lambda Squareds and deltaLambdaSquareds from file
       }
-    else if(filename.find(".txt", 1)!=string::npos)	// if it is text file
+    else if(isNpyFile(filename) || filename.find(".txt", 1)!=string::npos)	// if it is .npy or text file
       {
-	
-	ofstream outfile(const_cast<const char*>(filename.c_str()), ofstream::out);		// file with lambda squareds and RMSF complex intensities	
-	
-	if(outfile.fail())
-	  {
-	    throw "rmIO::writeRMSFtoFile failed to open file";
-	  }
-	
-	for(unsigned int i=0; i < vec1.size(); i++)
-	  {
-	    outfile << vec1[i] << "\t";
-	    outfile << vec2[i] << endl;
-	  }
-	
-	outfile.flush();
+	const double *columns[]={&vec1[0], &vec2[0]};
+	const unsigned int strides[]={1, 1};
+	writeColumns(filename, 2, columns, strides, vec1.size());
       }	
   }
   
@@ -696,7 +639,7 @@ namespace RM {  //  BEGIN -- namespace RM
     \brief Write a complex RMSF to a file
     
     \param rmsf - complex vector with RMSF intensities in Q and U
-    \param filename - fileanme to write to (can be FITS/HDF5 or txt file)
+    \param filename - fileanme to write to (can be FITS/HDF5, txt or npy file)
   */
   void rmIO::writeRMSFtoFile (const vector<complex<double> > &rmsf,
 			      const string &filename)
@@ -711,31 +654,20 @@ namespace RM {  //  BEGIN -- namespace RM
       {
 	// TODO
 	// use dal to read lambda Squareds and deltaLambdaSquareds from file
-	}
-	else if(filename.find(".fits", 1)!=string::npos)	// if FITS file  use rmFITS table
-	{
-		// TODO
-	   // use rmFITSTable to read lambda Squareds and deltaLambdaSquareds from file
-	}
-	else if(filename.find(".txt", 1)!=string::npos)	// if it is text file
-	{
-	
-		ofstream outfile(const_cast<const char*>(filename.c_str()), ofstream::out);		// file with lambda squareds and RMSF complex intensities	
-
-		if(outfile.fail())
-		{
-			throw "rmIO::writeRMSFtoFile failed to open file";
-		}
-	
-		for(unsigned int i=0; i < rmsf.size(); i++)
-		{
-			outfile << rmsf[i].real() << "\t";
-			outfile << rmsf[i].imag() << endl;
-		}
-		
-		outfile.flush();
-	}	
-}
+      }
+    else if(filename.find(".fits", 1)!=string::npos)	// if FITS file  use rmFITS table
+      {
+	// TODO
+	// use rmFITSTable to read lambda Squareds and deltaLambdaSquareds from file
+      }
+    else if(isNpyFile(filename) || filename.find(".txt", 1)!=string::npos)	// if it is .npy or text file
+      {
+	const double *values=reinterpret_cast<const double*>(&rmsf[0]);
+	const double *columns[]={values, values+1};
+	const unsigned int strides[]={2, 2};
+	writeColumns(filename, 2, columns, strides, rmsf.size(), true);
+      }	
+  }
 
   //_____________________________________________________________________________
   //                                                              writeRMSFtoFile
@@ -745,7 +677,7 @@ namespace RM {  //  BEGIN -- namespace RM
     
     \param faradaydepths - vector with faraday depths the RMSF is based on
     \param rmsf - complex vector with RMSF intensities in Q and U
-    \param filename - fileanme to write to (can be FITS/HDF5 or txt file)
+    \param filename - fileanme to write to (can be FITS/HDF5, txt/dat or npy file)
   */
   void rmIO::writeRMSFtoFile (const vector<double> &faradaydepths,
 			      const vector<complex<double> > &rmsf, 
@@ -754,6 +686,8 @@ namespace RM {  //  BEGIN -- namespace RM
     // Check data integrity
     if(rmsf.size()==0)
       throw "rmIO::writeRMSFtoFile";
+    if(faradaydepths.size()!=rmsf.size())
+      throw "rmIO::writeRMSFtoFile faradaydepths and rmsf differ in size";
     
     //----------------------------------------------------------
     // Check if filename is text file FITS file or HDF5 file
@@ -767,24 +701,12 @@ namespace RM {  //  BEGIN -- namespace RM
 	// TODO
 	// use rmFITSTable to read lambda Squareds and deltaLambdaSquareds from file
       }
-    else if(filename.find(".txt", 1)!=string::npos || filename.find(".dat", 1)!=string::npos)	// if it is text file
+    else if(isNpyFile(filename) || filename.find(".txt", 1)!=string::npos || filename.find(".dat", 1)!=string::npos)	// if it is .npy or text file
       {
-	
-	ofstream outfile(const_cast<const char*>(filename.c_str()), ofstream::out);		// file with lambda squareds and RMSF complex intensities	
-	
-	if(outfile.fail())
-	  {
-	    throw "rmIO::writeRMSFtoFile failed to open file";
-	  }
-	
-	for(unsigned int i=0; i < rmsf.size(); i++)
-	  {
-	    outfile << faradaydepths[i] << "\t";
-	    outfile << rmsf[i].real() << "\t";
-	    outfile << rmsf[i].imag() << endl;
-	  }
-	
-	outfile.flush();
+	const double *values=reinterpret_cast<const double*>(&rmsf[0]);
+	const double *columns[]={&faradaydepths[0], values, values+1};
+	const unsigned int strides[]={1, 2, 2};
+	writeColumns(filename, 3, columns, strides, rmsf.size());
       }
     else
       throw "rmIO::writeRMSFtoFile unrecognized file extension";
@@ -794,61 +716,48 @@ namespace RM {  //  BEGIN -- namespace RM
   //                                                                writeRMtoFile
   
   /*!
-    \brief Write a vector (RM) out to file on disk (mainly for debugging)
+    \brief Write a vector (RM) out to file on disk (text, or .npy by extension)
     
     \param rm - vector containing data (real double) to write to file
-    \param filename - name of file to create or append to
-    \param mode - write mode: overwrite, append
+    \param filename - name of file to create
   */
   void rmIO::writeRMtoFile (const vector<double> &rm,
 			    const std::string &filename)
   {
-    unsigned int i=0;	// loop variable
-    
-    ofstream outfile(const_cast<const char *>(filename.c_str()), ofstream::out);
+    const double *columns[]={rm.empty() ? NULL : &rm[0]};
+    const unsigned int strides[]={1};
     
-    for(i=0; i<rm.size(); i++)		// loop over vector
-      {
-	outfile << rm[i];				// write out data
-	outfile << endl;					// add endl
-      }
-    
-    outfile.flush();					// flush output file
+    writeColumns(filename, 1, columns, strides, rm.size());
   }
   
   //_____________________________________________________________________________
   //                                                                writeRMtoFile
   
   /*!
-    \brief Write a vector (RM) out to file on disk (mainly for debugging)
+    \brief Write a complex vector (RM) out to file on disk (text, or .npy by extension)
     
-    \param rm - vector containing data (real double) to write to file
-    \param filename - name of file to create or append to
+    \param rm - vector containing complex data to write to file
+    \param filename - name of file to create
   */
   void rmIO::writeRMtoFile (const vector<complex<double> > &rm,
 			    const std::string &filename)
   {
-    ofstream outfile(const_cast<const char *>(filename.c_str()), ofstream::out);
+    const double *values=rm.empty() ? NULL : reinterpret_cast<const double*>(&rm[0]);
+    const double *columns[]={values, values+1};
+    const unsigned int strides[]={2, 2};
     
-    for(unsigned int i=0; i<rm.size(); i++)   // loop over vector
-      {
-	outfile << rm[i].real() << "\t";      // write real part of data
-	outfile << rm[i].imag();              // write imaginary part of data
-	outfile << endl;                      // add endl
-      }
-    
-    outfile.flush();						// flush output file
+    writeColumns(filename, 2, columns, strides, rm.size(), true);
   }
   
   //_____________________________________________________________________________
   //                                                                writeRMtoFile
   
   /*!
-    \brief Write a vector (RM) out to file on disk (mainly for debugging)
+    \brief Write lambda squareds and a complex vector (RM) out to file on disk (text, or .npy by extension)
     
     \param lambdasq - vector containing the lambda squared wavelengths
-    \param rm - vector containing data (real double) to write to file
-    \param filename - name of file to create or append to
+    \param rm - vector containing complex data to write to file
+    \param filename - name of file to create
   */
   void rmIO::writeRMtoFile(const vector<double> &lambdasq, 
 			   const vector<complex<double> > &rm, 
@@ -857,17 +766,11 @@ namespace RM {  //  BEGIN -- namespace RM
     if(lambdasq.size()!=rm.size())
       throw "rmIO::writeRMtoFile lambdasq and rm vector differ in size";
     
-    ofstream outfile(const_cast<const char *>(filename.c_str()), ofstream::out);
+    const double *values=rm.empty() ? NULL : reinterpret_cast<const double*>(&rm[0]);
+    const double *columns[]={lambdasq.empty() ? NULL : &lambdasq[0], values, values+1};
+    const unsigned int strides[]={1, 2, 2};
     
-    for(unsigned int i=0; i<rm.size(); i++)		// loop over vector
-      {
-	outfile << lambdasq[i] << "\t";			// write lambda squareds 
-	outfile << rm[i].real() << "\t";			// write real part of data
-	outfile << rm[i].imag();						// write imaginary part of data
-	outfile << endl;									// add endl
-      }
-    
-    outfile.flush();						// flush output file
+    writeColumns(filename, 3, columns, strides, rm.size());
   }
   
   //_____________________________________________________________________________
@@ -878,7 +781,7 @@ namespace RM {  //  BEGIN -- namespace RM
     
     \param frequencies - vector containing frequencies the polarized intensities are given
     \param polint - vector containing complex polarized intensities
-    \param filename - name of text file to write to
+    \param filename - name of text (or .npy) file to write to
   */
   void rmIO::writePolIntToFile (const std::vector<double> &frequencies, 
 				const std::vector<std::complex<double> > &polint, 
@@ -888,17 +791,11 @@ namespace RM {  //  BEGIN -- namespace RM
       throw "rmIO::writePolIntToFile frequencies and polint vector differ in size";
     }
     
-    ofstream outfile(const_cast<const char *>(filename.c_str()), ofstream::out);
-    
-    for(unsigned int i=0; i<polint.size(); i++)	 // loop over vector
-      {
-	outfile << frequencies[i] << "\t";       // write lambda squareds 
-	outfile << polint[i].real() << "\t";     // write real part of data
-	outfile << polint[i].imag();             // write imaginary part of data
-	outfile << endl;                         // add endl
-      }
+    const double *values=polint.empty() ? NULL : reinterpret_cast<const double*>(&polint[0]);
+    const double *columns[]={frequencies.empty() ? NULL : &frequencies[0], values, values+1};
+    const unsigned int strides[]={1, 2, 2};
     
-    outfile.flush();                             // flush output file
+    writeColumns(filename, 3, columns, strides, polint.size());
   }
   
   //_____________________________________________________________________________
@@ -909,7 +806,7 @@ namespace RM {  //  BEGIN -- namespace RM
     
     \param frequencies - vector containing frequencies the polarized intensities are given
     \param intensities - vector containing single polarized intensities (Q or U)
-    \param filename - name of text file to write to
+    \param filename - name of text (or .npy) file to write to
   */
   void rmIO::writeIntToFile(const std::vector<double> &frequencies, 
 			    const std::vector<double> &intensities, 
@@ -918,20 +815,16 @@ namespace RM {  //  BEGIN -- namespace RM
     if(frequencies.size()!=intensities.size())
       throw "rmIO::writePolIntToFile frequencies and polint vector differ in size";
     
-    ofstream outfile(const_cast<const char *>(filename.c_str()), ofstream::out);
+    const double *columns[]={frequencies.empty() ? NULL : &frequencies[0],
+			     intensities.empty() ? NULL : &intensities[0]};
+    const unsigned int strides[]={1, 1};
     
-    for(unsigned int i=0; i<intensities.size(); i++)		// loop over vector
-      {
-	outfile << frequencies[i] << "\t";					// write lambda squareds 
-	outfile << intensities[i];								// write real part of data
-	outfile << endl;												// add endl
-      }
-    
-    outfile.flush();						// flush output file
+    writeColumns(filename, 2, columns, strides, intensities.size());
   }
   
   
   
+  
   //*************************************************************************************
   //
   // Image cube functions (internally only FITS implemented at first)
@@ -943,11 +836,11 @@ namespace RM {  //  BEGIN -- namespace RM
     \brief Check if the image cube is in correct format for RM-Synthesis
     
     \param filename - name of image cube to check
-    \param hdu - optional give a HDU to check (default=1)
+    \param hdu - HDU to check
     
     \return check - true if image format is correct, false if not
   */
-  bool rmIO::checkImageCube(const std::string &filename, int hdu=1)
+  bool rmIO::checkImageCube(const std::string &filename, int hdu)
   {
     if(filename.size()==0 || filename=="")
       throw "rmIO::checkImageCube no filename provided";
@@ -978,93 +871,80 @@ namespace RM {  //  BEGIN -- namespace RM
   }
   
   
-  /*
+  /*!
     \brief Check if Q image cube is in correct format for RM-Synthesis
-    
+
+    Accepts a separate 3-D Q cube or a 4-D IQUV cube with a STOKES axis
+    containing Q, which is read directly with rmFITS::readStokesPlanes().
+
     \param filename - name of image cube to check
-    \param hdu - optional give a HDU to check (default=1)
-    
+    \param hdu - HDU to check
+
     \return check - true if image format is correct, false if not
   */
-  /*
-    bool rmIO::checkImageCubeQ(const std::string &filename, int hdu=1)
-    {
-    if(filename.size()==0 || filename=="")
-    throw "rmIO::checkImageCube no filename provided";
-    
-    //----------------------------------------------------------
-    // Check if filename is text file FITS file or HDF5 file
-    if(filename.find(".hdf5", 1)!=string::npos || filename.find(".HDF5", 1)!=string::npos)			// if HDF5 use dal
-    {
-    // TODO
-    }
-    else if(filename.find(".fits", 1)!=string::npos || filename.find(".FITS", 1)!=string::npos)	// if FITS file  use rmFITS
-    {
-    DAL::rmFITS fitsimage(filename, READONLY);				// create and open rmFITS image object
-    
-    if(fitsimage.getImgDim()!=3)							// must have 3 axes
-    throw "rmIO::checkImageCubeQ image cube has wrong dimensions";
-    
-    if(fitsimage.getImgType()!=-32) 						// 32-Bit double format (-32)
-    throw "rmIO::checkImageCubeQ pixel values are not in 32 bit";
-    
-    fitsimage.close();										// close FITS image
-    
-    return true;
-    }	
-    else
-    {
-    throw "rmIO::checkImageCube unknown file extension";
-    }	
-    
-    return false;
-    }
-  */
-  
-  
-  /*
+  bool rmIO::checkImageCubeQ(const std::string &filename, int hdu)
+  {
+    return checkStokesImageCube(filename, hdu, 2);
+  }
+
+
+  /*!
     \brief Check if U image cube is in correct format for RM-Synthesis
-    
+
+    Accepts a separate 3-D U cube or a 4-D IQUV cube with a STOKES axis
+    containing U, which is read directly with rmFITS::readStokesPlanes().
+
     \param filename - name of image cube to check
-    \param hdu - optional give a HDU to check (default=1)
-    
+    \param hdu - HDU to check
+
     \return check - true if image format is correct, false if not
   */
-  /*
-    bool rmIO::checkImageCubeU(const std::string &filename, int hdu=1)
-    {
+  bool rmIO::checkImageCubeU(const std::string &filename, int hdu)
+  {
+    return checkStokesImageCube(filename, hdu, 3);
+  }
+
+
+  /*!
+    \brief Check if an image cube contains Stokes parameter stokes in a format
+    usable for RM-Synthesis
+
+    \param filename - name of image cube to check
+    \param hdu - HDU to check
+    \param stokes - Stokes parameter (FITS convention: 1=I, 2=Q, 3=U, 4=V)
+
+    \return check - true if image format is correct, false if not
+  */
+  bool rmIO::checkStokesImageCube(const std::string &filename, int hdu, int stokes)
+  {
     if(filename.size()==0 || filename=="")
-    throw "rmIO::checkImageCube no filename provided";
-    
+      throw "rmIO::checkStokesImageCube no filename provided";
+
     //----------------------------------------------------------
-    // Check if filename file FITS file or HDF5 file
-    if(filename.find(".hdf5", 1)!=string::npos || filename.find(".HDF5", 1)!=string::npos)				// if HDF5 use dal
-    {
-    // TODO
-    }
-    else if(filename.find(".fits", 1)!=string::npos || filename.find(".FITS", 1)!=string::npos)		// if FITS file  use rmFITS 
-    {
-    DAL::rmFITS fitsimage(filename, READONLY);			// create and open rmFITS image object
-    
-    if(fitsimage.getImgDim()!=3)			// must have 3 axes
-    throw "rmIO::checkImageCubeU image cube has wrong dimensions";
-    
-    if(fitsimage.getImgType()!=-32) 		// 32-Bit double format (-32)
-    throw "rmIO::checkImageCubeU pixel values are not in 32 bit";
-    
-    fitsimage.close();										// close FITS image
-    
-    return true;
-    }	
-    else {
-    throw "rmIO::checkImageCube unknown file extension";
-    }
-    
-    return false;
-    }
-  */
-  
-  
+    // Only FITS Stokes cubes are supported (rmHDF5 holds Faraday cubes)
+    if(filename.find(".fits", 1)!=string::npos || filename.find(".FITS", 1)!=string::npos)	// if FITS file  use rmFITS
+      {
+	RM::rmFITS fitsimage(filename, READONLY);	// create and open rmFITS image object
+	fitsimage.moveAbsoluteHDU(hdu);
+
+	if(fitsimage.getHDUType()!=IMAGE_HDU)
+	  return false;
+
+	int naxis=fitsimage.getImgDim();
+	if(naxis==3)					// separate Stokes cube
+	  return true;
+	if(naxis==4 && fitsimage.getStokesAxis()>=3)	// IQUV cube
+	  return fitsimage.getStokesPixel(stokes)!=0;
+
+	return false;
+      }
+    else
+      {
+	throw "rmIO::checkStokesImageCube unknown file extension";
+      }
+  }
+
+
   /*!
     \brief Read a list of files
     
@@ -21,6 +21,7 @@
 #ifndef RMIO_H
 #define RMIO_H
 
+#include <string>
 #include <vector>
 #include <complex>
 
@@ -55,6 +56,10 @@ namespace RM {  //  BEGIN -- namespace RM
     
     It provides vector<double> and vector<complex<double> > reading and writing I/O.
     Most of the functions have been taken from the rm class.
+
+    Text files are read with a single read and parsed in place, files with
+    the extension .npy are NumPy binary arrays accessed through rmNpy (memory
+    mapped, 1-D or rows x columns float64, or complex128).
     
     <h3>Example(s)<h3>
     
@@ -193,10 +198,30 @@ namespace RM {  //  BEGIN -- namespace RM
     //! Check if U image cube is in correct format for RM-Synthesis
     bool checkImageCubeU (const std::string &filename,
 			  int hdu);
+
+    //! Check if an image cube (3-D or 4-D IQUV) contains Stokes parameter stokes
+    bool checkStokesImageCube (const std::string &filename,
+			       int hdu,
+			       int stokes);
     
     //! Read in a list of input/output files from a text file
     void readFileList (const std::string &filename,
 		       vector<std::string> &list);
+
+  private:
+
+    //! Read ncolumns columns of values from a text or .npy file
+    void readColumns (const std::string &filename,
+		      unsigned int ncolumns,
+		      vector<double> *columns[]);
+
+    //! Write ncolumns (strided) columns of values to a text or .npy file
+    void writeColumns (const std::string &filename,
+		       unsigned int ncolumns,
+		       const double *columns[],
+		       const unsigned int strides[],
+		       size_t rows,
+		       bool complexData=false);
   };
   
 }  //  END -- namespace RM
@@ -0,0 +1,364 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <iostream>
+#include <sstream>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "rmNpy.h"
+
+using namespace std;
+
+namespace RM {
+
+  //! .npy magic string
+  static const char npyMagic[]="\x93NUMPY";
+  //! length of the magic string
+  static const size_t npyMagicLength=6;
+
+  //_____________________________________________________________________________
+  //                                                               isLittleEndian
+
+  static bool isLittleEndian ()
+  {
+    const uint16_t one=1;
+    return *reinterpret_cast<const unsigned char*>(&one)==1;
+  }
+
+  // ============================================================================
+  //
+  //  Construction / Destruction
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                                        rmNpy
+
+  /*!
+    \param &filename - name of .npy file to map
+  */
+  rmNpy::rmNpy (const string &filename)
+  {
+    struct stat filestat;
+
+    this->filename=filename;
+    fd=-1;
+    map=NULL;
+    mapSize=0;
+    data=NULL;
+    complexData=false;
+    fortranOrder=false;
+
+    if(!isLittleEndian())
+      throw "rmNpy::rmNpy only little-endian hosts are supported";
+
+    fd=::open(filename.c_str(), O_RDONLY);
+    if(fd < 0)
+      throw "rmNpy::rmNpy could not open file";
+    if(fstat(fd, &filestat) || filestat.st_size < 10)
+    {
+      unmap();
+      throw "rmNpy::rmNpy file is not a .npy file";
+    }
+
+    mapSize=filestat.st_size;
+    map=mmap(NULL, mapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(map==MAP_FAILED)
+    {
+      map=NULL;
+      unmap();
+      throw "rmNpy::rmNpy could not map file";
+    }
+    madvise(map, mapSize, MADV_SEQUENTIAL);
+
+    // magic, version and header length (2 bytes in 1.0, 4 bytes from 2.0)
+    const unsigned char *bytes=static_cast<const unsigned char*>(map);
+    if(memcmp(bytes, npyMagic, npyMagicLength)!=0)
+    {
+      unmap();
+      throw "rmNpy::rmNpy file is not a .npy file";
+    }
+
+    size_t headerStart=0, headerLength=0;
+    if(bytes[6]==1)
+    {
+      headerLength=bytes[8] | (bytes[9] << 8);
+      headerStart=10;
+    }
+    else if((bytes[6]==2 || bytes[6]==3) && mapSize >= 12)
+    {
+      headerLength=bytes[8] | (bytes[9] << 8) | (bytes[10] << 16) |
+                   (static_cast<size_t>(bytes[11]) << 24);
+      headerStart=12;
+    }
+    else
+    {
+      unmap();
+      throw "rmNpy::rmNpy unsupported .npy version";
+    }
+
+    if(headerStart+headerLength > mapSize)
+    {
+      unmap();
+      throw "rmNpy::rmNpy header exceeds file";
+    }
+
+    try {
+      parseHeader(string(reinterpret_cast<const char*>(bytes+headerStart), headerLength));
+    }
+    catch (const char *) {
+      unmap();
+      throw;
+    }
+
+    uint64_t bytesNeeded=getNumElements()*(complexData ? 16 : 8);
+    if(headerStart+headerLength+bytesNeeded > mapSize)
+    {
+      unmap();
+      throw "rmNpy::rmNpy file is shorter than its shape";
+    }
+
+    data=reinterpret_cast<const double*>(bytes+headerStart+headerLength);
+  }
+
+  //_____________________________________________________________________________
+  //                                                                       ~rmNpy
+
+  rmNpy::~rmNpy ()
+  {
+    unmap();
+  }
+
+  //_____________________________________________________________________________
+  //                                                                        unmap
+
+  void rmNpy::unmap ()
+  {
+    if(map!=NULL)
+      munmap(map, mapSize);
+    if(fd >= 0)
+      ::close(fd);
+    map=NULL;
+    fd=-1;
+    data=NULL;
+  }
+
+  // ============================================================================
+  //
+  //  Methods
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                                  parseHeader
+
+  /*!
+    \brief Parse the dict literal of the header, e.g.
+    {'descr': '<f8', 'fortran_order': False, 'shape': (1024, 3), }
+
+    \param &header - header string following the magic and header length
+  */
+  void rmNpy::parseHeader (const string &header)
+  {
+    string::size_type pos;
+
+    // dtype
+    if((pos=header.find("'descr'"))==string::npos ||
+       (pos=header.find_first_of("'\"", header.find(':', pos)))==string::npos)
+      throw "rmNpy::parseHeader header has no descr";
+    string::size_type end=header.find(header[pos], pos+1);
+    if(end==string::npos)
+      throw "rmNpy::parseHeader malformed descr";
+    string descr=header.substr(pos+1, end-pos-1);
+    if(descr=="<f8")
+      complexData=false;
+    else if(descr=="<c16")
+      complexData=true;
+    else
+      throw "rmNpy::parseHeader only '<f8' and '<c16' arrays are supported";
+
+    // memory order
+    if((pos=header.find("'fortran_order'"))==string::npos ||
+       (pos=header.find_first_not_of(" :", pos+15))==string::npos)
+      throw "rmNpy::parseHeader header has no fortran_order";
+    fortranOrder=(header.compare(pos, 4, "True")==0);
+
+    // shape, e.g. (), (n,) or (n, m)
+    if((pos=header.find("'shape'"))==string::npos ||
+       (pos=header.find('(', pos))==string::npos ||
+       (end=header.find(')', pos))==string::npos)
+      throw "rmNpy::parseHeader header has no shape";
+
+    shape.clear();
+    const char *p=header.c_str()+pos+1;
+    const char *last=header.c_str()+end;
+    while(p < last)
+    {
+      char *next=NULL;
+      unsigned long long length=strtoull(p, &next, 10);
+      if(next==p)		// separator or trailing comma
+      {
+        p++;
+        continue;
+      }
+      shape.push_back(length);
+      p=next;
+    }
+
+    if(shape.empty())	// 0-d array holds one element
+      shape.push_back(1);
+    if(shape.size() > 2)
+      throw "rmNpy::parseHeader only 1-D and 2-D arrays are supported";
+  }
+
+  //_____________________________________________________________________________
+  //                                                               getNumElements
+
+  uint64_t rmNpy::getNumElements () const
+  {
+    uint64_t n=1;
+    for(unsigned int i=0; i<shape.size(); i++)
+      n*=shape[i];
+    return n;
+  }
+
+  //_____________________________________________________________________________
+  //                                                                   getNumRows
+
+  uint64_t rmNpy::getNumRows () const
+  {
+    return shape[0];
+  }
+
+  //_____________________________________________________________________________
+  //                                                                getNumColumns
+
+  unsigned int rmNpy::getNumColumns () const
+  {
+    unsigned int columns=(shape.size() > 1) ? shape[1] : 1;
+    return complexData ? 2*columns : columns;
+  }
+
+  //_____________________________________________________________________________
+  //                                                                   copyColumn
+
+  /*!
+    \param column - (0-based) real column, the real and imaginary part of
+                    complex column c are columns 2*c and 2*c+1
+    \param &values - vector to copy the column into (resized to the number of rows)
+  */
+  void rmNpy::copyColumn (unsigned int column,
+                          vector<double> &values) const
+  {
+    if(column >= getNumColumns())
+      throw "rmNpy::copyColumn column out of range";
+
+    const uint64_t rows=getNumRows();
+    const unsigned int parts=complexData ? 2 : 1;
+    const uint64_t columns=getNumColumns()/parts;
+
+    // offset of the first element and distance between rows
+    uint64_t first, stride;
+    if(fortranOrder)
+    {
+      first=(column/parts)*rows*parts + column%parts;
+      stride=parts;
+    }
+    else
+    {
+      first=(column/parts)*parts + column%parts;
+      stride=columns*parts;
+    }
+
+    if(stride==1)
+      values.assign(data+first, data+first+rows);
+    else
+    {
+      values.resize(rows);
+      for(uint64_t r=0; r<rows; r++)
+        values[r]=data[first+r*stride];
+    }
+  }
+
+  //_____________________________________________________________________________
+  //                                                                        write
+
+  /*!
+    \param &filename - name of .npy file to create (overwritten if it exists)
+    \param *values - rows*columns values in C order, interleaved real and
+                     imaginary parts if complexData (2*rows*columns doubles)
+    \param rows - number of rows
+    \param columns - number of columns, 1 writes a 1-D array of shape (rows,)
+    \param complexData - write complex128 instead of float64
+  */
+  void rmNpy::write (const string &filename,
+                     const double *values,
+                     uint64_t rows,
+                     unsigned int columns,
+                     bool complexData)
+  {
+    if(values==NULL && rows*columns > 0)
+      throw "rmNpy::write values is NULL";
+    if(columns==0)
+      throw "rmNpy::write columns is 0";
+    if(!isLittleEndian())
+      throw "rmNpy::write only little-endian hosts are supported";
+
+    ostringstream dict;
+    dict << "{'descr': '" << (complexData ? "<c16" : "<f8")
+         << "', 'fortran_order': False, 'shape': (" << rows;
+    if(columns > 1)
+      dict << ", " << columns << "), }";
+    else
+      dict << ",), }";
+
+    // pad with spaces so that the data start is 64-byte aligned
+    string header=dict.str();
+    size_t total=10+header.size()+1;
+    header.append((64-total%64)%64, ' ');
+    header+='\n';
+    if(header.size() > 65535)
+      throw "rmNpy::write header too long";
+
+    unsigned char preamble[10];
+    memcpy(preamble, npyMagic, npyMagicLength);
+    preamble[6]=1;
+    preamble[7]=0;
+    preamble[8]=header.size() & 0xff;
+    preamble[9]=(header.size() >> 8) & 0xff;
+
+    FILE *file=fopen(filename.c_str(), "wb");
+    if(file==NULL)
+      throw "rmNpy::write could not open file";
+
+    size_t nvalues=rows*columns*(complexData ? 2 : 1);
+    bool ok=(fwrite(preamble, 1, 10, file)==10 &&
+             fwrite(header.data(), 1, header.size(), file)==header.size() &&
+             (nvalues==0 || fwrite(values, sizeof(double), nvalues, file)==nvalues));
+    if(fclose(file)!=0 || !ok)
+      throw "rmNpy::write could not write file";
+  }
+
+}  // END -- namespace RM
@@ -0,0 +1,121 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef RM_NPY_H
+#define RM_NPY_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace RM {
+
+  /*!
+    \class rmNpy
+
+    \ingroup RM
+
+    \brief Memory mapped reader and writer for NumPy .npy binary arrays
+
+    \author Sven Duscha
+
+    \test trmNpy.cpp
+
+    <h3>Synopsis</h3>
+
+    The .npy format is a small self-describing header (magic string, version,
+    a Python dict literal with dtype, memory order and shape) followed by the
+    raw array. It is used to exchange large vectors (simulations, RMSFs,
+    Faraday spectra) with the regression suite without ASCII formatting.
+
+    A file is opened by mapping it into memory; the header is parsed once and
+    the array is accessed in place. Supported are 1-D and 2-D arrays of
+    little-endian float64 ('<f8') and complex128 ('<c16') in C or Fortran
+    order. A 2-D array of shape (rows, columns) is a table; a complex column
+    counts as two real columns (real, imaginary).
+  */
+  class rmNpy {
+
+  private:
+
+    //! file name
+    std::string filename;
+    //! POSIX file descriptor
+    int fd;
+    //! mapped file
+    void *map;
+    //! size of the mapping in bytes
+    size_t mapSize;
+    //! start of the array in the mapping
+    const double *data;
+    //! array shape
+    std::vector<uint64_t> shape;
+    //! array is complex128
+    bool complexData;
+    //! array is stored in Fortran (column-major) order
+    bool fortranOrder;
+
+    // no copies of the mapping and the file descriptor
+    rmNpy (const rmNpy &);
+    rmNpy &operator= (const rmNpy &);
+
+    void parseHeader (const std::string &header);
+    void unmap ();
+
+  public:
+
+    // === Construction =========================================================
+
+    //! Map filename and parse its header
+    rmNpy (const std::string &filename);
+
+    // === Destruction ==========================================================
+
+    ~rmNpy ();
+
+    // === Methods ==============================================================
+
+    inline const std::vector<uint64_t> &getShape () const { return shape; }
+    inline bool isComplex () const { return complexData; }
+    inline bool isFortranOrder () const { return fortranOrder; }
+    //! Get the array as stored (complex arrays interleave real and imaginary)
+    inline const double *getData () const { return data; }
+
+    //! Get the number of elements of the array
+    uint64_t getNumElements () const;
+    //! Get the number of rows (length of the first axis)
+    uint64_t getNumRows () const;
+    //! Get the number of real columns (a complex column counts twice)
+    unsigned int getNumColumns () const;
+    //! Copy real column column into values
+    void copyColumn (unsigned int column,
+                     std::vector<double> &values) const;
+
+    //! Write a 1-D (columns=1) or 2-D C-order array to filename
+    static void write (const std::string &filename,
+                       const double *values,
+                       uint64_t rows,
+                       unsigned int columns=1,
+                       bool complexData=false);
+  };
+
+}  // END -- namespace RM
+
+#endif
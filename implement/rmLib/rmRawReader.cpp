@@ -0,0 +1,595 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <iostream>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <fitsio.h>
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#endif
+#include "rmRawReader.h"
+
+using namespace std;
+
+namespace RM {
+
+  // ============================================================================
+  //
+  //  Construction / Destruction
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                                  rmRawReader
+
+  /*!
+    \param &filename - name of FITS file to read from
+    \param hdu - image HDU to read from (default 1)
+    \param queueDepth - maximum number of reads in flight (default 64)
+    \param nthreads - number of threads of the pread fallback (default 8)
+    \param useUring - use io_uring if available (default true)
+  */
+  rmRawReader::rmRawReader (const string &filename,
+                            int hdu,
+                            unsigned int queueDepth,
+                            unsigned int nthreads,
+                            bool useUring)
+  {
+    if(queueDepth==0 || nthreads==0)
+      throw "rmRawReader::rmRawReader queueDepth or nthreads is 0";
+
+    this->filename=filename;
+    this->queueDepth=queueDepth;
+    this->nthreads=nthreads;
+    fd=-1;
+    ring=NULL;
+
+    openData(hdu);
+
+    fd=::open(filename.c_str(), O_RDONLY);
+    if(fd < 0)
+      throw "rmRawReader::rmRawReader could not open file";
+
+    if(useUring)
+      initRing();
+  }
+
+  //_____________________________________________________________________________
+  //                                                                 ~rmRawReader
+
+  rmRawReader::~rmRawReader ()
+  {
+#ifdef HAVE_LIBURING
+    if(ring!=NULL)
+    {
+      io_uring_queue_exit(ring);
+      delete ring;
+    }
+#endif
+    if(fd >= 0)
+      ::close(fd);
+  }
+
+  //_____________________________________________________________________________
+  //                                                                     openData
+
+  /*!
+    \brief Get the position and format of the data unit from the FITS header
+
+    \param hdu - image HDU to read from
+  */
+  void rmRawReader::openData (int hdu)
+  {
+    fitsfile *fptr=NULL;
+    int status=0;
+    int hdutype=0;
+    int naxis=0;
+    LONGLONG headstart=0, dataend=0, start=0;
+    char fits_error_message[FLEN_STATUS];
+
+    if(fits_open_file(&fptr, filename.c_str(), READONLY, &status) ||
+       fits_movabs_hdu(fptr, hdu, &hdutype, &status))
+    {
+      fits_get_errstatus(status, fits_error_message);
+      cerr << fits_error_message << endl;
+      status=0;
+      if(fptr!=NULL)
+        fits_close_file(fptr, &status);
+      throw "rmRawReader::openData could not open HDU";
+    }
+
+    if(hdutype!=IMAGE_HDU || fits_is_compressed_image(fptr, &status))
+    {
+      fits_close_file(fptr, &status);
+      throw "rmRawReader::openData HDU is not an uncompressed image";
+    }
+
+    fits_get_img_type(fptr, &bitpix, &status);
+    fits_get_img_dim(fptr, &naxis, &status);
+    vector<LONGLONG> naxes(naxis);
+    if(naxis > 0)
+      fits_get_img_sizell(fptr, naxis, &naxes[0], &status);
+    fits_get_hduaddrll(fptr, &headstart, &start, &dataend, &status);
+    if(status || naxis==0)
+    {
+      status=0;
+      fits_close_file(fptr, &status);
+      throw "rmRawReader::openData could not get image parameters";
+    }
+    dimensions.assign(naxes.begin(), naxes.end());
+    datastart=start;
+    bytesPerPixel=abs(bitpix)/8;
+
+    // optional keys
+    bscale=1.0;
+    bzero=0.0;
+    fits_read_key(fptr, TDOUBLE, "BSCALE", &bscale, NULL, &status);
+    status=0;
+    fits_read_key(fptr, TDOUBLE, "BZERO", &bzero, NULL, &status);
+    status=0;
+    LONGLONG blankvalue=0;
+    hasBlank=(bitpix > 0 && fits_read_key(fptr, TLONGLONG, "BLANK", &blankvalue, NULL, &status)==0);
+    blank=blankvalue;
+    status=0;
+
+    fits_close_file(fptr, &status);
+  }
+
+  //_____________________________________________________________________________
+  //                                                                     initRing
+
+  /*!
+    \brief Set up the io_uring; leaves ring NULL (pread fallback) if liburing
+    is not available at build time or the kernel refuses the ring
+  */
+  void rmRawReader::initRing ()
+  {
+#ifdef HAVE_LIBURING
+    ring=new struct io_uring;
+    if(io_uring_queue_init(queueDepth, ring, 0) < 0)
+    {
+      delete ring;
+      ring=NULL;
+    }
+#endif
+  }
+
+  // ============================================================================
+  //
+  //  Methods
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                                      convert
+
+  /*!
+    \brief Convert big-endian FITS values into scaled doubles
+
+    \param *raw - nelements values as stored in the file
+    \param nelements - number of values
+    \param *out - converted values (may alias raw for BITPIX -64)
+  */
+  void rmRawReader::convert (const unsigned char *raw,
+                             uint64_t nelements,
+                             double *out) const
+  {
+    const double nan=NAN;
+
+    for(uint64_t i=0; i<nelements; i++)
+    {
+      const unsigned char *p=raw+i*bytesPerPixel;
+      uint64_t bits=0;
+      for(unsigned int b=0; b<bytesPerPixel; b++)
+        bits=(bits << 8) | p[b];
+
+      double value=0;
+      int64_t ivalue=0;
+      switch(bitpix)
+      {
+        case BYTE_IMG:
+          ivalue=static_cast<uint8_t>(bits);
+          break;
+        case SHORT_IMG:
+          ivalue=static_cast<int16_t>(bits);
+          break;
+        case LONG_IMG:
+          ivalue=static_cast<int32_t>(bits);
+          break;
+        case LONGLONG_IMG:
+          ivalue=static_cast<int64_t>(bits);
+          break;
+        case FLOAT_IMG:
+        {
+          uint32_t b32=static_cast<uint32_t>(bits);
+          float f;
+          memcpy(&f, &b32, sizeof(f));
+          value=f;
+          break;
+        }
+        case DOUBLE_IMG:
+          memcpy(&value, &bits, sizeof(value));
+          break;
+      }
+
+      if(bitpix > 0)
+      {
+        if(hasBlank && ivalue==blank)
+        {
+          out[i]=nan;
+          continue;
+        }
+        value=static_cast<double>(ivalue);
+      }
+      out[i]=value*bscale+bzero;
+    }
+  }
+
+  //_____________________________________________________________________________
+  //                                                                    readFully
+
+  /*!
+    \brief Synchronous pread of bytes at position, retrying short reads
+  */
+  void rmRawReader::readFully (unsigned char *raw,
+                               uint64_t bytes,
+                               uint64_t position) const
+  {
+    while(bytes > 0)
+    {
+      ssize_t n=pread(fd, raw, bytes, position);
+      if(n < 0 && errno==EINTR)
+        continue;
+      if(n <= 0)
+        throw "rmRawReader::readFully pread failed";
+      raw+=n;
+      bytes-=n;
+      position+=n;
+    }
+  }
+
+  //_____________________________________________________________________________
+  //                                                                 checkRequest
+
+  void rmRawReader::checkRequest (const rmRawRequest &request) const
+  {
+    uint64_t npixels=1;
+    for(unsigned int i=0; i<dimensions.size(); i++)
+      npixels*=dimensions[i];
+
+    if(request.buffer==NULL)
+      throw "rmRawReader::read request buffer is NULL";
+    if(request.nelements==0 || request.offset+request.nelements > npixels)
+      throw "rmRawReader::read request exceeds image";
+  }
+
+  //_____________________________________________________________________________
+  //                                                                         read
+
+  /*!
+    \brief Read a batch of requests and deliver each completion
+
+    \param &requests - requests, completed in arbitrary order
+    \param *completion - receiver of completions (optional)
+  */
+  void rmRawReader::read (vector<rmRawRequest> &requests,
+                          rmRawCompletion *completion)
+  {
+    for(unsigned int i=0; i<requests.size(); i++)
+      checkRequest(requests[i]);
+
+    if(requests.size()==0)
+      return;
+
+    if(ring!=NULL)
+      readUring(requests, completion);
+    else
+      readThreads(requests, completion);
+  }
+
+  //_____________________________________________________________________________
+  //                                                                    readUring
+
+  /*!
+    \brief Keep up to queueDepth reads in flight on the io_uring
+
+    Each in-flight read owns a staging slot holding the raw bytes; for
+    BITPIX -64 the destination buffer itself is used and converted in place.
+
+    After an error no new reads are queued, but the reads in flight are
+    still reaped before the error is thrown. If the ring itself fails (SQEs
+    the kernel did not take, or waiting for completions fails) the ring is
+    closed, which cancels what is left on it, and later batches use the
+    pread threads.
+  */
+  void rmRawReader::readUring (vector<rmRawRequest> &requests,
+                               rmRawCompletion *completion)
+  {
+#ifdef HAVE_LIBURING
+    vector<vector<unsigned char> > staging(queueDepth);
+    vector<size_t> slotRequest(queueDepth);
+    vector<unsigned int> freeSlots;
+    vector<unsigned int> queuedSlots;
+    size_t next=0;
+    const char *error=NULL;
+    bool retire=false;
+
+    for(unsigned int s=0; s<queueDepth; s++)
+      freeSlots.push_back(queueDepth-1-s);
+
+    for(;;)
+    {
+      // fill the submission queue
+      queuedSlots.clear();
+      while(next < requests.size() && !freeSlots.empty() && error==NULL)
+      {
+        struct io_uring_sqe *sqe=io_uring_get_sqe(ring);
+        if(sqe==NULL)
+          break;
+
+        unsigned int slot=freeSlots.back();
+        freeSlots.pop_back();
+        const rmRawRequest &request=requests[next];
+        uint64_t bytes=request.nelements*bytesPerPixel;
+        unsigned char *dst=reinterpret_cast<unsigned char*>(request.buffer);
+        if(bitpix!=DOUBLE_IMG)
+        {
+          staging[slot].resize(bytes);
+          dst=&staging[slot][0];
+        }
+
+        // larger requests complete short and are finished by readFully
+        unsigned int length=bytes > (1u << 30) ? (1u << 30) : bytes;
+        io_uring_prep_read(sqe, fd, dst, length, datastart+request.offset*bytesPerPixel);
+        io_uring_sqe_set_data(sqe, reinterpret_cast<void*>(static_cast<uintptr_t>(slot)));
+        slotRequest[slot]=next++;
+        queuedSlots.push_back(slot);
+      }
+      if(queuedSlots.size() > 0)
+      {
+        // the kernel takes SQEs in order; the ones it did not take are not
+        // in flight, their slots are free again
+        int submitted=io_uring_submit(ring);
+        size_t taken=submitted > 0 ? submitted : 0;
+        if(taken < queuedSlots.size())
+        {
+          for(size_t k=taken; k<queuedSlots.size(); k++)
+            freeSlots.push_back(queuedSlots[k]);
+          if(error==NULL)
+            error="rmRawReader::readUring submit failed";
+          retire=true;	// untaken SQEs are still in the submission queue
+        }
+      }
+
+      // batch done, or failed and no reads left in flight
+      if(freeSlots.size()==queueDepth && (next==requests.size() || error!=NULL))
+        break;
+
+      // reap at least one completion
+      struct io_uring_cqe *cqe=NULL;
+      int waited=io_uring_wait_cqe(ring, &cqe);
+      if(waited==-EINTR || waited==-EAGAIN)
+        continue;
+      if(waited < 0)
+      {
+        // no completion can be reaped: closing the ring cancels the reads
+        // still in flight
+        if(error==NULL)
+          error="rmRawReader::readUring wait failed";
+        retire=true;
+        break;
+      }
+      while(cqe!=NULL)
+      {
+        unsigned int slot=static_cast<unsigned int>(reinterpret_cast<uintptr_t>(io_uring_cqe_get_data(cqe)));
+        int result=cqe->res;
+        io_uring_cqe_seen(ring, cqe);
+
+        const rmRawRequest &request=requests[slotRequest[slot]];
+        uint64_t bytes=request.nelements*bytesPerPixel;
+        unsigned char *raw=(bitpix==DOUBLE_IMG) ?
+          reinterpret_cast<unsigned char*>(request.buffer) : &staging[slot][0];
+
+        try
+        {
+          if(result < 0)
+            throw "rmRawReader::readUring read failed";
+          if(static_cast<uint64_t>(result) < bytes)	// short read: finish synchronously
+            readFully(raw+result, bytes-result, datastart+request.offset*bytesPerPixel+result);
+
+          convert(raw, request.nelements, request.buffer);
+          if(completion!=NULL)
+            completion->complete(request);
+        }
+        catch(const char *s)
+        {
+          if(error==NULL)
+            error=s;
+        }
+
+        freeSlots.push_back(slot);
+
+        cqe=NULL;
+        if(io_uring_peek_cqe(ring, &cqe)!=0)
+          cqe=NULL;
+      }
+    }
+
+    if(retire)
+    {
+      io_uring_queue_exit(ring);
+      delete ring;
+      ring=NULL;
+    }
+
+    if(error!=NULL)
+      throw error;
+#else
+    readThreads(requests, completion);
+#endif
+  }
+
+  //_____________________________________________________________________________
+  //                                                                  readThreads
+
+  /*!
+    \brief pread fallback: nthreads workers take the next request from the batch
+  */
+  void rmRawReader::readThreads (vector<rmRawRequest> &requests,
+                                 rmRawCompletion *completion)
+  {
+    batch b;
+    b.reader=this;
+    b.requests=&requests;
+    b.completion=completion;
+    b.next=0;
+    b.error=NULL;
+    pthread_mutex_init(&b.mutex, NULL);
+
+    unsigned int n=nthreads < requests.size() ? nthreads : requests.size();
+    vector<pthread_t> threads(n);
+    unsigned int started=0;
+    for(; started<n; started++)
+      if(pthread_create(&threads[started], NULL, readWorker, &b))
+        break;
+    if(started==0)	// no threads at all: read in the calling thread
+      readWorker(&b);
+    for(unsigned int t=0; t<started; t++)
+      pthread_join(threads[t], NULL);
+
+    pthread_mutex_destroy(&b.mutex);
+    if(b.error!=NULL)
+      throw b.error;
+  }
+
+  //_____________________________________________________________________________
+  //                                                                   readWorker
+
+  void *rmRawReader::readWorker (void *arg)
+  {
+    batch *b=static_cast<batch*>(arg);
+    const rmRawReader *reader=b->reader;
+    vector<unsigned char> staging;
+
+    for(;;)
+    {
+      pthread_mutex_lock(&b->mutex);
+      if(b->error!=NULL || b->next >= b->requests->size())
+      {
+        pthread_mutex_unlock(&b->mutex);
+        break;
+      }
+      const rmRawRequest &request=(*b->requests)[b->next++];
+      pthread_mutex_unlock(&b->mutex);
+
+      uint64_t bytes=request.nelements*reader->bytesPerPixel;
+      unsigned char *raw=reinterpret_cast<unsigned char*>(request.buffer);
+      if(reader->bitpix!=DOUBLE_IMG)
+      {
+        staging.resize(bytes);
+        raw=&staging[0];
+      }
+
+      try
+      {
+        reader->readFully(raw, bytes, reader->datastart+request.offset*reader->bytesPerPixel);
+        reader->convert(raw, request.nelements, request.buffer);
+      }
+      catch(const char *s)
+      {
+        pthread_mutex_lock(&b->mutex);
+        if(b->error==NULL)
+          b->error=s;
+        pthread_mutex_unlock(&b->mutex);
+        break;
+      }
+
+      if(b->completion!=NULL)	// completions are serialised
+      {
+        pthread_mutex_lock(&b->mutex);
+        b->completion->complete(request);
+        pthread_mutex_unlock(&b->mutex);
+      }
+    }
+
+    return NULL;
+  }
+
+  //_____________________________________________________________________________
+  //                                                                       addRow
+
+  /*!
+    \param &requests - batch to append to
+    \param x - first pixel (1-based) on axis 1
+    \param y - row (1-based) on axis 2
+    \param z - plane (1-based) on axis 3 (1 for 2-D images)
+    \param n - number of pixels
+    \param *buffer - destination of n values
+    \param *tag - caller data passed back with the completion
+  */
+  void rmRawReader::addRow (vector<rmRawRequest> &requests,
+                            uint64_t x,
+                            uint64_t y,
+                            uint64_t z,
+                            uint64_t n,
+                            double *buffer,
+                            void *tag) const
+  {
+    uint64_t nx=dimensions[0];
+    uint64_t ny=dimensions.size() > 1 ? dimensions[1] : 1;
+
+    if(x < 1 || y < 1 || z < 1 || x+n-1 > nx || y > ny)
+      throw "rmRawReader::addRow position out of range";
+
+    rmRawRequest request;
+    request.offset=((z-1)*ny+(y-1))*nx+(x-1);
+    request.nelements=n;
+    request.buffer=buffer;
+    request.tag=tag;
+    requests.push_back(request);
+  }
+
+  //_____________________________________________________________________________
+  //                                                                      addTile
+
+  /*!
+    \brief Append one request per tile row; the tile is complete once all ny
+    completions carrying tag have been delivered
+
+    \param *buffer - destination of the tile [ny][nx]
+  */
+  void rmRawReader::addTile (vector<rmRawRequest> &requests,
+                             uint64_t x,
+                             uint64_t y,
+                             uint64_t z,
+                             uint64_t nx,
+                             uint64_t ny,
+                             double *buffer,
+                             void *tag) const
+  {
+    for(uint64_t j=0; j<ny; j++)
+      addRow(requests, x, y+j, z, nx, buffer+j*nx, tag);
+  }
+
+}  // END -- namespace RM
@@ -0,0 +1,194 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef RM_RAWREADER_H
+#define RM_RAWREADER_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <pthread.h>
+
+// liburing is only included by the implementation
+struct io_uring;
+
+namespace RM {
+
+  /*!
+    \brief One raw read: nelements consecutive pixels starting at a linear
+    (0-based) pixel offset into the data unit of the image
+  */
+  struct rmRawRequest {
+    //! linear pixel offset, ((z*NAXIS2)+y)*NAXIS1+x for a cube
+    uint64_t offset;
+    //! number of consecutive pixels
+    uint64_t nelements;
+    //! destination for the (scaled) values as double
+    double *buffer;
+    //! caller data passed back with the completion (e.g. buffer pool slot)
+    void *tag;
+  };
+
+  /*!
+    \brief Receiver of completed raw reads
+
+    complete() is called once per request, after its buffer has been filled.
+    Calls are serialised, so an implementation does not need its own lock.
+  */
+  class rmRawCompletion {
+  public:
+    virtual ~rmRawCompletion () {}
+    virtual void complete (const rmRawRequest &request)=0;
+  };
+
+  /*!
+    \class rmRawReader
+
+    \ingroup RM
+
+    \brief Asynchronous raw reader for the data unit of a FITS image
+
+    \author Sven Duscha
+
+    \test trmRawReader.cpp
+
+    <h3>Synopsis</h3>
+
+    Reads scattered rows and tiles of an uncompressed FITS image directly
+    from the file, bypassing cfitsio. The byte offset of the data unit,
+    BITPIX, BSCALE/BZERO and BLANK are taken from the header once; values
+    are converted from big-endian to double and BLANK integers become NaN.
+
+    A batch of requests is either submitted to a Linux io_uring with up to
+    queueDepth reads in flight (if built with liburing and the kernel
+    supports it) or distributed over a pool of threads doing pread(). In
+    both cases every completion is handed to an rmRawCompletion as soon as
+    its data has arrived, so a pipeline can start on a tile while other
+    reads are still outstanding.
+
+    Compressed images (tile-compressed HDUs) are not supported, since their
+    pixels are not at fixed offsets.
+  */
+  class rmRawReader {
+
+  private:
+
+    //! file name
+    std::string filename;
+    //! POSIX file descriptor
+    int fd;
+    //! byte offset of the data unit in the file
+    uint64_t datastart;
+    //! bits per pixel
+    int bitpix;
+    //! bytes per pixel
+    unsigned int bytesPerPixel;
+    //! image dimensions
+    std::vector<int64_t> dimensions;
+    //! scaling of stored values
+    double bscale, bzero;
+    //! integer value of undefined pixels
+    bool hasBlank;
+    int64_t blank;
+
+    //! maximum number of reads in flight
+    unsigned int queueDepth;
+    //! number of threads of the pread fallback
+    unsigned int nthreads;
+    //! io_uring (NULL if the pread fallback is used)
+    struct io_uring *ring;
+
+    // no copies of the file descriptor and the ring
+    rmRawReader (const rmRawReader &);
+    rmRawReader &operator= (const rmRawReader &);
+
+    //! state shared by the pread threads of one batch
+    struct batch {
+      rmRawReader *reader;
+      std::vector<rmRawRequest> *requests;
+      rmRawCompletion *completion;
+      size_t next;
+      const char *error;
+      pthread_mutex_t mutex;
+    };
+
+    void openData (int hdu);
+    void initRing ();
+    void convert (const unsigned char *raw,
+                  uint64_t nelements,
+                  double *out) const;
+    void readFully (unsigned char *raw,
+                    uint64_t bytes,
+                    uint64_t position) const;
+    void checkRequest (const rmRawRequest &request) const;
+    void readUring (std::vector<rmRawRequest> &requests,
+                    rmRawCompletion *completion);
+    void readThreads (std::vector<rmRawRequest> &requests,
+                      rmRawCompletion *completion);
+    static void *readWorker (void *arg);
+
+  public:
+
+    // === Construction =========================================================
+
+    //! Open the image in HDU hdu of filename for raw reads
+    rmRawReader (const std::string &filename,
+                 int hdu=1,
+                 unsigned int queueDepth=64,
+                 unsigned int nthreads=8,
+                 bool useUring=true);
+
+    // === Destruction ==========================================================
+
+    ~rmRawReader ();
+
+    // === Methods ==============================================================
+
+    //! Read a batch of requests, returns when all have completed
+    void read (std::vector<rmRawRequest> &requests,
+               rmRawCompletion *completion=NULL);
+
+    //! Append the request for n pixels of row y in plane z (all 1-based) from x
+    void addRow (std::vector<rmRawRequest> &requests,
+                 uint64_t x,
+                 uint64_t y,
+                 uint64_t z,
+                 uint64_t n,
+                 double *buffer,
+                 void *tag=NULL) const;
+    //! Append the requests (one per row) for an nx*ny tile of plane z at x, y
+    void addTile (std::vector<rmRawRequest> &requests,
+                  uint64_t x,
+                  uint64_t y,
+                  uint64_t z,
+                  uint64_t nx,
+                  uint64_t ny,
+                  double *buffer,
+                  void *tag=NULL) const;
+
+    //! Check if reads go through io_uring
+    inline bool usesUring () const { return ring!=NULL; }
+    inline const std::vector<int64_t> &getDimensions () const { return dimensions; }
+    inline int getBitpix () const { return bitpix; }
+  };
+
+}  // END -- namespace RM
+
+#endif
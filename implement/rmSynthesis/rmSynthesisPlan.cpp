@@ -0,0 +1,261 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <math.h>
+#include "rmSynthesisPlan.h"
+
+using namespace std;
+
+namespace RM {
+
+  // ============================================================================
+  //
+  //  rmSynthesisPlan
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                              rmSynthesisPlan
+
+  /*!
+    \param &phis - Faraday depths to compute
+    \param &lambdaSquareds - lambda squareds of all channels
+    \param &weights - weights of all channels
+    \param &deltaLambdaSquareds - delta lambda squareds of all channels
+    \param &pattern - flag pattern, bit c set if channel c is valid
+    \param lambdaZero - wavelength to derotate polarization vectors to, default 0
+  */
+  rmSynthesisPlan::rmSynthesisPlan (const vector<double> &phis,
+                                    const vector<double> &lambdaSquareds,
+                                    const vector<double> &weights,
+                                    const vector<double> &deltaLambdaSquareds,
+                                    const vector<uint64_t> &pattern,
+                                    double lambdaZero)
+  {
+    const uint64_t nchannels=lambdaSquareds.size();
+
+    if(weights.size()!=nchannels || deltaLambdaSquareds.size()!=nchannels)
+      throw "rmSynthesisPlan::rmSynthesisPlan channel vectors differ in size";
+    if(pattern.size()!=(nchannels+63)/64)
+      throw "rmSynthesisPlan::rmSynthesisPlan pattern does not match channels";
+
+    double K=0;
+    for(uint64_t c=0; c<nchannels; c++)
+    {
+      if((pattern[c/64] >> (c % 64)) & 1)
+      {
+        channels.push_back(c);
+        K+=weights[c];
+      }
+    }
+    K=(K!=0) ? 1/K : 1;		// do not divide by zero
+
+    const double lambdaZeroSq=lambdaZero*lambdaZero;
+    const uint64_t nvalid=channels.size();
+
+    nphis=phis.size();
+    cosines.resize(nphis*nvalid);
+    sines.resize(nphis*nvalid);
+    for(uint64_t i=0; i<nphis; i++)
+    {
+      for(uint64_t k=0; k<nvalid; k++)
+      {
+        uint64_t c=channels[k];
+        double factor=K*weights[c]*deltaLambdaSquareds[c];
+        double arg=-2.0*phis[i]*(lambdaSquareds[c]-lambdaZeroSq);
+        cosines[i*nvalid+k]=factor*cos(arg);
+        sines[i*nvalid+k]=factor*sin(arg);
+      }
+    }
+  }
+
+  //_____________________________________________________________________________
+  //                                                                        apply
+
+  /*!
+    \param *q - Q of channel c at q[c*stride]
+    \param *u - U of channel c at u[c*stride]
+    \param stride - distance between channels in q and u
+    \param *out - P(phi_i) is written to out[i*outStride]
+    \param outStride - distance between Faraday depths in out
+  */
+  void rmSynthesisPlan::apply (const double *q,
+                               const double *u,
+                               uint64_t stride,
+                               complex<double> *out,
+                               uint64_t outStride) const
+  {
+    const uint64_t nvalid=channels.size();
+
+    // gather valid channels once, the phi loop then runs on dense arrays
+    vector<double> qv(nvalid), uv(nvalid);
+    for(uint64_t k=0; k<nvalid; k++)
+    {
+      qv[k]=q[channels[k]*stride];
+      uv[k]=u[channels[k]*stride];
+    }
+
+    for(uint64_t i=0; i<nphis; i++)
+    {
+      const double *cs=&cosines[i*nvalid];
+      const double *sn=&sines[i*nvalid];
+      double re=0, im=0;
+
+      // (q+iu)*(c+is)
+      for(uint64_t k=0; k<nvalid; k++)
+      {
+        re+=qv[k]*cs[k]-uv[k]*sn[k];
+        im+=qv[k]*sn[k]+uv[k]*cs[k];
+      }
+      out[i*outStride]=complex<double>(re, im);
+    }
+  }
+
+  // ============================================================================
+  //
+  //  rmSynthesisPlanCache
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                         rmSynthesisPlanCache
+
+  /*!
+    \param &phis - Faraday depths to compute
+    \param &lambdaSquareds - lambda squareds of all channels
+    \param &weights - weights of all channels
+    \param &deltaLambdaSquareds - delta lambda squareds of all channels
+    \param lambdaZero - wavelength to derotate polarization vectors to, default 0
+    \param maxPlans - maximum number of plans kept (default 256)
+  */
+  rmSynthesisPlanCache::rmSynthesisPlanCache (const vector<double> &phis,
+                                              const vector<double> &lambdaSquareds,
+                                              const vector<double> &weights,
+                                              const vector<double> &deltaLambdaSquareds,
+                                              double lambdaZero,
+                                              uint64_t maxPlans)
+  {
+    if(phis.size()==0 || lambdaSquareds.size()==0)
+      throw "rmSynthesisPlanCache::rmSynthesisPlanCache no Faraday depths or channels";
+    if(weights.size()!=lambdaSquareds.size() || deltaLambdaSquareds.size()!=lambdaSquareds.size())
+      throw "rmSynthesisPlanCache::rmSynthesisPlanCache channel vectors differ in size";
+    if(maxPlans==0)
+      throw "rmSynthesisPlanCache::rmSynthesisPlanCache maxPlans is 0";
+
+    this->phis=phis;
+    this->lambdaSquareds=lambdaSquareds;
+    this->weights=weights;
+    this->deltaLambdaSquareds=deltaLambdaSquareds;
+    this->lambdaZero=lambdaZero;
+    this->maxPlans=maxPlans;
+  }
+
+  //_____________________________________________________________________________
+  //                                                        ~rmSynthesisPlanCache
+
+  rmSynthesisPlanCache::~rmSynthesisPlanCache ()
+  {
+    clear();
+  }
+
+  //_____________________________________________________________________________
+  //                                                                        clear
+
+  void rmSynthesisPlanCache::clear ()
+  {
+    for(map<vector<uint64_t>, rmSynthesisPlan*>::iterator it=plans.begin(); it!=plans.end(); ++it)
+      delete it->second;
+    plans.clear();
+  }
+
+  //_____________________________________________________________________________
+  //                                                                      getPlan
+
+  /*!
+    \param &pattern - flag pattern (see rmValidityMask::getPattern)
+
+    \return plan - plan for the valid channels of pattern
+  */
+  const rmSynthesisPlan &rmSynthesisPlanCache::getPlan (const vector<uint64_t> &pattern)
+  {
+    map<vector<uint64_t>, rmSynthesisPlan*>::iterator it=plans.find(pattern);
+    if(it!=plans.end())
+      return *it->second;
+
+    if(plans.size() >= maxPlans)	// pathological flagging: start over
+      clear();
+
+    rmSynthesisPlan *plan=new rmSynthesisPlan(phis, lambdaSquareds, weights,
+                                              deltaLambdaSquareds, pattern, lambdaZero);
+    plans[pattern]=plan;
+
+    return *plan;
+  }
+
+  //_____________________________________________________________________________
+  //                                                                   synthesize
+
+  /*!
+    \brief RM-Synthesis of a tile of lines of sight honouring the validity mask
+
+    \param *q - Stokes Q [channel][npixels] (plane-major, as read by rmFITS)
+    \param *u - Stokes U [channel][npixels]
+    \param &mask - validity of each sample
+    \param *out - Faraday spectrum [phi][npixels] (layout of rmFITSproducts::writeTile)
+  */
+  void rmSynthesisPlanCache::synthesize (const double *q,
+                                         const double *u,
+                                         const rmValidityMask &mask,
+                                         complex<double> *out)
+  {
+    const uint64_t npixels=mask.getNumPixels();
+
+    if(q==NULL || u==NULL || out==NULL)
+      throw "rmSynthesisPlanCache::synthesize NULL pointer";
+    if(mask.getNumChannels()!=lambdaSquareds.size())
+      throw "rmSynthesisPlanCache::synthesize mask does not match channels";
+
+    // group lines of sight by flag pattern, skipping blank ones
+    map<vector<uint64_t>, vector<uint64_t> > groups;
+    for(uint64_t p=0; p<npixels; p++)
+    {
+      if(mask.isBlank(p))
+      {
+        for(uint64_t i=0; i<phis.size(); i++)
+          out[i*npixels+p]=0;
+        continue;
+      }
+      groups[mask.getPattern(p)].push_back(p);
+    }
+
+    for(map<vector<uint64_t>, vector<uint64_t> >::iterator it=groups.begin(); it!=groups.end(); ++it)
+    {
+      const rmSynthesisPlan &plan=getPlan(it->first);
+      const vector<uint64_t> &pixels=it->second;
+
+      for(uint64_t n=0; n<pixels.size(); n++)
+      {
+        uint64_t p=pixels[n];
+        plan.apply(q+p, u+p, npixels, out+p, npixels);
+      }
+    }
+  }
+
+}  // END -- namespace RM
@@ -0,0 +1,160 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef RMSYNTHESISPLAN_H
+#define RMSYNTHESISPLAN_H
+
+#include <vector>
+#include <map>
+#include <complex>
+#include <stdint.h>
+
+#include "rmValidityMask.h"
+
+namespace RM {
+
+  /*!
+    \class rmSynthesisPlan
+
+    \ingroup RM
+
+    \brief Precomputed RM-Synthesis kernel for one channel flag pattern
+
+    \author Sven Duscha
+
+    \test trmSynthesisPlan.cpp
+
+    The plan holds the phase factors
+
+      K*w_c*dlambda^2_c*exp(-2i*phi*(lambda^2_c-lambda^2_0))
+
+    for all Faraday depths and only the valid channels of its flag pattern,
+    with K=1/sum(w_c) over those channels. Flagged channels therefore
+    neither enter the transform as zeros nor bias the normalisation, and
+    the inner loop runs over a dense array of valid channels.
+  */
+  class rmSynthesisPlan {
+
+  private:
+
+    //! number of Faraday depths
+    uint64_t nphis;
+    //! indices of valid channels
+    std::vector<uint64_t> channels;
+    //! real/imaginary phase factors [phi][valid channel]
+    std::vector<double> cosines;
+    std::vector<double> sines;
+
+  public:
+
+    // === Construction =========================================================
+
+    //! Build the plan for the channels set in mask at line of sight pixel
+    rmSynthesisPlan (const std::vector<double> &phis,
+                     const std::vector<double> &lambdaSquareds,
+                     const std::vector<double> &weights,
+                     const std::vector<double> &deltaLambdaSquareds,
+                     const std::vector<uint64_t> &pattern,
+                     double lambdaZero=0);
+
+    // === Methods ==============================================================
+
+    //! Transform one line of sight; q/u are read with stride, out with stride
+    void apply (const double *q,
+                const double *u,
+                uint64_t stride,
+                std::complex<double> *out,
+                uint64_t outStride) const;
+
+    inline uint64_t getNumValidChannels () const { return channels.size(); }
+  };
+
+
+  /*!
+    \class rmSynthesisPlanCache
+
+    \ingroup RM
+
+    \brief Plans of RM-Synthesis cached per distinct channel flag pattern
+
+    \author Sven Duscha
+
+    \test trmSynthesisPlan.cpp
+
+    Lines of sight of a tile are grouped by their flag pattern; each group
+    is transformed with the plan of that pattern, which is built on first
+    use. Fully blanked lines of sight are skipped (their output is 0). In
+    typical data only a handful of patterns exist (unflagged, RFI-flagged
+    channels, partially blanked edges), so plans are reused across tiles.
+  */
+  class rmSynthesisPlanCache {
+
+  private:
+
+    std::vector<double> phis;
+    std::vector<double> lambdaSquareds;
+    std::vector<double> weights;
+    std::vector<double> deltaLambdaSquareds;
+    double lambdaZero;
+
+    //! maximum number of plans kept; cache is cleared when it is exceeded
+    uint64_t maxPlans;
+    //! plans by flag pattern
+    std::map<std::vector<uint64_t>, rmSynthesisPlan*> plans;
+
+    // no copies of the owned plans
+    rmSynthesisPlanCache (const rmSynthesisPlanCache &);
+    rmSynthesisPlanCache &operator= (const rmSynthesisPlanCache &);
+
+  public:
+
+    // === Construction =========================================================
+
+    rmSynthesisPlanCache (const std::vector<double> &phis,
+                          const std::vector<double> &lambdaSquareds,
+                          const std::vector<double> &weights,
+                          const std::vector<double> &deltaLambdaSquareds,
+                          double lambdaZero=0,
+                          uint64_t maxPlans=256);
+
+    // === Destruction ==========================================================
+
+    ~rmSynthesisPlanCache ();
+
+    // === Methods ==============================================================
+
+    //! Get (and build if necessary) the plan of a flag pattern
+    const rmSynthesisPlan &getPlan (const std::vector<uint64_t> &pattern);
+
+    //! RM-Synthesis of a tile: q, u [channel][npixels], out [phi][npixels]
+    void synthesize (const double *q,
+                     const double *u,
+                     const rmValidityMask &mask,
+                     std::complex<double> *out);
+
+    //! Drop all cached plans
+    void clear ();
+
+    inline uint64_t getNumPlans () const { return plans.size(); }
+  };
+
+}  // END -- namespace RM
+
+#endif
@@ -0,0 +1,162 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <math.h>
+#include "rmValidityMask.h"
+
+using namespace std;
+
+namespace RM {
+
+  // ============================================================================
+  //
+  //  Construction
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                               rmValidityMask
+
+  /*!
+    \param npixels - number of lines of sight
+    \param nchannels - number of channels per line of sight
+  */
+  rmValidityMask::rmValidityMask (uint64_t npixels,
+                                  uint64_t nchannels)
+  {
+    if(npixels==0 || nchannels==0)
+      throw "rmValidityMask::rmValidityMask dimension is 0";
+
+    this->npixels=npixels;
+    this->nchannels=nchannels;
+    nwords=(nchannels+63)/64;
+
+    // all valid; bits beyond nchannels stay 0 so patterns compare exactly
+    bits.assign(npixels*nwords, ~0ULL);
+    if(nchannels % 64)
+      for(uint64_t p=0; p<npixels; p++)
+        bits[p*nwords+nwords-1]=(1ULL << (nchannels % 64))-1;
+  }
+
+  // ============================================================================
+  //
+  //  Methods
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                                          set
+
+  void rmValidityMask::set (uint64_t pixel,
+                            uint64_t channel,
+                            bool valid)
+  {
+    if(pixel >= npixels || channel >= nchannels)
+      throw "rmValidityMask::set pixel or channel out of range";
+
+    uint64_t &word=bits[pixel*nwords+channel/64];
+    if(valid)
+      word|=1ULL << (channel % 64);
+    else
+      word&=~(1ULL << (channel % 64));
+  }
+
+  //_____________________________________________________________________________
+  //                                                        setPlaneFromNullFlags
+
+  /*!
+    \param channel - channel (0-based) the plane belongs to
+    \param *nullflags - npixels flags as returned by fits_read_pixnull
+  */
+  void rmValidityMask::setPlaneFromNullFlags (uint64_t channel,
+                                              const char *nullflags)
+  {
+    if(nullflags==NULL)
+      throw "rmValidityMask::setPlaneFromNullFlags nullflags is NULL";
+
+    for(uint64_t p=0; p<npixels; p++)
+      set(p, channel, nullflags[p]==0);
+  }
+
+  //_____________________________________________________________________________
+  //                                                           setPlaneFromValues
+
+  /*!
+    \param channel - channel (0-based) the plane belongs to
+    \param *plane - npixels values
+  */
+  void rmValidityMask::setPlaneFromValues (uint64_t channel,
+                                           const double *plane)
+  {
+    if(plane==NULL)
+      throw "rmValidityMask::setPlaneFromValues plane is NULL";
+
+    for(uint64_t p=0; p<npixels; p++)
+      set(p, channel, isfinite(plane[p]));
+  }
+
+  //_____________________________________________________________________________
+  //                                                                  flagChannel
+
+  void rmValidityMask::flagChannel (uint64_t channel)
+  {
+    for(uint64_t p=0; p<npixels; p++)
+      set(p, channel, false);
+  }
+
+  //_____________________________________________________________________________
+  //                                                                      isBlank
+
+  bool rmValidityMask::isBlank (uint64_t pixel) const
+  {
+    for(uint64_t w=0; w<nwords; w++)
+      if(bits[pixel*nwords+w])
+        return false;
+
+    return true;
+  }
+
+  //_____________________________________________________________________________
+  //                                                                   isComplete
+
+  bool rmValidityMask::isComplete (uint64_t pixel) const
+  {
+    for(uint64_t w=0; w<nwords; w++)
+    {
+      uint64_t full=(w==nwords-1 && nchannels % 64) ? (1ULL << (nchannels % 64))-1 : ~0ULL;
+      if(bits[pixel*nwords+w]!=full)
+        return false;
+    }
+
+    return true;
+  }
+
+  //_____________________________________________________________________________
+  //                                                                   getPattern
+
+  std::vector<uint64_t> rmValidityMask::getPattern (uint64_t pixel) const
+  {
+    if(pixel >= npixels)
+      throw "rmValidityMask::getPattern pixel out of range";
+
+    return vector<uint64_t>(bits.begin()+pixel*nwords, bits.begin()+(pixel+1)*nwords);
+  }
+
+}  // END -- namespace RM
@@ -0,0 +1,100 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef RMVALIDITYMASK_H
+#define RMVALIDITYMASK_H
+
+#include <vector>
+#include <stdint.h>
+
+namespace RM {
+
+  /*!
+    \class rmValidityMask
+
+    \ingroup RM
+
+    \brief Per-pixel, per-channel validity bitmask of a tile of lines of sight
+
+    \author Sven Duscha
+
+    \test trmSynthesisPlan.cpp
+
+    Bit c of line of sight p is set if channel c holds a valid sample. The
+    bits of each line of sight are packed into consecutive 64-bit words,
+    which are also the flag pattern used to look up synthesis plans.
+  */
+  class rmValidityMask {
+
+  private:
+
+    //! number of lines of sight
+    uint64_t npixels;
+    //! number of channels
+    uint64_t nchannels;
+    //! 64-bit words per line of sight
+    uint64_t nwords;
+    //! packed bits [pixel][nwords]
+    std::vector<uint64_t> bits;
+
+  public:
+
+    // === Construction =========================================================
+
+    //! Create a mask with all samples valid
+    rmValidityMask (uint64_t npixels,
+                    uint64_t nchannels);
+
+    // === Methods ==============================================================
+
+    //! Set channel from cfitsio null flags of a plane (non-zero flag = blanked)
+    void setPlaneFromNullFlags (uint64_t channel,
+                                const char *nullflags);
+    //! Set channel from a plane of values (NaN or Inf = blanked)
+    void setPlaneFromValues (uint64_t channel,
+                             const double *plane);
+    //! Flag a whole channel (e.g. RFI) for all lines of sight
+    void flagChannel (uint64_t channel);
+
+    //! Set validity of one sample
+    void set (uint64_t pixel,
+              uint64_t channel,
+              bool valid);
+    //! Check validity of one sample
+    inline bool isValid (uint64_t pixel,
+                         uint64_t channel) const
+    {
+      return (bits[pixel*nwords+channel/64] >> (channel % 64)) & 1;
+    }
+
+    //! Check if a line of sight has no valid sample
+    bool isBlank (uint64_t pixel) const;
+    //! Check if all samples of a line of sight are valid
+    bool isComplete (uint64_t pixel) const;
+    //! Get the flag pattern (packed bits) of a line of sight
+    std::vector<uint64_t> getPattern (uint64_t pixel) const;
+
+    inline uint64_t getNumPixels () const { return npixels; }
+    inline uint64_t getNumChannels () const { return nchannels; }
+  };
+
+}  // END -- namespace RM
+
+#endif
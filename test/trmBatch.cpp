@@ -0,0 +1,128 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*!
+  \file trmBatch.cpp
+  \ingroup RM
+  \brief Test program for the RM::rmBatch container of spectra
+
+  \author Sven Duscha (sduscha@mpa-garching.mpg.de)
+  \date 2010-06-17
+*/
+
+#include <iostream>
+#include <cstdio>
+#include <complex>
+#include <rmBatch.h>
+
+using namespace std;
+
+int main ()
+{
+  int nofFailedTests (0);
+  const unsigned int nchannels=64, nspectra=100;
+  const string filename="trmBatch.fits";
+
+  vector<double> lambdaSquareds(nchannels), deltas(nchannels, 0.001), weights(nchannels);
+  for(unsigned int c=0; c<nchannels; c++)
+  {
+    lambdaSquareds[c]=0.04+0.001*c;
+    weights[c]=1.0+0.01*c;
+  }
+
+  //________________________________________________________
+  // Fill and write a container
+
+  try {
+    cout << "-- write " << nspectra << " spectra to " << filename << " ..." << endl;
+    RM::rmBatch batch(lambdaSquareds, deltas, weights, nspectra);
+    vector<complex<double> > spectrum(nchannels);
+    for(unsigned int s=0; s<nspectra; s++)
+    {
+      for(unsigned int c=0; c<nchannels; c++)
+        spectrum[c]=complex<double>(s+0.5*c, -1.0*s);
+      batch.setSpectrum(s, spectrum);
+    }
+
+    // channel-major layout for rmSynthesisPlanCache
+    if(batch.getQ()[3*nspectra+7]!=7+1.5 || batch.getU()[3*nspectra+7]!=-7)
+    {
+      cerr << "Q/U are not stored [channel][spectrum]" << endl;
+      nofFailedTests++;
+    }
+
+    batch.write(filename);
+  }
+  catch (const char *s) {
+    cerr << s << endl;
+    return 1;
+  }
+
+  //________________________________________________________
+  // Read back
+
+  try {
+    cout << "-- read back ..." << endl;
+    RM::rmBatch batch(filename);
+    if(batch.getNumSpectra()!=nspectra || batch.getNumChannels()!=nchannels ||
+       batch.getLambdaSquareds()!=lambdaSquareds ||
+       batch.getDeltaLambdaSquareds()!=deltas || batch.getWeights()!=weights)
+    {
+      cerr << "channel setup differs" << endl;
+      nofFailedTests++;
+    }
+
+    vector<complex<double> > spectrum;
+    bool differ=false;
+    for(unsigned int s=0; s<batch.getNumSpectra(); s++)
+    {
+      batch.getSpectrum(s, spectrum);
+      for(unsigned int c=0; c<nchannels; c++)
+        if(spectrum[c]!=complex<double>(s+0.5*c, -1.0*s))
+          differ=true;
+    }
+    if(differ)
+    {
+      cerr << "spectra differ" << endl;
+      nofFailedTests++;
+    }
+  }
+  catch (const char *s) {
+    cerr << s << endl;
+    nofFailedTests++;
+  }
+
+  //________________________________________________________
+  // Wrong spectrum length must throw
+
+  try {
+    cout << "-- reject spectrum of wrong length ..." << endl;
+    RM::rmBatch batch(lambdaSquareds, deltas, weights, 1);
+    batch.setSpectrum(0, vector<complex<double> >(nchannels+1));
+    cerr << "spectrum of wrong length accepted" << endl;
+    nofFailedTests++;
+  }
+  catch (const char *s) {
+  }
+
+  remove(filename.c_str());
+
+  return nofFailedTests;
+}
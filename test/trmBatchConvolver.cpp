@@ -0,0 +1,164 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*!
+  \file trmBatchConvolver.cpp
+  \ingroup RM
+  \brief Test program for the batched FFT convolution RM::rmBatchConvolver
+
+  \author Sven Duscha (sduscha@mpa-garching.mpg.de)
+  \date 2010-06-18
+*/
+
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <complex>
+#include <vector>
+#include <rmBatchConvolver.h>
+
+using namespace std;
+
+//! Random complex number with real and imaginary part in [-0.5,0.5]
+complex<double> randomComplex ()
+{
+  return complex<double>(rand()/(double)RAND_MAX-0.5, rand()/(double)RAND_MAX-0.5);
+}
+
+//! Largest difference of the convolved spectra to a direct sum
+double compare (const vector<complex<double> > &in,
+                const vector<complex<double> > &out,
+                const vector<complex<double> > &kernel,
+                unsigned int centre,
+                unsigned int nphis,
+                unsigned int nlos,
+                unsigned int phiStride,
+                unsigned int losStride)
+{
+  double maxdiff=0;
+  for(unsigned int l=0; l<nlos; l++)
+    for(unsigned int i=0; i<nphis; i++)
+    {
+      complex<double> sum(0, 0);
+      for(unsigned int k=0; k<nphis; k++)
+      {
+        int j=static_cast<int>(centre+i)-static_cast<int>(k);
+        if(j>=0 && j<static_cast<int>(kernel.size()))
+          sum+=in[l*losStride+k*phiStride]*kernel[j];
+      }
+      maxdiff=max(maxdiff, abs(out[l*losStride+i*phiStride]-sum));
+    }
+  return maxdiff;
+}
+
+int main ()
+{
+  int nofFailedTests (0);
+  const unsigned int nphis=50;
+  const unsigned int nlos=37;		// not a multiple of the batch size
+
+  srand(42);
+  vector<complex<double> > spectra(nlos*nphis);
+  for(unsigned int i=0; i<spectra.size(); i++)
+    spectra[i]=randomComplex();
+
+  //________________________________________________________
+  // RMSF-like kernel of 2*nphis elements, centre nphis
+
+  try {
+    cout << "-- convolve " << nlos << " spectra with a 2N kernel in batches of 16 ..." << endl;
+    vector<complex<double> > kernel(2*nphis);
+    for(unsigned int i=0; i<kernel.size(); i++)
+      kernel[i]=randomComplex();
+
+    RM::rmBatchConvolver convolver(kernel, nphis, nphis, 16);
+    vector<complex<double> > out(nlos*nphis);
+    convolver.convolve(&spectra[0], &out[0], nlos);
+    double diff=compare(spectra, out, kernel, nphis, nphis, nlos, 1, nphis);
+    if(diff > 1e-10)
+    {
+      cerr << "convolution differs from direct sum by " << diff << endl;
+      nofFailedTests++;
+    }
+
+    // [phi][los] layout, in place
+    vector<complex<double> > transposed(nlos*nphis);
+    for(unsigned int l=0; l<nlos; l++)
+      for(unsigned int i=0; i<nphis; i++)
+        transposed[i*nlos+l]=spectra[l*nphis+i];
+    convolver.convolve(&transposed[0], &transposed[0], nlos, nlos, 1);
+    for(unsigned int l=0; l<nlos; l++)
+      for(unsigned int i=0; i<nphis; i++)
+        if(abs(transposed[i*nlos+l]-out[l*nphis+i]) > 1e-10)
+        {
+          cerr << "strided in-place convolution differs" << endl;
+          nofFailedTests++;
+          l=nlos;
+          break;
+        }
+  }
+  catch (const char *s) {
+    cerr << s << endl;
+    nofFailedTests++;
+  }
+
+  //________________________________________________________
+  // Short off-centre kernel: only its reach is padded
+
+  try {
+    cout << "-- convolve with a short off-centre kernel ..." << endl;
+    vector<complex<double> > kernel(9);
+    for(unsigned int i=0; i<kernel.size(); i++)
+      kernel[i]=randomComplex();
+
+    RM::rmBatchConvolver convolver(kernel, 2, nphis);
+    if(convolver.getPaddedLength() < nphis+6 || convolver.getPaddedLength() > 2*nphis)
+    {
+      cerr << "padded length " << convolver.getPaddedLength() << " does not fit the kernel" << endl;
+      nofFailedTests++;
+    }
+    vector<complex<double> > out(nlos*nphis);
+    convolver.convolve(&spectra[0], &out[0], nlos);
+    double diff=compare(spectra, out, kernel, 2, nphis, nlos, 1, nphis);
+    if(diff > 1e-10)
+    {
+      cerr << "convolution differs from direct sum by " << diff << endl;
+      nofFailedTests++;
+    }
+  }
+  catch (const char *s) {
+    cerr << s << endl;
+    nofFailedTests++;
+  }
+
+  //________________________________________________________
+  // Invalid kernel centre
+
+  try {
+    vector<complex<double> > kernel(4);
+    RM::rmBatchConvolver convolver(kernel, 4, nphis);
+    cerr << "centre outside of the kernel was accepted" << endl;
+    nofFailedTests++;
+  }
+  catch (const char *s) {
+  }
+
+  return nofFailedTests;
+}
@@ -28,6 +28,7 @@
 */
 
 #include <iostream>
+#include <cmath>
 #include "rmclean.h"
 
 int main(int argc, char **argv)
@@ -105,6 +106,243 @@ int main(int argc, char **argv)
     std::cerr << "[trmClean] Skipping tests - missing input file!" << std::endl;
   }
 
+  //________________________________________________________
+  // Hogbom CLEAN of a real map with a point source
+
+  try {
+    std::cout << "-- Hogbom CLEAN of a real map ..." << std::endl;
+    const int n=101;
+    rmclean hogbom (n);
+    hogbom.RMSF.resize(2*n+1);
+    for(int i=0; i < 2*n+1; i++) {
+      double x=(i-n)/3.0;
+      hogbom.RMSF[i]= (i==n) ? complex<double>(1,0) : complex<double>(sin(x)/x, 0);
+    }
+    vector<double> sources (n);
+    for(int i=0; i < n; i++) {
+      sources[i]=3*hogbom.RMSF[n+i-30].real();
+    }
+
+    hogbom.setGain(0.2);
+    hogbom.setFWHM(6);
+    vector<double> restored=hogbom.hogbom(sources, 0.01, 0);
+    vector<complex<double> > components=hogbom.getCleanComponents();
+
+    // an on-grid point source is recovered as a single component
+    double stray=0;
+    for(int k=0; k < n; k++)
+      if(k!=30)
+        stray+=abs(components[k]);
+    if(fabs(components[30].real()-3) > 0.01 || stray > 1e-9) {
+      std::cerr << "Hogbom components differ: " << components[30]
+                << " stray " << stray << std::endl;
+      nofFailedTests++;
+    }
+    if(fabs(restored[30]-3) > 0.01 || fabs(restored[29]-restored[31]) > 1e-9) {
+      std::cerr << "Hogbom restored peak differs: " << restored[30] << std::endl;
+      nofFailedTests++;
+    }
+  }
+  catch (const char *s) {
+    std::cerr << s << std::endl;
+    nofFailedTests++;
+  }
+
+  //________________________________________________________
+  // Clark CLEAN on two point sources with an analytic RMSF
+
+  try {
+    std::cout << "-- Clark CLEAN ..." << std::endl;
+    const int n=101;
+    rmclean clark (n);
+    clark.RMSF.resize(2*n+1);
+    for(int i=0; i < 2*n+1; i++) {
+      double x=(i-n)/3.0;
+      clark.RMSF[i]= (i==n) ? complex<double>(1,0) : complex<double>(sin(x)/x, 0);
+    }
+    // RMSF[n+i-k] = R(phi_i-phi_k)
+    vector<complex<double> > sources (n);
+    for(int i=0; i < n; i++) {
+      sources[i]=complex<double>(2,1)*clark.RMSF[n+i-30]+complex<double>(0,-1.5)*clark.RMSF[n+i-70];
+    }
+
+    clark.setGain(0.2);
+    clark.setFWHM(6);
+    vector<complex<double> > restored=clark.clark(sources, 0.01, 0);
+    vector<complex<double> > components=clark.getCleanComponents();
+
+    // components reproduce the data to the threshold
+    double maxResidual=0;
+    for(int i=0; i < n; i++) {
+      complex<double> model=0;
+      for(int k=0; k < n; k++)
+        model+=components[k]*clark.RMSF[n+i-k];
+      maxResidual=std::max(maxResidual, abs(sources[i]-model));
+    }
+    if(maxResidual > 0.011) {
+      std::cerr << "Clark residual above threshold: " << maxResidual << std::endl;
+      nofFailedTests++;
+    }
+    // truncated-patch minor cycles may spread flux into neighbouring channels
+    complex<double> flux30=0, flux70=0;
+    for(int k=-3; k <= 3; k++) {
+      flux30+=components[30+k];
+      flux70+=components[70+k];
+    }
+    if(abs(flux30-complex<double>(2,1)) > 0.05 ||
+       abs(flux70-complex<double>(0,-1.5)) > 0.05) {
+      std::cerr << "Clark components differ: " << flux30 << " " << flux70 << std::endl;
+      nofFailedTests++;
+    }
+    if(abs(restored[30]-complex<double>(2,1)) > 0.1) {
+      std::cerr << "Clark restored peak differs: " << restored[30] << std::endl;
+      nofFailedTests++;
+    }
+  }
+  catch (const char *s) {
+    std::cerr << s << std::endl;
+    nofFailedTests++;
+  }
+
+  //________________________________________________________
+  // rmsfClean of spectra of different lengths with one rmclean object
+
+  try {
+    std::cout << "-- rmsfClean of different lengths ..." << std::endl;
+    const int n=100;
+    rmclean rmsf (n);
+    rmsf.RMSF.resize(2*n);
+    for(int i=0; i < 2*n; i++) {
+      double x=(i-n)/3.0;
+      rmsf.RMSF[i]= (i==n) ? complex<double>(1,0) : complex<double>(sin(x)/x, 0);
+    }
+    rmsf.setGain(0.2);
+
+    // the second, longer spectrum has its source beyond the end of the first
+    const int lengths[2]={60, n};
+    const int positions[2]={20, 80};
+    for(int c=0; c < 2; c++) {
+      vector<complex<double> > data (lengths[c]), model;
+      for(int i=0; i < lengths[c]; i++)
+        data[i]=complex<double>(1,-2)*rmsf.RMSF[n+i-positions[c]];
+      rmsf.rmsfClean(data, model, 0.001, 1000);
+
+      double stray=0;
+      for(int k=0; k < lengths[c]; k++)
+        if(k!=positions[c])
+          stray+=abs(model[k]);
+      if(abs(model[positions[c]]-complex<double>(1,-2)) > 0.01 || stray > 1e-9 ||
+         rmsf.getResidualMap().size()!=static_cast<unsigned int>(lengths[c])) {
+        std::cerr << "rmsfClean of length " << lengths[c] << " differs: "
+                  << model[positions[c]] << " stray " << stray << std::endl;
+        nofFailedTests++;
+      }
+    }
+  }
+  catch (const char *s) {
+    std::cerr << s << std::endl;
+    nofFailedTests++;
+  }
+
+  //________________________________________________________
+  // Multi-scale CLEAN on a Faraday-thick source
+
+  try {
+    std::cout << "-- multi-scale CLEAN ..." << std::endl;
+    const int n=200;
+    rmclean multiscale (n);
+    multiscale.RMSF.resize(2*n);
+    for(int i=0; i < 2*n; i++) {
+      double x=(i-n)/3.0;
+      double sinc=(i==n) ? 1 : sin(x)/x;
+      multiscale.RMSF[i]=sinc*complex<double>(cos(0.1*(i-n)), sin(0.1*(i-n)));
+    }
+    // Gaussian slab of sigma 10 channels, polarized flux 10*sqrt(2*pi)*10
+    vector<double> slab (n);
+    double slabFlux=0;
+    for(int k=0; k < n; k++) {
+      slab[k]=10*exp(-0.5*(k-100)*(k-100)/100.0);
+      slabFlux+=slab[k];
+    }
+    vector<complex<double> > dirty (n);
+    double peak=0;
+    for(int i=0; i < n; i++) {
+      for(int k=0; k < n; k++)
+        dirty[i]+=slab[k]*multiscale.RMSF[n+i-k];
+      peak=std::max(peak, abs(dirty[i]));
+    }
+    const double threshold=0.01*peak;
+
+    vector<complex<double> > pointModel, scaleModel;
+    multiscale.setGain(0.1);
+    multiscale.rmsfClean(dirty, pointModel, threshold, 10000);
+    unsigned int pointIterations=multiscale.getNumIterations();
+
+    vector<double> scales;
+    scales.push_back(4);
+    scales.push_back(8);
+    scales.push_back(16);
+    scales.push_back(32);
+    multiscale.multiscaleClean(dirty, scaleModel, scales, threshold, 10000);
+    unsigned int scaleIterations=multiscale.getNumIterations();
+    vector<complex<double> > residual=multiscale.getResidualMap();
+
+    // tracked residual equals the data minus the model convolved with the RMSF
+    double maxResidual=0, maxDifference=0;
+    complex<double> modelFlux=0;
+    for(int i=0; i < n; i++) {
+      complex<double> model=0;
+      for(int k=0; k < n; k++)
+        model+=scaleModel[k]*multiscale.RMSF[n+i-k];
+      maxResidual=std::max(maxResidual, abs(dirty[i]-model));
+      maxDifference=std::max(maxDifference, abs(dirty[i]-model-residual[i]));
+      modelFlux+=scaleModel[i];
+    }
+    if(maxResidual > threshold || maxDifference > 1e-6*peak) {
+      std::cerr << "multi-scale residual differs: " << maxResidual << " "
+                << maxDifference << std::endl;
+      nofFailedTests++;
+    }
+    if(abs(modelFlux-slabFlux) > 0.02*slabFlux) {
+      std::cerr << "multi-scale model flux differs: " << modelFlux << std::endl;
+      nofFailedTests++;
+    }
+    if(scaleIterations >= pointIterations/2) {
+      std::cerr << "multi-scale iterations " << scaleIterations
+                << " not below half of point CLEAN " << pointIterations << std::endl;
+      nofFailedTests++;
+    }
+
+    // RMSF longer than twice the data, centred at round(0.5*(2n+2-n))+n/2 = n+1
+    rmclean longRMSF (n);
+    longRMSF.RMSF.resize(2*n+2);
+    for(int i=0; i < 2*n+2; i++) {
+      double x=(i-n-1)/3.0;
+      double sinc=(i==n+1) ? 1 : sin(x)/x;
+      longRMSF.RMSF[i]=sinc*complex<double>(cos(0.1*(i-n-1)), sin(0.1*(i-n-1)));
+    }
+    longRMSF.setGain(0.1);
+    longRMSF.multiscaleClean(dirty, scaleModel, scales, threshold, 10000);
+    residual=longRMSF.getResidualMap();
+    maxResidual=maxDifference=0;
+    for(int i=0; i < n; i++) {
+      complex<double> model=0;
+      for(int k=0; k < n; k++)
+        model+=scaleModel[k]*longRMSF.RMSF[n+1+i-k];
+      maxResidual=std::max(maxResidual, abs(dirty[i]-model));
+      maxDifference=std::max(maxDifference, abs(dirty[i]-model-residual[i]));
+    }
+    if(maxResidual > threshold || maxDifference > 1e-6*peak) {
+      std::cerr << "multi-scale residual with longer RMSF differs: " << maxResidual << " "
+                << maxDifference << std::endl;
+      nofFailedTests++;
+    }
+  }
+  catch (const char *s) {
+    std::cerr << s << std::endl;
+    nofFailedTests++;
+  }
+
   return nofFailedTests;
   }
   
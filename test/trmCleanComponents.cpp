@@ -0,0 +1,246 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*!
+  \file trmCleanComponents.cpp
+  \ingroup RM
+  \brief Test program for the sparse CLEAN component lists RM::rmCleanComponents
+
+  \author Sven Duscha (sduscha@mpa-garching.mpg.de)
+  \date 2010-06-18
+*/
+
+#include <iostream>
+#include <cstdio>
+#include <cmath>
+#include <complex>
+#include <vector>
+#include <rmCleanCube.h>
+#include <rmCleanComponents.h>
+#include <rmBatchConvolver.h>
+
+using namespace std;
+
+int main ()
+{
+  int nofFailedTests (0);
+  const unsigned int nphis=64;
+  const unsigned int nlos=100;
+  const string filename="trmCleanComponents.fits";
+
+  // analytic RMSF with peak 1 at its centre: rmsf[nphis+i-k] = R(phi_i-phi_k)
+  vector<complex<double> > rmsf(2*nphis);
+  for(unsigned int i=0; i<rmsf.size(); i++)
+  {
+    double x=(static_cast<double>(i)-nphis)/2.5;
+    rmsf[i]=(x==0) ? complex<double>(1, 0) : complex<double>(sin(x)/x, 0);
+  }
+
+  // two point sources per line of sight, spectral-major [los][phi]
+  vector<complex<double> > dirty(nlos*nphis);
+  for(unsigned int l=0; l<nlos; l++)
+    for(unsigned int i=0; i<nphis; i++)
+      dirty[l*nphis+i]=complex<double>(1+0.01*l, -0.5)*rmsf[nphis+i-(10+l % 20)]
+                      +complex<double>(0, 0.8)*rmsf[nphis+i-50];
+
+  RM::rmCleanComponents components(nphis, -31.5, 1, 4);
+  vector<complex<double> > model(nlos*nphis);
+
+  //________________________________________________________
+  // Sparse and dense CLEAN agree
+
+  try {
+    cout << "-- clean " << nlos << " lines of sight into component lists ..." << endl;
+    RM::rmCleanCube cube(rmsf, nphis, 3, "");
+    cube.setGain(0.2);
+    cube.setThreshold(0.001);
+    cube.clean(&dirty[0], &model[0], nlos);
+    cube.clean(&dirty[0], components, nlos);
+
+    uint64_t nonzero=0;
+    for(uint64_t i=0; i<model.size(); i++)
+      if(model[i]!=complex<double>(0, 0))
+        nonzero++;
+    if(components.getNumLinesOfSight()!=nlos || components.getNumComponents()!=nonzero)
+    {
+      cerr << "number of components differs: " << components.getNumComponents()
+           << " instead of " << nonzero << endl;
+      nofFailedTests++;
+    }
+    for(unsigned int l=0; l<nlos; l++)
+    {
+      const uint32_t *indices=components.getPhiIndices(l);
+      const complex<double> *fluxes=components.getFluxes(l);
+      for(uint64_t c=0; c<components.getNumComponents(l); c++)
+        if(fluxes[c]!=model[l*nphis+indices[c]])
+        {
+          cerr << "component of line of sight " << l << " differs" << endl;
+          nofFailedTests++;
+          l=nlos;
+          break;
+        }
+    }
+  }
+  catch (const char *s) {
+    cerr << s << endl;
+    nofFailedTests++;
+  }
+
+  //________________________________________________________
+  // Restore equals the dense model convolved with the Gaussian
+
+  try {
+    cout << "-- restore full spectra and a sub-range ..." << endl;
+    const double sigma=4/(2*sqrt(2*log(2.0)));
+    double maxDifference=0;
+    vector<complex<double> > restored(nphis), part(20);
+    for(unsigned int l=0; l<nlos; l++)
+    {
+      components.restore(l, 0, nphis, &restored[0]);
+      for(unsigned int i=0; i<nphis; i++)
+      {
+        complex<double> expected=0;
+        for(unsigned int k=0; k<nphis; k++)
+          expected+=model[l*nphis+k]*exp(-0.5*(double(i)-k)*(double(i)-k)/(sigma*sigma));
+        maxDifference=max(maxDifference, abs(restored[i]-expected));
+      }
+      components.restore(l, 30, 20, &part[0]);
+      for(unsigned int i=0; i<20; i++)
+        maxDifference=max(maxDifference, abs(part[i]-restored[30+i]));
+    }
+    if(maxDifference > 1e-12)
+    {
+      cerr << "restored spectra differ by " << maxDifference << endl;
+      nofFailedTests++;
+    }
+  }
+  catch (const char *s) {
+    cerr << s << endl;
+    nofFailedTests++;
+  }
+
+  //________________________________________________________
+  // Batched FFT restore equals the direct restore
+
+  try {
+    cout << "-- restore in batched FFTs ..." << endl;
+    vector<complex<double> > beam;
+    unsigned int centre;
+    components.getRestoringBeam(beam, centre);
+    RM::rmBatchConvolver convolver(beam, centre, nphis, 32);
+
+    vector<complex<double> > batched(nlos*nphis), restored(nphis);
+    components.restore(convolver, 0, nlos, &batched[0]);
+    double maxDifference=0;
+    for(unsigned int l=0; l<nlos; l++)
+    {
+      components.restore(l, 0, nphis, &restored[0]);
+      for(unsigned int i=0; i<nphis; i++)
+        maxDifference=max(maxDifference, abs(batched[l*nphis+i]-restored[i]));
+    }
+    if(maxDifference > 1e-12)
+    {
+      cerr << "batched restore differs by " << maxDifference << endl;
+      nofFailedTests++;
+    }
+  }
+  catch (const char *s) {
+    cerr << s << endl;
+    nofFailedTests++;
+  }
+
+  //________________________________________________________
+  // FITS table round trip, whole table and a range of rows
+
+  try {
+    cout << "-- write and read " << filename << " ..." << endl;
+    components.write(filename);
+
+    RM::rmCleanComponents all, range;
+    all.read(filename);
+    range.read(filename, 40, 25);
+
+    if(all.getNumLinesOfSight()!=nlos || all.getNumComponents()!=components.getNumComponents() ||
+       all.getNumPhis()!=nphis || all.getPhi0()!=-31.5 || all.getDeltaPhi()!=1 || all.getFWHM()!=4)
+    {
+      cerr << "table read back differs" << endl;
+      nofFailedTests++;
+    }
+    if(range.getNumLinesOfSight()!=25)
+    {
+      cerr << "range of rows has " << range.getNumLinesOfSight() << " lines of sight" << endl;
+      nofFailedTests++;
+    }
+    for(unsigned int l=0; l<25 && range.getNumLinesOfSight()==25; l++)
+    {
+      if(range.getNumComponents(l)!=components.getNumComponents(40+l))
+      {
+        cerr << "components of line of sight " << 40+l << " differ" << endl;
+        nofFailedTests++;
+        break;
+      }
+      // fluxes are stored in single precision
+      for(uint64_t c=0; c<range.getNumComponents(l); c++)
+        if(range.getPhiIndices(l)[c]!=components.getPhiIndices(40+l)[c] ||
+           abs(range.getFluxes(l)[c]-components.getFluxes(40+l)[c]) > 1e-6)
+        {
+          cerr << "component of line of sight " << 40+l << " differs" << endl;
+          nofFailedTests++;
+          l=25;
+          break;
+        }
+    }
+  }
+  catch (const char *s) {
+    cerr << s << endl;
+    nofFailedTests++;
+  }
+
+  //________________________________________________________
+  // Lines of sight without components at the end of the table
+
+  try {
+    cout << "-- write and read lines of sight without components ..." << endl;
+    RM::rmCleanComponents sparse(nphis, -31.5, 1, 4), back;
+    vector<complex<double> > empty(nphis);
+    for(unsigned int l=0; l<10; l++)
+      sparse.append(&model[l*nphis]);
+    for(unsigned int l=0; l<15; l++)
+      sparse.append(&empty[0]);
+    sparse.write(filename);
+    back.read(filename);
+
+    if(back.getNumLinesOfSight()!=25 || back.getNumComponents()!=sparse.getNumComponents() ||
+       back.getNumComponents(24)!=0)
+    {
+      cerr << "table with empty lines of sight has " << back.getNumLinesOfSight()
+           << " lines of sight" << endl;
+      nofFailedTests++;
+    }
+  }
+  catch (const char *s) {
+    cerr << s << endl;
+    nofFailedTests++;
+  }
+
+  remove(filename.c_str());
+
+  return nofFailedTests;
+}
@@ -0,0 +1,277 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*!
+  \file trmCleanCube.cpp
+  \ingroup RM
+  \brief Test program for the parallel cube CLEAN driver RM::rmCleanCube
+
+  \author Sven Duscha (sduscha@mpa-garching.mpg.de)
+  \date 2010-06-18
+*/
+
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <complex>
+#include <vector>
+#include <rmCleanCube.h>
+
+using namespace std;
+
+//! Complex Gaussian noise with sigma 1 in real and imaginary part (Box-Muller)
+complex<double> gaussianNoise ()
+{
+  double u1=(rand()+1.0)/(RAND_MAX+2.0), u2=rand()/(RAND_MAX+1.0);
+  double r=sqrt(-2*log(u1));
+  return complex<double>(r*cos(2*M_PI*u2), r*sin(2*M_PI*u2));
+}
+
+int main ()
+{
+  int nofFailedTests (0);
+  const unsigned int nphis=64;
+  const unsigned int nlos=100;
+  const string wisdom="trmCleanCube.wisdom";
+
+  // analytic RMSF with peak 1 at its centre: rmsf[nphis+i-k] = R(phi_i-phi_k)
+  vector<complex<double> > rmsf(2*nphis);
+  for(unsigned int i=0; i<rmsf.size(); i++)
+  {
+    double x=(static_cast<double>(i)-nphis)/2.5;
+    rmsf[i]=(x==0) ? complex<double>(1, 0) : complex<double>(sin(x)/x, 0);
+  }
+
+  // one point source per line of sight, spectral-major [los][phi]
+  vector<complex<double> > dirty(nlos*nphis);
+  for(unsigned int l=0; l<nlos; l++)
+  {
+    unsigned int pos=10+l % 40;
+    complex<double> flux(1+0.01*l, -0.5);
+    for(unsigned int i=0; i<nphis; i++)
+      dirty[l*nphis+i]=flux*rmsf[nphis+i-pos];
+  }
+
+  remove(wisdom.c_str());
+
+  //________________________________________________________
+  // Serial and parallel runs agree
+
+  try {
+    cout << "-- clean " << nlos << " lines of sight with 1 and 4 threads ..." << endl;
+    vector<complex<double> > serial(nlos*nphis), parallel(nlos*nphis);
+
+    RM::rmCleanCube one(rmsf, nphis, 1, wisdom);
+    one.setGain(0.2);
+    one.setThreshold(0.001);
+    one.clean(&dirty[0], &serial[0], nlos);
+
+    RM::rmCleanCube four(rmsf, nphis, 4, wisdom);
+    four.setGain(0.2);
+    four.setThreshold(0.001);
+    four.clean(&dirty[0], &parallel[0], nlos);
+
+    if(serial!=parallel || one.getNumIterations()!=four.getNumIterations())
+    {
+      cerr << "parallel result differs from serial result" << endl;
+      nofFailedTests++;
+    }
+    for(unsigned int l=0; l<nlos; l++)
+    {
+      unsigned int pos=10+l % 40;
+      if(abs(serial[l*nphis+pos]-complex<double>(1+0.01*l, -0.5)) > 0.01)
+      {
+        cerr << "component of line of sight " << l << " differs: " << serial[l*nphis+pos] << endl;
+        nofFailedTests++;
+        break;
+      }
+    }
+
+    // a second call reuses the workspaces
+    four.clean(&dirty[0], &parallel[0], nlos);
+    if(serial!=parallel)
+    {
+      cerr << "second parallel run differs" << endl;
+      nofFailedTests++;
+    }
+
+    ifstream file(wisdom.c_str());
+    if(!file.good())
+    {
+      cerr << "wisdom file was not written" << endl;
+      nofFailedTests++;
+    }
+  }
+  catch (const char *s) {
+    cerr << s << endl;
+    nofFailedTests++;
+  }
+
+  //________________________________________________________
+  // [phi][los] layout through strides
+
+  try {
+    cout << "-- clean [phi][los] layout ..." << endl;
+    vector<complex<double> > transposed(nlos*nphis), cleaned(nlos*nphis), reference(nlos*nphis);
+    for(unsigned int l=0; l<nlos; l++)
+      for(unsigned int i=0; i<nphis; i++)
+        transposed[i*nlos+l]=dirty[l*nphis+i];
+
+    RM::rmCleanCube cube(rmsf, nphis, 3, "");
+    cube.setThreshold(0.001);
+    cube.clean(&dirty[0], &reference[0], nlos);
+    cube.clean(&transposed[0], &cleaned[0], nlos, nlos, 1);
+
+    for(unsigned int l=0; l<nlos; l++)
+      for(unsigned int i=0; i<nphis; i++)
+        if(cleaned[i*nlos+l]!=reference[l*nphis+i])
+        {
+          cerr << "strided result differs" << endl;
+          nofFailedTests++;
+          l=nlos;
+          break;
+        }
+  }
+  catch (const char *s) {
+    cerr << s << endl;
+    nofFailedTests++;
+  }
+
+  //________________________________________________________
+  // Residual of the clean models in batched FFTs
+
+  try {
+    cout << "-- residual of the clean models ..." << endl;
+    vector<complex<double> > model(nlos*nphis), residual(nlos*nphis);
+    RM::rmCleanCube cube(rmsf, nphis, 2, "");
+    cube.setGain(0.2);
+    cube.setThreshold(0.001);
+    cube.clean(&dirty[0], &model[0], nlos);
+    cube.residual(&dirty[0], &model[0], &residual[0], nlos);
+
+    // residual of a direct convolution, rmsf[nphis+i-k] = R(phi_i-phi_k)
+    double maxDifference=0, maxResidual=0;
+    for(unsigned int l=0; l<nlos; l++)
+      for(unsigned int i=0; i<nphis; i++)
+      {
+        complex<double> expected=dirty[l*nphis+i];
+        for(unsigned int k=0; k<nphis; k++)
+          expected-=model[l*nphis+k]*rmsf[nphis+i-k];
+        maxDifference=max(maxDifference, abs(residual[l*nphis+i]-expected));
+        maxResidual=max(maxResidual, abs(residual[l*nphis+i]));
+      }
+    if(maxDifference > 1e-10 || maxResidual >= 0.001)
+    {
+      cerr << "residual differs by " << maxDifference << ", peak " << maxResidual << endl;
+      nofFailedTests++;
+    }
+  }
+  catch (const char *s) {
+    cerr << s << endl;
+    nofFailedTests++;
+  }
+
+  //________________________________________________________
+  // Noise-based stop: noise-only lines of sight stop early
+
+  try {
+    cout << "-- clean down to 5 times the noise of each line of sight ..." << endl;
+    const double sigma=0.01;
+    vector<complex<double> > noisy(nlos*nphis), cleaned(nlos*nphis);
+    srand(42);
+    for(unsigned int l=0; l<nlos; l++)
+    {
+      // even lines of sight hold a source in the inner half, odd ones noise only
+      unsigned int pos=28+l % 8;
+      complex<double> flux=(l % 2) ? 0 : complex<double>(1+0.01*l, -0.5);
+      for(unsigned int i=0; i<nphis; i++)
+        noisy[l*nphis+i]=flux*rmsf[nphis+i-pos]+sigma*gaussianNoise();
+    }
+
+    RM::rmCleanCube cube(rmsf, nphis, 2, "");
+    cube.setGain(0.2);
+    cube.setThreshold(0);
+    cube.setNoiseMultiple(5);
+    cube.setNoiseRange(0.25);
+    cube.setMaxIterations(500);
+    cube.clean(&noisy[0], &cleaned[0], nlos);
+
+    const vector<uint32_t> &iterations=cube.getIterations();
+    const vector<float> &noise=cube.getNoiseLevels();
+    const vector<float> &residual=cube.getResidualPeaks();
+    unsigned int sourceIterations=0, noiseIterations=0;
+    double meanNoise=0;
+    for(unsigned int l=0; l<nlos; l++)
+    {
+      // the median of 2*16*2 values scatters by ~15%
+      meanNoise+=noise[l]/nlos;
+      if(fabs(noise[l]-sigma) > 0.5*sigma)
+      {
+        cerr << "noise of line of sight " << l << " differs: " << noise[l] << endl;
+        nofFailedTests++;
+        break;
+      }
+      if(residual[l] > 5*noise[l] && iterations[l] < 500)
+      {
+        cerr << "line of sight " << l << " stopped above 5 sigma: " << residual[l] << endl;
+        nofFailedTests++;
+        break;
+      }
+      if(l % 2)
+        noiseIterations+=iterations[l];
+      else
+      {
+        sourceIterations+=iterations[l];
+        // noise may split the component over neighbouring Faraday depths
+        unsigned int pos=28+l % 8;
+        complex<double> flux(0, 0);
+        for(unsigned int i=pos-2; i<=pos+2; i++)
+          flux+=cleaned[l*nphis+i];
+        if(abs(flux-complex<double>(1+0.01*l, -0.5)) > 0.1)
+        {
+          cerr << "flux of line of sight " << l << " differs: " << flux << endl;
+          nofFailedTests++;
+          break;
+        }
+      }
+    }
+    cout << "iterations: " << sourceIterations << " with source, " << noiseIterations << " noise only" << endl;
+    if(fabs(meanNoise-sigma) > 0.1*sigma)
+    {
+      cerr << "mean noise level differs: " << meanNoise << endl;
+      nofFailedTests++;
+    }
+    if(noiseIterations*10 > sourceIterations)
+    {
+      cerr << "noise-only lines of sight were cleaned too deep" << endl;
+      nofFailedTests++;
+    }
+  }
+  catch (const char *s) {
+    cerr << s << endl;
+    nofFailedTests++;
+  }
+
+  remove(wisdom.c_str());
+
+  return nofFailedTests;
+}
@@ -0,0 +1,208 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*!
+  \file trmCleanKernels.cpp
+  \ingroup RM
+  \brief Test and benchmark of the CLEAN subtraction kernels RM::subtractScaled
+
+  \author Sven Duscha (sduscha@mpa-garching.mpg.de)
+  \date 2010-06-18
+
+  Without arguments the kernels are compared with the complex<double> loop
+  for lengths around the SIMD widths, and a short benchmark is printed.
+
+  With arguments it only benchmarks:
+
+  trmCleanKernels [n=1024] [repeat=200000]
+
+  Every variant subtracts a component times an RMSF of n elements repeat
+  times: the complex<double> loop CLEAN used before, the scalar split
+  real/imaginary kernel and the dispatched (AVX2/FMA if available) kernel
+  in double and single precision.
+*/
+
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <complex>
+#include <vector>
+#include <sys/time.h>
+#include <rmCleanKernels.h>
+
+using namespace std;
+
+double seconds ()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec+1e-6*tv.tv_usec;
+}
+
+//! Print the throughput of one variant in elements per nanosecond
+void report (const char *name,
+             double elapsed,
+             unsigned int n,
+             unsigned int repeat,
+             double baseline)
+{
+  cout << name << elapsed << " s, " << n*static_cast<double>(repeat)/elapsed*1e-9
+       << " elements/ns, " << baseline/elapsed << "x" << endl;
+}
+
+//_______________________________________________________________________________
+//                                                                      benchmark
+
+void benchmark (unsigned int n,
+                unsigned int repeat)
+{
+  vector<complex<double> > residual(n), rmsf(n);
+  vector<double> yRe(n), yIm(n), xRe(n), xIm(n);
+  vector<float> yReF(n), yImF(n), xReF(n), xImF(n);
+  for(unsigned int i=0; i<n; i++)
+  {
+    rmsf[i]=complex<double>(cos(0.1*i), sin(0.1*i))/(1.0+i);
+    xRe[i]=rmsf[i].real();
+    xIm[i]=rmsf[i].imag();
+    xReF[i]=xRe[i];
+    xImF[i]=xIm[i];
+  }
+  // tiny alternating components keep the residual bounded
+  const complex<double> component(1e-6, -1e-6);
+
+  double start=seconds();
+  for(unsigned int r=0; r<repeat; r++)
+  {
+    const complex<double> c=(r & 1) ? -component : component;
+    for(unsigned int i=0; i<n; i++)
+      residual[i]-=c*rmsf[i];
+  }
+  const double baseline=seconds()-start;
+  report("complex<double> loop  : ", baseline, n, repeat, baseline);
+
+  start=seconds();
+  for(unsigned int r=0; r<repeat; r++)
+  {
+    const double sign=(r & 1) ? -1 : 1;
+    RM::subtractScaledScalar(&yRe[0], &yIm[0], &xRe[0], &xIm[0], sign*component.real(), sign*component.imag(), n);
+  }
+  report("split scalar (double) : ", seconds()-start, n, repeat, baseline);
+
+  start=seconds();
+  for(unsigned int r=0; r<repeat; r++)
+  {
+    const double sign=(r & 1) ? -1 : 1;
+    RM::subtractScaled(&yRe[0], &yIm[0], &xRe[0], &xIm[0], sign*component.real(), sign*component.imag(), n);
+  }
+  report("dispatched (double)   : ", seconds()-start, n, repeat, baseline);
+
+  start=seconds();
+  for(unsigned int r=0; r<repeat; r++)
+  {
+    const float sign=(r & 1) ? -1 : 1;
+    RM::subtractScaled(&yReF[0], &yImF[0], &xReF[0], &xImF[0], sign*1e-6f, -sign*1e-6f, n);
+  }
+  report("dispatched (float)    : ", seconds()-start, n, repeat, baseline);
+
+  // keep the results alive
+  if(abs(residual[0])+yRe[0]+yReF[0] > 1e300)
+    cout << residual[0] << endl;
+}
+
+//_______________________________________________________________________________
+//                                                                           main
+
+int main (int argc, char **argv)
+{
+  int nofFailedTests (0);
+
+  cout << "-- SIMD kernels " << (RM::haveSIMDCleanKernels() ? "(AVX2/FMA)" : "not available")
+       << endl;
+
+  if(argc > 1)
+  {
+    unsigned int n=atoi(argv[1]);
+    unsigned int repeat=(argc > 2) ? atoi(argv[2]) : 200000;
+    if(n==0 || repeat==0)
+    {
+      cerr << "usage: " << argv[0] << " [n=1024] [repeat=200000]" << endl;
+      return 1;
+    }
+    benchmark(n, repeat);
+    return 0;
+  }
+
+  //________________________________________________________
+  // Kernels agree with the complex<double> loop
+
+  cout << "-- compare with the complex<double> loop ..." << endl;
+  const unsigned int lengths[]={0, 1, 3, 4, 7, 8, 9, 15, 16, 17, 33, 1000};
+  const complex<double> component(0.37, -1.21);
+  for(unsigned int l=0; l<sizeof(lengths)/sizeof(lengths[0]); l++)
+  {
+    const unsigned int n=lengths[l];
+    vector<complex<double> > residual(n), rmsf(n);
+    vector<double> yRe(n), yIm(n), xRe(n), xIm(n), sRe(n), sIm(n);
+    vector<float> yReF(n), yImF(n), xReF(n), xImF(n);
+    for(unsigned int i=0; i<n; i++)
+    {
+      residual[i]=complex<double>(sin(0.3*i), cos(0.7*i));
+      rmsf[i]=complex<double>(cos(0.1*i), -sin(0.2*i));
+      yRe[i]=sRe[i]=residual[i].real();
+      yIm[i]=sIm[i]=residual[i].imag();
+      xRe[i]=rmsf[i].real();
+      xIm[i]=rmsf[i].imag();
+      yReF[i]=yRe[i];
+      yImF[i]=yIm[i];
+      xReF[i]=xRe[i];
+      xImF[i]=xIm[i];
+      residual[i]-=component*rmsf[i];
+    }
+
+    RM::subtractScaled(n ? &yRe[0] : NULL, n ? &yIm[0] : NULL, n ? &xRe[0] : NULL, n ? &xIm[0] : NULL,
+                       component.real(), component.imag(), n);
+    RM::subtractScaledScalar(n ? &sRe[0] : NULL, n ? &sIm[0] : NULL, n ? &xRe[0] : NULL, n ? &xIm[0] : NULL,
+                             component.real(), component.imag(), n);
+    RM::subtractScaled(n ? &yReF[0] : NULL, n ? &yImF[0] : NULL, n ? &xReF[0] : NULL, n ? &xImF[0] : NULL,
+                       static_cast<float>(component.real()), static_cast<float>(component.imag()), n);
+
+    double maxDouble=0, maxScalar=0, maxFloat=0;
+    for(unsigned int i=0; i<n; i++)
+    {
+      maxDouble=max(maxDouble, abs(complex<double>(yRe[i], yIm[i])-residual[i]));
+      maxScalar=max(maxScalar, abs(complex<double>(sRe[i], sIm[i])-residual[i]));
+      maxFloat=max(maxFloat, abs(complex<double>(yReF[i], yImF[i])-residual[i]));
+    }
+    if(maxDouble > 1e-14 || maxScalar > 1e-14 || maxFloat > 1e-5)
+    {
+      cerr << "kernels differ for n=" << n << ": " << maxDouble << " " << maxScalar
+           << " " << maxFloat << endl;
+      nofFailedTests++;
+    }
+  }
+
+  //________________________________________________________
+  // Short benchmark
+
+  cout << "-- benchmark n=1024 ..." << endl;
+  benchmark(1024, 20000);
+
+  return nofFailedTests;
+}
@@ -0,0 +1,125 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*!
+  \file trmFITSLarge.cpp
+  \ingroup RM
+  \brief Test 64-bit addressing of RM::rmFITS on a cube with more than 2^31 pixels
+
+  \author Sven Duscha (sduscha@mpa-garching.mpg.de)
+  \date 2010-06-10
+
+  Creates a 32768 x 32768 x 3 float cube (3*2^30 pixels, 12 GB on disk), writes
+  marker rows into the last plane and reads them back through pixel offsets
+  beyond 2^31. The test is only built with RM_ENABLE_LARGE_TESTS.
+*/
+
+#include <iostream>
+#include <cstdio>
+#include <rmFITS.h>
+
+using namespace std;
+
+int main ()
+{
+  int nofFailedTests (0);
+  const int64_t nx=32768, ny=32768, nz=3;
+  const string filename="trmFITSLarge.fits";
+
+  //________________________________________________________
+  // Create cube and write the last rows of the last plane
+
+  try {
+    cout << "-- create " << nx << "x" << ny << "x" << nz << " cube " << filename << " ..." << endl;
+    RM::rmFITS out("!" + filename, READWRITE);
+    vector<int64_t> dimensions(3);
+    dimensions[0]=nx;
+    dimensions[1]=ny;
+    dimensions[2]=nz;
+    out.createImg(-32, dimensions);
+
+    // two rows at the end of the cube: linear offset > 3*2^30-2^16
+    vector<double> rows(2*nx);
+    for(int64_t i=0; i<2*nx; i++)
+      rows[i]=i % 1000;
+    LONGLONG fpixel[3]={1, ny-1, nz};
+    out.writePix(TDOUBLE, fpixel, 2*nx, &rows[0]);
+  }
+  catch (const char *s) {
+    cerr << s << endl;
+    return 1;
+  }
+
+  //________________________________________________________
+  // Read back through 64-bit offsets
+
+  try {
+    cout << "-- read back beyond 2^31 pixels ..." << endl;
+    RM::rmFITS in(filename, READONLY);
+    vector<int64_t> dimensions=in.getImageDimensions();
+    if(dimensions.size()!=3 || dimensions[0]!=nx || dimensions[1]!=ny || dimensions[2]!=nz)
+    {
+      cerr << "image dimensions differ" << endl;
+      nofFailedTests++;
+    }
+
+    // last pixel of the cube
+    double value=-1;
+    LONGLONG fpixel[3]={nx, ny, nz};
+    in.readPix(TDOUBLE, fpixel, 1, &value);
+    if(value!=(2*nx-1) % 1000)
+    {
+      cerr << "last pixel differs: " << value << endl;
+      nofFailedTests++;
+    }
+
+    // read across the plane boundary 2 -> 3 (offset 2^31)
+    vector<double> block(nx+10, -1);
+    LONGLONG fstart[3]={1, ny, nz-1};
+    in.readPix(TDOUBLE, fstart, nx+10, &block[0]);
+    if(block[nx]!=0 || block[nx+9]!=0)
+    {
+      cerr << "read across plane boundary differs" << endl;
+      nofFailedTests++;
+    }
+
+    // line of sight at the far corner
+    vector<double> line(nz);
+    long inc[3]={1, 1, 1};
+    long lfirst[3]={nx, ny, 1};
+    long llast[3]={nx, ny, nz};
+    double nulval=0;
+    int anynul=0;
+    in.readSubset(TDOUBLE, lfirst, llast, inc, &nulval, &line[0], &anynul);
+    if(line[nz-1]!=value || line[0]!=0)
+    {
+      cerr << "line of sight differs" << endl;
+      nofFailedTests++;
+    }
+  }
+  catch (const char *s) {
+    cerr << s << endl;
+    nofFailedTests++;
+  }
+
+  remove(filename.c_str());
+
+  return nofFailedTests;
+}
@@ -0,0 +1,130 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*!
+  \file trmFITSchecksum.cpp
+  \ingroup RM
+  \brief Test program for incremental DATASUM/CHECKSUM (RM::rmFITSchecksum)
+
+  \author Sven Duscha (sduscha@mpa-garching.mpg.de)
+  \date 2010-06-15
+*/
+
+#include <iostream>
+#include <string.h>
+#include <rmFITSchecksum.h>
+#include <rmFITSproducts.h>
+
+using namespace std;
+
+int main ()
+{
+  int nofFailedTests (0);
+  const uint64_t nx=13, ny=9, nphi=4, tile=5;
+
+  //________________________________________________________
+  // Sum is independent of order and of block alignment
+
+  cout << "-- check order independence of accumulator ..." << endl;
+  vector<float> values(101);
+  vector<unsigned char> bytes(4*values.size());
+  for(unsigned int i=0; i<values.size(); i++)
+  {
+    values[i]=1.5f*i-20.25f;
+    uint32_t word;
+    memcpy(&word, &values[i], 4);
+    for(int b=0; b<4; b++)
+      bytes[4*i+b]=(word >> (8*(3-b))) & 0xff;
+  }
+
+  RM::rmFITSchecksum forward, shuffled;
+  forward.addFloats(&values[0], values.size());
+  shuffled.addBytes(&bytes[203], bytes.size()-203, 203);	// unaligned tail first
+  shuffled.addBytes(&bytes[0], 203, 0);
+  if(forward.getDatasum()!=shuffled.getDatasum())
+  {
+    cerr << "DATASUM depends on order: " << forward.getDatasum() << " != " << shuffled.getDatasum() << endl;
+    nofFailedTests++;
+  }
+
+  //________________________________________________________
+  // Products written tile by tile get valid checksums
+
+  vector<double> faradayDepths(nphi);
+  for(uint64_t i=0; i<nphi; i++)
+    faradayDepths[i]=-5.0+2.5*i;
+
+  try {
+    cout << "-- write products into trmFITSchecksum.fits ..." << endl;
+    RM::rmFITSproducts out("trmFITSchecksum", RM::PRODUCT_ALL, nx, ny, faradayDepths, false, 4);
+
+    // tiles are handed in bottom-up to exercise out-of-order bands
+    for(int64_t y=((ny-1)/tile)*tile; y>=0; y-=tile)
+      for(uint64_t x=0; x<nx; x+=tile)
+      {
+        uint64_t tx=min(tile, nx-x), ty=min(tile, ny-y);
+        vector<complex<double> > data(nphi*tx*ty);
+        for(uint64_t z=0; z<nphi; z++)
+          for(uint64_t j=0; j<ty; j++)
+            for(uint64_t i=0; i<tx; i++)
+              data[(z*ty+j)*tx+i]=complex<double>(0.5*z-1.0, 0.01*((y+j)*nx+x+i));
+        out.writeTile(&data[0], x, y, tx, ty);
+      }
+    out.close();
+  }
+  catch (const char *s) {
+    cerr << s << endl;
+    return 1;
+  }
+
+  try {
+    cout << "-- verify checksums ..." << endl;
+    RM::rmFITS in("trmFITSchecksum.fits", READONLY);
+    vector<double> plane(nx*ny);
+
+    for(int hdu=1; hdu<=4; hdu++)
+    {
+      bool dataok=false, hduok=false;
+      in.moveAbsoluteHDU(hdu);
+      in.verifyChecksum(dataok, hduok);
+      if(!dataok || !hduok)
+      {
+        cerr << "checksum of HDU " << hdu << " is wrong" << endl;
+        nofFailedTests++;
+      }
+
+      in.setStreamingVerification(true);
+      for(uint64_t z=1; z<=nphi; z++)
+        in.readPlane(&plane[0], z);
+      if(!in.verifyStreamedChecksum())
+      {
+        cerr << "streamed DATASUM of HDU " << hdu << " differs" << endl;
+        nofFailedTests++;
+      }
+      in.setStreamingVerification(false);
+    }
+  }
+  catch (const char *s) {
+    cerr << s << endl;
+    nofFailedTests++;
+  }
+
+  return nofFailedTests;
+}
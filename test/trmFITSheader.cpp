@@ -0,0 +1,118 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*!
+  \file trmFITSheader.cpp
+  \ingroup RM
+  \brief Test program for the cached RM::rmFITSheader model
+
+  \author Sven Duscha (sduscha@mpa-garching.mpg.de)
+  \date 2010-06-12
+*/
+
+#include <iostream>
+#include <math.h>
+#include <rmFITS.h>
+
+using namespace std;
+
+int main ()
+{
+  int nofFailedTests (0);
+  const long nx=8, ny=6, nfreq=5;
+
+  try {
+    cout << "-- create cube trmFITSheader.fits with RA/DEC/FREQ axes ..." << endl;
+    RM::rmFITS fits("!trmFITSheader.fits", READWRITE);
+    vector<int64_t> dimensions(3);
+    dimensions[0]=nx;
+    dimensions[1]=ny;
+    dimensions[2]=nfreq;
+    fits.createImg(-32, dimensions);
+
+    char ra[]="RA---SIN", dec[]="DEC--SIN", freq[]="FREQ", mhz[]="MHz";
+    double crval1=180.0, crval2=45.0, cdelt1=-0.01, cdelt2=0.01, crpix=3.0;
+    double crval3=120.0, cdelt3=0.5, crpix3=1.0;
+    fits.writeKey(TSTRING, "CTYPE1", ra, "");
+    fits.writeKey(TDOUBLE, "CRVAL1", &crval1, "");
+    fits.writeKey(TDOUBLE, "CDELT1", &cdelt1, "");
+    fits.writeKey(TDOUBLE, "CRPIX1", &crpix, "");
+    fits.writeKey(TSTRING, "CTYPE2", dec, "");
+    fits.writeKey(TDOUBLE, "CRVAL2", &crval2, "");
+    fits.writeKey(TDOUBLE, "CDELT2", &cdelt2, "");
+    fits.writeKey(TDOUBLE, "CRPIX2", &crpix, "");
+    fits.writeKey(TSTRING, "CTYPE3", freq, "");
+    fits.writeKey(TSTRING, "CUNIT3", mhz, "");
+    fits.writeKey(TDOUBLE, "CRVAL3", &crval3, "");
+    fits.writeKey(TDOUBLE, "CDELT3", &cdelt3, "");
+    fits.writeKey(TDOUBLE, "CRPIX3", &crpix3, "");
+
+    //________________________________________________________
+    // Model
+
+    cout << "-- check header model ..." << endl;
+    const RM::rmFITSheader &header=fits.getHeader();
+    if(header.getBitpix()!=-32 || header.getNaxis()!=3 || header.getAxes()[2]!=nfreq)
+    {
+      cerr << "image parameters differ" << endl;
+      nofFailedTests++;
+    }
+    if(header.getLongitudeAxis()!=1 || header.getLatitudeAxis()!=2 || header.getSpectralAxis()!=3)
+    {
+      cerr << "axis classification differs" << endl;
+      nofFailedTests++;
+    }
+
+    vector<double> bins=fits.getBins();
+    if(bins.size()!=static_cast<unsigned long>(nfreq) || fabs(bins[4]-122e6) > 1e-3 ||
+       fabs(fits.getBinWidths()[0]-0.5e6) > 1e-3)
+    {
+      cerr << "frequency bins differ" << endl;
+      nofFailedTests++;
+    }
+
+    double lon=0, lat=0;
+    header.pixelToWorld(crpix, crpix, lon, lat);
+    if(fabs(lon-crval1) > 1e-9 || fabs(lat-crval2) > 1e-9)
+    {
+      cerr << "reference pixel does not map to reference value" << endl;
+      nofFailedTests++;
+    }
+
+    //________________________________________________________
+    // Header writes invalidate the model
+
+    cout << "-- check invalidation on header write ..." << endl;
+    string keyname="CRVAL3", comment="";
+    crval3=150.0;
+    fits.updateKey(TDOUBLE, keyname, &crval3, comment);
+    if(fabs(fits.getHeader().getFrequencies()[0]-150e6) > 1e-3)
+    {
+      cerr << "model not updated after updateKey" << endl;
+      nofFailedTests++;
+    }
+  }
+  catch (const char *s) {
+    cerr << s << endl;
+    nofFailedTests++;
+  }
+
+  return nofFailedTests;
+}
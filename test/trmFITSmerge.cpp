@@ -0,0 +1,188 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*!
+  \file trmFITSmerge.cpp
+  \ingroup RM
+  \brief Test program for the RM::rmFITSmerge parallel 2-D to 3-D merge
+
+  \author Sven Duscha (sduscha@mpa-garching.mpg.de)
+  \date 2010-06-16
+*/
+
+#include <iostream>
+#include <cstdio>
+#include <sstream>
+#include <math.h>
+#include <rmFITSmerge.h>
+
+using namespace std;
+
+//! Write a 2-D channel image with a degenerate FREQ axis (if frequency > 0)
+void writeChannel (const string &filename,
+                   int64_t nx,
+                   int64_t ny,
+                   unsigned int channel,
+                   double frequency)
+{
+  RM::rmFITS out("!" + filename, READWRITE);
+  vector<int64_t> dimensions(3);
+  dimensions[0]=nx;
+  dimensions[1]=ny;
+  dimensions[2]=1;
+  out.createImg(-32, dimensions);
+
+  if(frequency > 0)
+  {
+    char ctype[]="FREQ";
+    char cunit[]="MHz";
+    double width=0.5, one=1;
+    out.writeKey(TSTRING, "CTYPE3", ctype, "");
+    out.writeKey(TSTRING, "CUNIT3", cunit, "");
+    out.writeKey(TDOUBLE, "CRVAL3", &frequency, "");
+    out.writeKey(TDOUBLE, "CDELT3", &width, "");
+    out.writeKey(TDOUBLE, "CRPIX3", &one, "");
+  }
+
+  vector<double> plane(nx*ny);
+  for(int64_t i=0; i<nx*ny; i++)
+    plane[i]=1000.0*channel+i;
+  out.writePlane(&plane[0], 1);
+}
+
+int main ()
+{
+  int nofFailedTests (0);
+  const int64_t nx=12, ny=9;
+  const unsigned int nchannels=11;
+  vector<string> list;
+
+  //________________________________________________________
+  // Write the channel images
+
+  try {
+    cout << "-- write " << nchannels << " channel images ..." << endl;
+    for(unsigned int c=0; c<nchannels; c++)
+    {
+      ostringstream filename;
+      filename << "trmFITSmerge_" << c << ".fits";
+      writeChannel(filename.str(), nx, ny, c, 120.0+2.0*c);
+      list.push_back(filename.str());
+    }
+  }
+  catch (const char *s) {
+    cerr << s << endl;
+    return 1;
+  }
+
+  //________________________________________________________
+  // Merge with more images than buffered planes, plain and compressed
+
+  for(int compressed=0; compressed<2; compressed++)
+  {
+    try {
+      cout << "-- merge " << (compressed ? "into compressed cube" : "into cube") << " ..." << endl;
+      RM::rmFITSmerge merger(list, 3, 2);
+      merger.merge("!trmFITSmerge.fits", compressed ? GZIP_2 : 0);
+
+      if(!merger.isLinearFrequencyAxis() || merger.getFrequencies()[3]!=126e6 ||
+         merger.getFrequencyWidths()[3]!=0.5e6)
+      {
+        cerr << "input frequencies differ" << endl;
+        nofFailedTests++;
+      }
+
+      RM::rmFITS in("trmFITSmerge.fits", READONLY);
+      if(compressed)
+        in.moveAbsoluteHDU(2);
+      const RM::rmFITSheader &header=in.getHeader();
+      if(header.getNaxis()!=3 || header.getAxes()[2]!=nchannels)
+      {
+        cerr << "cube dimensions differ" << endl;
+        nofFailedTests++;
+      }
+      if(header.getFrequencies().size()!=nchannels ||
+         fabs(header.getFrequencies()[nchannels-1]-140e6) > 1 ||
+         fabs(header.getCdelt(3)-2e6) > 1e-3)
+      {
+        cerr << "frequency axis differs" << endl;
+        nofFailedTests++;
+      }
+
+      vector<double> plane(nx*ny);
+      for(unsigned int c=0; c<nchannels; c++)
+      {
+        in.readPlane(&plane[0], c+1);
+        if(plane[0]!=1000.0*c || plane[nx*ny-1]!=1000.0*c+nx*ny-1)
+        {
+          cerr << "plane " << c << " differs" << endl;
+          nofFailedTests++;
+        }
+      }
+    }
+    catch (const char *s) {
+      cerr << s << endl;
+      nofFailedTests++;
+    }
+  }
+
+  //________________________________________________________
+  // An image without frequency turns NAXIS3 into a channel axis
+
+  try {
+    cout << "-- merge with an image without frequency ..." << endl;
+    writeChannel(list[4], nx, ny, 4, 0);
+    RM::rmFITSmerge merger(list, 3);
+    merger.merge("!trmFITSmerge.fits");
+
+    RM::rmFITS in("trmFITSmerge.fits", READONLY);
+    const RM::rmFITSheader &header=in.getHeader();
+    if(header.getCtype(3)!="CHANNEL" || header.getFrequencies().size()!=0 ||
+       header.getCrval(3)!=1)
+    {
+      cerr << "axis without frequencies is not marked as channel axis" << endl;
+      nofFailedTests++;
+    }
+  }
+  catch (const char *s) {
+    cerr << s << endl;
+    nofFailedTests++;
+  }
+
+  //________________________________________________________
+  // Images of different size are rejected
+
+  try {
+    cout << "-- merge images of different size ..." << endl;
+    writeChannel(list[5], nx+1, ny, 5, 130.0);
+    RM::rmFITSmerge merger(list, 4);
+    merger.merge("!trmFITSmerge.fits");
+    cerr << "size mismatch was not detected" << endl;
+    nofFailedTests++;
+  }
+  catch (const char *s) {
+  }
+
+  for(unsigned int c=0; c<nchannels; c++)
+    remove(list[c].c_str());
+  remove("trmFITSmerge.fits");
+
+  return nofFailedTests;
+}
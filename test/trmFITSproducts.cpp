@@ -0,0 +1,130 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*!
+  \file trmFITSproducts.cpp
+  \ingroup RM
+  \brief Test program for the RM::rmFITSproducts multi-product writer
+
+  \author Sven Duscha (sduscha@mpa-garching.mpg.de)
+  \date 2010-06-03
+*/
+
+#include <iostream>
+#include <math.h>
+#include <rmFITSproducts.h>
+
+using namespace std;
+
+int main ()
+{
+  int nofFailedTests (0);
+  const uint64_t nx=10, ny=7, nphi=5, tile=4;
+  vector<double> faradayDepths(nphi);
+
+  for(uint64_t i=0; i<nphi; i++)
+    faradayDepths[i]=-10.0+5.0*i;
+
+  //________________________________________________________
+  // Write all products as HDUs of one file, tiles not aligned to bands
+
+  try {
+    cout << "-- write products into trmFITSproducts.fits ..." << endl;
+    RM::rmFITSproducts out("trmFITSproducts", RM::PRODUCT_ALL, nx, ny, faradayDepths, false, 3);
+
+    for(uint64_t y=0; y<ny; y+=tile)
+    {
+      for(uint64_t x=0; x<nx; x+=tile)
+      {
+        uint64_t tx=min(tile, nx-x), ty=min(tile, ny-y);
+        vector<complex<double> > data(nphi*tx*ty);
+        for(uint64_t z=0; z<nphi; z++)
+          for(uint64_t j=0; j<ty; j++)
+            for(uint64_t i=0; i<tx; i++)
+              data[(z*ty+j)*tx+i]=complex<double>(3.0*(z+1), 4.0*((y+j)*nx+x+i));
+        out.writeTile(&data[0], x, y, tx, ty);
+      }
+    }
+    out.close();
+  }
+  catch (const char *s) {
+    cerr << s << endl;
+    nofFailedTests++;
+  }
+
+  //________________________________________________________
+  // Read back one pixel of each product
+
+  try {
+    cout << "-- read back products ..." << endl;
+    RM::rmFITS in("trmFITSproducts.fits", READONLY);
+    const uint64_t x=8, y=5, z=2;
+    double q=3.0*(z+1), u=4.0*(y*nx+x);
+    double expected[4]={q, u, sqrt(q*q+u*u), 0.5*atan2(u, q)};
+    LONGLONG fpixel[3]={x+1, y+1, z+1};
+
+    for(int hdu=1; hdu<=4; hdu++)
+    {
+      double value=0;
+      in.moveAbsoluteHDU(hdu);
+      in.readPix(TDOUBLE, fpixel, 1, &value);
+      if(fabs(value-expected[hdu-1]) > 1e-3*fabs(expected[hdu-1]))
+      {
+        cerr << "product in HDU " << hdu << " differs: " << value << endl;
+        nofFailedTests++;
+      }
+    }
+  }
+  catch (const char *s) {
+    cerr << s << endl;
+    nofFailedTests++;
+  }
+
+  //________________________________________________________
+  // Mixing writeTile and writePlane on one sink is rejected
+
+  try {
+    cout << "-- reject writePlane after writeTile ..." << endl;
+    RM::rmFITSproducts out("trmFITSproducts_mixed", RM::PRODUCT_Q, nx, ny, faradayDepths, false, 3);
+    vector<complex<double> > data(nphi*nx*ny, complex<double>(1.0, 2.0));
+    bool thrown=false;
+
+    out.writeTile(&data[0], 0, 0, nx, 1);
+    try {
+      out.writePlane(&data[0], 0);
+    }
+    catch (const char *) {
+      thrown=true;
+    }
+    if(!thrown)
+    {
+      cerr << "writePlane after writeTile did not throw" << endl;
+      nofFailedTests++;
+    }
+    out.writeTile(&data[0], 0, 1, nx, ny-1);
+    out.close();
+  }
+  catch (const char *s) {
+    cerr << s << endl;
+    nofFailedTests++;
+  }
+
+  return nofFailedTests;
+}
@@ -0,0 +1,150 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*!
+  \file trmFITSreaderPool.cpp
+  \ingroup RM
+  \brief Test program for concurrent reads through RM::rmFITSreaderPool
+
+  \author Sven Duscha (sduscha@mpa-garching.mpg.de)
+  \date 2010-06-07
+*/
+
+#include <iostream>
+#include <rmFITS.h>
+#include <rmFITSreaderPool.h>
+
+using namespace std;
+
+const long nx=32, ny=24, nz=8;
+const unsigned int nthreads=4;
+
+//! value written at (1-based) pixel x, y, z
+double pixelValue(long x, long y, long z)
+{
+  return z*10000.0+y*100.0+x;
+}
+
+//! per-thread work: read all 8x8 sub cubes in rows thread, thread+nthreads, ...
+struct worker {
+  RM::rmFITSreaderPool *pool;
+  unsigned int thread;
+  int nofErrors;
+};
+
+void *readTiles(void *arg)
+{
+  worker *w=static_cast<worker*>(arg);
+  const long tile=8;
+  vector<double> subCube(tile*tile*nz);
+
+  try {
+    for(long y=1+w->thread*tile; y<=ny; y+=nthreads*tile)
+      for(long x=1; x<=nx; x+=tile)
+      {
+        w->pool->readSubCube(&subCube[0], x, y, tile, tile);
+        for(long z=0; z<nz; z++)
+          for(long j=0; j<tile; j++)
+            for(long i=0; i<tile; i++)
+              if(subCube[(z*tile+j)*tile+i]!=pixelValue(x+i, y+j, z+1))
+                w->nofErrors++;
+      }
+  }
+  catch (const char *s) {
+    cerr << s << endl;
+    w->nofErrors++;
+  }
+
+  return NULL;
+}
+
+int main ()
+{
+  int nofFailedTests (0);
+
+  //________________________________________________________
+  // Create test cube
+
+  try {
+    cout << "-- create test cube trmFITSreaderPool.fits ..." << endl;
+    RM::rmFITS out("!trmFITSreaderPool.fits", READWRITE);
+    vector<int64_t> dimensions(3);
+    dimensions[0]=nx;
+    dimensions[1]=ny;
+    dimensions[2]=nz;
+    out.createImg(-32, dimensions);
+
+    vector<double> plane(nx*ny);
+    for(long z=1; z<=nz; z++)
+    {
+      LONGLONG fpixel[3]={1, 1, z};
+      for(long y=1; y<=ny; y++)
+        for(long x=1; x<=nx; x++)
+          plane[(y-1)*nx+x-1]=pixelValue(x, y, z);
+      out.writePix(TDOUBLE, fpixel, nx*ny, &plane[0]);
+    }
+  }
+  catch (const char *s) {
+    cerr << s << endl;
+    return 1;
+  }
+
+  //________________________________________________________
+  // Read sub cubes concurrently from nthreads threads
+
+  try {
+    cout << "-- read sub cubes from " << nthreads << " threads ..." << endl;
+    RM::rmFITSreaderPool pool("trmFITSreaderPool.fits", nthreads);
+    cout << "-- cfitsio reentrant: " << pool.isReentrant() << endl;
+
+    pthread_t threads[nthreads];
+    worker workers[nthreads];
+    for(unsigned int t=0; t<nthreads; t++)
+    {
+      workers[t].pool=&pool;
+      workers[t].thread=t;
+      workers[t].nofErrors=0;
+      pthread_create(&threads[t], NULL, readTiles, &workers[t]);
+    }
+    for(unsigned int t=0; t<nthreads; t++)
+    {
+      pthread_join(threads[t], NULL);
+      if(workers[t].nofErrors)
+      {
+        cerr << "thread " << t << ": " << workers[t].nofErrors << " wrong values" << endl;
+        nofFailedTests++;
+      }
+    }
+
+    vector<double> line(nz);
+    pool.readLine(&line[0], 5, 17);
+    if(line[nz-1]!=pixelValue(5, 17, nz))
+    {
+      cerr << "readLine value differs" << endl;
+      nofFailedTests++;
+    }
+  }
+  catch (const char *s) {
+    cerr << s << endl;
+    nofFailedTests++;
+  }
+
+  return nofFailedTests;
+}
@@ -0,0 +1,198 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*!
+  \file trmFITSspectral.cpp
+  \ingroup RM
+  \brief Test spectral-major ("Faraday axis first") output and the spectrum readers of RM::rmFITS
+
+  \author Sven Duscha (sduscha@mpa-garching.mpg.de)
+  \date 2010-06-14
+
+  Writes the same Faraday cube in plane-major and spectral-major layout and
+  reads lines of sight back through rmFITS::readSpectrum/readSpectra.
+*/
+
+#include <iostream>
+#include <cstdio>
+#include <math.h>
+#include <rmFITSproducts.h>
+
+using namespace std;
+
+int main ()
+{
+  int nofFailedTests (0);
+  const uint64_t nx=9, ny=6, nphi=7, tile=4;
+  const string basename[2]={"trmFITSspectral_plane", "trmFITSspectral_spectral"};
+  vector<double> faradayDepths(nphi);
+
+  for(uint64_t i=0; i<nphi; i++)
+    faradayDepths[i]=-30.0+10.0*i;
+
+  //________________________________________________________
+  // Write Q in both layouts
+
+  for(int layout=0; layout<2; layout++)
+  {
+    try {
+      cout << "-- write " << basename[layout] << "_Q.fits ..." << endl;
+      RM::rmFITSproducts out(basename[layout], RM::PRODUCT_Q, nx, ny, faradayDepths, true, 2, layout==1);
+
+      for(uint64_t y=0; y<ny; y+=tile)
+      {
+        for(uint64_t x=0; x<nx; x+=tile)
+        {
+          uint64_t tx=min(tile, nx-x), ty=min(tile, ny-y);
+          vector<complex<double> > data(nphi*tx*ty);
+          for(uint64_t z=0; z<nphi; z++)
+            for(uint64_t j=0; j<ty; j++)
+              for(uint64_t i=0; i<tx; i++)
+                data[(z*ty+j)*tx+i]=complex<double>(100.0*z+10.0*(y+j)+(x+i), 0);
+          out.writeTile(&data[0], x, y, tx, ty);
+        }
+      }
+      out.close();
+    }
+    catch (const char *s) {
+      cerr << s << endl;
+      nofFailedTests++;
+    }
+  }
+
+  //________________________________________________________
+  // Check layout and WCS of spectral-major cube
+
+  try {
+    cout << "-- check spectral-major header ..." << endl;
+    RM::rmFITS in(basename[1] + "_Q.fits", READONLY);
+    vector<int64_t> dimensions=in.getImageDimensions();
+    const RM::rmFITSheader &header=in.getHeader();
+
+    if(!in.isSpectralMajor() || header.getFaradayAxis()!=1)
+    {
+      cerr << "Faraday axis is not NAXIS1" << endl;
+      nofFailedTests++;
+    }
+    if(dimensions.size()!=3 || dimensions[0]!=(int64_t)nphi ||
+       dimensions[1]!=(int64_t)nx || dimensions[2]!=(int64_t)ny)
+    {
+      cerr << "image dimensions differ" << endl;
+      nofFailedTests++;
+    }
+    if(header.getCrval(1)!=faradayDepths[0] || header.getCdelt(1)!=10.0)
+    {
+      cerr << "Faraday WCS differs" << endl;
+      nofFailedTests++;
+    }
+  }
+  catch (const char *s) {
+    cerr << s << endl;
+    nofFailedTests++;
+  }
+
+  //________________________________________________________
+  // Read lines of sight back from both layouts
+
+  for(int layout=0; layout<2; layout++)
+  {
+    try {
+      cout << "-- read spectra from " << basename[layout] << "_Q.fits ..." << endl;
+      RM::rmFITS in(basename[layout] + "_Q.fits", READONLY);
+
+      if(in.getSpectrumLength()!=(int64_t)nphi)
+      {
+        cerr << "spectrum length differs" << endl;
+        nofFailedTests++;
+      }
+
+      vector<double> spectrum(nphi);
+      in.readSpectrum(&spectrum[0], 6, 5);
+      for(uint64_t z=0; z<nphi; z++)
+        if(spectrum[z]!=100.0*z+10.0*4+5)
+        {
+          cerr << "spectrum at (6,5) differs at z=" << z << ": " << spectrum[z] << endl;
+          nofFailedTests++;
+          break;
+        }
+
+      vector<double> spectra(3*nphi);
+      bool differ=false;
+      in.readSpectra(&spectra[0], 2, 3, 3);
+      for(uint64_t i=0; i<3; i++)
+        for(uint64_t z=0; z<nphi; z++)
+          if(spectra[i*nphi+z]!=100.0*z+10.0*2+(1+i))
+            differ=true;
+      if(differ)
+      {
+        cerr << "spectra of row 3 differ" << endl;
+        nofFailedTests++;
+      }
+
+      // scattered positions, unsorted and with two on the same row
+      const unsigned long px[4]={7, 1, 9, 3}, py[4]={2, 6, 2, 1};
+      vector<unsigned long> xs(px, px+4), ys(py, py+4);
+      vector<double> batch(4*nphi);
+      in.readSpectraAt(xs, ys, &batch[0]);
+      differ=false;
+      for(uint64_t i=0; i<4; i++)
+        for(uint64_t z=0; z<nphi; z++)
+          if(batch[i*nphi+z]!=100.0*z+10.0*(py[i]-1)+(px[i]-1))
+            differ=true;
+      if(differ)
+      {
+        cerr << "spectra at scattered positions differ" << endl;
+        nofFailedTests++;
+      }
+    }
+    catch (const char *s) {
+      cerr << s << endl;
+      nofFailedTests++;
+    }
+  }
+
+  //________________________________________________________
+  // Overwrite one line of sight with writeLine
+
+  try {
+    cout << "-- write line of sight into spectral-major cube ..." << endl;
+    RM::rmFITS io(basename[1] + "_Q.fits", READWRITE);
+    vector<double> line(nphi), back(nphi);
+    for(uint64_t z=0; z<nphi; z++)
+      line[z]=-1.0*z;
+
+    io.writeLine(&line[0], 9, 6);
+    io.readSpectrum(&back[0], 9, 6);
+    if(back!=line)
+    {
+      cerr << "written line of sight differs" << endl;
+      nofFailedTests++;
+    }
+  }
+  catch (const char *s) {
+    cerr << s << endl;
+    nofFailedTests++;
+  }
+
+  for(int layout=0; layout<2; layout++)
+    remove((basename[layout] + "_Q.fits").c_str());
+
+  return nofFailedTests;
+}
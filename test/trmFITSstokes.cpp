@@ -0,0 +1,154 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*!
+  \file trmFITSstokes.cpp
+  \ingroup RM
+  \brief Test reading Q, U and I planes from a 4-D (RA, Dec, Freq, Stokes) cube
+
+  \author Sven Duscha (sduscha@mpa-garching.mpg.de)
+  \date 2010-06-11
+*/
+
+#include <iostream>
+#include <limits>
+#include <rmFITS.h>
+
+using namespace std;
+
+const long nx=6, ny=5, nfreq=4, nstokes=4;
+
+//! value written at (1-based) pixel x, y, channel and Stokes parameter
+double pixelValue(long x, long y, long channel, long stokes)
+{
+  return stokes*100000.0+channel*1000.0+y*10.0+x;
+}
+
+int main ()
+{
+  int nofFailedTests (0);
+
+  //________________________________________________________
+  // Create IQUV cube
+
+  try {
+    cout << "-- create IQUV cube trmFITSstokes.fits ..." << endl;
+    RM::rmFITS out("!trmFITSstokes.fits", READWRITE);
+    vector<int64_t> dimensions(4);
+    dimensions[0]=nx;
+    dimensions[1]=ny;
+    dimensions[2]=nfreq;
+    dimensions[3]=nstokes;
+    out.createImg(-32, dimensions);
+
+    char freq[]="FREQ", stokes[]="STOKES";
+    double one=1.0;
+    out.writeKey(TSTRING, "CTYPE3", freq, "");
+    out.writeKey(TSTRING, "CTYPE4", stokes, "");
+    out.writeKey(TDOUBLE, "CRVAL4", &one, "");
+    out.writeKey(TDOUBLE, "CDELT4", &one, "");
+    out.writeKey(TDOUBLE, "CRPIX4", &one, "");
+
+    vector<double> plane(nx*ny);
+    for(long s=1; s<=nstokes; s++)
+      for(long c=1; c<=nfreq; c++)
+      {
+        LONGLONG fpixel[4]={1, 1, c, s};
+        for(long y=1; y<=ny; y++)
+          for(long x=1; x<=nx; x++)
+            plane[(y-1)*nx+x-1]=pixelValue(x, y, c, s);
+        if(s==2 && c==2)		// blanked Q pixel at 3,4 of channel 2
+          plane[(4-1)*nx+3-1]=numeric_limits<double>::quiet_NaN();
+        out.writePix(TDOUBLE, fpixel, nx*ny, &plane[0]);
+      }
+  }
+  catch (const char *s) {
+    cerr << s << endl;
+    return 1;
+  }
+
+  //________________________________________________________
+  // Read Q, U and I of one channel
+
+  try {
+    cout << "-- read Stokes planes ..." << endl;
+    RM::rmFITS in("trmFITSstokes.fits", READONLY);
+
+    if(in.getStokesAxis()!=4 || in.getSpectralAxis()!=3 || !in.hasStokesQU())
+    {
+      cerr << "Stokes or spectral axis not detected" << endl;
+      nofFailedTests++;
+    }
+
+    vector<double> q(nx*ny), u(nx*ny), i(nx*ny);
+    const long channel=3;
+    in.readStokesPlanes(&q[0], &u[0], channel, &i[0]);
+    for(long y=1; y<=ny; y++)
+      for(long x=1; x<=nx; x++)
+      {
+        long n=(y-1)*nx+x-1;
+        if(q[n]!=pixelValue(x, y, channel, 2) || u[n]!=pixelValue(x, y, channel, 3) ||
+           i[n]!=pixelValue(x, y, channel, 1))
+        {
+          cerr << "Stokes value differs at " << x << "," << y << endl;
+          nofFailedTests++;
+          y=ny;
+          break;
+        }
+      }
+  }
+  catch (const char *s) {
+    cerr << s << endl;
+    nofFailedTests++;
+  }
+
+  //________________________________________________________
+  // Read rows 3 to 5 of Q and U of channel 2 with null flags
+
+  try {
+    cout << "-- read rows of Stokes planes with null flags ..." << endl;
+    RM::rmFITS in("trmFITSstokes.fits", READONLY);
+
+    const long channel=2, y0=3, rows=3;
+    vector<double> q(nx*rows), u(nx*rows);
+    vector<char> qflags(nx*rows), uflags(nx*rows);
+    in.readStokesPlanesFlags(&q[0], &u[0], channel, &qflags[0], &uflags[0], y0, rows);
+    for(long y=y0; y<y0+rows; y++)
+      for(long x=1; x<=nx; x++)
+      {
+        long n=(y-y0)*nx+x-1;
+        bool blanked=(x==3 && y==4);
+        if(qflags[n]!=blanked || uflags[n]!=0 || u[n]!=pixelValue(x, y, channel, 3) ||
+           (!blanked && q[n]!=pixelValue(x, y, channel, 2)))
+        {
+          cerr << "flagged Stokes value differs at " << x << "," << y << endl;
+          nofFailedTests++;
+          y=y0+rows;
+          break;
+        }
+      }
+  }
+  catch (const char *s) {
+    cerr << s << endl;
+    nofFailedTests++;
+  }
+
+  return nofFailedTests;
+}
@@ -0,0 +1,154 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*!
+  \file trmFITStable.cpp
+  \ingroup RM
+  \brief Test program for the RM::rmFITStable catalog writer
+
+  \author Sven Duscha (sduscha@mpa-garching.mpg.de)
+  \date 2010-06-14
+*/
+
+#include <iostream>
+#include <rmFITStable.h>
+
+using namespace std;
+
+int main ()
+{
+  int nofFailedTests (0);
+  const long nsources=10000;
+
+  //________________________________________________________
+  // Write catalog in blocks smaller than the number of rows
+
+  try {
+    cout << "-- write " << nsources << " sources to trmFITStable.fits ..." << endl;
+    RM::rmFITStable table("trmFITStable.fits", true, 999);
+    table.createCatalog();
+
+    RM::rmCatalogEntry entry;
+    for(long i=0; i<nsources; i++)
+    {
+      entry.x=i % 100+1;
+      entry.y=i/100+1;
+      entry.ra=180.0+i*1e-4;
+      entry.dec=45.0;
+      entry.peakRM=i*0.5;
+      entry.peakRMerr=0.1;
+      entry.polInt=1.0;
+      entry.polIntErr=0.01;
+      entry.angle=0.25;
+      entry.angleErr=0.02;
+      entry.ccPhi.assign(i % 4, i*0.5);
+      entry.ccQ.assign(i % 4, 0.5);
+      entry.ccU.assign(i % 4, -0.5);
+      table.writeCatalogEntry(entry);
+    }
+    table.close();
+  }
+  catch (const char *s) {
+    cerr << s << endl;
+    return 1;
+  }
+
+  //________________________________________________________
+  // Read back a scalar and a variable-length array column
+
+  int status=0;
+  fitsfile *fptr=NULL;
+  long nrows=0;
+  fits_open_table(&fptr, "trmFITStable.fits", READONLY, &status);
+  fits_get_num_rows(fptr, &nrows, &status);
+  if(status || nrows!=nsources)
+  {
+    cerr << "number of rows differs: " << nrows << endl;
+    nofFailedTests++;
+  }
+
+  const long row=7003;		// row 7003 is the source with i=7002
+  double peakRM=0;
+  long repeat=0, offset=0;
+  vector<double> ccPhi(4);
+  int anynul=0;
+  fits_read_col(fptr, TDOUBLE, 5, row, 1, 1, NULL, &peakRM, &anynul, &status);
+  fits_read_descript(fptr, 11, row, &repeat, &offset, &status);
+  if(repeat > 0)
+    fits_read_col(fptr, TDOUBLE, 11, row, 1, repeat, NULL, &ccPhi[0], &anynul, &status);
+  if(status || peakRM!=7002*0.5 || repeat!=7002 % 4 || ccPhi[0]!=7002*0.5)
+  {
+    cerr << "catalog values differ" << endl;
+    nofFailedTests++;
+  }
+  fits_close_file(fptr, &status);
+
+  //________________________________________________________
+  // Fixed-length vector column between scalar columns
+
+  try {
+    cout << "-- write a fixed-length vector column ..." << endl;
+    RM::rmFITStable table("trmFITStable.fits", true, 4);
+    table.addColumn("X", "K", "pixel");
+    table.addColumn("SPECTRUM", "3D", "Jy/beam");
+    table.addColumn("PEAK", "D", "Jy/beam");
+    table.create("SPECTRA");
+
+    vector<double> spectrum(3);
+    for(long i=0; i<10; i++)
+    {
+      for(long k=0; k<3; k++)
+        spectrum[k]=10*i+k;
+      table.setInteger(0, i);
+      table.setArray(1, spectrum);
+      table.setValue(2, 0.5*i);
+      table.nextRow();
+    }
+    try {
+      spectrum.resize(2);
+      table.setArray(1, spectrum);
+      cerr << "array of wrong length was accepted" << endl;
+      nofFailedTests++;
+    }
+    catch (const char *s) {
+    }
+    table.close();
+
+    status=0;
+    fits_open_table(&fptr, "trmFITStable.fits", READONLY, &status);
+    fits_get_num_rows(fptr, &nrows, &status);
+    vector<double> cells(6);
+    double peak=0;
+    fits_read_col(fptr, TDOUBLE, 2, 6, 1, 6, NULL, &cells[0], &anynul, &status);	// rows 6 and 7
+    fits_read_col(fptr, TDOUBLE, 3, 7, 1, 1, NULL, &peak, &anynul, &status);
+    if(status || nrows!=10 || cells[0]!=50 || cells[2]!=52 || cells[3]!=60 || cells[5]!=62 || peak!=3)
+    {
+      cerr << "fixed-length vector column differs" << endl;
+      nofFailedTests++;
+    }
+    fits_close_file(fptr, &status);
+  }
+  catch (const char *s) {
+    cerr << s << endl;
+    nofFailedTests++;
+  }
+
+  return nofFailedTests;
+}
@@ -0,0 +1,123 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*!
+  \file trmHDF5.cpp
+  \ingroup RM
+  \brief Test program for the RM::rmHDF5 Faraday cube storage
+
+  \author Sven Duscha (sduscha@mpa-garching.mpg.de)
+  \date 2010-06-01
+*/
+
+#include <iostream>
+#include <rmHDF5.h>
+
+using namespace std;
+
+int main ()
+{
+  int nofFailedTests (0);
+  const unsigned long nx=20, ny=12, nphi=16;
+  vector<double> faradayDepths(nphi);
+  vector<complex<double> > plane(nx*ny);
+
+  for(unsigned long i=0; i<nphi; i++)
+    faradayDepths[i]=-40.0+5.0*i;
+
+  //________________________________________________________
+  // Write cube plane by plane with compressed 8x8 chunks
+
+  try {
+    cout << "-- write Faraday cube trmHDF5.h5 ..." << endl;
+    RM::rmHDF5 out("trmHDF5.h5", 2);
+    out.setChunkShape(8, 8);
+    out.setCompression(4);
+    out.createFaradayCube(nx, ny, faradayDepths);
+
+    for(unsigned long z=0; z<nphi; z++)
+    {
+      for(unsigned long i=0; i<nx*ny; i++)
+        plane[i]=complex<double>(z*1000.0+i, -1.0*i);
+      out.writePlane(&plane[0], z);
+    }
+
+    vector<double> map(nx*ny, 3.0);
+    out.writeMap("PeakRM", &map[0]);
+  }
+  catch (const char *s) {
+    cerr << s << endl;
+    nofFailedTests++;
+  }
+
+  //________________________________________________________
+  // Read back lines of sight, tiles and maps
+
+  try {
+    cout << "-- read Faraday cube trmHDF5.h5 ..." << endl;
+    RM::rmHDF5 in("trmHDF5.h5", 0);
+
+    if(in.getX()!=nx || in.getY()!=ny || in.getFaradaySize()!=nphi)
+    {
+      cerr << "dimensions differ" << endl;
+      nofFailedTests++;
+    }
+    if(in.readFaradayDepths()!=faradayDepths)
+    {
+      cerr << "Faraday depths differ" << endl;
+      nofFailedTests++;
+    }
+
+    vector<complex<double> > line(nphi);
+    unsigned long x=13, y=5;
+    in.readLine(&line[0], x, y);
+    for(unsigned long z=0; z<nphi; z++)
+    {
+      if(line[z]!=complex<double>(z*1000.0+y*nx+x, -1.0*(y*nx+x)))
+      {
+        cerr << "readLine value differs at z=" << z << endl;
+        nofFailedTests++;
+        break;
+      }
+    }
+
+    vector<complex<double> > tile(nphi*3*2);
+    in.readTile(&tile[0], 4, 6, 3, 2);
+    if(tile[(nphi-1)*6+5]!=complex<double>((nphi-1)*1000.0+7*nx+6, -1.0*(7*nx+6)))
+    {
+      cerr << "readTile value differs" << endl;
+      nofFailedTests++;
+    }
+
+    vector<double> map(nx*ny);
+    in.readMap("PeakRM", &map[0]);
+    if(map[nx*ny-1]!=3.0)
+    {
+      cerr << "readMap value differs" << endl;
+      nofFailedTests++;
+    }
+  }
+  catch (const char *s) {
+    cerr << s << endl;
+    nofFailedTests++;
+  }
+
+  return nofFailedTests;
+}
@@ -0,0 +1,235 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*!
+  \file trmNpy.cpp
+  \ingroup RM
+  \brief Test program for RM::rmNpy and the .npy/text readers of RM::rmIO
+
+  \author Sven Duscha (sduscha@mpa-garching.mpg.de)
+  \date 2010-06-17
+*/
+
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <complex>
+#include <rmNpy.h>
+#include <rmIO.h>
+
+using namespace std;
+
+int main ()
+{
+  int nofFailedTests (0);
+  const unsigned int n=257;
+
+  //________________________________________________________
+  // Write and map a 2-D float64 array
+
+  try {
+    cout << "-- rows x 3 float64 array ..." << endl;
+    vector<double> table(3*n);
+    for(unsigned int i=0; i<3*n; i++)
+      table[i]=0.5*i-10;
+    RM::rmNpy::write("trmNpy_table.npy", &table[0], n, 3);
+
+    RM::rmNpy array("trmNpy_table.npy");
+    if(array.getShape().size()!=2 || array.getNumRows()!=n ||
+       array.getNumColumns()!=3 || array.isComplex() || array.isFortranOrder())
+    {
+      cerr << "array header differs" << endl;
+      nofFailedTests++;
+    }
+    if(reinterpret_cast<size_t>(array.getData()) % 64)
+    {
+      cerr << "array data is not 64-byte aligned" << endl;
+      nofFailedTests++;
+    }
+
+    vector<double> column;
+    array.copyColumn(2, column);
+    bool differ=(column.size()!=n);
+    for(unsigned int r=0; r<column.size(); r++)
+      if(column[r]!=table[3*r+2])
+        differ=true;
+    if(differ)
+    {
+      cerr << "column 2 differs" << endl;
+      nofFailedTests++;
+    }
+  }
+  catch (const char *s) {
+    cerr << s << endl;
+    nofFailedTests++;
+  }
+
+  //________________________________________________________
+  // Fortran order complex array written by hand
+
+  try {
+    cout << "-- Fortran order complex128 array ..." << endl;
+    const char header[]="{'descr': '<c16', 'fortran_order': True, 'shape': (4, 2), }";
+    string dict(header);
+    dict.append(128-10-dict.size()-1, ' ');
+    dict+='\n';
+    ofstream out("trmNpy_fortran.npy", ios::binary);
+    out.write("\x93NUMPY\x01\x00", 8);
+    out.put(static_cast<char>(dict.size() & 0xff));
+    out.put(static_cast<char>(dict.size() >> 8));
+    out << dict;
+    // column-major: element (r, c) = complex(10*r+c, -(10*r+c))
+    for(unsigned int c=0; c<2; c++)
+      for(unsigned int r=0; r<4; r++)
+      {
+        double value[2]={10.0*r+c, -(10.0*r+c)};
+        out.write(reinterpret_cast<const char*>(value), sizeof(value));
+      }
+    out.close();
+
+    RM::rmNpy array("trmNpy_fortran.npy");
+    vector<double> imag;
+    array.copyColumn(3, imag);	// imaginary part of column 1
+    if(array.getNumColumns()!=4 || imag.size()!=4 || imag[0]!=-1 || imag[3]!=-31)
+    {
+      cerr << "Fortran order column differs" << endl;
+      nofFailedTests++;
+    }
+  }
+  catch (const char *s) {
+    cerr << s << endl;
+    nofFailedTests++;
+  }
+
+  //________________________________________________________
+  // rmIO round trips through .npy and text
+
+  try {
+    cout << "-- rmIO .npy and text round trips ..." << endl;
+    RM::rmIO io;
+    vector<double> phi(n);
+    vector<complex<double> > rmsf(n);
+    for(unsigned int i=0; i<n; i++)
+    {
+      phi[i]=i-128.0;
+      rmsf[i]=complex<double>(1.0/(i+1), -0.25*i);
+    }
+
+    const char *names[]={"trmNpy_rmsf.npy", "trmNpy_rmsf.dat"};
+    for(unsigned int f=0; f<2; f++)
+    {
+      vector<double> phiRead;
+      vector<complex<double> > rmsfRead;
+      io.writeRMSFtoFile(phi, rmsf, names[f]);
+      io.readRMSFfromFile(phiRead, rmsfRead, names[f]);
+
+      // text is written with 6 significant digits
+      double tolerance=(f==0) ? 0 : 1e-5;
+      bool differ=(phiRead.size()!=n || rmsfRead.size()!=n);
+      for(unsigned int i=0; i<phiRead.size() && i<n; i++)
+        if(phiRead[i]!=phi[i] || abs(rmsfRead[i]-rmsf[i]) > tolerance*abs(rmsf[i]))
+          differ=true;
+      if(differ)
+      {
+        cerr << names[f] << ": RMSF round trip differs" << endl;
+        nofFailedTests++;
+      }
+    }
+
+    // complex vector as complex128 .npy
+    io.writeRMtoFile(rmsf, "trmNpy_complex.npy");
+    vector<complex<double> > polint;
+    io.readPolIntensitiesFromFile("trmNpy_complex.npy", polint);
+    if(polint!=rmsf)
+    {
+      cerr << "complex128 round trip differs" << endl;
+      nofFailedTests++;
+    }
+
+    // text with trailing newline and blank lines yields exactly the values
+    ofstream text("trmNpy_vector.txt");
+    text << "1.5\n  -2e3\t\n\n3\n\n";
+    text.close();
+    vector<double> v;
+    io.readVectorFromFile(v, "trmNpy_vector.txt");
+    if(v.size()!=3 || v[0]!=1.5 || v[1]!=-2000 || v[2]!=3)
+    {
+      cerr << "text vector differs" << endl;
+      nofFailedTests++;
+    }
+
+    // frequencies with deltas to the next channel, the last one repeated
+    ofstream freqs("trmNpy_freqs.txt");
+    freqs << "100e6\n102e6\n\n105e6\n";
+    freqs.close();
+    vector<double> frequencies, deltas;
+    io.readFrequenciesDiffFrequencies("trmNpy_freqs.txt", frequencies, deltas);
+    if(frequencies.size()!=3 || frequencies[2]!=105e6 || deltas.size()!=3 ||
+       deltas[0]!=2e6 || deltas[1]!=3e6 || deltas[2]!=3e6)
+    {
+      cerr << "frequencies and delta frequencies differ" << endl;
+      nofFailedTests++;
+    }
+  }
+  catch (const char *s) {
+    cerr << s << endl;
+    nofFailedTests++;
+  }
+
+  //________________________________________________________
+  // Malformed input must throw
+
+  try {
+    cout << "-- reject wrong column count ..." << endl;
+    RM::rmIO io;
+    vector<double> v1, v2;
+    io.read2VectorsFromFile(v1, v2, "trmNpy_table.npy");
+    cerr << "3-column array read as 2 columns" << endl;
+    nofFailedTests++;
+  }
+  catch (const char *s) {
+  }
+
+  try {
+    cout << "-- reject unparsable text ..." << endl;
+    ofstream text("trmNpy_bad.txt");
+    text << "1.0 2.0x\n";
+    text.close();
+    RM::rmIO io;
+    vector<double> v;
+    io.readVectorFromFile(v, "trmNpy_bad.txt");
+    cerr << "unparsable value accepted" << endl;
+    nofFailedTests++;
+  }
+  catch (const char *s) {
+  }
+
+  remove("trmNpy_table.npy");
+  remove("trmNpy_fortran.npy");
+  remove("trmNpy_rmsf.npy");
+  remove("trmNpy_rmsf.dat");
+  remove("trmNpy_complex.npy");
+  remove("trmNpy_vector.txt");
+  remove("trmNpy_freqs.txt");
+  remove("trmNpy_bad.txt");
+
+  return nofFailedTests;
+}
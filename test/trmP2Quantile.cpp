@@ -0,0 +1,141 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*!
+  \file trmP2Quantile.cpp
+  \ingroup RM
+  \brief Test program for the streaming quantile estimate RM::rmP2Quantile
+
+  \author Sven Duscha (sduscha@mpa-garching.mpg.de)
+  \date 2010-06-18
+*/
+
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <rmP2Quantile.h>
+
+using namespace std;
+
+//! Exact p-quantile of values by sorting
+double exactQuantile (vector<double> values,
+                      double p)
+{
+  sort(values.begin(), values.end());
+  return values[static_cast<unsigned int>(p*(values.size()-1))];
+}
+
+int main ()
+{
+  int nofFailedTests (0);
+  const unsigned int n=20000;
+
+  srand(42);
+  vector<double> gauss(n);
+  for(unsigned int i=0; i<n; i++)		// Box-Muller
+  {
+    double u1=(rand()+1.0)/(RAND_MAX+2.0), u2=rand()/(RAND_MAX+1.0);
+    gauss[i]=sqrt(-2*log(u1))*cos(2*M_PI*u2);
+  }
+
+  //________________________________________________________
+  // Quantiles of a Gaussian stream
+
+  try {
+    cout << "-- quantiles of " << n << " Gaussian values ..." << endl;
+    double quantiles[3]={0.5, 0.1, 0.9};
+    for(unsigned int k=0; k<3; k++)
+    {
+      RM::rmP2Quantile estimate(quantiles[k]);
+      for(unsigned int i=0; i<n; i++)
+        estimate.add(gauss[i]);
+
+      double exact=exactQuantile(gauss, quantiles[k]);
+      if(estimate.getCount()!=n || fabs(estimate.get()-exact) > 0.02)
+      {
+        cerr << quantiles[k] << "-quantile differs: " << estimate.get() << " != " << exact << endl;
+        nofFailedTests++;
+      }
+    }
+
+    // MAD of |x| of a Gaussian stream gives its sigma
+    RM::rmP2Quantile median;
+    for(unsigned int i=0; i<n; i++)
+      median.add(fabs(gauss[i]));
+    if(fabs(1.4826*median.get()-1) > 0.03)
+    {
+      cerr << "sigma from MAD differs: " << 1.4826*median.get() << endl;
+      nofFailedTests++;
+    }
+  }
+  catch (const char *s) {
+    cerr << s << endl;
+    nofFailedTests++;
+  }
+
+  //________________________________________________________
+  // Sorted input, few values and reset
+
+  try {
+    cout << "-- sorted input, few values and reset ..." << endl;
+    RM::rmP2Quantile median;
+    for(unsigned int i=0; i<1001; i++)
+      median.add(1000-i);
+    if(fabs(median.get()-500) > 5)
+    {
+      cerr << "median of a sorted stream differs: " << median.get() << endl;
+      nofFailedTests++;
+    }
+
+    median.reset();
+    if(median.getCount()!=0 || median.get()!=0)
+    {
+      cerr << "reset estimator is not empty" << endl;
+      nofFailedTests++;
+    }
+    median.add(3);
+    median.add(1);
+    median.add(2);
+    if(median.get()!=2)
+    {
+      cerr << "median of three values differs: " << median.get() << endl;
+      nofFailedTests++;
+    }
+  }
+  catch (const char *s) {
+    cerr << s << endl;
+    nofFailedTests++;
+  }
+
+  //________________________________________________________
+  // Invalid quantile
+
+  try {
+    RM::rmP2Quantile invalid(1.0);
+    cerr << "p=1 was accepted" << endl;
+    nofFailedTests++;
+  }
+  catch (const char *s) {
+  }
+
+  return nofFailedTests;
+}
@@ -0,0 +1,170 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*!
+  \file trmPeakFinder.cpp
+  \ingroup RM
+  \brief Test program for the incremental peak search RM::rmPeakFinder
+
+  \author Sven Duscha (sduscha@mpa-garching.mpg.de)
+  \date 2010-06-18
+*/
+
+#include <iostream>
+#include <cstdlib>
+#include <complex>
+#include <vector>
+#include <rmPeakFinder.h>
+
+using namespace std;
+
+//! Position of the largest |F|^2 by a full search
+unsigned int bruteForce (const vector<complex<double> > &data)
+{
+  unsigned int maxpos=0;
+  for(unsigned int i=1; i<data.size(); i++)
+    if(norm(data[i]) > norm(data[maxpos]))
+      maxpos=i;
+  return maxpos;
+}
+
+int main ()
+{
+  int nofFailedTests (0);
+  const unsigned int n=1000;		// not a multiple of the block size
+
+  srand(42);
+  vector<complex<double> > data(n);
+  for(unsigned int i=0; i<n; i++)
+    data[i]=complex<double>(rand()/(double)RAND_MAX-0.5, rand()/(double)RAND_MAX-0.5);
+
+  //________________________________________________________
+  // Build and compare against a full search
+
+  try {
+    cout << "-- build ..." << endl;
+    RM::rmPeakFinder finder(64);
+    finder.build(&data[0], n);
+    if(finder.getPeakPos()!=bruteForce(data) || finder.getPeakPower()!=norm(data[bruteForce(data)]))
+    {
+      cerr << "peak after build differs" << endl;
+      nofFailedTests++;
+    }
+
+    //______________________________________________________
+    // CLEAN-like updates: reduce the peak and perturb a range around it
+
+    cout << "-- incremental updates ..." << endl;
+    for(unsigned int k=0; k<500; k++)
+    {
+      unsigned int pos=finder.getPeakPos();
+      unsigned int first=pos > 100 ? pos-100 : 0;
+      unsigned int last=pos+100 < n ? pos+100 : n;
+      data[pos]*=0.5;
+      for(unsigned int i=first; i<last; i++)
+        data[i]+=complex<double>(0.01*(rand()/(double)RAND_MAX-0.5), 0);
+      finder.update(&data[0], first, last);
+
+      if(finder.getPeakPos()!=bruteForce(data))
+      {
+        cerr << "peak differs after update " << k << endl;
+        nofFailedTests++;
+        break;
+      }
+    }
+
+    // ties resolve to the first position, as with max_element
+    vector<complex<double> > flat(n, complex<double>(1, 1));
+    finder.build(&flat[0], n);
+    if(finder.getPeakPos()!=0)
+    {
+      cerr << "tie not resolved to first position" << endl;
+      nofFailedTests++;
+    }
+    flat[700]=complex<double>(2, 0);
+    finder.update(&flat[0], 700, 701);
+    flat[700]=complex<double>(0, 0);
+    finder.update(&flat[0], 650, 701);
+    if(finder.getPeakPos()!=0)
+    {
+      cerr << "peak not restored after update" << endl;
+      nofFailedTests++;
+    }
+  }
+  catch (const char *s) {
+    cerr << s << endl;
+    nofFailedTests++;
+  }
+
+  //________________________________________________________
+  // Split real/imaginary input gives the same peaks
+
+  try {
+    cout << "-- split real and imaginary parts ..." << endl;
+    vector<double> re(n), im(n);
+    for(unsigned int i=0; i<n; i++)
+    {
+      re[i]=data[i].real();
+      im[i]=data[i].imag();
+    }
+    RM::rmPeakFinder finder(64);
+    finder.build(&re[0], &im[0], n);
+    for(unsigned int k=0; k<100; k++)
+    {
+      unsigned int pos=finder.getPeakPos();
+      if(pos!=bruteForce(data))
+      {
+        cerr << "split peak differs after update " << k << endl;
+        nofFailedTests++;
+        break;
+      }
+      data[pos]*=0.5;
+      re[pos]*=0.5;
+      im[pos]*=0.5;
+      finder.update(&re[0], &im[0], pos, pos+1);
+    }
+  }
+  catch (const char *s) {
+    cerr << s << endl;
+    nofFailedTests++;
+  }
+
+  //________________________________________________________
+  // Single element and invalid ranges
+
+  try {
+    cout << "-- single element ..." << endl;
+    RM::rmPeakFinder finder(4);
+    complex<double> one(3, 4);
+    finder.build(&one, 1);
+    if(finder.getPeakPos()!=0 || finder.getPeakPower()!=25)
+    {
+      cerr << "single element peak differs" << endl;
+      nofFailedTests++;
+    }
+    finder.update(&one, 0, 2);
+    cerr << "range beyond length accepted" << endl;
+    nofFailedTests++;
+  }
+  catch (const char *s) {
+  }
+
+  return nofFailedTests;
+}
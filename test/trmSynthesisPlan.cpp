@@ -0,0 +1,118 @@
+/***************************************************************************
+ *   Copyright (C) 2010                                                    *
+ *   Sven Duscha (sduscha@mpa-garching.mpg.de)                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*!
+  \file trmSynthesisPlan.cpp
+  \ingroup RM
+  \brief Test RM-Synthesis with validity masks and plans cached per flag pattern
+
+  \author Sven Duscha (sduscha@mpa-garching.mpg.de)
+  \date 2010-06-16
+*/
+
+#include <iostream>
+#include <math.h>
+#include <rmSynthesisPlan.h>
+
+using namespace std;
+
+int main ()
+{
+  int nofFailedTests (0);
+  const uint64_t nchan=70, npix=6, nphi=21;	// more than 64 channels: two words per pattern
+
+  vector<double> lambdaSq(nchan), weights(nchan, 1.0), deltaLambdaSq(nchan, 0.001), phis(nphi);
+  for(uint64_t c=0; c<nchan; c++)
+    lambdaSq[c]=0.5+0.001*c;
+  for(uint64_t i=0; i<nphi; i++)
+    phis[i]=-50.0+5.0*i;
+
+  // Q/U planes [channel][pixel], pixel p has RM 10*p
+  vector<double> q(nchan*npix), u(nchan*npix);
+  for(uint64_t c=0; c<nchan; c++)
+    for(uint64_t p=0; p<npix; p++)
+    {
+      q[c*npix+p]=cos(2*10.0*p*lambdaSq[c]);
+      u[c*npix+p]=sin(2*10.0*p*lambdaSq[c]);
+    }
+
+  // pixel 1: RFI channels 3 and 66, pixel 2: blank, pixels 3 and 4: same pattern as 1
+  RM::rmValidityMask mask(npix, nchan);
+  for(uint64_t p=1; p<5; p++)
+  {
+    mask.set(p, 3, false);
+    mask.set(p, 66, false);
+  }
+  for(uint64_t c=0; c<nchan; c++)
+    mask.set(2, c, false);
+  q[3*npix+1]=u[3*npix+1]=1e6;		// flagged samples must not contribute
+
+  try {
+    cout << "-- synthesize tile with flagged channels ..." << endl;
+    RM::rmSynthesisPlanCache cache(phis, lambdaSq, weights, deltaLambdaSq);
+    vector<complex<double> > out(nphi*npix);
+    cache.synthesize(&q[0], &u[0], mask, &out[0]);
+
+    if(cache.getNumPlans()!=2)
+    {
+      cerr << "expected 2 plans (complete, RFI-flagged), got " << cache.getNumPlans() << endl;
+      nofFailedTests++;
+    }
+    for(uint64_t i=0; i<nphi; i++)
+      if(out[i*npix+2]!=complex<double>(0, 0))
+      {
+        cerr << "blank line of sight has non-zero output" << endl;
+        nofFailedTests++;
+        break;
+      }
+
+    // direct sum over valid channels with K=1/sum(w) of valid channels
+    for(uint64_t p=0; p<npix; p++)
+    {
+      if(p==2)
+        continue;
+      double K=0;
+      for(uint64_t c=0; c<nchan; c++)
+        if(mask.isValid(p, c))
+          K+=weights[c];
+      for(uint64_t i=0; i<nphi; i++)
+      {
+        complex<double> expected=0;
+        for(uint64_t c=0; c<nchan; c++)
+          if(mask.isValid(p, c))
+            expected+=weights[c]*deltaLambdaSq[c]*complex<double>(q[c*npix+p], u[c*npix+p])*
+                      polar(1.0, -2.0*phis[i]*lambdaSq[c]);
+        expected/=K;
+        if(abs(out[i*npix+p]-expected) > 1e-12)
+        {
+          cerr << "pixel " << p << " phi " << phis[i] << " differs" << endl;
+          nofFailedTests++;
+          i=nphi;
+        }
+      }
+    }
+  }
+  catch (const char *s) {
+    cerr << s << endl;
+    nofFailedTests++;
+  }
+
+  return nofFailedTests;
+}